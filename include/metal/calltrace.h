@@ -8,6 +8,13 @@
 
 
  This header provides the C version of the test macros.
+
+ If calltrace is compiled with `METAL_CALLTRACE_BUFFER_SIZE` defined to a value greater than zero, the function calls
+ are recorded in a buffer of that many entries, which the debugger reads when it is full,
+ a calltrace is set or reset or the program exits. This avoids a debugger stop for every function call.
+
+ If calltrace is compiled with `METAL_CALLTRACE_TARGET_CHECK` defined, the function calls are only verified by the target
+ and not passed to the debugger at all, which is meant for `--metal-calltrace-target-check`.
  */
 #ifndef METAL_CALLTRACE_H_
 #define METAL_CALLTRACE_H_
@@ -93,6 +100,10 @@ static int METAL_NO_INSTRUMENT metal_calltrace_init(metal_calltrace * ct)
     ct->repeated = 0;
     ct->current_position = 0;
     ct->start_depth = -1;
+    ct->error_type = metal_calltrace_no_error;
+    ct->error_position = -1;
+    ct->error_fn = 0;
+    ct->thread = 0;
 
     return __metal_set_calltrace(ct);
 }
@@ -738,7 +738,7 @@ public:
      */
     template<typename Func>
     inline METAL_NO_INSTRUMENT calltrace(Func func, int repeat, int skip)
-        : metal_calltrace_{detail::func_cast(func), _funcs, static_cast<int>(Size), repeat, skip, skip, 0, 0, 0, -1},
+        : metal_calltrace_{detail::func_cast(func), _funcs, static_cast<int>(Size), repeat, skip, skip, 0, 0, 0, -1, metal_calltrace_no_error, -1, nullptr, 0ul},
           _funcs{nullptr},
           _inited{__metal_set_calltrace(this) != 0}
     {
@@ -765,7 +765,7 @@ public:
      */
     template<typename Func, typename ...Args>
     inline METAL_NO_INSTRUMENT calltrace(Func func, int repeat, int skip, Args... args)
-        : metal_calltrace_{detail::func_cast(func), _funcs, static_cast<int>(Size), repeat, skip, skip, 0, 0, 0, -1},
+        : metal_calltrace_{detail::func_cast(func), _funcs, static_cast<int>(Size), repeat, skip, skip, 0, 0, 0, -1, metal_calltrace_no_error, -1, nullptr, 0ul},
           _funcs{detail::func_cast(args)...},
           _inited{__metal_set_calltrace(this) != 0}
     {
@@ -829,7 +829,7 @@ public:
      */
     template<typename Func>
     inline METAL_NO_INSTRUMENT calltrace(Func func, int repeat, int skip)
-        : metal_calltrace_{detail::func_cast(func), &_funcs, 0, repeat, skip, skip, 0, 0, 0, -1},
+        : metal_calltrace_{detail::func_cast(func), &_funcs, 0, repeat, skip, skip, 0, 0, 0, -1, metal_calltrace_no_error, -1, nullptr, 0ul},
           _inited{__metal_set_calltrace(this) != 0}
     {
     }
@@ -16,13 +16,19 @@ to asser the correctness of the function signatures and linkage.
 
 #include <vector>
 #include <memory>
+#include <string>
 #include <boost/program_options/options_description.hpp>
 #include <metal/debug/break_point.hpp>
+#include <metal/debug/sampler.hpp>
 
 ///This function is the central function needed to provide a break-point plugin.
 extern "C" BOOST_SYMBOL_EXPORT void metal_dbg_setup_bps(std::vector<std::unique_ptr<metal::debug::break_point>> & bps);
 ///This function can be used to add program options for the plugin.
 extern "C" BOOST_SYMBOL_EXPORT void metal_dbg_setup_options(boost::program_options::options_description & po);
+///This function is optional and provides samplers, which are invoked when the program gets interrupted periodically.
+extern "C" BOOST_SYMBOL_EXPORT void metal_dbg_setup_samplers(std::vector<std::unique_ptr<metal::debug::sampler>> & samplers);
+///This function is optional and receives the arguments of the runner, i.e. to launch further instances of it.
+extern "C" BOOST_SYMBOL_EXPORT void metal_dbg_setup_args(const std::vector<std::string> & args);
 
 
 #endif /* METAL_GDB_PLUGIN_HPP_ */
@@ -17,6 +17,7 @@
 #include <boost/asio/deadline_timer.hpp>
 
 #include <metal/debug/break_point.hpp>
+#include <metal/debug/sampler.hpp>
 #include <metal/debug/interpreter.hpp>
 
 #include <boost/process/child.hpp>
@@ -60,6 +61,7 @@ protected:
     std::vector<std::uint64_t> _thread_id;
     std::vector<std::string> _args;
     std::vector<std::unique_ptr<break_point>> _break_points;
+    std::vector<std::unique_ptr<sampler>> _samplers;
     bool _exited = false;
     void _set_timer();
     virtual void _terminate()
@@ -67,13 +69,15 @@ protected:
         BOOST_THROW_EXCEPTION( std::runtime_error("metal::gdb::process panic!") );
     }
     virtual void _run_impl(boost::asio::yield_context &yield) = 0;
+    ///For a backend that does not launch a debugger process.
+    process() = default;
 
 public:
 
     void set_init_script(      std::vector<std::string> && init_scripts) {_init_scripts = std::move(init_scripts);}
     void set_init_scripts(const std::vector<std::string> &  init_scripts) {_init_scripts = init_scripts;}
 
-    bool running() {return _child.running();}
+    virtual bool running() {return _child.running();}
     void set_exit(int code)
     {
         _exited=true;
@@ -115,6 +119,11 @@ public:
         for (auto & in : ptrs)
             _break_points.emplace_back(in.release());
     }
+    void add_samplers(std::vector<std::unique_ptr<sampler>> && ptrs)
+    {
+        for (auto & in : ptrs)
+            _samplers.emplace_back(in.release());
+    }
     virtual void run();
 };
 
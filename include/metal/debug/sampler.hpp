@@ -0,0 +1,49 @@
+/**
+ * @file   metal/debug/sampler.hpp
+ * @date   19.10.2026
+ * @author Klemens D. Morgenstern
+ *
+
+ */
+
+#ifndef METAL_DEBUG_SAMPLER_HPP_
+#define METAL_DEBUG_SAMPLER_HPP_
+
+#include <metal/debug/frame.hpp>
+#include <chrono>
+#include <cstdint>
+
+namespace metal {
+namespace debug {
+
+/** This class is used to implement a sampler, i.e. a plugin that gets invoked when the program is interrupted periodically.
+ * In contrast to a break_point it does not require any change of the program.
+ */
+class sampler
+{
+    std::chrono::microseconds _interval;
+public:
+    /**Construct the sampler.
+     *
+     * @param interval The time the program runs, before it gets interrupted for the next sample.
+     */
+    sampler(std::chrono::microseconds interval) : _interval(interval) {}
+
+    ///The interval the sampler wants to be invoked with.
+    std::chrono::microseconds interval() const {return _interval;}
+
+    /**This function will be called when the program was interrupted.
+     *
+     * @param fr The frame the program was interrupted in.
+     * @param pc The address the program was interrupted at, as obtained from the stop without further requests.
+     */
+    virtual void sample(frame & fr, std::uint64_t pc) = 0;
+
+    ///Destructor
+    virtual ~sampler() = default;
+};
+
+} /* namespace debug */
+} /* namespace metal */
+
+#endif /* METAL_DEBUG_SAMPLER_HPP_ */
@@ -12,6 +12,7 @@
 
 #include <boost/asio/streambuf.hpp>
 #include <boost/asio/spawn.hpp>
+#include <boost/asio/deadline_timer.hpp>
 #include <boost/process/async_pipe.hpp>
 #include <boost/signals2/signal.hpp>
 
@@ -101,6 +102,7 @@ class BOOST_SYMBOL_EXPORT interpreter : public metal::debug::interpreter_impl
     void _work(std::uint64_t token, result_class rc);
   //  void _work(const std::function<void(const result_output&)> & func);
     void _work(std::uint64_t, const std::function<void(const result_output&)> & func);
+    void _work(std::uint64_t token, bool & pending);
 
     void _handle_record(const std::string& line, const boost::optional<std::uint64_t> &token, const result_output & sr);
     void _handle_record(const std::string& line, const boost::optional<std::uint64_t> &token, const result_output & sr,
@@ -109,6 +111,8 @@ class BOOST_SYMBOL_EXPORT interpreter : public metal::debug::interpreter_impl
 //                        const std::function<void(const result_output&)> & func);
     void _handle_record(const std::string& line, const boost::optional<std::uint64_t> &token, const result_output & sr,
                         std::uint64_t expected_token, const std::function<void(const result_output&)> & func);
+    void _handle_record(const std::string& line, const boost::optional<std::uint64_t> &token, const result_output & sr,
+                        std::uint64_t expected_token, bool & pending);
 
     std::vector<std::pair<std::uint64_t, std::function<bool(const async_output &)>>> _pending_asyncs;
 public:
@@ -123,6 +127,10 @@ public:
     async_record_handler_t async_record_handler{_async_sink};
 
     async_result wait_for_stop();
+    /** Wait for the program to stop, but interrupt it when the timer expires.
+     * This requires mi-async to be enabled, so the interrupt can be sent while the program is running.
+     */
+    async_result wait_for_stop(boost::asio::deadline_timer & interrupt_timer);
 
     //read the opening of the interpreter
     std::string read_header();
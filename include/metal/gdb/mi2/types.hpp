@@ -46,6 +46,8 @@ struct async_result
 {
     std::string reason;
     std::vector<result> content;
+    ///True if the stop was requested with an interrupt by wait_for_stop.
+    bool interrupted = false;
 
     template<typename T>
     T as() const {return parse_result<T>(content);}
@@ -42,6 +42,7 @@ class BOOST_SYMBOL_EXPORT process : public metal::debug::process
 {
 
     std::map<int, break_point*>               _break_point_map;
+    boost::asio::deadline_timer _sample_timer{_io_service};
     void _run_impl(boost::asio::yield_context &yield) override;
 
     void _read_header(mi2::interpreter & interpreter);
@@ -62,6 +63,10 @@ class BOOST_SYMBOL_EXPORT process : public metal::debug::process
     void _start_remote(mi2::interpreter & interpreter);
     void _start_local (mi2::interpreter & interpreter);
     void _handle_bps  (mi2::interpreter & interpreter);
+    void _init_samplers(mi2::interpreter & interpreter);
+    mi2::async_result _wait_for_stop(mi2::interpreter & interpreter);
+    bool _is_sample(const mi2::async_result & val) const;
+    void _handle_sample(mi2::interpreter & interpreter, const mi2::async_result & val);
 
 public:
     void reset_timer();
@@ -0,0 +1,110 @@
+/**
+ * @file   metal/ptrace/process.hpp
+ * @date   19.10.2026
+ * @author Klemens D. Morgenstern
+ *
+
+ The debugger backend driving the program directly with ptrace, i.e. without gdb. It's limited to x86-64 linux
+ and to programs built with frame pointers, e.g. -O0. The break-points are int3 instructions at the entry of the
+ functions, found in the symbol table, and the expressions of the plugins are evaluated by metal itself.
+
+ */
+
+#ifndef METAL_PTRACE_PROCESS_HPP_
+#define METAL_PTRACE_PROCESS_HPP_
+
+#include <metal/debug/process.hpp>
+#include <metal/debug/frame.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace metal {
+namespace ptrace {
+
+using metal::debug::break_point;
+
+struct target_info;
+struct frame_impl;
+
+class BOOST_SYMBOL_EXPORT process : public metal::debug::process
+{
+    friend struct frame_impl;
+
+    std::string _exe;
+    std::unique_ptr<target_info> _target;
+    ///The difference between the link-time and the run-time addresses, i.e. of a PIE.
+    std::uint64_t _load_bias = 0u;
+    bool _finished = false;
+
+    //every address has one int3, shared by the break-points resolved to it.
+    struct insertion
+    {
+        std::uint8_t original = 0u;
+        bool inserted = false;
+        std::vector<break_point*> break_points;
+    };
+    std::map<std::uint64_t, insertion> _insertions;
+    std::set<const break_point*> _disabled;
+    std::set<int> _threads;
+    ///The signals received by threads while they were stopped for the all-stop, delivered when they continue.
+    std::map<int, int> _resume_signals;
+
+    //the watchdog thread kills the program on timeout and stops it to take the samples.
+    std::thread _watchdog;
+    std::mutex _mutex;
+    std::condition_variable _cv;
+    std::chrono::steady_clock::time_point _deadline;
+    bool _stop_watchdog = false;
+    std::atomic<bool> _timed_out{false};
+    std::atomic<bool> _sample_pending{false};
+
+    //the program is driven synchronously by run.
+    void _run_impl(boost::asio::yield_context &) override {}
+
+    void _launch();
+    void _init_bps();
+    void _set_breakpoint(break_point & bp);
+    void _insert(std::uint64_t addr, insertion & ins);
+    void _remove(std::uint64_t addr, insertion & ins);
+    void _handle_bps();
+    void _handle_breakpoint(int tid, std::uint64_t addr);
+    void _handle_sample(int tid);
+    ///Returns the signal to deliver, when the thread continues.
+    int  _step_over(int tid, std::uint64_t addr);
+    void _stop_threads(int tid);
+    void _resume_threads(int tid, int sig);
+    void _thread_exited(int tid, int status);
+    void _kill();
+    void _start_watchdog();
+    void _end_watchdog();
+
+    std::vector<std::uint8_t> _read_memory(std::uint64_t addr, std::size_t size);
+    void _write_memory(std::uint64_t addr, const std::vector<std::uint8_t> & vec);
+    void _disable(const break_point & bp);
+    void _enable(const break_point & bp);
+    boost::optional<metal::debug::address_info> _addr2line(std::uint64_t addr) const;
+public:
+    void reset_timer();
+
+    ///Throws an elf_error, if the executable cannot be read.
+    process(const std::string & exe);
+    ~process();
+
+    ///True until the run has finished.
+    bool running() override {return !_finished;}
+    void run() override;
+};
+
+} /* namespace ptrace */
+} /* namespace metal */
+
+#endif /* METAL_PTRACE_PROCESS_HPP_ */
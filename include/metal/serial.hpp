@@ -9,4 +9,42 @@
 
 #include <metal/serial.def>
 
+namespace metal
+{
+namespace serial
+{
+namespace detail
+{
+
+template<typename End>
+struct profile_scope
+{
+    End end;
+    ~profile_scope() {end();}
+};
+
+template<typename End>
+profile_scope<End> make_profile_scope(End end) {return {end};}
+
+}
+}
+}
+
+/* Profiles the rest of the scope, the end is written by a destructor, so it's recorded on every exit of the scope.
+ * Both records have the location of this macro, the first value tells them apart, like with METAL_SERIAL_CALL.
+ * The end is not inlined, because the destructor is called on several paths, which would duplicate the location label. */
+#define METAL_SERIAL_PROFILE_SCOPE(Name)                                                                            \
+    _METAL_SERIAL_RECORD(_METAL_SERIAL_WRITE_LOCATION(); _METAL_SERIAL_WRITE_BYTE(1);)                               \
+    const METAL_SERIAL_TIMESTAMP_TYPE __metal_serial_profile_ ## Name = metal_serial_timestamp();                    \
+    auto && __metal_serial_profile_scope_ ## Name = ::metal::serial::detail::make_profile_scope(                     \
+        [&]() __attribute__((noinline))                                                                             \
+        {                                                                                                           \
+            _METAL_SERIAL_RECORD(                                                                                   \
+                const METAL_SERIAL_TIMESTAMP_TYPE __metal_serial_profile_duration =                                 \
+                        (METAL_SERIAL_TIMESTAMP_TYPE)(metal_serial_timestamp() - __metal_serial_profile_ ## Name);  \
+                _METAL_SERIAL_WRITE_LOCATION(); _METAL_SERIAL_WRITE_BYTE(0);                                         \
+                _METAL_SERIAL_WRITE_UINT(__metal_serial_profile_duration);)                                         \
+        });                                                                                                         \
+    (void)__metal_serial_profile_scope_ ## Name;
+
 #endif /* METAL_SERIAL_HPP_ */
@@ -13,6 +13,7 @@
 #define METAL_UNIT_HPP_
 
 
+#include <climits>
 #include <metal/unit.def>
 
 #if (__cplusplus < 201103L )
@@ -217,6 +218,25 @@ static_assert(Condition, "\n" METAL_LOCATION_STR() " static assertion failed: "
 #define METAL_EXPECT_EXECUTE() __metal_impl(__metal_level_expect, __metal_oper_exec, 1, 0, "expected execution", 0, 0, __FILE__, __LINE__);
 
 
+#define METAL_BENCHMARK(Name, Iterations, Code...)                                                                       \
+{                                                                                                                        \
+    const unsigned long __metal_bm_iterations = (Iterations);                                                            \
+    __metal_ticks_t __metal_bm_min = static_cast<__metal_ticks_t>(-1);                                                   \
+    __metal_ticks_t __metal_bm_max = 0;                                                                                  \
+    __metal_ticks_t __metal_bm_sum = 0;                                                                                  \
+    for (unsigned long __metal_bm_i = 0; __metal_bm_i < __metal_bm_iterations; __metal_bm_i++)                           \
+    {                                                                                                                    \
+        const __metal_ticks_t __metal_bm_start = metal_timestamp();                                                      \
+        Code ;                                                                                                           \
+        const __metal_ticks_t __metal_bm_ticks = metal_timestamp() - __metal_bm_start;                                   \
+        if (__metal_bm_ticks < __metal_bm_min) __metal_bm_min = __metal_bm_ticks;                                        \
+        if (__metal_bm_ticks > __metal_bm_max) __metal_bm_max = __metal_bm_ticks;                                        \
+        __metal_bm_sum += __metal_bm_ticks;                                                                              \
+    }                                                                                                                    \
+    __metal_impl(__metal_level_expect, __metal_oper_benchmark, __metal_bm_iterations > 0, 0, Name, #Iterations, #Code, __FILE__, __LINE__); \
+}
+
+
 #define METAL_CRITICAL(Check)  __metal_critical ++; Check ; __metal_critical--;
 #define METAL_ENTER_CRITICAL() __metal_critical ++;
 #define METAL_EXIT_CRITICAL()  __metal_critical --;
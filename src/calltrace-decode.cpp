@@ -0,0 +1,312 @@
+/**
+ * @file   calltrace-decode.cpp
+ * @date   19.10.2026
+ * @author Klemens D. Morgenstern
+ *
+
+ Converts the output of --metal-calltrace-format=bin into any of the other formats, by replaying it into the sinks of metal.calltrace.
+
+ */
+
+#include <boost/core/demangle.hpp>
+#include <boost/optional.hpp>
+#include <boost/program_options.hpp>
+
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "calltrace/bin_format.hpp"
+#include "calltrace/sink.hpp"
+
+namespace po = boost::program_options;
+using namespace std;
+
+//the sinks write into this stream in their destructors, so it needs to outlive them.
+boost::optional<std::ofstream> fstr;
+
+struct decoder
+{
+    std::istream & is;
+    data_sink_t & sink;
+
+    std::vector<std::string> strings;
+    std::vector<calltrace_clone_entry> addresses;
+    std::unordered_map<std::uint64_t, calltrace_clone> calltraces;
+
+    std::uint64_t last_timestamp = 0u;
+
+    decoder(std::istream & is, data_sink_t & sink) : is(is), sink(sink) {}
+
+    std::uint64_t varint() {return bin_format::read_varint(is);}
+
+    template<typename T>
+    T & get(std::vector<T> & vec, std::uint64_t id, const char * what)
+    {
+        if (id >= vec.size())
+            throw bin_format::format_error(std::string("reference to undefined ") + what + " " + std::to_string(id));
+        return vec[id];
+    }
+
+    boost::optional<std::string> opt_string(std::uint64_t id)
+    {
+        if (id == 0u)
+            return boost::none;
+        return get(strings, id - 1, "string");
+    }
+
+    void header()
+    {
+        char magic[sizeof(bin_format::magic)];
+        if (!is.read(magic, sizeof(magic)) || !std::equal(std::begin(magic), std::end(magic), std::begin(bin_format::magic)))
+            throw bin_format::format_error("not a metal.calltrace binary file");
+
+        auto version = varint();
+        if (version != bin_format::version)
+            throw bin_format::format_error("unsupported version " + std::to_string(version));
+    }
+
+    std::uint64_t timestamp_delta()
+    {
+        last_timestamp += bin_format::unzigzag(varint());
+        return last_timestamp;
+    }
+
+    boost::optional<std::uint64_t> timestamp()
+    {
+        if (varint() == 0u)
+            return boost::none;
+        return timestamp_delta();
+    }
+
+    void define_string()
+    {
+        auto id   = varint();
+        auto size = varint();
+        std::string value(size, '\0');
+        if (!is.read(&value[0], size))
+            throw bin_format::format_error("unexpected end of the calltrace file");
+
+        if (strings.size() <= id)
+            strings.resize(id + 1);
+        strings[id] = std::move(value);
+    }
+
+    void define_address()
+    {
+        auto id      = varint();
+        auto address = varint();
+
+        boost::optional<metal::debug::address_info> info;
+        if (varint() != 0u)
+        {
+            info.emplace();
+            info->line      = varint();
+            info->file      = get(strings, varint(), "string");
+            info->full_name = opt_string(varint());
+            info->function  = opt_string(varint());
+            auto offset = varint();
+            if (offset != 0u)
+                info->offset = offset - 1;
+        }
+        if (addresses.size() <= id)
+            addresses.resize(id + 1);
+        addresses[id] = calltrace_clone_entry{address, std::move(info)};
+    }
+
+    void call(std::uint64_t type)
+    {
+        auto & fn = get(addresses, varint(), "address");
+        auto & cs = get(addresses, varint(), "address");
+
+        boost::optional<std::uint64_t> ts;
+        if (type & bin_format::has_timestamp)
+            ts = timestamp_delta();
+
+        std::uint64_t thread = 0u;
+        if (type & bin_format::has_thread)
+            thread = varint();
+
+        if ((type & ~(bin_format::has_timestamp | bin_format::has_thread)) == bin_format::enter)
+            sink.enter(fn.address, fn.info, cs.address, cs.info, ts, thread);
+        else
+            sink.exit (fn.address, fn.info, cs.address, cs.info, ts, thread);
+    }
+
+    void set()
+    {
+        auto location = varint();
+        auto fn       = get(addresses, varint(), "address");
+        auto repeat   = static_cast<int>(varint());
+        auto skip     = static_cast<int>(varint());
+
+        std::vector<calltrace_clone_entry> content;
+        content.resize(varint());
+        for (auto & c : content)
+            c = get(addresses, varint(), "address");
+
+        auto ts = timestamp();
+
+        calltraces.erase(location);
+        auto itr = calltraces.emplace(location, calltrace_clone{location, std::move(fn), std::move(content), repeat, skip}).first;
+        sink.set(itr->second, ts);
+    }
+
+    //the state of the calltrace at the time of the record.
+    calltrace_clone & state()
+    {
+        auto location = varint();
+        auto itr = calltraces.find(location);
+        if (itr == calltraces.end())
+            itr = calltraces.emplace(location, calltrace_clone{location, {}, {}, 0, 0}).first;
+
+        auto repeated = static_cast<int>(varint());
+        auto errors   = static_cast<int>(varint());
+        auto position = static_cast<int>(varint());
+        itr->second.load(repeated, errors, position);
+        return itr->second;
+    }
+
+    void run()
+    {
+        header();
+        std::uint64_t type;
+        while (bin_format::read_varint(is, type, true))
+        {
+            switch (type & ~(bin_format::has_timestamp | bin_format::has_thread))
+            {
+            case bin_format::enter:
+            case bin_format::exit:
+                call(type);
+                break;
+            case bin_format::define_string:
+                define_string();
+                break;
+            case bin_format::define_address:
+                define_address();
+                break;
+            case bin_format::set:
+                set();
+                break;
+            case bin_format::reset:
+            {
+                auto & cc = state();
+                auto error_cnt = static_cast<int>(varint());
+                sink.reset(cc, error_cnt, timestamp());
+                break;
+            }
+            case bin_format::overflow:
+            case bin_format::mismatch:
+            {
+                auto & cc = state();
+                auto & fn = get(addresses, varint(), "address");
+                if (type == bin_format::overflow)
+                    sink.overflow(cc, fn.address, fn.info);
+                else
+                    sink.mismatch(cc, fn.address, fn.info);
+                break;
+            }
+            case bin_format::incomplete:
+            {
+                auto & cc = state();
+                sink.incomplete(cc, static_cast<int>(varint()));
+                break;
+            }
+            case bin_format::timestamp_unavailable:
+                sink.timestamp_unavailable();
+                break;
+            default:
+                throw bin_format::format_error("unknown record type " + std::to_string(type));
+            }
+        }
+        sink.flush();
+    }
+};
+
+int main(int argc, char * argv[])
+{
+    std::string input;
+    std::string output;
+    std::string format;
+    double tick_us = 1.0;
+
+    po::options_description desc;
+    desc.add_options()
+            ("help,H",   "produce help message")
+            ("input,I",  po::value<std::string>(&input),  "binary calltrace file")
+            ("output,O", po::value<std::string>(&output), "output file, instead of stdout")
+            ("format,F", po::value<std::string>(&format)->default_value("hrf"), "format [hrf, json, ndjson, folded, profile, profile-json, chrome]")
+            ("tick-us",  po::value<double>(&tick_us)->default_value(tick_us), "microseconds per timestamp tick in the chrome format")
+            ;
+
+    po::positional_options_description pos;
+    pos.add("input", 1);
+
+    try
+    {
+        po::variables_map vm;
+        po::store(po::command_line_parser(argc, argv).options(desc).positional(pos).run(), vm);
+        po::notify(vm);
+
+        if (vm.count("help"))
+        {
+            cout << desc << endl;
+            return 0;
+        }
+
+        if (input.empty())
+        {
+            cerr << "No input file defined\n" << endl;
+            return 2;
+        }
+
+        std::ifstream is{input, std::ios::in | std::ios::binary};
+        if (!is)
+        {
+            cerr << "Could not open " << input << endl;
+            return 2;
+        }
+
+        std::ostream * os = &std::cout;
+        if (!output.empty())
+        {
+            fstr.emplace(output);
+            os = &*fstr;
+        }
+
+        data_sink_t * sink = nullptr;
+        if (format == "hrf")
+            sink = get_hrf_sink(*os);
+        else if (format == "json")
+            sink = get_json_sink(*os);
+        else if (format == "ndjson")
+            sink = get_json_sink(*os, true);
+        else if (format == "chrome")
+            sink = get_chrome_sink(*os, tick_us);
+        else
+            sink = get_profile_sink(*os, format);
+
+        if (sink == nullptr)
+        {
+            cerr << "Unknown format \"" << format << "\"" << endl;
+            return 2;
+        }
+
+        decoder{is, *sink}.run();
+    }
+    catch (bin_format::format_error & fe)
+    {
+        cerr << "Format error " << fe.what() << endl;
+        return 1;
+    }
+    catch (std::exception & e)
+    {
+        cerr << "**metal-calltrace-decode** Exception ["
+             << boost::core::demangle(typeid(e).name())
+             << "] thrown: '" << e.what() << "'" << endl;
+        return 2;
+    }
+    return 0;
+}
@@ -17,8 +17,19 @@ enum type_t
     metal_enter, metal_exit, metal_set, metal_reset
 };
 
-void __metal_profile(enum type_t type __attribute__((unused)), void* this_fn __attribute__((unused)), void *call_site __attribute__((unused))) __attribute__((no_instrument_function));
-void __metal_profile(enum type_t type __attribute__((unused)), void* this_fn __attribute__((unused)), void *call_site __attribute__((unused)))
+/* The depth & thread are passed, so the debugger doesn't need to read them. */
+void __metal_profile(enum type_t type __attribute__((unused)), void* this_fn __attribute__((unused)), void *call_site __attribute__((unused)),
+                     unsigned int depth __attribute__((unused)), unsigned long thread __attribute__((unused))) __attribute__((no_instrument_function));
+void __metal_profile(enum type_t type __attribute__((unused)), void* this_fn __attribute__((unused)), void *call_site __attribute__((unused)),
+                     unsigned int depth __attribute__((unused)), unsigned long thread __attribute__((unused)))
+{
+    asm("");
+}
+
+/* The debugger stops here when a calltrace is set or reset, which is all it needs if the target verifies the calls.
+ * It's separate from __metal_profile, so there's no stop at all for the function calls. */
+void __metal_calltrace_changed(enum type_t type, struct metal_calltrace_ * ct) __attribute__((noinline, no_instrument_function));
+void __metal_calltrace_changed(enum type_t type __attribute__((unused)), struct metal_calltrace_ * ct __attribute__((unused)))
 {
     asm("");
 }
@@ -34,123 +45,346 @@ typedef unsigned long timestamp_t;
 #endif
 
 
-static struct metal_calltrace_ * calltrace_stack[METAL_CALLTRACE_STACK_SIZE];
+#if !defined(METAL_CALLTRACE_TABLE_SIZE)
+#define METAL_CALLTRACE_TABLE_SIZE (2 * METAL_CALLTRACE_STACK_SIZE)
+#endif
+
+#if METAL_CALLTRACE_TABLE_SIZE <= METAL_CALLTRACE_STACK_SIZE
+#error "METAL_CALLTRACE_TABLE_SIZE must be larger than METAL_CALLTRACE_STACK_SIZE"
+#endif
+
+/* The registered calltraces, in an open-addressing table keyed by the function they trace.
+ * The active ones are additionally kept on a stack, ordered by their start depth, so only the top needs to be checked. */
+static struct metal_calltrace_ * calltrace_table[METAL_CALLTRACE_TABLE_SIZE];
+static struct metal_calltrace_ * calltrace_active[METAL_CALLTRACE_STACK_SIZE];
+static int calltrace_active_size = 0;
+
 int __metal_calltrace_size = -1;
 
+static unsigned int __metal_calltrace_hash(const void * fn) __attribute__((no_instrument_function));
+static unsigned int __metal_calltrace_hash(const void * fn)
+{
+    return (unsigned int)(((uintptr_t)fn >> 2) % METAL_CALLTRACE_TABLE_SIZE);
+}
+
+/* The call depth is kept per thread. If METAL_CALLTRACE_THREAD_LOCAL is defined as the thread local specifier (e.g. __thread)
+ * the depth is thread local, otherwise it is kept in a table by the id metal_calltrace_thread_id returns.
+ * Without either all calls are counted as one thread. */
+#pragma weak metal_calltrace_thread_id
 
-unsigned int __metal_calltrace_depth = 1;
-void __metal_calltrace_enter(void * this_fn) __attribute__((no_instrument_function));
-void __metal_calltrace_exit (void * this_fn) __attribute__((no_instrument_function));
+#if defined(METAL_CALLTRACE_THREAD_LOCAL)
 
+static METAL_CALLTRACE_THREAD_LOCAL unsigned int __metal_calltrace_depth = 1;
 
-void __metal_calltrace_enter(void * this_fn)
+static unsigned long __metal_calltrace_thread(void) __attribute__((no_instrument_function));
+static unsigned long __metal_calltrace_thread(void)
 {
-    int i, cnt = 0;
-    for (i = 0; (cnt < __metal_calltrace_size) && (i <= sizeof(calltrace_stack)/sizeof(struct metal_calltrace_ * )); i++)
+    //the address of the thread local variable identifies the thread.
+    return metal_calltrace_thread_id ? metal_calltrace_thread_id() : (unsigned long)(uintptr_t)&__metal_calltrace_depth;
+}
+
+static unsigned int * __metal_calltrace_thread_depth(unsigned long thread __attribute__((unused))) __attribute__((no_instrument_function));
+static unsigned int * __metal_calltrace_thread_depth(unsigned long thread __attribute__((unused)))
+{
+    return &__metal_calltrace_depth;
+}
+
+#else
+
+#if !defined(METAL_CALLTRACE_THREADS)
+#define METAL_CALLTRACE_THREADS 8
+#endif
+
+struct __metal_calltrace_thread_
+{
+    unsigned long id;
+    unsigned int depth;
+};
+
+/* The slots are claimed in order & never released, so the used ones are a prefix of the table.
+ * A slot is free while its id is zero, except for the first one, which belongs to thread zero.
+ * The id is claimed atomically, so the hook may be called concurrently by several threads. */
+static struct __metal_calltrace_thread_ calltrace_threads[METAL_CALLTRACE_THREADS] = {{0, 1}};
+static unsigned int calltrace_thread_last = 0;
+
+static unsigned long __metal_calltrace_thread(void) __attribute__((no_instrument_function));
+static unsigned long __metal_calltrace_thread(void)
+{
+    return metal_calltrace_thread_id ? metal_calltrace_thread_id() : 0ul;
+}
+
+//if there are more threads than slots, the ones exceeding it share the last one.
+static unsigned int * __metal_calltrace_thread_depth(unsigned long thread) __attribute__((no_instrument_function));
+static unsigned int * __metal_calltrace_thread_depth(unsigned long thread)
+{
+    unsigned int last = __atomic_load_n(&calltrace_thread_last, __ATOMIC_RELAXED);
+    if (__atomic_load_n(&calltrace_threads[last].id, __ATOMIC_ACQUIRE) == thread)
+        return &calltrace_threads[last].depth;
+
+    unsigned int i;
+    for (i = 0; i < METAL_CALLTRACE_THREADS; i++)
     {
-        if (calltrace_stack[i] != 0)
-        {
-            cnt++;
-            struct metal_calltrace_ *ct = calltrace_stack[i];
+        unsigned long id = __atomic_load_n(&calltrace_threads[i].id, __ATOMIC_ACQUIRE);
+        if (id == thread)
+            break;
+        if ((id != 0ul) || (i == 0))
+            continue;
 
-            if ((ct->start_depth == -1) //inactive
-             && (ct->fn == this_fn) //that's my function
-             && ((ct->repeat > ct->repeated) || (ct->repeat == 0) )) //not repeated to often
-            {
-                if (ct->to_skip > 0)
-                {
-                    ct->to_skip--;
-                    continue;
-                }
-                else
-                {
-                    ct->start_depth = __metal_calltrace_depth;
-                }
-            }
-            else if (ct->start_depth == (__metal_calltrace_depth-1)) //alright, I'm on the spot
-            {
-                if (ct->current_position >= ct->content_size) //to many calls
-                {
-                    ct->errored = 1;
-                    continue;
-                }
-                const void * ptr = ct->content[ct->current_position];
-                if ((ptr != this_fn) && (ptr != 0))
-                    ct->errored = 1;
-                ct->current_position++;
-            }
+        //only this thread can use the slot it claims, so the depth needs no synchronization.
+        if (__atomic_compare_exchange_n(&calltrace_threads[i].id, &id, thread, 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+        {
+            calltrace_threads[i].depth = 1;
+            break;
         }
+        else if (id == thread)
+            break;
     }
 
+    if (i == METAL_CALLTRACE_THREADS)
+        i = METAL_CALLTRACE_THREADS - 1;
+
+    __atomic_store_n(&calltrace_thread_last, i, __ATOMIC_RELAXED);
+    return &calltrace_threads[i].depth;
+}
+
+#endif
+
+//used by the debugger to determine the byte order, so it can read the structs in one go.
+const unsigned short __metal_calltrace_marker = 0x0102;
+
+#if !defined(METAL_CALLTRACE_BUFFER_SIZE)
+#define METAL_CALLTRACE_BUFFER_SIZE 0
+#endif
+
+void __metal_calltrace_flush(void) __attribute__((no_instrument_function));
+
+#if METAL_CALLTRACE_BUFFER_SIZE > 0
+
+/* The function calls are recorded here and read by the debugger in one go, when the buffer is full,
+ * a calltrace gets set or reset or the program exits. */
+struct __metal_calltrace_record
+{
+    int type;
+    unsigned int depth;
+    unsigned long thread;
+    void * this_fn;
+    void * call_site;
+    timestamp_t timestamp;
+};
+
+#pragma weak metal_timestamp
+
+struct __metal_calltrace_record __metal_calltrace_buffer[METAL_CALLTRACE_BUFFER_SIZE];
+unsigned int __metal_calltrace_buffer_used = 0;
+const unsigned int __metal_calltrace_buffer_size = METAL_CALLTRACE_BUFFER_SIZE;
+
+static void __metal_calltrace_record(enum type_t type, void * this_fn, void * call_site, unsigned int depth, unsigned long thread) __attribute__((no_instrument_function));
+static void __metal_calltrace_record(enum type_t type, void * this_fn, void * call_site, unsigned int depth, unsigned long thread)
+{
+    struct __metal_calltrace_record * rec = &__metal_calltrace_buffer[__metal_calltrace_buffer_used];
+    rec->type      = type;
+    rec->depth     = depth;
+    rec->thread    = thread;
+    rec->this_fn   = this_fn;
+    rec->call_site = call_site;
+    rec->timestamp = metal_timestamp ? metal_timestamp() : 0;
+
+    if (++__metal_calltrace_buffer_used >= METAL_CALLTRACE_BUFFER_SIZE)
+        __metal_calltrace_flush();
 }
 
-void __metal_calltrace_exit (void * this_fn)
+/* The debugger reads the buffer at this function. It's not done through __metal_profile,
+ * so the break-point is independent of its condition and only exists if the calls are buffered. */
+void __metal_calltrace_flush_buffer(struct __metal_calltrace_record * buffer) __attribute__((noinline, no_instrument_function));
+void __metal_calltrace_flush_buffer(struct __metal_calltrace_record * buffer __attribute__((unused)))
 {
-    int i, cnt = 0;
-    for (i = 0; (cnt < __metal_calltrace_size) && (i <= sizeof(calltrace_stack)/sizeof(struct metal_calltrace_ * )); i++)
+    asm("");
+}
+
+void __metal_calltrace_flush(void) __attribute__((destructor));
+void __metal_calltrace_flush(void)
+{
+    if (__metal_calltrace_buffer_used == 0)
+        return;
+
+    __metal_calltrace_flush_buffer(__metal_calltrace_buffer);
+    __metal_calltrace_buffer_used = 0;
+}
+
+#else
+
+void __metal_calltrace_flush(void)
+{
+}
+
+#endif
+
+void __metal_calltrace_enter(void * this_fn, unsigned int depth, unsigned long thread) __attribute__((no_instrument_function));
+void __metal_calltrace_exit (void * this_fn, unsigned int depth, unsigned long thread) __attribute__((no_instrument_function));
+
+
+static void __metal_calltrace_error(struct metal_calltrace_ * ct, int type, const void * fn) __attribute__((no_instrument_function));
+static void __metal_calltrace_error(struct metal_calltrace_ * ct, int type, const void * fn)
+{
+    //only the first error is kept, errored counts all of them.
+    if (ct->errored++ == 0)
+    {
+        ct->error_type = type;
+        ct->error_position = ct->current_position;
+        ct->error_fn = fn;
+    }
+}
+
+void __metal_calltrace_enter(void * this_fn, unsigned int depth, unsigned long thread)
+{
+    int i;
+    //the calltraces with the calling function as start are on top of the stack, the ones of other threads are skipped.
+    for (i = calltrace_active_size - 1; i >= 0; i--)
     {
-        if (calltrace_stack[i] != 0)
+        struct metal_calltrace_ *ct = calltrace_active[i];
+        if (ct->thread != thread)
+            continue;
+        if (ct->start_depth != (int)(depth - 1))
+            break;
+        if (ct->current_position >= ct->content_size) //to many calls
         {
-            cnt++;
-            struct metal_calltrace_ *ct = calltrace_stack[i];
-            if (ct->start_depth == __metal_calltrace_depth)
-            {
-                ct->start_depth = -1;
+            __metal_calltrace_error(ct, metal_calltrace_overflow, this_fn);
+            continue;
+        }
+        const void * ptr = ct->content[ct->current_position];
+        if ((ptr != this_fn) && (ptr != 0))
+            __metal_calltrace_error(ct, metal_calltrace_mismatch, this_fn);
+        ct->current_position++;
+    }
 
-                if (ct->current_position != ct->content_size)
-                    ct->errored = 1;
+    unsigned int idx;
+    for (idx = __metal_calltrace_hash(this_fn); calltrace_table[idx] != 0; idx = (idx + 1) % METAL_CALLTRACE_TABLE_SIZE)
+    {
+        struct metal_calltrace_ *ct = calltrace_table[idx];
 
-                ct->current_position = 0;
-                ct->repeated ++;
+        if ((ct->start_depth == -1) //inactive
+         && (ct->fn == this_fn) //that's my function
+         && ((ct->repeat > ct->repeated) || (ct->repeat == 0) )) //not repeated to often
+        {
+            if (ct->to_skip > 0)
+                ct->to_skip--;
+            else if (calltrace_active_size < METAL_CALLTRACE_STACK_SIZE)
+            {
+                ct->start_depth = depth;
+                ct->thread = thread;
+                calltrace_active[calltrace_active_size++] = ct;
             }
         }
     }
 }
 
+void __metal_calltrace_exit (void * this_fn, unsigned int depth, unsigned long thread)
+{
+    int i, j;
+    //the calltraces of this thread that started here are the topmost of it.
+    for (i = calltrace_active_size - 1, j = calltrace_active_size; i >= 0; i--)
+    {
+        struct metal_calltrace_ *ct = calltrace_active[i];
+        if (ct->thread != thread)
+            continue;
+        if (ct->start_depth != (int)depth)
+            break;
+        j = i;
+    }
+    if (j == calltrace_active_size)
+        return;
+
+    //the stopped ones are removed, the ones of the other threads above them are kept in order.
+    int k = j;
+    for (i = j; i < calltrace_active_size; i++)
+    {
+        struct metal_calltrace_ *ct = calltrace_active[i];
+        if (ct->thread != thread)
+        {
+            calltrace_active[k++] = ct;
+            continue;
+        }
+        ct->start_depth = -1;
+
+        if (ct->current_position != ct->content_size)
+            __metal_calltrace_error(ct, metal_calltrace_incomplete, this_fn);
+
+        ct->current_position = 0;
+        ct->repeated ++;
+    }
+    calltrace_active_size = k;
+}
+
 
 int __metal_set_calltrace(struct metal_calltrace_ * ct) __attribute__((no_instrument_function));
 int __metal_set_calltrace(struct metal_calltrace_ * ct)
 {
+    __metal_calltrace_flush();
     if (__metal_calltrace_size < 0) //init the array first
     {
         int i;
-        for (i = 0; i < sizeof(calltrace_stack)/sizeof(struct metal_calltrace_ *); i++)
-            calltrace_stack[i] = 0;
+        for (i = 0; i < METAL_CALLTRACE_TABLE_SIZE; i++)
+            calltrace_table[i] = 0;
         __metal_calltrace_size = 0;
     }
 
-    if (__metal_calltrace_size >= (sizeof(calltrace_stack)/sizeof(struct metal_calltrace_ *)))
+    if (__metal_calltrace_size >= METAL_CALLTRACE_STACK_SIZE)
         return 0;
 
-    int i;
-    for (i = 0; i < (sizeof(calltrace_stack)/sizeof(struct metal_calltrace_ *)); i++)
-    {
-        if (calltrace_stack[i] == 0)
-        {
-            calltrace_stack[i] = ct;
-            __metal_calltrace_size ++;
-            __metal_profile(metal_set, ct, 0);
-            break;
-        }
-    }
+    unsigned int idx = __metal_calltrace_hash(ct->fn);
+    while (calltrace_table[idx] != 0)
+        idx = (idx + 1) % METAL_CALLTRACE_TABLE_SIZE;
+
+    calltrace_table[idx] = ct;
+    __metal_calltrace_size ++;
+    __metal_profile(metal_set, ct, 0, 0, 0);
+    __metal_calltrace_changed(metal_set, ct);
     return 1;
 }
 
 int __metal_reset_calltrace(struct metal_calltrace_ * ct) __attribute__((no_instrument_function));
 int __metal_reset_calltrace(struct metal_calltrace_ * ct)
 {
-    int i;
-    for (i = 0; i < (sizeof(calltrace_stack)/sizeof(struct metal_calltrace_ *)); i++)
+    __metal_calltrace_flush();
+    if (__metal_calltrace_size <= 0)
+        return 0;
+
+    unsigned int idx = __metal_calltrace_hash(ct->fn);
+    while ((calltrace_table[idx] != 0) && (calltrace_table[idx] != ct))
+        idx = (idx + 1) % METAL_CALLTRACE_TABLE_SIZE;
+
+    if (calltrace_table[idx] == 0)
+        return 0;
+
+    calltrace_table[idx] = 0;
+
+    //move the following entries of the probe sequence up, so the lookup doesn't stop at the gap.
+    unsigned int next = (idx + 1) % METAL_CALLTRACE_TABLE_SIZE;
+    while (calltrace_table[next] != 0)
     {
-        if (calltrace_stack[i] == ct)
+        unsigned int home = __metal_calltrace_hash(calltrace_table[next]->fn);
+        int stays = (idx <= next) ? ((idx < home) && (home <= next))
+                                  : ((idx < home) || (home <= next));
+        if (!stays)
         {
-            calltrace_stack[i] = 0;
-            __metal_profile(metal_reset, ct, 0);
-            __metal_calltrace_size --;
-            return 1;
+            calltrace_table[idx] = calltrace_table[next];
+            calltrace_table[next] = 0;
+            idx = next;
         }
+        next = (next + 1) % METAL_CALLTRACE_TABLE_SIZE;
     }
-    return 0;
+
+    //it can only be active if it's deinitialized within the traced function.
+    int i, j;
+    for (i = 0, j = 0; i < calltrace_active_size; i++)
+        if (calltrace_active[i] != ct)
+            calltrace_active[j++] = calltrace_active[i];
+    calltrace_active_size = j;
+
+    __metal_profile(metal_reset, ct, 0, 0, 0);
+    __metal_calltrace_changed(metal_reset, ct);
+    __metal_calltrace_size --;
+    return 1;
 }
 
 
@@ -159,18 +393,35 @@ void __cyg_profile_func_exit (void *this_fn, void *call_site) __attribute__((no_
 
 void __cyg_profile_func_enter(void *this_fn, void *call_site)
 {
-    __metal_calltrace_depth++;
+    unsigned long thread = __metal_calltrace_thread();
+    unsigned int * depth = __metal_calltrace_thread_depth(thread);
+    (*depth)++;
 
-    __metal_profile(metal_enter, this_fn, call_site);
+#if defined(METAL_CALLTRACE_TARGET_CHECK)
+    (void)call_site;
+#elif METAL_CALLTRACE_BUFFER_SIZE > 0
+    __metal_calltrace_record(metal_enter, this_fn, call_site, *depth, thread);
+#else
+    __metal_profile(metal_enter, this_fn, call_site, *depth, thread);
+#endif
 
     if (__metal_calltrace_size > 0)
-        __metal_calltrace_enter(this_fn);
+        __metal_calltrace_enter(this_fn, *depth, thread);
 }
 void __cyg_profile_func_exit (void *this_fn, void *call_site)
 {
-    __metal_profile(metal_exit, this_fn, call_site);
+    unsigned long thread = __metal_calltrace_thread();
+    unsigned int * depth = __metal_calltrace_thread_depth(thread);
+
+#if defined(METAL_CALLTRACE_TARGET_CHECK)
+    (void)call_site;
+#elif METAL_CALLTRACE_BUFFER_SIZE > 0
+    __metal_calltrace_record(metal_exit, this_fn, call_site, *depth, thread);
+#else
+    __metal_profile(metal_exit, this_fn, call_site, *depth, thread);
+#endif
     if (__metal_calltrace_size > 0)
-        __metal_calltrace_exit(this_fn);
+        __metal_calltrace_exit(this_fn, *depth, thread);
 
-    __metal_calltrace_depth--;
+    (*depth)--;
 }
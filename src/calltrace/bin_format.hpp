@@ -0,0 +1,107 @@
+/**
+ * @file   src/calltrace/bin_format.hpp
+ * @date   19.10.2026
+ * @author Klemens D. Morgenstern
+ *
+
+ The binary format of the calltrace output. It starts with a header, followed by a stream of records,
+ each starting with the record type as a varint. All numbers are unsigned varints (LEB128),
+ the timestamps are zigzag encoded deltas to the previous timestamp.
+
+ Addresses and strings are defined once by a record before the first event that uses them and are
+ referenced by id afterwards, so every event only takes a few bytes.
+
+ */
+
+#ifndef CALLTRACE_BIN_FORMAT_HPP_
+#define CALLTRACE_BIN_FORMAT_HPP_
+
+#include <cstdint>
+#include <istream>
+#include <stdexcept>
+#include <string>
+
+namespace bin_format
+{
+
+constexpr static char magic[8] = {'M', 'E', 'T', 'A', 'L', 'C', 'T', '\0'};
+constexpr static std::uint64_t version = 1u;
+
+/** The calltrace state in the records of the calltraces is `location, repeated, errors, position`.
+ *  The timestamps of set & reset are a flag followed by the delta if set.
+ */
+enum record_t : std::uint64_t
+{
+    enter = 0,      ///< fn, call_site [, timestamp] [, thread]
+    exit,           ///< fn, call_site [, timestamp] [, thread]
+    define_string,  ///< id, size, characters
+    define_address, ///< id, address, has_info [, line, file, full_name + 1, function + 1, offset + 1]
+    set,            ///< location, fn, repeat, skip, size, content..., timestamp
+    reset,          ///< state, error count, timestamp
+    overflow,       ///< state, fn
+    mismatch,       ///< state, fn
+    incomplete,     ///< state, position
+    timestamp_unavailable
+};
+
+///The flag added to the enter and exit records, if they have a timestamp.
+constexpr static std::uint64_t has_timestamp = 0x10;
+///The flag added to the enter and exit records, if they have a thread id.
+constexpr static std::uint64_t has_thread    = 0x20;
+
+struct format_error : std::runtime_error
+{
+    using std::runtime_error::runtime_error;
+};
+
+template<typename Buffer>
+void write_varint(Buffer & buf, std::uint64_t value)
+{
+    while (value >= 0x80)
+    {
+        buf.push_back(static_cast<char>((value & 0x7F) | 0x80));
+        value >>= 7;
+    }
+    buf.push_back(static_cast<char>(value));
+}
+
+inline std::uint64_t zigzag(std::int64_t value)
+{
+    return (static_cast<std::uint64_t>(value) << 1) ^ static_cast<std::uint64_t>(value >> 63);
+}
+
+inline std::int64_t unzigzag(std::uint64_t value)
+{
+    return static_cast<std::int64_t>(value >> 1) ^ -static_cast<std::int64_t>(value & 1);
+}
+
+///Returns false at the end of the stream, if `at_end` is allowed.
+inline bool read_varint(std::istream & is, std::uint64_t & value, bool at_end = false)
+{
+    value = 0u;
+    for (int shift = 0; shift < 64; shift += 7)
+    {
+        auto c = is.get();
+        if (c == std::char_traits<char>::eof())
+        {
+            if (at_end && (shift == 0))
+                return false;
+            throw format_error("unexpected end of the calltrace file");
+        }
+        value |= static_cast<std::uint64_t>(c & 0x7F) << shift;
+        if ((c & 0x80) == 0)
+            return true;
+    }
+    throw format_error("invalid varint in the calltrace file");
+}
+
+inline std::uint64_t read_varint(std::istream & is)
+{
+    std::uint64_t value;
+    read_varint(is, value);
+    return value;
+}
+
+}
+
+#endif /* CALLTRACE_BIN_FORMAT_HPP_ */
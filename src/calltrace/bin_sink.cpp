@@ -0,0 +1,244 @@
+/**
+ * @file   bin_sink.cpp
+ * @date   19.10.2026
+ * @author Klemens D. Morgenstern
+ *
+
+
+ */
+#include "sink.hpp"
+#include "bin_format.hpp"
+
+#include <boost/optional.hpp>
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+using namespace std;
+
+struct bin_sink_t : data_sink_t
+{
+    std::ostream & os;
+    std::vector<char> buffer;
+
+    constexpr static std::size_t capacity = 64 * 1024;
+
+    std::unordered_map<std::string, std::uint64_t> strings;
+    std::unordered_map<std::uint64_t, std::uint64_t> addresses;
+
+    std::uint64_t last_timestamp = 0u;
+
+    bin_sink_t(std::ostream & os) : os(os)
+    {
+        buffer.reserve(capacity);
+        buffer.insert(buffer.end(), std::begin(bin_format::magic), std::end(bin_format::magic));
+        varint(bin_format::version);
+    }
+
+    virtual ~bin_sink_t()
+    {
+        write_out();
+    }
+
+    void varint(std::uint64_t value) {bin_format::write_varint(buffer, value);}
+
+    void write_out()
+    {
+        if (buffer.empty())
+            return;
+        os.write(buffer.data(), buffer.size());
+        os.flush();
+        buffer.clear();
+    }
+
+    void flush() override
+    {
+        write_out();
+    }
+
+    //a record is complete, so the buffer can be written if it's full.
+    void end_record()
+    {
+        if (buffer.size() >= capacity)
+            write_out();
+    }
+
+    std::uint64_t string_id(const std::string & value)
+    {
+        auto itr = strings.find(value);
+        if (itr != strings.end())
+            return itr->second;
+
+        auto id = strings.size();
+        strings.emplace(value, id);
+        varint(bin_format::define_string);
+        varint(id);
+        varint(value.size());
+        buffer.insert(buffer.end(), value.begin(), value.end());
+        return id;
+    }
+
+    std::uint64_t opt_string_id(const boost::optional<std::string> & value)
+    {
+        return value ? (string_id(*value) + 1) : 0u;
+    }
+
+    std::uint64_t address_id(std::uint64_t address, const boost::optional<metal::debug::address_info> & info)
+    {
+        auto itr = addresses.find(address);
+        if (itr != addresses.end())
+            return itr->second;
+
+        //the strings need to be defined before the address.
+        std::uint64_t file = 0u, full_name = 0u, function = 0u;
+        if (info)
+        {
+            file      = string_id(info->file);
+            full_name = opt_string_id(info->full_name);
+            function  = opt_string_id(info->function);
+        }
+
+        auto id = addresses.size();
+        addresses.emplace(address, id);
+        varint(bin_format::define_address);
+        varint(id);
+        varint(address);
+        varint(info ? 1u : 0u);
+        if (info)
+        {
+            varint(info->line);
+            varint(file);
+            varint(full_name);
+            varint(function);
+            varint(info->offset ? (*info->offset + 1) : 0u);
+        }
+        return id;
+    }
+
+    std::uint64_t address_id(const calltrace_clone_entry & cce)
+    {
+        return address_id(cce.address, cce.info);
+    }
+
+    void timestamp_delta(std::uint64_t ts)
+    {
+        varint(bin_format::zigzag(static_cast<std::int64_t>(ts - last_timestamp)));
+        last_timestamp = ts;
+    }
+
+    void timestamp(const boost::optional<std::uint64_t> & ts)
+    {
+        varint(ts ? 1u : 0u);
+        if (ts)
+            timestamp_delta(*ts);
+    }
+
+    void state(const calltrace_clone & cc)
+    {
+        varint(cc.location());
+        varint(cc.repeated());
+        varint(cc.errors());
+        varint(cc.current_position());
+    }
+
+    void call(bin_format::record_t type,
+              std::uint64_t      func_ptr, const boost::optional<metal::debug::address_info>& func,
+              std::uint64_t call_site_ptr, const boost::optional<metal::debug::address_info>& call_site,
+              const boost::optional<std::uint64_t> & ts, std::uint64_t thread)
+    {
+        auto fn = address_id(func_ptr, func);
+        auto cs = address_id(call_site_ptr, call_site);
+
+        varint(type | (ts ? bin_format::has_timestamp : 0u) | ((thread != 0u) ? bin_format::has_thread : 0u));
+        varint(fn);
+        varint(cs);
+        if (ts)
+            timestamp_delta(*ts);
+        if (thread != 0u)
+            varint(thread);
+        end_record();
+    }
+
+    void enter(std::uint64_t      func_ptr, const boost::optional<metal::debug::address_info>& func,
+               std::uint64_t call_site_ptr, const boost::optional<metal::debug::address_info>& call_site,
+               const boost::optional<std::uint64_t> & ts, std::uint64_t thread) override
+    {
+        call(bin_format::enter, func_ptr, func, call_site_ptr, call_site, ts, thread);
+    }
+    void exit (std::uint64_t      func_ptr, const boost::optional<metal::debug::address_info>& func,
+               std::uint64_t call_site_ptr, const boost::optional<metal::debug::address_info>& call_site,
+               const boost::optional<std::uint64_t> & ts, std::uint64_t thread) override
+    {
+        call(bin_format::exit, func_ptr, func, call_site_ptr, call_site, ts, thread);
+    }
+
+    void set(const calltrace_clone & cc, const boost::optional<std::uint64_t> & ts) override
+    {
+        auto fn = address_id(cc.fn());
+        std::vector<std::uint64_t> content;
+        content.reserve(cc.content().size());
+        for (auto & c : cc.content())
+            content.push_back(address_id(c));
+
+        varint(bin_format::set);
+        varint(cc.location());
+        varint(fn);
+        varint(cc.repeat());
+        varint(cc.skip());
+        varint(content.size());
+        for (auto c : content)
+            varint(c);
+        timestamp(ts);
+        end_record();
+    }
+
+    void reset(const calltrace_clone & cc, int error_cnt, const boost::optional<std::uint64_t> & ts) override
+    {
+        varint(bin_format::reset);
+        state(cc);
+        varint(error_cnt);
+        timestamp(ts);
+        end_record();
+    }
+
+    void error(bin_format::record_t type, const calltrace_clone & cc, std::uint64_t addr, const boost::optional<metal::debug::address_info> & ai)
+    {
+        auto fn = address_id(addr, ai);
+        varint(type);
+        state(cc);
+        varint(fn);
+        end_record();
+    }
+
+    void overflow(const calltrace_clone & cc, std::uint64_t addr, const boost::optional<metal::debug::address_info> & ai) override
+    {
+        error(bin_format::overflow, cc, addr, ai);
+    }
+    void mismatch(const calltrace_clone & cc, std::uint64_t addr, const boost::optional<metal::debug::address_info> & ai) override
+    {
+        error(bin_format::mismatch, cc, addr, ai);
+    }
+
+    void incomplete(const calltrace_clone & cc, int position) override
+    {
+        varint(bin_format::incomplete);
+        state(cc);
+        varint(position);
+        end_record();
+    }
+
+    void timestamp_unavailable() override
+    {
+        varint(bin_format::timestamp_unavailable);
+        end_record();
+    }
+};
+
+boost::optional<bin_sink_t> bin_sink;
+
+data_sink_t * get_bin_sink(std::ostream & os)
+{
+    bin_sink.emplace(os);
+    return &*bin_sink;
+}
@@ -43,6 +43,7 @@ class calltrace_clone
     int _current_position = 0;
     int _start_depth = -1;
     int _repeated = 0;
+    std::uint64_t _thread = 0u;
 
     bool _ovl = false;
 public:
@@ -74,7 +75,10 @@ public:
     bool to_skip() const {return _to_skip > 0;}
     void add_skipped() {_to_skip--;}
 
-    void start(int depth) {_start_depth = depth; _ovl = false;}
+    void start(int depth, std::uint64_t thread = 0u) {_start_depth = depth; _thread = thread; _ovl = false;}
+
+    ///The thread the calltrace is active in.
+    std::uint64_t thread() const {return _thread;}
 
     bool my_depth(int value) const {return value == _start_depth;}
     bool my_child(int value) const {return value == (_start_depth + 1);}
@@ -110,6 +114,14 @@ public:
             return true;
     }
 
+    ///Take over the state the target recorded itself, so the first error can be reported with the position it occured at.
+    void load(int repeated, int errors, int position)
+    {
+        _repeated = repeated;
+        _errors = errors;
+        _current_position = position;
+    }
+
     bool ovl() const {return _ovl;}
     bool stop()
     {
@@ -0,0 +1,188 @@
+/**
+ * @file   chrome_sink.cpp
+ * @date   19.10.2026
+ * @author Klemens D. Morgenstern
+ *
+
+ Writes the calls as trace events (https://docs.google.com/document/d/1CvAClvFfyA5R-PhYUmn5OOQtYMH4h6I0nSsKchNAySU),
+ so they can be viewed in chrome://tracing or perfetto. The events are written as a json array, one per line,
+ which the viewers load even if the closing bracket is missing, i.e. if the run got interrupted.
+
+ */
+#include "sink.hpp"
+#include "../sink/json_stream.hpp"
+
+#include <boost/optional.hpp>
+#include <fmt/format.h>
+
+using namespace std;
+
+struct chrome_sink_t : data_sink_t
+{
+    metal::sink::json_ostream out;
+    rapidjson::Writer<metal::sink::json_ostream> w;
+    double tick_us;
+
+    bool first = true;
+    //without a timestamp, the events are placed one tick after the last one, to keep the order visible.
+    std::uint64_t last_timestamp = 0u;
+    //the calltrace events are shown on the thread of the last call.
+    std::uint64_t last_thread = 0u;
+
+    chrome_sink_t(std::ostream & os, double tick_us) : out(os), tick_us(tick_us)
+    {
+        out.Put('[');
+        out.Put('\n');
+    }
+
+    virtual ~chrome_sink_t()
+    {
+        out.Put(']');
+        out.Put('\n');
+    }
+
+    void flush() override
+    {
+        out.write_out();
+    }
+
+    template<typename Func>
+    void event(const char * phase, const boost::optional<std::uint64_t> & ts, Func && func)
+    {
+        last_timestamp = ts ? *ts : (last_timestamp + 1);
+
+        if (!first)
+        {
+            out.Put(',');
+            out.Put('\n');
+        }
+        first = false;
+
+        w.Reset(out);
+        w.StartObject();
+        w.Key("ph");  w.String(phase);
+        w.Key("ts");  w.Double(static_cast<double>(last_timestamp) * tick_us);
+        w.Key("pid"); w.Int(1);
+        w.Key("tid"); w.Uint64(last_thread);
+        func();
+        w.EndObject();
+    }
+
+    static std::string name(std::uint64_t addr, const boost::optional<metal::debug::address_info> & ai)
+    {
+        if (ai && ai->function)
+            return *ai->function;
+        else
+            return fmt::format("0x{:x}", addr);
+    }
+
+    void location(const char * key, const boost::optional<metal::debug::address_info> & ai)
+    {
+        if (!ai)
+            return;
+        w.Key(key); w.String(fmt::format("{}({})", ai->file, ai->line));
+    }
+
+    void call(const char * phase,
+              std::uint64_t      func_ptr, const boost::optional<metal::debug::address_info>& func,
+              std::uint64_t call_site_ptr, const boost::optional<metal::debug::address_info>& call_site,
+              const boost::optional<std::uint64_t> & ts, std::uint64_t thread)
+    {
+        last_thread = thread;
+        event(phase, ts, [&]
+                {
+                    w.Key("name"); w.String(name(func_ptr, func));
+                    w.Key("cat");  w.String("function");
+                    w.Key("args");
+                    w.StartObject();
+                    w.Key("address");   w.String(fmt::format("0x{:x}", func_ptr));
+                    w.Key("call_site"); w.String(fmt::format("0x{:x}", call_site_ptr));
+                    location("location", call_site);
+                    w.EndObject();
+                });
+    }
+
+    void enter(std::uint64_t      func_ptr, const boost::optional<metal::debug::address_info>& func,
+               std::uint64_t call_site_ptr, const boost::optional<metal::debug::address_info>& call_site,
+               const boost::optional<std::uint64_t> & ts, std::uint64_t thread) override
+    {
+        call("B", func_ptr, func, call_site_ptr, call_site, ts, thread);
+    }
+    void exit (std::uint64_t      func_ptr, const boost::optional<metal::debug::address_info>& func,
+               std::uint64_t call_site_ptr, const boost::optional<metal::debug::address_info>& call_site,
+               const boost::optional<std::uint64_t> & ts, std::uint64_t thread) override
+    {
+        call("E", func_ptr, func, call_site_ptr, call_site, ts, thread);
+    }
+
+    //everything but the calls is shown as an instant event on the thread.
+    template<typename Func>
+    void instant(const std::string & name, const calltrace_clone & cc, const boost::optional<std::uint64_t> & ts, Func && func)
+    {
+        event("i", ts, [&]
+                {
+                    w.Key("name"); w.String(name);
+                    w.Key("cat");  w.String("calltrace");
+                    w.Key("s");    w.String("t");
+                    w.Key("args");
+                    w.StartObject();
+                    w.Key("calltrace"); w.String(fmt::format("0x{:x}", cc.location()));
+                    func();
+                    w.EndObject();
+                });
+    }
+
+    void set(const calltrace_clone & cc, const boost::optional<std::uint64_t> & ts) override
+    {
+        instant("calltrace set", cc, ts, [&]
+                {
+                    w.Key("function"); w.String(name(cc.fn().address, cc.fn().info));
+                });
+    }
+
+    void reset(const calltrace_clone & cc, int error_cnt, const boost::optional<std::uint64_t> & ts) override
+    {
+        instant("calltrace reset", cc, ts, [&]
+                {
+                    w.Key("repeated"); w.Int(cc.repeated());
+                    w.Key("errors");   w.Int(error_cnt);
+                });
+    }
+
+    void overflow(const calltrace_clone & cc, std::uint64_t addr, const boost::optional<metal::debug::address_info> & ai) override
+    {
+        instant("calltrace overflow", cc, boost::none, [&]
+                {
+                    w.Key("function"); w.String(name(addr, ai));
+                });
+    }
+
+    void mismatch(const calltrace_clone & cc, std::uint64_t addr, const boost::optional<metal::debug::address_info> & ai) override
+    {
+        instant("calltrace mismatch", cc, boost::none, [&]
+                {
+                    w.Key("function"); w.String(name(addr, ai));
+                    w.Key("expected"); w.String(name(cc.previous().address, cc.previous().info));
+                    w.Key("position"); w.Int(cc.current_position());
+                });
+    }
+
+    void incomplete(const calltrace_clone & cc, int position) override
+    {
+        instant("calltrace incomplete", cc, boost::none, [&]
+                {
+                    w.Key("position"); w.Int(position);
+                    w.Key("size");     w.Uint64(cc.content().size());
+                });
+    }
+
+    void timestamp_unavailable() override {}
+};
+
+boost::optional<chrome_sink_t> chrome_sink;
+
+data_sink_t * get_chrome_sink(std::ostream & os, double tick_us)
+{
+    chrome_sink.emplace(os, tick_us);
+    return &*chrome_sink;
+}
@@ -0,0 +1,87 @@
+/**
+ * @file   src/calltrace/event_buffer.hpp
+ * @date   19.10.2026
+ * @author Klemens D. Morgenstern
+ *
+
+ */
+
+#ifndef CALLTRACE_EVENT_BUFFER_HPP_
+#define CALLTRACE_EVENT_BUFFER_HPP_
+
+#include <metal/debug/frame.hpp>
+#include "target_layout.hpp"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+///A function call recorded by the target, if built with METAL_CALLTRACE_BUFFER_SIZE.
+struct calltrace_event
+{
+    bool enter;
+    int depth;
+    std::uint64_t thread;
+    std::uint64_t this_fn;
+    std::uint64_t call_site;
+    std::uint64_t timestamp;
+};
+
+/**The layout of `__metal_calltrace_buffer` on the target.
+ * It is obtained once from the debug information and then used to decode the raw memory of the buffer.
+ */
+class calltrace_event_buffer
+{
+    bool _little_endian = true;
+    std::size_t _record_size;
+
+    target_field _type;
+    target_field _depth;
+    target_field _thread;
+    target_field _this_fn;
+    target_field _call_site;
+    target_field _timestamp;
+
+    int _enter_value;
+
+public:
+    calltrace_event_buffer(metal::debug::frame & fr)
+        : _record_size(std::stoull(fr.print("sizeof(struct __metal_calltrace_record)").value)),
+          _type     (target_field::of(fr, "struct __metal_calltrace_record", "type")),
+          _depth    (target_field::of(fr, "struct __metal_calltrace_record", "depth")),
+          _thread   (target_field::of(fr, "struct __metal_calltrace_record", "thread")),
+          _this_fn  (target_field::of(fr, "struct __metal_calltrace_record", "this_fn")),
+          _call_site(target_field::of(fr, "struct __metal_calltrace_record", "call_site")),
+          _timestamp(target_field::of(fr, "struct __metal_calltrace_record", "timestamp")),
+          _enter_value(std::stoi(fr.print("(int)metal_enter").value))
+    {
+        _little_endian = target_little_endian(fr);
+    }
+
+    ///Read all recorded events with one memory access.
+    std::vector<calltrace_event> read(metal::debug::frame & fr, std::uint64_t address) const
+    {
+        auto used = std::stoull(fr.print("__metal_calltrace_buffer_used").value);
+        std::vector<calltrace_event> events;
+        if (used == 0u)
+            return events;
+
+        auto data = fr.read_memory(address, used * _record_size);
+        events.reserve(used);
+
+        for (auto itr = data.data(); itr + _record_size <= data.data() + data.size(); itr += _record_size)
+        {
+            calltrace_event ev;
+            ev.enter     = static_cast<int>(_type.get(itr, _little_endian)) == _enter_value;
+            ev.depth     = static_cast<int>(_depth.get(itr, _little_endian));
+            ev.thread    = _thread.get(itr, _little_endian);
+            ev.this_fn   = _this_fn.get(itr, _little_endian);
+            ev.call_site = _call_site.get(itr, _little_endian);
+            ev.timestamp = _timestamp.get(itr, _little_endian);
+            events.push_back(ev);
+        }
+        return events;
+    }
+};
+
+#endif /* CALLTRACE_EVENT_BUFFER_HPP_ */
@@ -10,129 +10,140 @@
 #include <iostream>
 #include <boost/optional.hpp>
 #include <boost/algorithm/string/replace.hpp>
-#include <sstream>
 
 using namespace std;
 
 struct hrf_sink_t : data_sink_t
 {
-    std::ostream * os = &std::cout;
+    metal::sink::hrf_stream os;
 
     std::string group{"__metal_call"};
 
-    std::ostream & loc(const std::string & file, int line)
-    {
-        return *os << boost::replace_all_copy(file, "\\\\", "\\") << '(' << line << ')';
-    }
+    hrf_sink_t(std::ostream & os, const metal::sink::hrf_options & options) : os(os, options) {}
 
     virtual ~hrf_sink_t() = default;
 
+    void flush() override
+    {
+        os.flush();
+    }
 
-    std::string loc(const boost::optional<metal::debug::address_info> & location)
+    void loc(const boost::optional<metal::debug::address_info> & location)
     {
         if (!location)
-            return "***unknown location***(0)";
+            os.write("***unknown location***(0)");
         else
-            return boost::replace_all_copy(location->file, "\\\\", "\\") + "(" + std::to_string(location->line) + ")";
+            os.print("{}({})", boost::replace_all_copy(location->file, "\\\\", "\\"), location->line);
     }
 
-    std::string fn(std::uint64_t ptr, const boost::optional<metal::debug::address_info> & func)
+    void fn(std::uint64_t ptr, const boost::optional<metal::debug::address_info> & func)
     {
-        std::stringstream ss;
         if (!func || !func->function)
-            ss << "@0x" << std::hex << ptr << ":***unknown function***";
+            os.print("@0x{:x}:***unknown function***", ptr);
         else
-            ss << "@0x" << std::hex << ptr << ":" << *func->function;
-
-        return ss.str();
+            os.print("@0x{:x}:{}", ptr, *func->function);
     }
 
-    void enter(std::uint64_t      func_ptr, const boost::optional<metal::debug::address_info> & func,
-               std::uint64_t call_site_ptr, const boost::optional<metal::debug::address_info>& call_site,
-               const boost::optional<std::uint64_t> & ts) override
+    void timestamp(const boost::optional<std::uint64_t> & ts)
     {
-        *os << "metal.calltrace entering function [" << fn(func_ptr, func) << "]";
         if (ts)
-            *os << ", with timestamp " << *ts;
+            os.print(", with timestamp {}", *ts);
+    }
+
+    void call(const char * mode, std::uint64_t func_ptr, const boost::optional<metal::debug::address_info> & func,
+              const boost::optional<metal::debug::address_info>& call_site, const boost::optional<std::uint64_t> & ts,
+              std::uint64_t thread)
+    {
+        os.print("metal.calltrace {} function [", mode);
+        fn(func_ptr, func);
+        os.write(']');
+        timestamp(ts);
 
         if (call_site)
-            *os << ", at "  << loc(call_site);
-        *os << std::endl;
+        {
+            os.write(", at ");
+            loc(call_site);
+        }
+        if (thread != 0u)
+            os.print(", in thread 0x{:x}", thread);
+        os.end_record();
+    }
+
+    void enter(std::uint64_t      func_ptr, const boost::optional<metal::debug::address_info> & func,
+               std::uint64_t call_site_ptr, const boost::optional<metal::debug::address_info>& call_site,
+               const boost::optional<std::uint64_t> & ts, std::uint64_t thread) override
+    {
+        call("entering", func_ptr, func, call_site, ts, thread);
     }
     void exit (std::uint64_t      func_ptr, const boost::optional<metal::debug::address_info> & func,
                std::uint64_t call_site_ptr, const boost::optional<metal::debug::address_info>& call_site,
-               const boost::optional<std::uint64_t> & ts) override
+               const boost::optional<std::uint64_t> & ts, std::uint64_t thread) override
     {
-        *os << "metal.calltrace  exiting function [" << fn(func_ptr, func) << "]";
-        if (ts)
-            *os << ", with timestamp " << *ts;
-
-        if (call_site)
-            *os << ", at "  << loc(call_site);
-        *os << std::endl;
+        call(" exiting", func_ptr, func, call_site, ts, thread);
     }
 
     void set(const calltrace_clone & cc, const boost::optional<std::uint64_t> & ts) override
     {
-        *os << "metal.calltrace   registered calltrace @0x" << std::hex << cc.location() << std::dec <<" [" << fn(cc.fn().address, cc.fn().info) <<  "]: ";
-
-        *os << "{";
+        os.print("metal.calltrace   registered calltrace @0x{:x} [", cc.location());
+        fn(cc.fn().address, cc.fn().info);
+        os.write("]: {");
 
         for (const auto & val : cc.content())
         {
             if (&val != &cc.content().front())
-                *os << ", ";
+                os.write(", ");
 
             if (val.address == 0ull)
-                *os << "**any**";
+                os.write("**any**");
             else
-                *os << "[" << fn(val.address, val.info) << "]";
+            {
+                os.write('[');
+                fn(val.address, val.info);
+                os.write(']');
+            }
         }
-        *os << "}";
-
-        if (ts)
-            *os << ", with timestamp " << *ts;
-
-        *os << std::endl;
+        os.write('}');
+        timestamp(ts);
+        os.end_record();
     }
 
     void reset(const calltrace_clone & cc, int error_cnt, const boost::optional<std::uint64_t> & ts) override
     {
-        *os << "metal.calltrace unregistered calltrace @0x" << std::hex << cc.location() << std::dec
-            << " executed " << cc.repeated() << " times, with " << error_cnt << " errors";
-        if (ts)
-            *os << ", with timestamp " << *ts;
-        *os << std::endl;
+        os.print("metal.calltrace unregistered calltrace @0x{:x} executed {} times, with {} errors", cc.location(), cc.repeated(), error_cnt);
+        timestamp(ts);
+        os.end_record();
     }
 
     void overflow(const calltrace_clone & cc, std::uint64_t addr, const boost::optional<metal::debug::address_info> & ai) override
     {
-        *os << "metal.calltrace.error overflow in calltrace @0x" << std::hex << cc.location()
-            << std::dec << " with size " << cc.content().size() << " at [" << fn(addr, ai) << "]" << std::endl;
+        os.print("metal.calltrace.error overflow in calltrace @0x{:x} with size {} at [", cc.location(), cc.content().size());
+        fn(addr, ai);
+        os.write(']').end_record();
     }
     void mismatch(const calltrace_clone & cc, std::uint64_t addr, const boost::optional<metal::debug::address_info> & ai) override
     {
-         *os << "metal.calltrace.error mismatch in calltrace @0x" << std::hex << cc.location() << std::dec << " at pos " << cc.current_position() 
-             << " {[" << fn(addr, ai) << "] != [" << fn(cc.previous().address, cc.previous().info) << "]}" << std::endl;
+        os.print("metal.calltrace.error mismatch in calltrace @0x{:x} at pos {} {{[", cc.location(), cc.current_position());
+        fn(addr, ai);
+        os.write("] != [");
+        fn(cc.previous().address, cc.previous().info);
+        os.write("]}").end_record();
     }
     void incomplete(const calltrace_clone & cc, int position) override
     {
-        auto sz = cc.content().size();
-        *os << "metal.calltrace.error incomplete in calltrace @0x" << std::hex << cc.location() << std::dec
-            << " stopped " << position << "/" << sz << std::endl;
+        os.print("metal.calltrace.error incomplete in calltrace @0x{:x} stopped {}/{}", cc.location(), position, cc.content().size());
+        os.end_record();
     }
 
     void timestamp_unavailable() override
     {
-        *os << "metal.calltrace.error timestamp not available" << std::endl;
+        os.write("metal.calltrace.error timestamp not available").end_record();
     }
 };
 
 boost::optional<hrf_sink_t> hrf_sink;
 
-data_sink_t * get_hrf_sink(std::ostream & os)
+data_sink_t * get_hrf_sink(std::ostream & os, const metal::sink::hrf_options & options)
 {
-    hrf_sink.emplace();
-    hrf_sink->os = &os;
+    hrf_sink.emplace(os, options);
     return &*hrf_sink;
 }
@@ -7,16 +7,13 @@
 
  */
 #include "sink.hpp"
+#include "../sink/json_stream.hpp"
 #include <iostream>
-#include <stack>
 
 #include <boost/algorithm/string/replace.hpp>
 #include <boost/optional.hpp>
 
-#include <rapidjson/rapidjson.h>
-#include <rapidjson/document.h>
-#include <rapidjson/filewritestream.h>
-#include <rapidjson/prettywriter.h>
+#include <rapidjson/stringbuffer.h>
 
 using namespace std;
 
@@ -24,269 +21,294 @@ namespace rj = rapidjson;
 
 struct json_sink_t : data_sink_t
 {
-    std::ostream * os = &std::cout;
+    metal::sink::json_stream js;
 
-    rj::Document doc;
-    rj::Value calls;
-    rj::Value errors;
+    //the errors are few, so they get collected until the calls are complete.
+    rj::StringBuffer errors;
+    bool has_errors = false;
 
-    void add_to_calls(rj::Value && val)
+    template<typename Func>
+    void add_to_calls(Func && func)
     {
-        calls.PushBack(std::move(val), doc.GetAllocator());
+        js.event([&](auto & w)
+                {
+                    w.StartObject();
+                    func(w);
+                    w.EndObject();
+                });
+    }
+
+    template<typename Func>
+    void add_to_errors(Func && func)
+    {
+        if (js.ndjson())
+        {
+            add_to_calls(func);
+            return;
+        }
+
+        if (has_errors)
+            errors.Put(',');
+        has_errors = true;
+
+        rj::Writer<rj::StringBuffer> w(errors);
+        w.StartObject();
+        func(w);
+        w.EndObject();
     }
 
-    rj::Value loc(const std::string & file, int line)
+    template<typename Writer>
+    static void loc(Writer & w, const std::string & file, int line)
     {
-        rj::Value val;
-        val.SetObject();
-        val.AddMember("file", boost::replace_all_copy(file, "\\\\", "\\"), doc.GetAllocator());
-        val.AddMember("line", line, doc.GetAllocator());
-        return val;
+        w.Key("file"); w.String(boost::replace_all_copy(file, "\\\\", "\\"));
+        w.Key("line"); w.Int(line);
     }
 
-    json_sink_t()
+    json_sink_t(std::ostream & os, bool ndjson) : js(os, ndjson)
     {
-        doc.SetObject();
-        calls.SetArray();
-        errors.SetArray();
+        js.nested([](auto & w)
+                {
+                    w.StartObject();
+                    w.Key("calls");
+                    w.StartArray();
+                });
     }
     virtual ~json_sink_t()
     {
-        doc.AddMember("calls",  std::move(calls),  doc.GetAllocator());
-        doc.AddMember("errors", std::move(errors), doc.GetAllocator());
-
-        rj::StringBuffer buffer;
-        rj::PrettyWriter<rapidjson::StringBuffer> writer(buffer);
-
-        doc.Accept(writer);
+        js.nested([&](auto & w)
+                {
+                    w.EndArray();
+                    w.Key("errors");
+                    std::string arr = "[";
+                    arr.append(errors.GetString(), errors.GetSize());
+                    arr += "]";
+                    w.RawValue(arr.c_str(), arr.size(), rj::kArrayType);
+                    w.EndObject();
+                });
+    }
 
-        *os << buffer.GetString();
+    void flush() override
+    {
+        js.flush();
     }
 
-    rj::Value address_info(const metal::debug::address_info & ai)
+    template<typename Writer>
+    static void address_info(Writer & w, const metal::debug::address_info & ai)
     {
-        rj::Value val;
-        val.SetObject();
-        val.AddMember("file", ai.file, doc.GetAllocator());
+        w.StartObject();
+        w.Key("file"); w.String(ai.file);
         if (ai.full_name)
-            val.AddMember("full_name",  boost::replace_all_copy(*ai.full_name, "\\\\", "\\"), doc.GetAllocator());
-        val.AddMember("line", static_cast<int>(ai.line), doc.GetAllocator());
+        {
+            w.Key("full_name"); w.String(boost::replace_all_copy(*ai.full_name, "\\\\", "\\"));
+        }
+        w.Key("line"); w.Int(static_cast<int>(ai.line));
         if (ai.function)
-            val.AddMember("function", *ai.function, doc.GetAllocator());
+        {
+            w.Key("function"); w.String(*ai.function);
+        }
         if (ai.offset)
-            val.AddMember("offset", *ai.offset, doc.GetAllocator());
-
-        return val;
+        {
+            w.Key("offset"); w.Uint64(*ai.offset);
+        }
+        w.EndObject();
     }
 
-    rj::Value ct_entry(const calltrace_clone_entry & cce)
+    template<typename Writer>
+    static void ct_entry(Writer & w, const calltrace_clone_entry & cce)
     {
-        rj::Value val;
-        val.SetObject();
-        val.AddMember("address", cce.address, doc.GetAllocator());
+        w.StartObject();
+        w.Key("address"); w.Uint64(cce.address);
 
         if (cce.info)
-            val.AddMember("info", address_info(*cce.info), doc.GetAllocator());
+        {
+            w.Key("info");
+            address_info(w, *cce.info);
+        }
+        w.EndObject();
+    }
 
-        return val;
+    void call(const char * mode,
+              std::uint64_t      func_ptr, const boost::optional<metal::debug::address_info>& func,
+              std::uint64_t call_site_ptr, const boost::optional<metal::debug::address_info>& call_site,
+              const boost::optional<std::uint64_t> & ts, std::uint64_t thread)
+    {
+        add_to_calls([&](auto & w)
+                {
+                    w.Key("mode");          w.String(mode);
+                    w.Key("this_fn_ptr");   w.Uint64(func_ptr);
+                    w.Key("call_site_ptr"); w.Uint64(call_site_ptr);
+
+                    if (func)
+                    {
+                        w.Key("this_fn");
+                        address_info(w, *func);
+                    }
+                    if (call_site)
+                    {
+                        w.Key("call_site");
+                        address_info(w, *call_site);
+                    }
+                    if (ts)
+                    {
+                        w.Key("timestamp"); w.Uint64(*ts);
+                    }
+                    if (thread != 0u)
+                    {
+                        w.Key("thread"); w.Uint64(thread);
+                    }
+                });
     }
 
     void enter(std::uint64_t      func_ptr, const boost::optional<metal::debug::address_info>& func,
                std::uint64_t call_site_ptr, const boost::optional<metal::debug::address_info>& call_site,
-               const boost::optional<std::uint64_t> & ts) override
+               const boost::optional<std::uint64_t> & ts, std::uint64_t thread) override
     {
-        rj::Value val;
-        val.SetObject();
-        val.AddMember("mode", "enter", doc.GetAllocator());
-        val.AddMember("this_fn_ptr",    func_ptr, doc.GetAllocator());
-        val.AddMember("call_site_ptr", call_site_ptr, doc.GetAllocator());
-
-        if (func)
-            val.AddMember("this_fn", address_info(*func), doc.GetAllocator());
-        if (call_site)
-            val.AddMember("call_site", address_info(*call_site), doc.GetAllocator());
-
-        if (ts)
-            val.AddMember("timestamp", *ts, doc.GetAllocator());
-
-        add_to_calls(std::move(val));
+        call("enter", func_ptr, func, call_site_ptr, call_site, ts, thread);
     }
     void exit (std::uint64_t      func_ptr, const boost::optional<metal::debug::address_info>& func,
                std::uint64_t call_site_ptr, const boost::optional<metal::debug::address_info>& call_site,
-               const boost::optional<std::uint64_t> & ts) override
+               const boost::optional<std::uint64_t> & ts, std::uint64_t thread) override
     {
-        rj::Value val;
-        val.SetObject();
-        val.AddMember("mode", "exit", doc.GetAllocator());
-        val.AddMember("this_fn_ptr",    func_ptr, doc.GetAllocator());
-        val.AddMember("call_site_ptr", call_site_ptr, doc.GetAllocator());
-        if (func)
-            val.AddMember("this_fn", address_info(*func), doc.GetAllocator());
-        if (call_site)
-            val.AddMember("call_site", address_info(*call_site), doc.GetAllocator());
-
-        if (ts)
-            val.AddMember("timestamp", *ts, doc.GetAllocator());
-
-        add_to_calls(std::move(val));
+        call("exit", func_ptr, func, call_site_ptr, call_site, ts, thread);
     }
 
     void set(const calltrace_clone & cc, const boost::optional<std::uint64_t> & ts) override
     {
-        rj::Value val;
-        val.SetObject();
-        val.AddMember("mode", "set", doc.GetAllocator());
-        if (ts)
-            val.AddMember("timestamp", *ts, doc.GetAllocator());
-
-
-        rj::Value ct;
-        ct.SetObject();
-
-        ct.AddMember("location", cc.location(), doc.GetAllocator());
-        ct.AddMember("repeat", cc.repeat(), doc.GetAllocator());
-        ct.AddMember("skip",   cc.skip(), doc.GetAllocator());
-        ct.AddMember("fn", ct_entry(cc.fn()), doc.GetAllocator());
-
-        rj::Value arr;
-        arr.SetArray();
-        arr.Reserve(cc.content().size(), doc.GetAllocator());
-
-        for (auto & c : cc.content())
-        {
-            rj::Value val;
-            val.SetObject();
-            val.AddMember("address", c.address, doc.GetAllocator());
-            if (c.address == 0)
-                arr.PushBack(rj::Value().SetNull(), doc.GetAllocator());
-            else
-            {
-                rj::Value val;
-                val.SetObject();
-                val.AddMember("address", c.address, doc.GetAllocator());
-                if (c.info)
+        add_to_errors([&](auto & w)
                 {
-                    auto & i = *c.info;
-                    if (i.function)
-                        val.AddMember("fn", *i.function, doc.GetAllocator());
-                    val.AddMember("line", static_cast<int>(i.line), doc.GetAllocator());
-                    val.AddMember("file", boost::replace_all_copy(i.file, "\\\\", "\\"), doc.GetAllocator());
-                    if (i.full_name)
-                        val.AddMember("full_name", boost::replace_all_copy(*i.full_name, "\\\\", "\\"), doc.GetAllocator());
-                }
-
-                arr.PushBack(std::move(val), doc.GetAllocator());
-            }
-            arr.PushBack(std::move(val), doc.GetAllocator());
-        }
-        val.AddMember("calltrace", std::move(ct), doc.GetAllocator());
-
-        errors.PushBack(std::move(val), doc.GetAllocator());
+                    w.Key("mode"); w.String("set");
+                    if (ts)
+                    {
+                        w.Key("timestamp"); w.Uint64(*ts);
+                    }
+
+                    w.Key("calltrace");
+                    w.StartObject();
+                    w.Key("location"); w.Uint64(cc.location());
+                    w.Key("repeat");   w.Int(cc.repeat());
+                    w.Key("skip");     w.Int(cc.skip());
+                    w.Key("fn");       ct_entry(w, cc.fn());
+
+                    w.Key("content");
+                    w.StartArray();
+                    for (auto & c : cc.content())
+                    {
+                        if (c.address == 0)
+                        {
+                            w.Null();
+                            continue;
+                        }
+                        w.StartObject();
+                        w.Key("address"); w.Uint64(c.address);
+                        if (c.info)
+                        {
+                            auto & i = *c.info;
+                            if (i.function)
+                            {
+                                w.Key("fn"); w.String(*i.function);
+                            }
+                            loc(w, i.file, static_cast<int>(i.line));
+                            if (i.full_name)
+                            {
+                                w.Key("full_name"); w.String(boost::replace_all_copy(*i.full_name, "\\\\", "\\"));
+                            }
+                        }
+                        w.EndObject();
+                    }
+                    w.EndArray();
+                    w.EndObject();
+                });
     }
 
     void reset(const calltrace_clone & cc, int error_cnt, const boost::optional<std::uint64_t> & ts)
     {
-        rj::Value val;
-        val.SetObject();
-        val.AddMember("mode", "reset", doc.GetAllocator());
-        if (ts)
-            val.AddMember("timestamp", *ts, doc.GetAllocator());
-
-        rj::Value ct;
-        ct.SetObject();
-        ct.AddMember("location", cc.location(), doc.GetAllocator());
-        ct.AddMember("repeat", cc.repeat(), doc.GetAllocator());
-
-        val.AddMember("calltrace", std::move(ct), doc.GetAllocator());
+        add_to_errors([&](auto & w)
+                {
+                    w.Key("mode"); w.String("reset");
+                    if (ts)
+                    {
+                        w.Key("timestamp"); w.Uint64(*ts);
+                    }
+
+                    w.Key("calltrace");
+                    w.StartObject();
+                    w.Key("location"); w.Uint64(cc.location());
+                    w.Key("repeat");   w.Int(cc.repeat());
+                    w.EndObject();
+                });
+    }
 
-        errors.PushBack(std::move(val), doc.GetAllocator());
+    template<typename Writer>
+    static void error_calltrace(Writer & w, const calltrace_clone & cc)
+    {
+        w.Key("calltrace");
+        w.StartObject();
+        w.Key("location"); w.Uint64(cc.location());
+        w.Key("repeated"); w.Int(cc.repeated());
+        w.EndObject();
+        w.Key("location"); w.Uint64(cc.location());
     }
 
     void overflow(const calltrace_clone & cc, std::uint64_t addr, const boost::optional<metal::debug::address_info> & ai) override
     {
-        rj::Value val;
-        val.SetObject();
-
-        val.AddMember("mode", "error", doc.GetAllocator());
-        val.AddMember("type", "overflow", doc.GetAllocator());
-        val.AddMember("calltrace_loc", cc.location(), doc.GetAllocator());
-        val.AddMember("function_ptr", addr, doc.GetAllocator());
-        if (ai)
-            val.AddMember("function", address_info(*ai), doc.GetAllocator());
-
-        rj::Value ct;
-        ct.SetObject();
-        ct.AddMember("location", cc.location(), doc.GetAllocator());
-        ct.AddMember("repeated", cc.repeated(), doc.GetAllocator());
-
-        val.AddMember("calltrace", std::move(ct), doc.GetAllocator());
-        val.AddMember("location", cc.location(), doc.GetAllocator());
-
-        errors.PushBack(std::move(val), doc.GetAllocator());
+        add_to_errors([&](auto & w)
+                {
+                    w.Key("mode"); w.String("error");
+                    w.Key("type"); w.String("overflow");
+                    w.Key("calltrace_loc"); w.Uint64(cc.location());
+                    w.Key("function_ptr");  w.Uint64(addr);
+                    if (ai)
+                    {
+                        w.Key("function");
+                        address_info(w, *ai);
+                    }
+                    error_calltrace(w, cc);
+                });
     }
     void mismatch(const calltrace_clone & cc, std::uint64_t addr, const boost::optional<metal::debug::address_info> & ai) override
     {
-        rj::Value val;
-        val.SetObject();
-
-        val.AddMember("mode", "error", doc.GetAllocator());
-        val.AddMember("type", "mismatch", doc.GetAllocator());
-        val.AddMember("function_ptr", addr, doc.GetAllocator());
-
-        if (ai)
-            val.AddMember("function", address_info(*ai), doc.GetAllocator());
-
-        rj::Value ct;
-        ct.SetObject();
-        ct.AddMember("location", cc.location(), doc.GetAllocator());
-        ct.AddMember("repeated", cc.repeated(), doc.GetAllocator());
-
-        val.AddMember("calltrace", std::move(ct), doc.GetAllocator());
-        val.AddMember("location", cc.location(), doc.GetAllocator());
-
-        errors.PushBack(std::move(val), doc.GetAllocator());
+        add_to_errors([&](auto & w)
+                {
+                    w.Key("mode"); w.String("error");
+                    w.Key("type"); w.String("mismatch");
+                    w.Key("function_ptr"); w.Uint64(addr);
+                    if (ai)
+                    {
+                        w.Key("function");
+                        address_info(w, *ai);
+                    }
+                    error_calltrace(w, cc);
+                });
     }
 
     void incomplete(const calltrace_clone & cc, int position) override
     {
-        rj::Value val;
-        val.SetObject();
-
-        val.AddMember("mode", "error", doc.GetAllocator());
-        val.AddMember("type", "incomplete", doc.GetAllocator());
-
-        val.AddMember("position", position, doc.GetAllocator());
-        val.AddMember("size", static_cast<uint64_t>(cc.content().size()), doc.GetAllocator());
-
-        rj::Value ct;
-        ct.SetObject();
-        ct.AddMember("location", cc.location(), doc.GetAllocator());
-        ct.AddMember("repeated", cc.repeated(), doc.GetAllocator());
-
-        val.AddMember("calltrace", std::move(ct), doc.GetAllocator());
-        val.AddMember("location", cc.location(), doc.GetAllocator());
-
-        errors.PushBack(std::move(val), doc.GetAllocator());
+        add_to_errors([&](auto & w)
+                {
+                    w.Key("mode"); w.String("error");
+                    w.Key("type"); w.String("incomplete");
+                    w.Key("position"); w.Int(position);
+                    w.Key("size");     w.Uint64(cc.content().size());
+                    error_calltrace(w, cc);
+                });
     }
 
 
     void timestamp_unavailable() override
     {
-        rj::Value val;
-        val.SetObject();
-        val.AddMember("mode", "error", doc.GetAllocator());
-        val.AddMember("type", "missing-timestamp", doc.GetAllocator());
-
-        errors.PushBack(std::move(val), doc.GetAllocator());
+        add_to_errors([&](auto & w)
+                {
+                    w.Key("mode"); w.String("error");
+                    w.Key("type"); w.String("missing-timestamp");
+                });
     }
 };
 
 
 boost::optional<json_sink_t> json_sink;
 
-data_sink_t * get_json_sink(std::ostream & os)
+data_sink_t * get_json_sink(std::ostream & os, bool ndjson)
 {
-    json_sink.emplace();
-    json_sink->os = &os;
+    json_sink.emplace(os, ndjson);
     return &*json_sink;
 }
@@ -0,0 +1,122 @@
+/**
+ * @file   profile_sink.cpp
+ * @date   19.10.2026
+ * @author Klemens D. Morgenstern
+ *
+
+ The profiling sinks build the call tree on the host, so the memory is bounded by the number of distinct call paths.
+ The result is written when the sink gets flushed at the end of the run.
+
+ */
+#include "sink.hpp"
+#include "../sink/call_graph.hpp"
+
+#include <boost/optional.hpp>
+
+#include <algorithm>
+#include <unordered_map>
+#include <vector>
+
+using namespace std;
+
+struct profile_sink_t : data_sink_t
+{
+    enum format_t {folded, report, json};
+
+    std::ostream & os;
+    format_t format;
+    bool written = false;
+
+    metal::sink::call_graph graph{"metal.calltrace"};
+
+    struct active_call
+    {
+        std::size_t node;
+        std::uint64_t start;
+        std::uint64_t children;
+    };
+    //every thread has its own stack, the call graph of all threads is merged.
+    std::unordered_map<std::uint64_t, std::vector<active_call>> stacks;
+
+    profile_sink_t(std::ostream & os, format_t format) : os(os), format(format) {}
+
+    void enter(std::uint64_t      func_ptr, const boost::optional<metal::debug::address_info>& func,
+               std::uint64_t call_site_ptr, const boost::optional<metal::debug::address_info>& call_site,
+               const boost::optional<std::uint64_t> & ts, std::uint64_t thread) override
+    {
+        if (func && func->function)
+            graph.set_name(func_ptr, *func->function);
+
+        graph.ticks = graph.ticks || ts;
+
+        auto & stack = stacks[thread];
+        auto idx = graph.child(stack.empty() ? graph.root : stack.back().node, func_ptr);
+        graph[idx].calls++;
+        stack.push_back({idx, ts.value_or(0u), 0u});
+    }
+
+    void exit (std::uint64_t      func_ptr, const boost::optional<metal::debug::address_info>& func,
+               std::uint64_t call_site_ptr, const boost::optional<metal::debug::address_info>& call_site,
+               const boost::optional<std::uint64_t> & ts, std::uint64_t thread) override
+    {
+        auto & stack = stacks[thread];
+        auto itr = std::find_if(stack.rbegin(), stack.rend(), [&](const active_call & ac){return graph[ac.node].fn == func_ptr;});
+        if (itr == stack.rend()) //the call started before we recorded.
+            return;
+
+        //calls above it did not exit regularly (e.g. longjmp), so they end here too.
+        auto cnt = std::distance(stack.rbegin(), itr) + 1;
+        for (auto i = 0; i < cnt; i++)
+        {
+            auto ac = stack.back();
+            stack.pop_back();
+
+            auto incl = (ts && (*ts > ac.start)) ? (*ts - ac.start) : 0u;
+            graph[ac.node].add(incl, incl - std::min(incl, ac.children));
+
+            if (!stack.empty())
+                stack.back().children += incl;
+        }
+    }
+
+    void set  (const calltrace_clone &, const boost::optional<std::uint64_t> &) override {}
+    void reset(const calltrace_clone &, int, const boost::optional<std::uint64_t> &) override {}
+
+    void overflow(const calltrace_clone &, std::uint64_t, const boost::optional<metal::debug::address_info> &) override {}
+    void mismatch(const calltrace_clone &, std::uint64_t, const boost::optional<metal::debug::address_info> &) override {}
+
+    void incomplete(const calltrace_clone &, int) override {}
+    void timestamp_unavailable() override {}
+
+    //everything is kept until the end, so the result is written at the first flush, which is done at the end of the run.
+    void flush() override
+    {
+        if (written)
+            return;
+        written = true;
+
+        switch (format)
+        {
+        case folded: graph.write_folded(os); break;
+        case report: graph.write_report(os); break;
+        case json:   graph.write_json(os);   break;
+        }
+        os.flush();
+    }
+};
+
+boost::optional<profile_sink_t> profile_sink;
+
+data_sink_t * get_profile_sink(std::ostream & os, const std::string & format)
+{
+    if (format == "folded")
+        profile_sink.emplace(os, profile_sink_t::folded);
+    else if (format == "profile")
+        profile_sink.emplace(os, profile_sink_t::report);
+    else if (format == "profile-json")
+        profile_sink.emplace(os, profile_sink_t::json);
+    else
+        return nullptr;
+
+    return &*profile_sink;
+}
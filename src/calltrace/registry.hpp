@@ -0,0 +1,118 @@
+/**
+ * @file   src/calltrace/registry.hpp
+ * @date   19.10.2026
+ * @author Klemens D. Morgenstern
+ *
+
+ */
+
+#ifndef CALLTRACE_REGISTRY_HPP_
+#define CALLTRACE_REGISTRY_HPP_
+
+#include "calltrace_clone.hpp"
+
+#include <algorithm>
+#include <list>
+#include <unordered_map>
+#include <vector>
+
+/**The registered calltraces, indexed like on the target.
+ * The inactive ones are found by the function they trace, the active ones are on a stack ordered by their start depth.
+ */
+class calltrace_registry
+{
+    std::list<calltrace_clone> _cts;
+    std::unordered_map<std::uint64_t, std::vector<calltrace_clone*>> _by_fn;
+    std::vector<calltrace_clone*> _active;
+
+    //the first of the topmost calltraces of the thread that match, the ones of other threads might be in between.
+    template<typename Pred>
+    std::vector<calltrace_clone*>::iterator _first_of(std::uint64_t thread, Pred && pred)
+    {
+        auto first = _active.end();
+        for (auto itr = _active.end(); itr != _active.begin(); itr--)
+        {
+            auto ct = *std::prev(itr);
+            if (ct->thread() != thread)
+                continue;
+            if (!pred(ct))
+                break;
+            first = std::prev(itr);
+        }
+        return first;
+    }
+
+    void _erase(std::list<calltrace_clone>::iterator itr)
+    {
+        auto & vec = _by_fn[itr->fn().address];
+        vec.erase(std::remove(vec.begin(), vec.end(), &*itr), vec.end());
+        if (vec.empty())
+            _by_fn.erase(itr->fn().address);
+
+        _active.erase(std::remove(_active.begin(), _active.end(), &*itr), _active.end());
+        _cts.erase(itr);
+    }
+public:
+    bool empty() const {return _cts.empty();}
+
+    calltrace_clone & add(calltrace_clone && cc)
+    {
+        _cts.push_back(std::move(cc));
+        auto & ct = _cts.back();
+        _by_fn[ct.fn().address].push_back(&ct);
+        return ct;
+    }
+
+    ///Remove the calltraces registered before the one at the location in order, `func` gets called before each is erased.
+    template<typename Func>
+    void remove_until(std::uint64_t location, Func && func)
+    {
+        while (!_cts.empty() && (_cts.front().location() != location))
+        {
+            func(_cts.front());
+            _erase(_cts.begin());
+        }
+    }
+
+    ///A function at `depth` was entered in `thread`, `on_child` is called for every active calltrace that it belongs to.
+    template<typename Func>
+    void enter(std::uint64_t fn, int depth, std::uint64_t thread, Func && on_child)
+    {
+        std::for_each(_first_of(thread, [&](calltrace_clone * ct){return ct->my_child(depth);}), _active.end(),
+                [&](calltrace_clone * ct)
+                {
+                    if (ct->thread() == thread)
+                        on_child(*ct);
+                });
+
+        auto itr = _by_fn.find(fn);
+        if (itr == _by_fn.end())
+            return;
+
+        for (auto ct : itr->second)
+        {
+            if (ct->inactive() && ((ct->repeat() > ct->repeated()) || (ct->repeat() == 0)))
+            {
+                if (ct->to_skip())
+                    ct->add_skipped();
+                else
+                {
+                    ct->start(depth, thread);
+                    _active.push_back(ct);
+                }
+            }
+        }
+    }
+
+    ///A function at `depth` was exited in `thread`, `on_stop` is called for every calltrace that started there.
+    template<typename Func>
+    void exit(int depth, std::uint64_t thread, Func && on_stop)
+    {
+        auto first = _first_of(thread, [&](calltrace_clone * ct){return ct->my_depth(depth);});
+
+        std::for_each(first, _active.end(), [&](calltrace_clone * ct){if (ct->thread() == thread) on_stop(*ct);});
+        _active.erase(std::remove_if(first, _active.end(), [&](calltrace_clone * ct){return ct->thread() == thread;}), _active.end());
+    }
+};
+
+#endif /* CALLTRACE_REGISTRY_HPP_ */
@@ -12,15 +12,16 @@
 
 #include <metal/debug/frame.hpp>
 #include "calltrace_clone.hpp"
+#include "../sink/hrf_stream.hpp"
 
 struct data_sink_t
 {
     virtual void enter(std::uint64_t      func_ptr, const boost::optional<metal::debug::address_info>& func,
                        std::uint64_t call_site_ptr, const boost::optional<metal::debug::address_info>& call_site,
-                       const boost::optional<std::uint64_t> & ts = boost::none) = 0;
+                       const boost::optional<std::uint64_t> & ts = boost::none, std::uint64_t thread = 0u) = 0;
     virtual void exit (std::uint64_t      func_ptr, const boost::optional<metal::debug::address_info>& func,
                        std::uint64_t call_site_ptr, const boost::optional<metal::debug::address_info>& call_site,
-                       const boost::optional<std::uint64_t> & ts = boost::none) = 0;
+                       const boost::optional<std::uint64_t> & ts = boost::none, std::uint64_t thread = 0u) = 0;
 
     virtual void set  (const calltrace_clone & cc, const boost::optional<std::uint64_t> & ts) = 0;
     virtual void reset(const calltrace_clone & cc, int error_cnt, const boost::optional<std::uint64_t> & ts) = 0;
@@ -30,14 +31,22 @@ struct data_sink_t
 
     virtual void incomplete(const calltrace_clone & cc, int missing) = 0;
     virtual void timestamp_unavailable() = 0;
+    ///Write out everything that is buffered.
+    virtual void flush() = 0;
 
     virtual ~data_sink_t() = default;
 
 
 };
 
-data_sink_t * get_hrf_sink (std::ostream & os);
-data_sink_t * get_json_sink(std::ostream & os);
+data_sink_t * get_hrf_sink (std::ostream & os, const metal::sink::hrf_options & options = {});
+data_sink_t * get_json_sink(std::ostream & os, bool ndjson = false);
+///The profiling sinks, the format is one of folded, profile or profile-json. Returns nullptr for any other format.
+data_sink_t * get_profile_sink(std::ostream & os, const std::string & format);
+///The compact binary format, that can be converted with metal.calltrace-decode. The stream needs to be opened in binary mode.
+data_sink_t * get_bin_sink(std::ostream & os);
+///The trace event format of chrome://tracing and perfetto, the timestamps get multiplied by tick_us.
+data_sink_t * get_chrome_sink(std::ostream & os, double tick_us);
 
 
 #endif /* SINK_HPP_ */
@@ -0,0 +1,267 @@
+/**
+ * @file   src/calltrace/symbol_cache.hpp
+ * @date   19.10.2026
+ * @author Klemens D. Morgenstern
+ *
+
+ */
+
+#ifndef CALLTRACE_SYMBOL_CACHE_HPP_
+#define CALLTRACE_SYMBOL_CACHE_HPP_
+
+#include <metal/debug/frame.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/filesystem/fstream.hpp>
+#include <boost/optional.hpp>
+#include <boost/core/demangle.hpp>
+
+#include <algorithm>
+#include <iostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "../elf/elf_file.hpp"
+#include "../elf/line_table.hpp"
+
+/**The results of addr2line, which can be stored in a file so the next run of the same binary doesn't need to resolve them again.
+ * The file is keyed by the build-id of the binary, or by its size and modification time if it has none.
+ * The addresses are stored as linked, so the entries of a PIE stay valid, wherever it gets loaded.
+ */
+class symbol_cache
+{
+    std::unordered_map<std::uint64_t, boost::optional<metal::debug::address_info>> _map;
+
+    boost::filesystem::path _file;
+    std::string _key;
+    bool _modified = false;
+
+    //the link-time address of the anchor symbol and the load bias determined from it.
+    boost::optional<std::uint64_t> _anchor;
+    std::uint64_t _bias = 0u;
+
+    constexpr static const char * _header = "metal.calltrace.symbols";
+
+    static std::string _escape(const std::string & in)
+    {
+        std::string out;
+        out.reserve(in.size());
+        for (auto c : in)
+        {
+            if      (c == '\\') out += "\\\\";
+            else if (c == '\t') out += "\\t";
+            else if (c == '\n') out += "\\n";
+            else out.push_back(c);
+        }
+        return out;
+    }
+
+    static std::string _unescape(const std::string & in)
+    {
+        std::string out;
+        out.reserve(in.size());
+        for (auto itr = in.begin(); itr != in.end(); itr++)
+        {
+            if ((*itr == '\\') && ((itr + 1) != in.end()))
+            {
+                itr++;
+                out.push_back(*itr == 't' ? '\t' : (*itr == 'n' ? '\n' : *itr));
+            }
+            else
+                out.push_back(*itr);
+        }
+        return out;
+    }
+
+    static std::vector<std::string> _split(const std::string & line)
+    {
+        std::vector<std::string> res(1);
+        for (auto c : line)
+            if (c == '\t')
+                res.emplace_back();
+            else
+                res.back().push_back(c);
+        return res;
+    }
+
+    static boost::optional<std::string> _opt(const std::string & value)
+    {
+        if (value.empty())
+            return boost::none;
+        else
+            return _unescape(value);
+    }
+
+    void _load()
+    {
+        boost::filesystem::ifstream fs{_file};
+        std::string line;
+        if (!fs || !std::getline(fs, line) || (line != (_header + (" " + _key))))
+            return;
+
+        while (std::getline(fs, line))
+        {
+            auto fields = _split(line);
+            try
+            {
+                auto addr = std::stoull(fields[0], nullptr, 16);
+                if (fields.size() == 1)
+                    _map.emplace(addr, boost::none);
+                else if (fields.size() == 6)
+                {
+                    metal::debug::address_info ai;
+                    ai.line      = std::stoull(fields[1]);
+                    ai.file      = _unescape(fields[2]);
+                    ai.full_name = _opt(fields[3]);
+                    ai.function  = _opt(fields[4]);
+                    if (!fields[5].empty())
+                        ai.offset = std::stoull(fields[5]);
+                    _map.emplace(addr, std::move(ai));
+                }
+            }
+            catch (std::logic_error &) //a broken line, just resolve it again.
+            {
+            }
+        }
+    }
+    //the function entry points are resolved from the symbol & line table of the binary, without asking the debugger.
+    void _preload(const metal::elf::elf_file & elf)
+    {
+        try
+        {
+            metal::elf::line_table lines{elf};
+            for (auto & sym : elf.function_symbols())
+            {
+                if (_map.count(sym.value) != 0)
+                    continue;
+                auto le = lines.find(sym.value);
+                if ((le == nullptr) || (le->line == 0u)) //resolved by the debugger, when it's used.
+                    continue;
+
+                metal::debug::address_info ai;
+                ai.file = lines.file(*le);
+                ai.line = le->line;
+                if (!ai.file.empty() && (ai.file.front() == '/'))
+                    ai.full_name = ai.file;
+                ai.function = boost::core::demangle(sym.name.c_str());
+                ai.offset = 0u;
+                _map.emplace(sym.value, std::move(ai));
+                _modified = true;
+            }
+        }
+        catch (metal::elf::elf_error & ee)
+        {
+            std::cerr << "metal.calltrace.error cannot preload the symbols: " << ee.what() << std::endl;
+        }
+    }
+public:
+    /**Use a cache file for the binary. If `cache` is a directory, the file is named after the key inside it,
+     * if it is empty, the file is placed next to the binary. With `preload` all functions of the binary are added to it.
+     * The run-time address of the `anchor` symbol, passed to relocate, yields the load bias.
+     */
+    void open(const boost::filesystem::path & binary, const boost::filesystem::path & cache, bool preload,
+              const std::string & anchor)
+    {
+        namespace fs = boost::filesystem;
+        boost::optional<metal::elf::elf_file> elf;
+        try
+        {
+            elf.emplace(binary);
+            if (auto id = elf->build_id())
+                _key = "build-id:" + *id;
+            for (auto & sym : elf->symbols_with_prefix(anchor))
+                if (sym.name == anchor)
+                    _anchor = sym.value;
+        }
+        catch (metal::elf::elf_error & ee)
+        {
+            std::cerr << "metal.calltrace.error " << ee.what() << std::endl;
+        }
+
+        boost::system::error_code ec;
+        if (_key.empty())
+        {
+            auto size = fs::file_size(binary, ec);
+            auto time = fs::last_write_time(binary, ec);
+            if (ec)
+                return;
+            _key = "file:" + std::to_string(size) + ":" + std::to_string(time);
+        }
+
+        if (cache.empty())
+            _file = binary.string() + ".metal-symbols";
+        else if (fs::is_directory(cache, ec))
+        {
+            auto name = _key.substr(_key.find(':') + 1);
+            std::replace(name.begin(), name.end(), ':', '-');
+            _file = cache / (name + ".metal-symbols");
+        }
+        else
+            _file = cache;
+
+        _load();
+
+        if (preload && elf)
+            _preload(*elf);
+    }
+
+    ///True if the run-time address of the anchor symbol is needed to compute the load bias.
+    bool needs_anchor() const {return static_cast<bool>(_anchor);}
+
+    ///Set the load bias from the run-time address of the anchor symbol passed to open.
+    void relocate(std::uint64_t anchor)
+    {
+        if (_anchor)
+            _bias = anchor - *_anchor;
+    }
+
+    template<typename Resolve>
+    const boost::optional<metal::debug::address_info> & get(std::uint64_t addr, Resolve && resolve)
+    {
+        auto itr = _map.find(addr - _bias);
+        if (itr != _map.end())
+            return itr->second;
+
+        _modified = true;
+        return _map.emplace(addr - _bias, resolve(addr)).first->second;
+    }
+
+    ///Write the cache file, if anything was added.
+    void save()
+    {
+        if (_file.empty() || !_modified)
+            return;
+
+        auto tmp = _file;
+        tmp += ".tmp";
+        {
+            boost::filesystem::ofstream fs{tmp};
+            if (!fs)
+            {
+                std::cerr << "metal.calltrace.error cannot write symbol cache " << _file << std::endl;
+                return;
+            }
+
+            fs << _header << " " << _key << "\n";
+            for (auto & entry : _map)
+            {
+                fs << std::hex << entry.first << std::dec;
+                if (auto & ai = entry.second)
+                {
+                    fs << '\t' << ai->line << '\t' << _escape(ai->file)
+                       << '\t' << (ai->full_name ? _escape(*ai->full_name) : "")
+                       << '\t' << (ai->function  ? _escape(*ai->function)  : "")
+                       << '\t';
+                    if (ai->offset)
+                        fs << *ai->offset;
+                }
+                fs << '\n';
+            }
+        }
+        boost::system::error_code ec;
+        boost::filesystem::rename(tmp, _file, ec);
+        _modified = false;
+    }
+};
+
+#endif /* CALLTRACE_SYMBOL_CACHE_HPP_ */
@@ -0,0 +1,182 @@
+/**
+ * @file   src/calltrace/target_layout.hpp
+ * @date   19.10.2026
+ * @author Klemens D. Morgenstern
+ *
+
+ The layout of the structs of the target is obtained once from the debug information,
+ so their memory can be read with one access and decoded on the host.
+
+ */
+
+#ifndef CALLTRACE_TARGET_LAYOUT_HPP_
+#define CALLTRACE_TARGET_LAYOUT_HPP_
+
+#include <metal/debug/frame.hpp>
+
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+struct target_field
+{
+    std::size_t offset;
+    std::size_t size;
+
+    ///Obtain the offset & size of a member of a struct of the target.
+    static target_field of(metal::debug::frame & fr, const std::string & type, const std::string & member)
+    {
+        const std::string rec = "((" + type + "*)0)->" + member;
+        target_field f;
+        f.offset = std::stoull(fr.print("(unsigned long)&" + rec).value);
+        f.size   = std::stoull(fr.print("sizeof(" + rec + ")").value);
+        return f;
+    }
+
+    std::uint64_t get(const std::uint8_t * data, bool little_endian) const
+    {
+        std::uint64_t value = 0u;
+        for (auto i = 0u; i < size; i++)
+        {
+            auto idx = little_endian ? (size - i - 1) : i;
+            value = (value << 8) | data[offset + idx];
+        }
+        return value;
+    }
+
+    std::int64_t get_signed(const std::uint8_t * data, bool little_endian) const
+    {
+        auto value = get(data, little_endian);
+        if ((size < 8) && (value & (std::uint64_t(1) << (size * 8 - 1))))
+            value |= ~std::uint64_t(0) << (size * 8);
+        return static_cast<std::int64_t>(value);
+    }
+};
+
+///Determines the byte order from the marker the target provides, 0x0102.
+inline bool target_little_endian(metal::debug::frame & fr)
+{
+    auto marker_addr = std::stoull(fr.print("(unsigned long long)&__metal_calltrace_marker").value);
+    auto marker = fr.read_memory(marker_addr, 2u);
+    return marker.at(0) == 0x02;
+}
+
+///The part of `struct metal_calltrace_` that describes the expected calls.
+struct calltrace_descriptor
+{
+    std::uint64_t fn;
+    int repeat;
+    int skip;
+    std::vector<std::uint64_t> content;
+};
+
+///Reads a `struct metal_calltrace_` with two memory accesses, one for the struct and one for the content.
+class calltrace_layout
+{
+    bool _little_endian;
+    std::size_t _size;
+    std::size_t _pointer_size;
+
+    target_field _fn;
+    target_field _content;
+    target_field _content_size;
+    target_field _repeat;
+    target_field _skip;
+
+public:
+    calltrace_layout(metal::debug::frame & fr)
+        : _little_endian(target_little_endian(fr)),
+          _size(std::stoull(fr.print("sizeof(struct metal_calltrace_)").value)),
+          _pointer_size(std::stoull(fr.print("sizeof(void*)").value)),
+          _fn          (target_field::of(fr, "struct metal_calltrace_", "fn")),
+          _content     (target_field::of(fr, "struct metal_calltrace_", "content")),
+          _content_size(target_field::of(fr, "struct metal_calltrace_", "content_size")),
+          _repeat      (target_field::of(fr, "struct metal_calltrace_", "repeat")),
+          _skip        (target_field::of(fr, "struct metal_calltrace_", "skip"))
+    {
+    }
+
+    calltrace_descriptor read(metal::debug::frame & fr, std::uint64_t address) const
+    {
+        auto data = fr.read_memory(address, _size);
+        if (data.size() < _size)
+            throw std::runtime_error("incomplete read of metal_calltrace_ at " + std::to_string(address));
+
+        calltrace_descriptor cd;
+        cd.fn     = _fn    .get(data.data(), _little_endian);
+        cd.repeat = static_cast<int>(_repeat.get_signed(data.data(), _little_endian));
+        cd.skip   = static_cast<int>(_skip  .get_signed(data.data(), _little_endian));
+
+        auto content_ptr  = _content.get(data.data(), _little_endian);
+        auto content_size = _content_size.get_signed(data.data(), _little_endian);
+        if ((content_size <= 0) || (content_ptr == 0u))
+            return cd;
+
+        auto content = fr.read_memory(content_ptr, content_size * _pointer_size);
+        const target_field entry{0u, _pointer_size};
+        cd.content.reserve(content_size);
+        for (auto itr = content.data(); itr + _pointer_size <= content.data() + content.size(); itr += _pointer_size)
+            cd.content.push_back(entry.get(itr, _little_endian));
+
+        return cd;
+    }
+};
+
+///The values of `enum metal_calltrace_error_`.
+enum class calltrace_error
+{
+    no_error, mismatch, overflow, incomplete
+};
+
+///The result a target verifying the calltrace itself records in `struct metal_calltrace_`.
+struct calltrace_state
+{
+    int repeated;
+    int errored;
+    calltrace_error error_type;
+    int error_position;
+    std::uint64_t error_fn;
+};
+
+///Reads the state of a `struct metal_calltrace_` with one memory access, only needed if the target checks the calls.
+class calltrace_state_layout
+{
+    bool _little_endian;
+    std::size_t _size;
+
+    target_field _repeated;
+    target_field _errored;
+    target_field _error_type;
+    target_field _error_position;
+    target_field _error_fn;
+
+public:
+    calltrace_state_layout(metal::debug::frame & fr)
+        : _little_endian(target_little_endian(fr)),
+          _size(std::stoull(fr.print("sizeof(struct metal_calltrace_)").value)),
+          _repeated      (target_field::of(fr, "struct metal_calltrace_", "repeated")),
+          _errored       (target_field::of(fr, "struct metal_calltrace_", "errored")),
+          _error_type    (target_field::of(fr, "struct metal_calltrace_", "error_type")),
+          _error_position(target_field::of(fr, "struct metal_calltrace_", "error_position")),
+          _error_fn      (target_field::of(fr, "struct metal_calltrace_", "error_fn"))
+    {
+    }
+
+    calltrace_state read(metal::debug::frame & fr, std::uint64_t address) const
+    {
+        auto data = fr.read_memory(address, _size);
+        if (data.size() < _size)
+            throw std::runtime_error("incomplete read of metal_calltrace_ at " + std::to_string(address));
+
+        calltrace_state cs;
+        cs.repeated       = static_cast<int>(_repeated      .get_signed(data.data(), _little_endian));
+        cs.errored        = static_cast<int>(_errored       .get_signed(data.data(), _little_endian));
+        cs.error_type     = static_cast<calltrace_error>(_error_type.get_signed(data.data(), _little_endian));
+        cs.error_position = static_cast<int>(_error_position.get_signed(data.data(), _little_endian));
+        cs.error_fn       = _error_fn.get(data.data(), _little_endian);
+        return cs;
+    }
+};
+
+#endif /* CALLTRACE_TARGET_LAYOUT_HPP_ */
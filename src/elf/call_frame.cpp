@@ -0,0 +1,407 @@
+/**
+ * @file   elf/call_frame.cpp
+ * @date   19.10.2026
+ * @author Klemens D. Morgenstern
+ *
+
+ */
+
+#include "call_frame.hpp"
+#include "dwarf_reader.hpp"
+
+#include <boost/optional.hpp>
+
+#include <algorithm>
+#include <limits>
+#include <map>
+#include <unordered_map>
+
+namespace metal { namespace elf {
+
+namespace
+{
+
+//pointer encodings
+constexpr unsigned char dw_eh_pe_absptr  = 0x00;
+constexpr unsigned char dw_eh_pe_uleb128 = 0x01;
+constexpr unsigned char dw_eh_pe_udata2  = 0x02;
+constexpr unsigned char dw_eh_pe_udata4  = 0x03;
+constexpr unsigned char dw_eh_pe_udata8  = 0x04;
+constexpr unsigned char dw_eh_pe_sleb128 = 0x09;
+constexpr unsigned char dw_eh_pe_sdata2  = 0x0a;
+constexpr unsigned char dw_eh_pe_sdata4  = 0x0b;
+constexpr unsigned char dw_eh_pe_sdata8  = 0x0c;
+constexpr unsigned char dw_eh_pe_pcrel   = 0x10;
+
+//call frame instructions, the first three have the operand in the low 6 bits.
+constexpr unsigned char dw_cfa_advance_loc        = 0x40;
+constexpr unsigned char dw_cfa_offset             = 0x80;
+constexpr unsigned char dw_cfa_restore            = 0xc0;
+constexpr unsigned char dw_cfa_nop                = 0x00;
+constexpr unsigned char dw_cfa_set_loc            = 0x01;
+constexpr unsigned char dw_cfa_advance_loc1       = 0x02;
+constexpr unsigned char dw_cfa_advance_loc2       = 0x03;
+constexpr unsigned char dw_cfa_advance_loc4       = 0x04;
+constexpr unsigned char dw_cfa_offset_extended    = 0x05;
+constexpr unsigned char dw_cfa_restore_extended   = 0x06;
+constexpr unsigned char dw_cfa_undefined          = 0x07;
+constexpr unsigned char dw_cfa_same_value         = 0x08;
+constexpr unsigned char dw_cfa_register           = 0x09;
+constexpr unsigned char dw_cfa_remember_state     = 0x0a;
+constexpr unsigned char dw_cfa_restore_state      = 0x0b;
+constexpr unsigned char dw_cfa_def_cfa            = 0x0c;
+constexpr unsigned char dw_cfa_def_cfa_register   = 0x0d;
+constexpr unsigned char dw_cfa_def_cfa_offset     = 0x0e;
+constexpr unsigned char dw_cfa_def_cfa_expression = 0x0f;
+constexpr unsigned char dw_cfa_expression         = 0x10;
+constexpr unsigned char dw_cfa_offset_extended_sf = 0x11;
+constexpr unsigned char dw_cfa_def_cfa_sf         = 0x12;
+constexpr unsigned char dw_cfa_def_cfa_offset_sf  = 0x13;
+constexpr unsigned char dw_cfa_val_offset         = 0x14;
+constexpr unsigned char dw_cfa_val_offset_sf      = 0x15;
+constexpr unsigned char dw_cfa_val_expression     = 0x16;
+constexpr unsigned char dw_cfa_gnu_args_size      = 0x2e;
+constexpr unsigned char dw_cfa_gnu_negative_offset_extended = 0x2f;
+
+std::int64_t sign_extend(std::uint64_t value, std::size_t size)
+{
+    if ((size < 8u) && (value & (std::uint64_t(1) << (size * 8u - 1u))))
+        value |= ~std::uint64_t(0) << (size * 8u);
+    return static_cast<std::int64_t>(value);
+}
+
+//the address of the field is needed for pc-relative pointers, so that's the link-time address of the section plus the offset.
+std::uint64_t read_pointer(dwarf_reader & rd, unsigned char encoding, std::uint64_t field_address)
+{
+    std::uint64_t value;
+    switch (encoding & 0x0f)
+    {
+    case dw_eh_pe_absptr:  value = rd.u(rd.elf.is64() ? 8u : 4u); break;
+    case dw_eh_pe_uleb128: value = rd.uleb(); break;
+    case dw_eh_pe_udata2:  value = rd.u(2u); break;
+    case dw_eh_pe_udata4:  value = rd.u(4u); break;
+    case dw_eh_pe_udata8:  value = rd.u(8u); break;
+    case dw_eh_pe_sleb128: value = static_cast<std::uint64_t>(rd.sleb()); break;
+    case dw_eh_pe_sdata2:  value = static_cast<std::uint64_t>(sign_extend(rd.u(2u), 2u)); break;
+    case dw_eh_pe_sdata4:  value = static_cast<std::uint64_t>(sign_extend(rd.u(4u), 4u)); break;
+    case dw_eh_pe_sdata8:  value = rd.u(8u); break;
+    default:
+        throw elf_error("unsupported pointer encoding in .eh_frame");
+    }
+
+    switch (encoding & 0x70)
+    {
+    case 0x00:
+        return value;
+    case dw_eh_pe_pcrel:
+        return value + field_address;
+    default:
+        throw elf_error("unsupported pointer encoding in .eh_frame");
+    }
+}
+
+//an entry of .eh_frame, the id is zero for a CIE and the offset of the CIE for a FDE.
+struct entry
+{
+    std::uint64_t offset;
+    std::uint64_t cie_offset;
+    bool is_cie;
+    const char * begin; ///<After the id.
+    const char * end;
+};
+
+std::vector<entry> read_entries(const elf_file & elf, const section_data & sd)
+{
+    std::vector<entry> res;
+    const char * ptr = sd.data;
+    const char * end = sd.data + sd.size;
+    while (ptr < end)
+    {
+        dwarf_reader rd{elf, ptr, end, ".eh_frame"};
+        std::uint64_t length = rd.u(4u);
+        if (length == 0u) //the terminator
+            break;
+        if (length == 0xffffffffu)
+            length = rd.u(8u);
+        rd.check(length);
+
+        entry e;
+        e.offset = static_cast<std::uint64_t>(ptr - sd.data);
+        e.end    = rd.ptr + length;
+
+        const char * id_ptr = rd.ptr;
+        auto id = rd.u(4u);
+        e.is_cie     = (id == 0u);
+        e.cie_offset = static_cast<std::uint64_t>(id_ptr - sd.data) - id;
+        e.begin      = rd.ptr;
+
+        res.push_back(e);
+        ptr = e.end;
+    }
+    return res;
+}
+
+//the rules of the registers, as far as they are needed to restore the saved ones.
+struct cfa_state
+{
+    bool cfa_expression = false;
+    unsigned int cfa_register = 0u;
+    std::int64_t cfa_offset   = 0;
+    std::map<unsigned int, boost::optional<std::int64_t>> regs; ///<The offset from the CFA or none, if it's not supported.
+};
+
+//executes the instructions until the location is past the address.
+void execute(const elf_file & elf, const std::string & instructions, std::uint64_t code_align, std::int64_t data_align,
+             std::uint64_t loc, std::uint64_t address, cfa_state & st, const cfa_state & initial)
+{
+    dwarf_reader rd{elf, instructions.data(), instructions.data() + instructions.size(), ".eh_frame"};
+    std::vector<cfa_state> stack;
+
+    auto advance = [&](std::uint64_t delta) {loc += delta * code_align; return loc > address;};
+    auto restore = [&](unsigned int reg)
+        {
+            auto itr = initial.regs.find(reg);
+            if (itr != initial.regs.end())
+                st.regs[reg] = itr->second;
+            else
+                st.regs.erase(reg);
+        };
+
+    while (rd.ptr < rd.end)
+    {
+        auto op = static_cast<unsigned char>(rd.u(1u));
+        auto operand = static_cast<unsigned int>(op & 0x3f);
+        switch (op & 0xc0)
+        {
+        case dw_cfa_advance_loc:
+            if (advance(operand))
+                return;
+            continue;
+        case dw_cfa_offset:
+            st.regs[operand] = static_cast<std::int64_t>(rd.uleb()) * data_align;
+            continue;
+        case dw_cfa_restore:
+            restore(operand);
+            continue;
+        default:
+            break;
+        }
+
+        switch (op)
+        {
+        case dw_cfa_nop:
+            break;
+        case dw_cfa_advance_loc1:
+            if (advance(rd.u(1u)))
+                return;
+            break;
+        case dw_cfa_advance_loc2:
+            if (advance(rd.u(2u)))
+                return;
+            break;
+        case dw_cfa_advance_loc4:
+            if (advance(rd.u(4u)))
+                return;
+            break;
+        case dw_cfa_offset_extended:
+        {
+            auto reg = static_cast<unsigned int>(rd.uleb());
+            st.regs[reg] = static_cast<std::int64_t>(rd.uleb()) * data_align;
+            break;
+        }
+        case dw_cfa_offset_extended_sf:
+        {
+            auto reg = static_cast<unsigned int>(rd.uleb());
+            st.regs[reg] = rd.sleb() * data_align;
+            break;
+        }
+        case dw_cfa_gnu_negative_offset_extended:
+        {
+            auto reg = static_cast<unsigned int>(rd.uleb());
+            st.regs[reg] = -static_cast<std::int64_t>(rd.uleb()) * data_align;
+            break;
+        }
+        case dw_cfa_restore_extended:
+            restore(static_cast<unsigned int>(rd.uleb()));
+            break;
+        case dw_cfa_undefined:
+        case dw_cfa_same_value:
+            st.regs.erase(static_cast<unsigned int>(rd.uleb()));
+            break;
+        case dw_cfa_register:
+            st.regs[static_cast<unsigned int>(rd.uleb())] = boost::none;
+            rd.uleb();
+            break;
+        case dw_cfa_val_offset:
+            st.regs[static_cast<unsigned int>(rd.uleb())] = boost::none;
+            rd.uleb();
+            break;
+        case dw_cfa_val_offset_sf:
+            st.regs[static_cast<unsigned int>(rd.uleb())] = boost::none;
+            rd.sleb();
+            break;
+        case dw_cfa_expression:
+        case dw_cfa_val_expression:
+            st.regs[static_cast<unsigned int>(rd.uleb())] = boost::none;
+            rd.skip(rd.uleb());
+            break;
+        case dw_cfa_remember_state:
+            stack.push_back(st);
+            break;
+        case dw_cfa_restore_state:
+            if (stack.empty())
+                throw elf_error("DW_CFA_restore_state without a remembered state in .eh_frame");
+            st = std::move(stack.back());
+            stack.pop_back();
+            break;
+        case dw_cfa_def_cfa:
+            st.cfa_expression = false;
+            st.cfa_register = static_cast<unsigned int>(rd.uleb());
+            st.cfa_offset   = static_cast<std::int64_t>(rd.uleb());
+            break;
+        case dw_cfa_def_cfa_sf:
+            st.cfa_expression = false;
+            st.cfa_register = static_cast<unsigned int>(rd.uleb());
+            st.cfa_offset   = rd.sleb() * data_align;
+            break;
+        case dw_cfa_def_cfa_register:
+            st.cfa_expression = false;
+            st.cfa_register = static_cast<unsigned int>(rd.uleb());
+            break;
+        case dw_cfa_def_cfa_offset:
+            st.cfa_offset = static_cast<std::int64_t>(rd.uleb());
+            break;
+        case dw_cfa_def_cfa_offset_sf:
+            st.cfa_offset = rd.sleb() * data_align;
+            break;
+        case dw_cfa_def_cfa_expression:
+            st.cfa_expression = true;
+            rd.skip(rd.uleb());
+            break;
+        case dw_cfa_gnu_args_size:
+            rd.uleb();
+            break;
+        case dw_cfa_set_loc: //not emitted by gcc or clang, the encoding of the FDE would be needed here.
+        default:
+            throw elf_error("unsupported call frame instruction " + std::to_string(op) + " in .eh_frame");
+        }
+    }
+}
+
+}
+
+call_frame_info::call_frame_info(const elf_file & elf) : _elf(&elf)
+{
+    auto sec = elf.find_section(".eh_frame");
+    if (sec == nullptr)
+        throw elf_error("no .eh_frame section");
+
+    auto sd = elf.data(*sec);
+    auto entries = read_entries(elf, sd);
+    auto address_of = [&](const char * ptr){return sec->address + static_cast<std::uint64_t>(ptr - sd.data);};
+
+    std::unordered_map<std::uint64_t, std::size_t> cies;
+    for (auto & e : entries)
+    {
+        if (!e.is_cie)
+            continue;
+
+        dwarf_reader rd{elf, e.begin, e.end, ".eh_frame"};
+        cie c;
+        auto version = rd.u(1u);
+        auto augmentation = rd.str();
+        if (augmentation.find("eh") != std::string::npos)
+            rd.skip(elf.is64() ? 8u : 4u);
+        c.code_align = rd.uleb();
+        c.data_align = rd.sleb();
+        if (version == 1u)
+            rd.u(1u);
+        else
+            rd.uleb();
+
+        c.fde_encoding = dw_eh_pe_absptr;
+        c.augmented = !augmentation.empty() && (augmentation[0] == 'z');
+        if (c.augmented)
+        {
+            auto size = rd.uleb();
+            rd.check(size);
+            const char * data_end = rd.ptr + size;
+            for (auto ch : augmentation.substr(1u))
+            {
+                if (ch == 'R')
+                    c.fde_encoding = static_cast<unsigned char>(rd.u(1u));
+                else if (ch == 'P')
+                {
+                    auto encoding = static_cast<unsigned char>(rd.u(1u));
+                    read_pointer(rd, encoding & 0x7f, address_of(rd.ptr));
+                }
+                else if (ch == 'L')
+                    rd.u(1u);
+                else if ((ch != 'S') && (ch != 'B'))
+                    break;
+            }
+            rd.ptr = data_end;
+        }
+        c.instructions.assign(rd.ptr, e.end);
+
+        cies.emplace(e.offset, _cies.size());
+        _cies.push_back(std::move(c));
+    }
+
+    for (auto & e : entries)
+    {
+        if (e.is_cie)
+            continue;
+
+        auto itr = cies.find(e.cie_offset);
+        if (itr == cies.end())
+            throw elf_error("FDE without a CIE in .eh_frame");
+        auto & c = _cies[itr->second];
+
+        dwarf_reader rd{elf, e.begin, e.end, ".eh_frame"};
+        fde f;
+        f.cie   = itr->second;
+        f.begin = read_pointer(rd, c.fde_encoding, address_of(rd.ptr));
+        f.end   = f.begin + read_pointer(rd, c.fde_encoding & 0x0f, address_of(rd.ptr));
+        if (c.augmented)
+            rd.skip(rd.uleb());
+        f.instructions.assign(rd.ptr, e.end);
+
+        //the FDEs of discarded sections start at zero.
+        if (f.begin != 0u)
+            _fdes.push_back(std::move(f));
+    }
+
+    std::sort(_fdes.begin(), _fdes.end(), [](const fde & lhs, const fde & rhs){return lhs.begin < rhs.begin;});
+}
+
+frame_rules call_frame_info::rules(std::uint64_t address) const
+{
+    auto itr = std::upper_bound(_fdes.begin(), _fdes.end(), address,
+                                [](std::uint64_t a, const fde & f){return a < f.begin;});
+    if ((itr == _fdes.begin()) || (address >= std::prev(itr)->end))
+        throw elf_error("no call frame information for address " + std::to_string(address));
+
+    auto & f = *std::prev(itr);
+    auto & c = _cies[f.cie];
+
+    cfa_state initial;
+    execute(*_elf, c.instructions, c.code_align, c.data_align, f.begin, std::numeric_limits<std::uint64_t>::max(), initial, initial);
+    cfa_state st = initial;
+    execute(*_elf, f.instructions, c.code_align, c.data_align, f.begin, address, st, initial);
+
+    frame_rules res;
+    res.cfa_expression = st.cfa_expression;
+    res.cfa_register   = st.cfa_register;
+    res.cfa_offset     = st.cfa_offset;
+    for (auto & r : st.regs)
+    {
+        if (r.second)
+            res.saved.push_back({r.first, *r.second});
+        else
+            res.unsupported.push_back(r.first);
+    }
+    return res;
+}
+
+}}
@@ -0,0 +1,77 @@
+/**
+ * @file   elf/call_frame.hpp
+ * @date   19.10.2026
+ * @author Klemens D. Morgenstern
+ *
+
+ This header provides the call frame information of an ELF file, decoded from the `.eh_frame` section.
+ It's only used to find the registers a function saved on the stack, so they can be restored when returning
+ from an outer frame. The frames themselves are still found through the frame pointers.
+
+ */
+#ifndef METAL_ELF_CALL_FRAME_HPP_
+#define METAL_ELF_CALL_FRAME_HPP_
+
+#include "elf_file.hpp"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace metal { namespace elf {
+
+///A register saved by a function, at an offset from the canonical frame address.
+struct saved_register
+{
+    unsigned int reg; ///<The DWARF number of the register.
+    std::int64_t offset;
+};
+
+///The rules of a function at a given address.
+struct frame_rules
+{
+    ///The CFA is the value of the register plus the offset, unless it's defined by an expression.
+    bool cfa_expression = false;
+    unsigned int cfa_register = 0u;
+    std::int64_t cfa_offset   = 0;
+
+    std::vector<saved_register> saved;
+    ///The registers with a rule other than an offset, e.g. an expression, which cannot be restored.
+    std::vector<unsigned int> unsupported;
+};
+
+class call_frame_info
+{
+    struct cie
+    {
+        std::uint64_t code_align;
+        std::int64_t  data_align;
+        unsigned char fde_encoding;
+        bool augmented;
+        std::string instructions;
+    };
+
+    struct fde
+    {
+        std::uint64_t begin;
+        std::uint64_t end;
+        std::size_t cie;
+        std::string instructions;
+    };
+
+    const elf_file * _elf;
+    std::vector<cie> _cies;
+    std::vector<fde> _fdes;
+public:
+    ///Throws an elf_error, if the file has no or a malformed `.eh_frame` section. The file needs to outlive this.
+    explicit call_frame_info(const elf_file & elf);
+
+    bool empty() const {return _fdes.empty();}
+
+    ///The rules at the link-time address. Throws an elf_error, if it is not covered or the instructions are invalid.
+    frame_rules rules(std::uint64_t address) const;
+};
+
+}}
+
+#endif /* METAL_ELF_CALL_FRAME_HPP_ */
@@ -0,0 +1,927 @@
+/**
+ * @file   elf/debug_info.cpp
+ * @date   19.10.2026
+ * @author Klemens D. Morgenstern
+ *
+
+ */
+
+#include "debug_info.hpp"
+#include "dwarf_reader.hpp"
+
+#include <algorithm>
+#include <tuple>
+
+namespace metal { namespace elf {
+
+namespace
+{
+
+constexpr std::uint64_t dw_tag_array_type            = 0x01;
+constexpr std::uint64_t dw_tag_class_type            = 0x02;
+constexpr std::uint64_t dw_tag_enumeration_type      = 0x04;
+constexpr std::uint64_t dw_tag_formal_parameter      = 0x05;
+constexpr std::uint64_t dw_tag_lexical_block         = 0x0b;
+constexpr std::uint64_t dw_tag_member                = 0x0d;
+constexpr std::uint64_t dw_tag_pointer_type          = 0x0f;
+constexpr std::uint64_t dw_tag_reference_type        = 0x10;
+constexpr std::uint64_t dw_tag_compile_unit          = 0x11;
+constexpr std::uint64_t dw_tag_structure_type        = 0x13;
+constexpr std::uint64_t dw_tag_subroutine_type       = 0x15;
+constexpr std::uint64_t dw_tag_typedef               = 0x16;
+constexpr std::uint64_t dw_tag_union_type            = 0x17;
+constexpr std::uint64_t dw_tag_ptr_to_member_type    = 0x1f;
+constexpr std::uint64_t dw_tag_subrange_type         = 0x21;
+constexpr std::uint64_t dw_tag_base_type             = 0x24;
+constexpr std::uint64_t dw_tag_const_type            = 0x26;
+constexpr std::uint64_t dw_tag_enumerator            = 0x28;
+constexpr std::uint64_t dw_tag_subprogram            = 0x2e;
+constexpr std::uint64_t dw_tag_variable              = 0x34;
+constexpr std::uint64_t dw_tag_volatile_type         = 0x35;
+constexpr std::uint64_t dw_tag_restrict_type         = 0x37;
+constexpr std::uint64_t dw_tag_namespace             = 0x39;
+constexpr std::uint64_t dw_tag_unspecified_type      = 0x3b;
+constexpr std::uint64_t dw_tag_partial_unit          = 0x3c;
+constexpr std::uint64_t dw_tag_rvalue_reference_type = 0x42;
+constexpr std::uint64_t dw_tag_atomic_type           = 0x47;
+
+constexpr std::uint64_t dw_at_location             = 0x02;
+constexpr std::uint64_t dw_at_name                 = 0x03;
+constexpr std::uint64_t dw_at_stmt_list            = 0x10;
+constexpr std::uint64_t dw_at_byte_size            = 0x0b;
+constexpr std::uint64_t dw_at_low_pc               = 0x11;
+constexpr std::uint64_t dw_at_high_pc              = 0x12;
+constexpr std::uint64_t dw_at_const_value          = 0x1c;
+constexpr std::uint64_t dw_at_comp_dir             = 0x1b;
+constexpr std::uint64_t dw_at_upper_bound          = 0x2f;
+constexpr std::uint64_t dw_at_abstract_origin      = 0x31;
+constexpr std::uint64_t dw_at_count                = 0x37;
+constexpr std::uint64_t dw_at_data_member_location = 0x38;
+constexpr std::uint64_t dw_at_declaration          = 0x3c;
+constexpr std::uint64_t dw_at_encoding             = 0x3e;
+constexpr std::uint64_t dw_at_frame_base           = 0x40;
+constexpr std::uint64_t dw_at_specification        = 0x47;
+constexpr std::uint64_t dw_at_type                 = 0x49;
+constexpr std::uint64_t dw_at_str_offsets_base     = 0x72;
+constexpr std::uint64_t dw_at_addr_base            = 0x73;
+
+constexpr std::uint64_t dw_form_addr           = 0x01;
+constexpr std::uint64_t dw_form_block2         = 0x03;
+constexpr std::uint64_t dw_form_block4         = 0x04;
+constexpr std::uint64_t dw_form_data2          = 0x05;
+constexpr std::uint64_t dw_form_data4          = 0x06;
+constexpr std::uint64_t dw_form_data8          = 0x07;
+constexpr std::uint64_t dw_form_string         = 0x08;
+constexpr std::uint64_t dw_form_block          = 0x09;
+constexpr std::uint64_t dw_form_block1         = 0x0a;
+constexpr std::uint64_t dw_form_data1          = 0x0b;
+constexpr std::uint64_t dw_form_flag           = 0x0c;
+constexpr std::uint64_t dw_form_sdata          = 0x0d;
+constexpr std::uint64_t dw_form_strp           = 0x0e;
+constexpr std::uint64_t dw_form_udata          = 0x0f;
+constexpr std::uint64_t dw_form_ref_addr       = 0x10;
+constexpr std::uint64_t dw_form_ref1           = 0x11;
+constexpr std::uint64_t dw_form_ref2           = 0x12;
+constexpr std::uint64_t dw_form_ref4           = 0x13;
+constexpr std::uint64_t dw_form_ref8           = 0x14;
+constexpr std::uint64_t dw_form_ref_udata      = 0x15;
+constexpr std::uint64_t dw_form_indirect       = 0x16;
+constexpr std::uint64_t dw_form_sec_offset     = 0x17;
+constexpr std::uint64_t dw_form_exprloc        = 0x18;
+constexpr std::uint64_t dw_form_flag_present   = 0x19;
+constexpr std::uint64_t dw_form_strx           = 0x1a;
+constexpr std::uint64_t dw_form_addrx          = 0x1b;
+constexpr std::uint64_t dw_form_ref_sup4       = 0x1c;
+constexpr std::uint64_t dw_form_strp_sup       = 0x1d;
+constexpr std::uint64_t dw_form_data16         = 0x1e;
+constexpr std::uint64_t dw_form_line_strp      = 0x1f;
+constexpr std::uint64_t dw_form_ref_sig8       = 0x20;
+constexpr std::uint64_t dw_form_implicit_const = 0x21;
+constexpr std::uint64_t dw_form_loclistx       = 0x22;
+constexpr std::uint64_t dw_form_rnglistx       = 0x23;
+constexpr std::uint64_t dw_form_ref_sup8       = 0x24;
+constexpr std::uint64_t dw_form_strx1          = 0x25;
+constexpr std::uint64_t dw_form_strx4          = 0x28;
+constexpr std::uint64_t dw_form_addrx1         = 0x29;
+constexpr std::uint64_t dw_form_addrx4         = 0x2c;
+constexpr std::uint64_t dw_form_gnu_addr_index = 0x1f01;
+constexpr std::uint64_t dw_form_gnu_str_index  = 0x1f02;
+constexpr std::uint64_t dw_form_gnu_ref_alt    = 0x1f20;
+constexpr std::uint64_t dw_form_gnu_strp_alt   = 0x1f21;
+
+constexpr unsigned char dw_op_addr           = 0x03;
+constexpr unsigned char dw_op_plus_uconst    = 0x23;
+constexpr unsigned char dw_op_reg6           = 0x56;
+constexpr unsigned char dw_op_breg6          = 0x76;
+constexpr unsigned char dw_op_fbreg          = 0x91;
+constexpr unsigned char dw_op_call_frame_cfa = 0x9c;
+
+struct attribute_spec
+{
+    std::uint64_t name;
+    std::uint64_t form;
+    std::int64_t implicit_const;
+};
+
+struct abbreviation
+{
+    std::uint64_t tag;
+    bool children;
+    std::vector<attribute_spec> attributes;
+};
+
+struct form_value
+{
+    enum kind_t {none, constant, signed_constant, address, string, block, reference, strx, addrx, section_offset} kind = none;
+    std::uint64_t value = 0u;
+    std::string str;
+    const char * data = nullptr;
+    std::size_t size = 0u;
+};
+
+///The attributes of a debugging information entry, as far as they're used.
+struct die
+{
+    std::uint64_t offset;
+    std::uint64_t tag;
+    std::string name;
+    std::string comp_dir;
+    std::uint64_t type = 0u;
+    boost::optional<std::uint64_t> byte_size, encoding, low_pc, high_pc, upper_bound, count,
+                                   member_offset, specification, abstract_origin, stmt_list;
+    boost::optional<std::int64_t> const_value;
+    bool high_pc_is_offset = false;
+    bool declaration = false;
+    form_value location, frame_base;
+};
+
+}
+
+struct debug_info::parser
+{
+    debug_info & info;
+    const elf_file & elf;
+    const char * section_begin;
+
+    parser(debug_info & info, const elf_file & elf, const char * section_begin)
+        : info(info), elf(elf), section_begin(section_begin), address_size(elf.is64() ? 8u : 4u)
+    {
+    }
+
+    //the attributes of the unit being read
+    std::size_t offset_size = 4u;
+    std::size_t address_size = 8u;
+    std::uint64_t version = 4u;
+    std::uint64_t unit_offset = 0u;
+    std::uint64_t str_offsets_base = 0u;
+    std::uint64_t addr_base = 0u;
+
+    std::unordered_map<std::uint64_t, std::unordered_map<std::uint64_t, abbreviation>> abbrev_tables;
+
+    //the references are resolved, after everything is read.
+    std::unordered_map<std::uint64_t, std::size_t> type_at;
+    struct named_entry
+    {
+        std::string name;
+        std::uint64_t type;
+        std::uint64_t origin;
+    };
+    std::unordered_map<std::uint64_t, named_entry> named;
+    std::vector<std::pair<std::size_t, std::uint64_t>> function_origins;
+    std::vector<std::pair<std::size_t, std::uint64_t>> global_origins;
+    //function, local (or parameter), index and origin
+    std::vector<std::tuple<std::size_t, bool, std::size_t, std::uint64_t>> variable_origins;
+
+    struct scope
+    {
+        std::uint64_t tag;
+        std::string ns;
+        std::size_t type = no_type;
+        std::size_t function = no_type;
+        std::uint64_t low_pc = 0u;
+        std::uint64_t high_pc = 0u;
+    };
+    std::vector<scope> scopes;
+
+    const std::unordered_map<std::uint64_t, abbreviation> & abbrev_table(std::uint64_t offset)
+    {
+        auto itr = abbrev_tables.find(offset);
+        if (itr != abbrev_tables.end())
+            return itr->second;
+
+        auto sec = elf.find_section(".debug_abbrev");
+        if (sec == nullptr)
+            throw elf_error("no .debug_abbrev section");
+        auto sd = elf.data(*sec);
+        if (offset >= sd.size)
+            throw elf_error("invalid offset into .debug_abbrev");
+
+        dwarf_reader rd{elf, sd.data + offset, sd.data + sd.size, ".debug_abbrev"};
+        auto & table = abbrev_tables[offset];
+        for (auto code = rd.uleb(); code != 0u; code = rd.uleb())
+        {
+            abbreviation ab;
+            ab.tag = rd.uleb();
+            ab.children = rd.u(1) != 0u;
+            while (true)
+            {
+                attribute_spec as{rd.uleb(), rd.uleb(), 0};
+                if ((as.name == 0u) && (as.form == 0u))
+                    break;
+                if (as.form == dw_form_implicit_const)
+                    as.implicit_const = rd.sleb();
+                ab.attributes.push_back(as);
+            }
+            table.emplace(code, std::move(ab));
+        }
+        return table;
+    }
+
+    std::uint64_t read_offset(const char * section_name, std::uint64_t offset, std::size_t size)
+    {
+        auto sec = elf.find_section(section_name);
+        if (sec == nullptr)
+            throw elf_error(std::string("missing section ") + section_name);
+        auto sd = elf.data(*sec);
+        if ((offset + size) > sd.size)
+            throw elf_error(std::string("invalid offset into ") + section_name);
+        return elf.read(sd.data + offset, size);
+    }
+
+    form_value read_form(dwarf_reader & rd, std::uint64_t form, std::int64_t implicit_const)
+    {
+        form_value fv;
+        auto constant = [&](std::uint64_t value) {fv.kind = form_value::constant; fv.value = value;};
+        auto block    = [&](std::size_t size)
+            {
+                rd.check(size);
+                fv.kind = form_value::block;
+                fv.data = rd.ptr;
+                fv.size = size;
+                rd.ptr += size;
+            };
+        auto reference = [&](std::uint64_t value) {fv.kind = form_value::reference; fv.value = value;};
+
+        switch (form)
+        {
+        case dw_form_addr:     fv.kind = form_value::address; fv.value = rd.u(address_size); break;
+        case dw_form_block1:   block(rd.u(1)); break;
+        case dw_form_block2:   block(rd.u(2)); break;
+        case dw_form_block4:   block(rd.u(4)); break;
+        case dw_form_block:
+        case dw_form_exprloc:  block(rd.uleb()); break;
+        case dw_form_data1:
+        case dw_form_flag:     constant(rd.u(1)); break;
+        case dw_form_data2:    constant(rd.u(2)); break;
+        case dw_form_data4:    constant(rd.u(4)); break;
+        case dw_form_data8:    constant(rd.u(8)); break;
+        case dw_form_data16:   rd.skip(16); break;
+        case dw_form_udata:    constant(rd.uleb()); break;
+        case dw_form_sdata:    fv.kind = form_value::signed_constant; fv.value = static_cast<std::uint64_t>(rd.sleb()); break;
+        case dw_form_implicit_const: fv.kind = form_value::signed_constant; fv.value = static_cast<std::uint64_t>(implicit_const); break;
+        case dw_form_flag_present: constant(1u); break;
+        case dw_form_string:   fv.kind = form_value::string; fv.str = rd.str(); break;
+        case dw_form_strp:     fv.kind = form_value::string; fv.str = string_at(elf, ".debug_str", rd.u(offset_size)); break;
+        case dw_form_line_strp:fv.kind = form_value::string; fv.str = string_at(elf, ".debug_line_str", rd.u(offset_size)); break;
+        case dw_form_ref_addr: reference(rd.u(version <= 2 ? address_size : offset_size)); break;
+        case dw_form_ref1:     reference(unit_offset + rd.u(1)); break;
+        case dw_form_ref2:     reference(unit_offset + rd.u(2)); break;
+        case dw_form_ref4:     reference(unit_offset + rd.u(4)); break;
+        case dw_form_ref8:     reference(unit_offset + rd.u(8)); break;
+        case dw_form_ref_udata:reference(unit_offset + rd.uleb()); break;
+        case dw_form_indirect: return read_form(rd, rd.uleb(), implicit_const);
+        case dw_form_sec_offset: fv.kind = form_value::section_offset; fv.value = rd.u(offset_size); break;
+        case dw_form_strp_sup:
+        case dw_form_gnu_ref_alt:
+        case dw_form_gnu_strp_alt: rd.u(offset_size); break; //location lists & supplementary files are not supported.
+        case dw_form_ref_sup4: rd.u(4); break;
+        case dw_form_ref_sup8:
+        case dw_form_ref_sig8: rd.u(8); break;
+        case dw_form_loclistx:
+        case dw_form_rnglistx: rd.uleb(); break;
+        case dw_form_strx:
+        case dw_form_gnu_str_index:  fv.kind = form_value::strx;  fv.value = rd.uleb(); break;
+        case dw_form_addrx:
+        case dw_form_gnu_addr_index: fv.kind = form_value::addrx; fv.value = rd.uleb(); break;
+        default:
+            if ((form >= dw_form_strx1) && (form <= dw_form_strx4))
+            {
+                fv.kind = form_value::strx;
+                fv.value = rd.u(form - dw_form_strx1 + 1);
+            }
+            else if ((form >= dw_form_addrx1) && (form <= dw_form_addrx4))
+            {
+                fv.kind = form_value::addrx;
+                fv.value = rd.u(form - dw_form_addrx1 + 1);
+            }
+            else
+                throw elf_error("unsupported form " + std::to_string(form) + " in .debug_info");
+        }
+        return fv;
+    }
+
+    //the indexed forms need the bases of the unit, which are attributes of the unit itself.
+    void resolve_index(form_value & fv)
+    {
+        if (fv.kind == form_value::strx)
+        {
+            fv.kind = form_value::string;
+            fv.str = string_at(elf, ".debug_str", read_offset(".debug_str_offsets", str_offsets_base + fv.value * offset_size, offset_size));
+        }
+        else if (fv.kind == form_value::addrx)
+        {
+            fv.kind = form_value::address;
+            fv.value = read_offset(".debug_addr", addr_base + fv.value * address_size, address_size);
+        }
+    }
+
+    static boost::optional<std::int64_t> as_signed(const form_value & fv)
+    {
+        if ((fv.kind == form_value::constant) || (fv.kind == form_value::signed_constant))
+            return static_cast<std::int64_t>(fv.value);
+        return boost::none;
+    }
+
+    die read_die(dwarf_reader & rd, const abbreviation & ab, std::uint64_t offset)
+    {
+        die d;
+        d.offset = offset;
+        d.tag = ab.tag;
+        for (auto & as : ab.attributes)
+        {
+            auto fv = read_form(rd, as.form, as.implicit_const);
+            if ((fv.kind == form_value::strx) || (fv.kind == form_value::addrx))
+            {
+                //the bases are not known yet, when reading the unit itself.
+                if (ab.tag == dw_tag_compile_unit || ab.tag == dw_tag_partial_unit)
+                    continue;
+                resolve_index(fv);
+            }
+
+            auto value = [&]() -> boost::optional<std::uint64_t>
+                {
+                    if ((fv.kind == form_value::constant) || (fv.kind == form_value::signed_constant) || (fv.kind == form_value::address))
+                        return fv.value;
+                    return boost::none;
+                };
+
+            switch (as.name)
+            {
+            case dw_at_name:        if (fv.kind == form_value::string) d.name = std::move(fv.str); break;
+            case dw_at_type:        if (fv.kind == form_value::reference) d.type = fv.value; break;
+            case dw_at_byte_size:   d.byte_size   = value(); break;
+            case dw_at_encoding:    d.encoding    = value(); break;
+            case dw_at_low_pc:      d.low_pc      = value(); break;
+            case dw_at_high_pc:
+                d.high_pc = value();
+                d.high_pc_is_offset = fv.kind != form_value::address;
+                break;
+            case dw_at_upper_bound: if (fv.kind == form_value::constant) d.upper_bound = fv.value; break;
+            case dw_at_count:       if (fv.kind == form_value::constant) d.count = fv.value; break;
+            case dw_at_const_value: d.const_value = as_signed(fv); break;
+            case dw_at_declaration: d.declaration = fv.value != 0u; break;
+            case dw_at_specification:   if (fv.kind == form_value::reference) d.specification   = fv.value; break;
+            case dw_at_abstract_origin: if (fv.kind == form_value::reference) d.abstract_origin = fv.value; break;
+            case dw_at_location:    d.location   = std::move(fv); break;
+            case dw_at_frame_base:  d.frame_base = std::move(fv); break;
+            case dw_at_data_member_location:
+                if (fv.kind == form_value::block)
+                {
+                    dwarf_reader expr{elf, fv.data, fv.data + fv.size, ".debug_info"};
+                    if ((fv.size > 0) && (static_cast<unsigned char>(expr.u(1)) == dw_op_plus_uconst))
+                        d.member_offset = expr.uleb();
+                }
+                else
+                    d.member_offset = value();
+                break;
+            case dw_at_comp_dir:    if (fv.kind == form_value::string) d.comp_dir = std::move(fv.str); break;
+            //a constant before dwarf 4
+            case dw_at_stmt_list:
+                if ((fv.kind == form_value::section_offset) || (fv.kind == form_value::constant))
+                    d.stmt_list = fv.value;
+                break;
+            case dw_at_str_offsets_base: str_offsets_base = fv.value; break;
+            case dw_at_addr_base:        addr_base        = fv.value; break;
+            default:
+                break;
+            }
+        }
+        return d;
+    }
+
+    std::size_t add_type(const die & d, type_kind kind)
+    {
+        auto idx = info._types.size();
+        type_entry te;
+        te.kind = kind;
+        te.name = d.name;
+        te.size = d.byte_size.value_or(0u);
+        te.encoding = static_cast<std::uint32_t>(d.encoding.value_or(0u));
+        te.target = static_cast<std::size_t>(d.type); //resolved in finish
+        info._types.push_back(std::move(te));
+        type_at[d.offset] = idx;
+        return idx;
+    }
+
+    void name_type(const std::string & name, std::size_t idx, bool declaration)
+    {
+        if (name.empty())
+            return;
+        //a definition hides the declarations.
+        if (declaration)
+            info._type_names.emplace(name, idx);
+        else
+            info._type_names[name] = idx;
+    }
+
+    //a variable of a function or a global variable, with a simple location
+    void read_location(const die & d, variable & var)
+    {
+        if ((d.location.kind != form_value::block) || (d.location.size == 0u))
+            return;
+        dwarf_reader expr{elf, d.location.data, d.location.data + d.location.size, ".debug_info"};
+        auto op = static_cast<unsigned char>(expr.u(1));
+        if ((op == dw_op_addr) && (d.location.size == address_size + 1))
+            var.address = expr.u(address_size);
+        else if (op == dw_op_fbreg)
+            var.frame_offset = expr.sleb();
+    }
+
+    void handle(const die & d, scope & sc)
+    {
+        auto & parent = scopes.back();
+        sc.tag = d.tag;
+        sc.ns  = parent.ns;
+        sc.low_pc  = parent.low_pc;
+        sc.high_pc = parent.high_pc;
+
+        if (!d.name.empty() || d.specification || d.abstract_origin)
+        {
+            //functions & static variables are qualified with the namespace or class.
+            bool qualified = !d.name.empty() && ((d.tag == dw_tag_subprogram) || ((d.tag == dw_tag_variable) && (parent.function == no_type)));
+            named[d.offset] = named_entry{qualified ? parent.ns + d.name : d.name, d.type,
+                                          d.specification ? *d.specification : d.abstract_origin.value_or(0u)};
+        }
+
+        switch (d.tag)
+        {
+        case dw_tag_namespace:
+            sc.ns = parent.ns + (d.name.empty() ? std::string("(anonymous namespace)") : d.name) + "::";
+            break;
+        case dw_tag_base_type:
+        {
+            auto idx = add_type(d, type_kind::base);
+            name_type(d.name, idx, false);
+            break;
+        }
+        case dw_tag_unspecified_type: //i.e. decltype(nullptr)
+        {
+            auto idx = add_type(d, type_kind::base);
+            info._types[idx].size = address_size;
+            info._types[idx].encoding = dw_ate_unsigned;
+            name_type(parent.ns + d.name, idx, false);
+            break;
+        }
+        case dw_tag_pointer_type:
+        case dw_tag_ptr_to_member_type:
+        case dw_tag_reference_type:
+        case dw_tag_rvalue_reference_type:
+        {
+            auto idx = add_type(d, d.tag == dw_tag_reference_type || d.tag == dw_tag_rvalue_reference_type
+                                    ? type_kind::reference : type_kind::pointer);
+            if (!d.byte_size)
+                info._types[idx].size = address_size;
+            break;
+        }
+        case dw_tag_typedef:
+        {
+            auto idx = add_type(d, type_kind::alias);
+            name_type(d.name, idx, true);
+            if (!parent.ns.empty())
+                name_type(parent.ns + d.name, idx, true);
+            break;
+        }
+        case dw_tag_const_type:
+        case dw_tag_volatile_type:
+        case dw_tag_restrict_type:
+        case dw_tag_atomic_type:
+            add_type(d, type_kind::alias);
+            break;
+        case dw_tag_structure_type:
+        case dw_tag_class_type:
+        case dw_tag_union_type:
+        {
+            auto idx = add_type(d, type_kind::structure);
+            info._types[idx].target = 0u;
+            sc.type = idx;
+            sc.function = no_type; //member functions are only declared
+            if (!d.name.empty())
+            {
+                const char * key = d.tag == dw_tag_union_type ? "union " : (d.tag == dw_tag_class_type ? "class " : "struct ");
+                name_type(key + d.name, idx, d.declaration);
+                name_type(d.name, idx, d.declaration);
+                if (!parent.ns.empty())
+                    name_type(parent.ns + d.name, idx, d.declaration);
+                sc.ns = parent.ns + d.name + "::";
+            }
+            if (d.declaration)
+                declarations.push_back(idx);
+            break;
+        }
+        case dw_tag_member:
+            if ((parent.type != no_type) && !d.declaration)
+                info._types[parent.type].members.push_back(member{d.name, static_cast<std::size_t>(d.type), d.member_offset.value_or(0u)});
+            break;
+        case dw_tag_array_type:
+            sc.type = add_type(d, type_kind::array);
+            break;
+        case dw_tag_subrange_type:
+            if ((parent.type != no_type) && (info._types[parent.type].kind == type_kind::array))
+            {
+                std::uint64_t count = d.count ? *d.count : (d.upper_bound ? *d.upper_bound + 1u : 0u);
+                auto & arr = info._types[parent.type];
+                //multiple dimensions are flattened
+                arr.count = (arr.count == 0u) ? count : arr.count * count;
+            }
+            break;
+        case dw_tag_enumeration_type:
+        {
+            auto idx = add_type(d, type_kind::enumeration);
+            sc.type = idx;
+            if (!d.name.empty())
+            {
+                name_type("enum " + d.name, idx, d.declaration);
+                name_type(d.name, idx, d.declaration);
+                if (!parent.ns.empty())
+                    name_type(parent.ns + d.name, idx, d.declaration);
+            }
+            break;
+        }
+        case dw_tag_enumerator:
+            if ((parent.type != no_type) && d.const_value)
+            {
+                info._types[parent.type].enumerators.push_back(enumerator{d.name, *d.const_value});
+                info._enumerators.emplace(d.name, std::make_pair(*d.const_value, parent.type));
+                if (!parent.ns.empty())
+                    info._enumerators.emplace(parent.ns + d.name, std::make_pair(*d.const_value, parent.type));
+            }
+            break;
+        case dw_tag_subroutine_type:
+            add_type(d, type_kind::function);
+            break;
+        case dw_tag_subprogram:
+            sc.function = no_type;
+            if (d.low_pc && d.high_pc && !d.declaration)
+            {
+                function fn;
+                fn.name = d.name.empty() ? d.name : parent.ns + d.name;
+                fn.low_pc  = *d.low_pc;
+                fn.high_pc = d.high_pc_is_offset ? (*d.low_pc + *d.high_pc) : *d.high_pc;
+                if ((d.frame_base.kind == form_value::block) && (d.frame_base.size > 0u))
+                {
+                    auto op = static_cast<unsigned char>(d.frame_base.data[0]);
+                    fn.frame_base_cfa = (op != dw_op_reg6) && (op != dw_op_breg6);
+                }
+                sc.function = info._functions.size();
+                sc.low_pc  = fn.low_pc;
+                sc.high_pc = fn.high_pc;
+                info._functions.push_back(std::move(fn));
+                if (d.name.empty() && (d.specification || d.abstract_origin))
+                    function_origins.emplace_back(sc.function, d.specification ? *d.specification : *d.abstract_origin);
+            }
+            break;
+        case dw_tag_lexical_block:
+            if (d.low_pc && d.high_pc)
+            {
+                sc.low_pc  = *d.low_pc;
+                sc.high_pc = d.high_pc_is_offset ? (*d.low_pc + *d.high_pc) : *d.high_pc;
+            }
+            break;
+        case dw_tag_formal_parameter:
+        case dw_tag_variable:
+        {
+            variable var;
+            var.name = d.name;
+            var.type = static_cast<std::size_t>(d.type);
+            var.low_pc  = parent.low_pc;
+            var.high_pc = parent.high_pc;
+            read_location(d, var);
+            auto origin = d.specification ? *d.specification : d.abstract_origin.value_or(0u);
+
+            if ((parent.function != no_type) && (parent.tag == dw_tag_subprogram || parent.tag == dw_tag_lexical_block))
+            {
+                auto & fn = info._functions[parent.function];
+                bool local = (d.tag == dw_tag_variable) || (parent.tag != dw_tag_subprogram);
+                auto & vec = local ? fn.locals : fn.parameters;
+                if (origin != 0u)
+                    variable_origins.emplace_back(parent.function, local, vec.size(), origin);
+                vec.push_back(std::move(var));
+            }
+            else if ((d.tag == dw_tag_variable) && var.address)
+            {
+                if (!var.name.empty())
+                    var.name = parent.ns + var.name;
+                if (origin != 0u)
+                    global_origins.emplace_back(info._globals.size(), origin);
+                info._globals.push_back(std::move(var));
+            }
+            break;
+        }
+        default:
+            sc.function = no_type;
+            break;
+        }
+
+        //the children of a type or a block are still part of the function.
+        if ((d.tag == dw_tag_lexical_block) || (d.tag == dw_tag_formal_parameter) || (d.tag == dw_tag_variable))
+            sc.function = parent.function;
+    }
+
+    std::vector<std::size_t> declarations;
+
+    //if set, only the entries of the units are read, for their compilation directories.
+    std::unordered_map<std::uint64_t, std::string> * comp_dirs = nullptr;
+
+    void read_unit(const char * & ptr, const char * end)
+    {
+        dwarf_reader rd{elf, ptr, end, ".debug_info"};
+        unit_offset = static_cast<std::uint64_t>(ptr - section_begin);
+
+        offset_size = 4u;
+        auto unit_length = rd.u(4);
+        if (unit_length == 0xffffffffu)
+        {
+            offset_size = 8u;
+            unit_length = rd.u(8);
+        }
+        rd.check(unit_length);
+        const char * unit_end = rd.ptr + unit_length;
+        ptr = unit_end;
+        rd.end = unit_end;
+
+        version = rd.u(2);
+        if ((version < 2) || (version > 5))
+            throw elf_error("unsupported .debug_info version " + std::to_string(version));
+
+        std::uint64_t abbrev_offset;
+        if (version >= 5)
+        {
+            auto unit_type = rd.u(1);
+            address_size = rd.u(1);
+            abbrev_offset = rd.u(offset_size);
+            if (unit_type != 1u && unit_type != 3u) //only full & partial units have the debug info of the program.
+                return;
+        }
+        else
+        {
+            abbrev_offset = rd.u(offset_size);
+            address_size = rd.u(1);
+        }
+
+        auto & abbrevs = abbrev_table(abbrev_offset);
+        str_offsets_base = 0u;
+        addr_base = 0u;
+
+        scopes.clear();
+        scopes.push_back(scope{0u, std::string(), no_type, no_type, 0u, 0u});
+
+        while (rd.ptr < rd.end)
+        {
+            auto offset = static_cast<std::uint64_t>(rd.ptr - section_begin);
+            auto code = rd.uleb();
+            if (code == 0u)
+            {
+                if (scopes.size() > 1u)
+                    scopes.pop_back();
+                continue;
+            }
+            auto itr = abbrevs.find(code);
+            if (itr == abbrevs.end())
+                throw elf_error("invalid abbreviation code in .debug_info");
+
+            auto & ab = itr->second;
+            auto d = read_die(rd, ab, offset);
+            if (comp_dirs)
+            {
+                if (d.stmt_list && !d.comp_dir.empty())
+                    comp_dirs->emplace(*d.stmt_list, std::move(d.comp_dir));
+                return;
+            }
+            scope sc{d.tag, std::string(), no_type, no_type, 0u, 0u};
+            if ((d.tag != dw_tag_compile_unit) && (d.tag != dw_tag_partial_unit))
+                handle(d, sc);
+
+            if (ab.children)
+                scopes.push_back(std::move(sc));
+        }
+    }
+
+    const named_entry * find_named(std::uint64_t offset)
+    {
+        //follow the specifications & origins to the declaration with the name.
+        for (int i = 0; (i < 8) && (offset != 0u); i++)
+        {
+            auto itr = named.find(offset);
+            if (itr == named.end())
+                return nullptr;
+            if (!itr->second.name.empty())
+                return &itr->second;
+            offset = itr->second.origin;
+        }
+        return nullptr;
+    }
+
+    std::size_t type_index(std::uint64_t offset) const
+    {
+        auto itr = type_at.find(offset);
+        return itr == type_at.end() ? no_type : itr->second;
+    }
+
+    void finish()
+    {
+        for (auto & fo : function_origins)
+            if (auto ne = find_named(fo.second))
+                info._functions[fo.first].name = ne->name;
+
+        auto complete = [&](variable & var, std::uint64_t origin)
+            {
+                if (auto ne = find_named(origin))
+                {
+                    if (var.name.empty())
+                        var.name = ne->name;
+                    if (var.type == 0u)
+                        var.type = static_cast<std::size_t>(ne->type);
+                }
+            };
+        for (auto & go : global_origins)
+            complete(info._globals[go.first], go.second);
+        for (auto & vo : variable_origins)
+        {
+            auto & fn = info._functions[std::get<0>(vo)];
+            complete((std::get<1>(vo) ? fn.locals : fn.parameters)[std::get<2>(vo)], std::get<3>(vo));
+        }
+
+        //until here the types are the offsets of the entries.
+        for (auto & te : info._types)
+        {
+            te.target = type_index(te.target);
+            for (auto & m : te.members)
+                m.type = type_index(m.type);
+        }
+        for (auto & g : info._globals)
+            g.type = type_index(g.type);
+        for (auto & fn : info._functions)
+        {
+            for (auto & p : fn.parameters)
+                p.type = type_index(p.type);
+            for (auto & l : fn.locals)
+                l.type = type_index(l.type);
+        }
+
+        //a declared struct refers to the definition of the same name.
+        for (auto idx : declarations)
+        {
+            auto & te = info._types[idx];
+            auto itr = info._type_names.find(te.name);
+            if ((itr != info._type_names.end()) && (itr->second != idx) && (info._types[itr->second].kind == type_kind::structure))
+            {
+                te.kind = type_kind::alias;
+                te.target = itr->second;
+            }
+        }
+
+        for (std::size_t i = 0u; i < info._globals.size(); i++)
+            info._global_names.emplace(info._globals[i].name, i);
+
+        std::sort(info._functions.begin(), info._functions.end(),
+                  [](const function & lhs, const function & rhs){return lhs.low_pc < rhs.low_pc;});
+    }
+};
+
+debug_info::debug_info(const elf_file & elf)
+{
+    auto sec = elf.find_section(".debug_info");
+    if (sec == nullptr)
+        throw elf_error("no .debug_info section");
+
+    auto sd = elf.data(*sec);
+    parser p(*this, elf, sd.data);
+
+    const char * ptr = sd.data;
+    const char * end = sd.data + sd.size;
+    while (ptr < end)
+        p.read_unit(ptr, end);
+
+    p.finish();
+}
+
+std::unordered_map<std::uint64_t, std::string> debug_info::compilation_dirs(const elf_file & elf)
+{
+    std::unordered_map<std::uint64_t, std::string> res;
+    auto sec = elf.find_section(".debug_info");
+    if (sec == nullptr)
+        return res;
+
+    debug_info info;
+    auto sd = elf.data(*sec);
+    parser p(info, elf, sd.data);
+    p.comp_dirs = &res;
+
+    const char * ptr = sd.data;
+    const char * end = sd.data + sd.size;
+    while (ptr < end)
+        p.read_unit(ptr, end);
+    return res;
+}
+
+std::size_t debug_info::resolve(std::size_t idx) const
+{
+    for (int i = 0; (i < 32) && (idx != no_type) && (_types[idx].kind == type_kind::alias); i++)
+        idx = _types[idx].target;
+    return idx;
+}
+
+std::size_t debug_info::find_type(const std::string & name) const
+{
+    auto itr = _type_names.find(name);
+    return itr == _type_names.end() ? no_type : itr->second;
+}
+
+std::size_t debug_info::add_type(type_entry && te)
+{
+    auto idx = _types.size();
+    if (!te.name.empty())
+        _type_names.emplace(te.name, idx);
+    _types.push_back(std::move(te));
+    return idx;
+}
+
+std::size_t debug_info::pointer_to(std::size_t idx)
+{
+    auto itr = _pointers.find(idx);
+    if (itr != _pointers.end())
+        return itr->second;
+
+    //look for one in the debug info first, so the names are the same.
+    auto res = no_type;
+    for (std::size_t i = 0u; i < _types.size(); i++)
+        if ((_types[i].kind == type_kind::pointer) && (_types[i].target == idx))
+        {
+            res = i;
+            break;
+        }
+
+    if (res == no_type)
+    {
+        type_entry te;
+        te.kind = type_kind::pointer;
+        te.size = sizeof(std::uint64_t);
+        te.target = idx;
+        res = add_type(std::move(te));
+    }
+    _pointers.emplace(idx, res);
+    return res;
+}
+
+std::uint64_t debug_info::size_of(std::size_t idx) const
+{
+    idx = resolve(idx);
+    if (idx == no_type)
+        return 1u; //like gdb, sizeof(void) is 1.
+
+    auto & te = _types[idx];
+    switch (te.kind)
+    {
+    case type_kind::array:    return te.count * size_of(te.target);
+    case type_kind::function: return 1u;
+    case type_kind::enumeration:
+        return (te.size == 0u) && (te.target != no_type) ? size_of(te.target) : te.size;
+    default:                  return te.size;
+    }
+}
+
+const variable * debug_info::find_global(const std::string & name) const
+{
+    auto itr = _global_names.find(name);
+    return itr == _global_names.end() ? nullptr : &_globals[itr->second];
+}
+
+const function * debug_info::find_function(std::uint64_t address) const
+{
+    auto itr = std::upper_bound(_functions.begin(), _functions.end(), address,
+                                [](std::uint64_t addr, const function & fn){return addr < fn.low_pc;});
+    if (itr == _functions.begin())
+        return nullptr;
+    --itr;
+    return (address < itr->high_pc) ? &*itr : nullptr;
+}
+
+boost::optional<std::pair<std::int64_t, std::size_t>> debug_info::find_enumerator(const std::string & name) const
+{
+    auto itr = _enumerators.find(name);
+    if (itr == _enumerators.end())
+        return boost::none;
+    return itr->second;
+}
+
+}}
@@ -0,0 +1,137 @@
+/**
+ * @file   elf/debug_info.hpp
+ * @date   19.10.2026
+ * @author Klemens D. Morgenstern
+ *
+
+ This header provides the parts of the `.debug_info` section (DWARF 2 to 5) a debugger needs to show values:
+ the types, the global variables and the functions with their parameters and local variables.
+ Everything else (e.g. location lists, templates or inlined calls) is skipped.
+
+ */
+#ifndef METAL_ELF_DEBUG_INFO_HPP_
+#define METAL_ELF_DEBUG_INFO_HPP_
+
+#include "elf_file.hpp"
+
+#include <boost/optional.hpp>
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace metal { namespace elf {
+
+///The index of a type, no_type is `void`.
+constexpr std::size_t no_type = static_cast<std::size_t>(-1);
+
+enum class type_kind
+{
+    base,        ///<int, char, float etc., distinguished by the encoding
+    pointer,
+    reference,   ///<lvalue- and rvalue-references
+    structure,   ///<struct, class & union
+    array,
+    enumeration,
+    function,
+    alias        ///<typedef and the cv-qualifiers, resolved by debug_info::resolve
+};
+
+//the encodings of base types
+constexpr std::uint32_t dw_ate_boolean       = 0x02;
+constexpr std::uint32_t dw_ate_float         = 0x04;
+constexpr std::uint32_t dw_ate_signed        = 0x05;
+constexpr std::uint32_t dw_ate_signed_char   = 0x06;
+constexpr std::uint32_t dw_ate_unsigned      = 0x07;
+constexpr std::uint32_t dw_ate_unsigned_char = 0x08;
+constexpr std::uint32_t dw_ate_utf           = 0x10;
+
+struct member
+{
+    std::string name;
+    std::size_t type;
+    std::uint64_t offset;
+};
+
+struct enumerator
+{
+    std::string name;
+    std::int64_t value;
+};
+
+struct type_entry
+{
+    type_kind kind;
+    std::string name;
+    std::uint64_t size = 0u;
+    std::uint32_t encoding = 0u;
+    std::size_t target = no_type;  ///<The pointee, element, underlying or aliased type.
+    std::uint64_t count = 0u;      ///<The number of elements of an array
+    std::vector<member> members;
+    std::vector<enumerator> enumerators;
+};
+
+struct variable
+{
+    std::string name;
+    std::size_t type = no_type;
+    boost::optional<std::uint64_t> address;     ///<The address of a static variable.
+    boost::optional<std::int64_t>  frame_offset; ///<The offset to the frame base of the function.
+    ///The range of the block declaring it, which is the whole function for the parameters.
+    std::uint64_t low_pc = 0u;
+    std::uint64_t high_pc = 0u;
+};
+
+struct function
+{
+    std::string name;
+    std::uint64_t low_pc;
+    std::uint64_t high_pc;
+    ///The frame base is the canonical frame address, otherwise it's the frame pointer, i.e. rbp.
+    bool frame_base_cfa = true;
+    std::vector<variable> parameters;
+    std::vector<variable> locals;
+};
+
+class debug_info
+{
+    std::vector<type_entry> _types;
+    std::vector<variable>   _globals;
+    std::vector<function>   _functions;
+    std::unordered_map<std::string, std::size_t> _type_names;
+    std::unordered_map<std::string, std::size_t> _global_names;
+    std::unordered_map<std::string, std::pair<std::int64_t, std::size_t>> _enumerators;
+    std::unordered_map<std::size_t, std::size_t> _pointers;
+
+    struct parser;
+public:
+    ///Empty, i.e. for a binary without debug information.
+    debug_info() = default;
+    ///Throws an elf_error, if the file has no or a malformed `.debug_info` section.
+    explicit debug_info(const elf_file & elf);
+
+    const type_entry & type(std::size_t idx) const {return _types.at(idx);}
+    ///Follow typedefs & qualifiers to the actual type.
+    std::size_t resolve(std::size_t idx) const;
+    ///Find a type by name, e.g. `int`, `uint32_t` or `struct foo`. Returns no_type if it's unknown.
+    std::size_t find_type(const std::string & name) const;
+    ///Add a type, that isn't part of the debug info, e.g. a pointer used in a cast.
+    std::size_t add_type(type_entry && te);
+    std::size_t pointer_to(std::size_t idx);
+    ///The size of an instance, i.e. sizeof.
+    std::uint64_t size_of(std::size_t idx) const;
+
+    const variable * find_global(const std::string & name) const;
+    ///The function containing the address or nullptr.
+    const function * find_function(std::uint64_t address) const;
+    ///The value and the enumeration type of an enumerator.
+    boost::optional<std::pair<std::int64_t, std::size_t>> find_enumerator(const std::string & name) const;
+
+    ///The compilation directories of the units by the offset of their line program, i.e. DW_AT_stmt_list.
+    static std::unordered_map<std::uint64_t, std::string> compilation_dirs(const elf_file & elf);
+};
+
+}}
+
+#endif /* METAL_ELF_DEBUG_INFO_HPP_ */
@@ -0,0 +1,103 @@
+/**
+ * @file   elf/dwarf_reader.hpp
+ * @date   19.10.2026
+ * @author Klemens D. Morgenstern
+ *
+
+ The primitives to decode the DWARF sections, i.e. integers in the byte order of the file, LEB128 and strings.
+
+ */
+#ifndef METAL_ELF_DWARF_READER_HPP_
+#define METAL_ELF_DWARF_READER_HPP_
+
+#include "elf_file.hpp"
+
+#include <cstring>
+#include <string>
+
+namespace metal { namespace elf {
+
+struct dwarf_reader
+{
+    const elf_file & elf;
+    const char * ptr;
+    const char * end;
+    const char * section; ///<The name of the section, for the error messages.
+
+    void check(std::size_t size) const
+    {
+        if (size > static_cast<std::size_t>(end - ptr))
+            throw elf_error(std::string(section) + " is truncated");
+    }
+
+    std::uint64_t u(std::size_t size)
+    {
+        check(size);
+        auto value = elf.read(ptr, size);
+        ptr += size;
+        return value;
+    }
+
+    std::uint64_t uleb()
+    {
+        std::uint64_t value = 0u;
+        for (int shift = 0; ; shift += 7)
+        {
+            auto byte = static_cast<unsigned char>(u(1));
+            if (shift < 64)
+                value |= static_cast<std::uint64_t>(byte & 0x7F) << shift;
+            if ((byte & 0x80) == 0)
+                return value;
+        }
+    }
+
+    std::int64_t sleb()
+    {
+        std::int64_t value = 0;
+        int shift = 0;
+        unsigned char byte;
+        do
+        {
+            byte = static_cast<unsigned char>(u(1));
+            if (shift < 64)
+                value |= static_cast<std::int64_t>(byte & 0x7F) << shift;
+            shift += 7;
+        }
+        while (byte & 0x80);
+
+        if ((shift < 64) && (byte & 0x40))
+            value |= -(static_cast<std::int64_t>(1) << shift);
+        return value;
+    }
+
+    std::string str()
+    {
+        auto len = strnlen(ptr, end - ptr);
+        check(len + 1);
+        std::string value(ptr, len);
+        ptr += len + 1;
+        return value;
+    }
+
+    void skip(std::size_t size)
+    {
+        check(size);
+        ptr += size;
+    }
+};
+
+///Read the null-terminated string at `offset` of a string section, e.g. `.debug_str`.
+inline std::string string_at(const elf_file & elf, const char * section_name, std::uint64_t offset)
+{
+    auto sec = elf.find_section(section_name);
+    if (sec == nullptr)
+        throw elf_error(std::string("missing section ") + section_name);
+    auto sd = elf.data(*sec);
+    if (offset >= sd.size)
+        throw elf_error(std::string("invalid offset into ") + section_name);
+    return std::string(sd.data + offset, strnlen(sd.data + offset, sd.size - offset));
+}
+
+}}
+
+#endif /* METAL_ELF_DWARF_READER_HPP_ */
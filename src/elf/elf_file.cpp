@@ -0,0 +1,245 @@
+/**
+ * @file   elf/elf_file.cpp
+ * @date   19.10.2026
+ * @author Klemens D. Morgenstern
+ *
+
+ */
+
+#include "elf_file.hpp"
+
+#include <boost/filesystem/fstream.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+
+namespace metal { namespace elf {
+
+namespace
+{
+
+constexpr std::uint32_t sht_symtab = 2;
+constexpr std::uint32_t sht_note   = 7;
+constexpr std::uint32_t nt_gnu_build_id = 3;
+constexpr unsigned char stt_func   = 2;
+
+std::uint64_t align4(std::uint64_t value) {return (value + 3) & ~std::uint64_t(3);}
+
+}
+
+elf_file::elf_file(const boost::filesystem::path & path)
+{
+    boost::filesystem::ifstream fs{path, std::ios::binary};
+    if (!fs)
+        throw elf_error("cannot open " + path.string());
+
+    _data.assign(std::istreambuf_iterator<char>(fs), std::istreambuf_iterator<char>());
+
+    if ((_data.size() < 0x34) || !std::equal(_data.begin(), _data.begin() + 4, "\x7f" "ELF"))
+        throw elf_error(path.string() + " is not an elf file");
+
+    _is64          = _data[4] == 2;
+    _little_endian = _data[5] == 1;
+
+    if (_is64 && (_data.size() < 0x40))
+        throw elf_error(path.string() + " is not an elf file");
+
+    _load_sections();
+}
+
+void elf_file::_check_range(std::uint64_t offset, std::uint64_t size) const
+{
+    if ((offset > _data.size()) || (size > (_data.size() - offset)))
+        throw elf_error("elf file is truncated");
+}
+
+std::uint64_t elf_file::read(const char * ptr, std::size_t size) const
+{
+    std::uint64_t value = 0;
+    for (std::size_t i = 0u; i < size; i++)
+    {
+        auto byte = static_cast<std::uint64_t>(static_cast<unsigned char>(ptr[_little_endian ? (size - i - 1) : i]));
+        value = (value << 8) | byte;
+    }
+    return value;
+}
+
+void elf_file::_load_sections()
+{
+    const char * hdr = _data.data();
+
+    auto sh_offset    = _is64 ? read(hdr + 0x28, 8) : read(hdr + 0x20, 4);
+    auto sh_entsize   = _is64 ? read(hdr + 0x3A, 2) : read(hdr + 0x2E, 2);
+    auto sh_num       = _is64 ? read(hdr + 0x3C, 2) : read(hdr + 0x30, 2);
+    auto sh_str_index = _is64 ? read(hdr + 0x3E, 2) : read(hdr + 0x32, 2);
+
+    if (sh_num == 0)
+        return;
+
+    _check_range(sh_offset, sh_entsize * sh_num);
+
+    _sections.reserve(sh_num);
+    std::vector<std::uint32_t> names;
+    names.reserve(sh_num);
+
+    for (auto i = 0u; i < sh_num; i++)
+    {
+        const char * sh = hdr + sh_offset + i * sh_entsize;
+        section sec;
+        names.push_back(static_cast<std::uint32_t>(read(sh, 4)));
+        sec.type = static_cast<std::uint32_t>(read(sh + 4, 4));
+        if (_is64)
+        {
+            sec.address    = read(sh + 0x10, 8);
+            sec.offset     = read(sh + 0x18, 8);
+            sec.size       = read(sh + 0x20, 8);
+            sec.link       = static_cast<std::uint32_t>(read(sh + 0x28, 4));
+            sec.entry_size = read(sh + 0x38, 8);
+        }
+        else
+        {
+            sec.address    = read(sh + 0x0C, 4);
+            sec.offset     = read(sh + 0x10, 4);
+            sec.size       = read(sh + 0x14, 4);
+            sec.link       = static_cast<std::uint32_t>(read(sh + 0x18, 4));
+            sec.entry_size = read(sh + 0x24, 4);
+        }
+        _sections.push_back(std::move(sec));
+    }
+
+    if (sh_str_index >= _sections.size())
+        return;
+
+    auto str_tab = data(_sections[sh_str_index]);
+    for (auto i = 0u; i < _sections.size(); i++)
+        if (names[i] < str_tab.size)
+            _sections[i].name = str_tab.data + names[i]; //the table is null-terminated.
+}
+
+const section * elf_file::find_section(const std::string & name) const
+{
+    auto itr = std::find_if(_sections.begin(), _sections.end(), [&](const section & sec){return sec.name == name;});
+    if (itr == _sections.end())
+        return nullptr;
+    else
+        return &*itr;
+}
+
+section_data elf_file::data(const section & sec) const
+{
+    _check_range(sec.offset, sec.size);
+    return {_data.data() + sec.offset, static_cast<std::size_t>(sec.size)};
+}
+
+std::uint64_t elf_file::entry() const
+{
+    return _is64 ? read(_data.data() + 0x18, 8) : read(_data.data() + 0x18, 4);
+}
+
+boost::optional<std::string> elf_file::build_id() const
+{
+    for (auto & sec : _sections)
+    {
+        if (sec.type != sht_note)
+            continue;
+
+        auto dt = data(sec);
+        std::uint64_t pos = 0u;
+        while (pos + 12 <= dt.size)
+        {
+            auto name_size = read(dt.data + pos,     4);
+            auto desc_size = read(dt.data + pos + 4, 4);
+            auto type      = read(dt.data + pos + 8, 4);
+
+            auto name_pos = pos + 12;
+            auto desc_pos = name_pos + align4(name_size);
+            if ((desc_pos + desc_size) > dt.size)
+                break;
+
+            if ((type == nt_gnu_build_id) && (name_size == 4) && std::equal(dt.data + name_pos, dt.data + name_pos + 4, "GNU"))
+            {
+                static const char hex[] = "0123456789abcdef";
+                std::string res;
+                res.reserve(desc_size * 2);
+                for (auto i = 0u; i < desc_size; i++)
+                {
+                    auto c = static_cast<unsigned char>(dt.data[desc_pos + i]);
+                    res.push_back(hex[c >> 4]);
+                    res.push_back(hex[c & 0xF]);
+                }
+                return res;
+            }
+            pos = desc_pos + align4(desc_size);
+        }
+    }
+    return boost::none;
+}
+
+template<typename Func>
+void elf_file::_for_each_symbol(Func && func) const
+{
+    for (auto & sec : _sections)
+    {
+        if ((sec.type != sht_symtab) || (sec.link >= _sections.size()))
+            continue;
+
+        auto sym_tab = data(sec);
+        auto str_tab = data(_sections[sec.link]);
+
+        const std::size_t entry_size = _is64 ? 24 : 16;
+        for (std::size_t pos = 0u; (pos + entry_size) <= sym_tab.size; pos += entry_size)
+        {
+            const char * sym = sym_tab.data + pos;
+            auto name = read(sym, 4);
+
+            unsigned char info;
+            symbol s;
+            if (_is64)
+            {
+                info    = static_cast<unsigned char>(sym[4]);
+                s.value = read(sym + 8,  8);
+                s.size  = read(sym + 16, 8);
+            }
+            else
+            {
+                s.value = read(sym + 4, 4);
+                s.size  = read(sym + 8, 4);
+                info    = static_cast<unsigned char>(sym[12]);
+            }
+
+            const char * name_ptr = (name < str_tab.size) ? (str_tab.data + name) : "";
+            func(std::move(s), info, name_ptr);
+        }
+    }
+}
+
+std::vector<symbol> elf_file::function_symbols() const
+{
+    std::vector<symbol> res;
+    _for_each_symbol(
+            [&](symbol && s, unsigned char info, const char * name)
+            {
+                if (((info & 0xF) != stt_func) || (s.size == 0) || (s.value == 0))
+                    return;
+                s.name = name;
+                res.push_back(std::move(s));
+            });
+    return res;
+}
+
+std::vector<symbol> elf_file::symbols_with_prefix(const std::string & prefix) const
+{
+    std::vector<symbol> res;
+    _for_each_symbol(
+            [&](symbol && s, unsigned char, const char * name)
+            {
+                if (std::strncmp(name, prefix.c_str(), prefix.size()) != 0)
+                    return;
+                s.name = name;
+                res.push_back(std::move(s));
+            });
+    return res;
+}
+
+}}
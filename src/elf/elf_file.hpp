@@ -0,0 +1,93 @@
+/**
+ * @file   elf/elf_file.hpp
+ * @date   19.10.2026
+ * @author Klemens D. Morgenstern
+ *
+
+ This header provides a minimal reader for ELF files, i.e. for the sections, symbols and the build-id.
+ It is used to obtain information about the target binary without asking the debugger.
+
+ */
+#ifndef METAL_ELF_ELF_FILE_HPP_
+#define METAL_ELF_ELF_FILE_HPP_
+
+#include <boost/filesystem/path.hpp>
+#include <boost/optional.hpp>
+
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace metal { namespace elf {
+
+///Thrown if the file cannot be read or is not a valid ELF file.
+struct elf_error : std::runtime_error
+{
+    using std::runtime_error::runtime_error;
+};
+
+struct section
+{
+    std::string name;
+    std::uint32_t type;
+    std::uint64_t address;
+    std::uint64_t offset;
+    std::uint64_t size;
+    std::uint32_t link;
+    std::uint64_t entry_size;
+};
+
+struct symbol
+{
+    std::string name;
+    std::uint64_t value;
+    std::uint64_t size;
+};
+
+///A view of the raw content of a section.
+struct section_data
+{
+    const char * data;
+    std::size_t size;
+};
+
+class elf_file
+{
+    std::vector<char> _data;
+    bool _is64;
+    bool _little_endian;
+    std::vector<section> _sections;
+
+    void _load_sections();
+    void _check_range(std::uint64_t offset, std::uint64_t size) const;
+    template<typename Func>
+    void _for_each_symbol(Func && func) const;
+public:
+    explicit elf_file(const boost::filesystem::path & path);
+
+    bool is64() const {return _is64;}
+    bool little_endian() const {return _little_endian;}
+
+    const std::vector<section> & sections() const {return _sections;}
+    ///Returns the section with the given name or nullptr.
+    const section * find_section(const std::string & name) const;
+    section_data data(const section & sec) const;
+
+    ///Read an unsigned integer of `size` bytes, in the byte order of the file.
+    std::uint64_t read(const char * ptr, std::size_t size) const;
+
+    ///The entry point of the program as linked, the difference to the actual one is the load bias of a PIE.
+    std::uint64_t entry() const;
+
+    ///The content of the GNU build-id note as hex-string, if present.
+    boost::optional<std::string> build_id() const;
+    ///All function symbols with a size, i.e. the entry points of the functions.
+    std::vector<symbol> function_symbols() const;
+    ///All symbols whose name starts with `prefix`, e.g. labels emitted by inline assembly.
+    std::vector<symbol> symbols_with_prefix(const std::string & prefix) const;
+};
+
+}}
+
+#endif /* METAL_ELF_ELF_FILE_HPP_ */
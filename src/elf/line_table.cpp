@@ -0,0 +1,331 @@
+/**
+ * @file   elf/line_table.cpp
+ * @date   19.10.2026
+ * @author Klemens D. Morgenstern
+ *
+
+ */
+
+#include "line_table.hpp"
+#include "debug_info.hpp"
+#include "dwarf_reader.hpp"
+
+#include <boost/filesystem/path.hpp>
+
+#include <algorithm>
+
+namespace metal { namespace elf {
+
+namespace
+{
+
+//standard opcodes
+constexpr unsigned char dw_lns_copy               = 1;
+constexpr unsigned char dw_lns_advance_pc         = 2;
+constexpr unsigned char dw_lns_advance_line       = 3;
+constexpr unsigned char dw_lns_set_file           = 4;
+constexpr unsigned char dw_lns_const_add_pc       = 8;
+constexpr unsigned char dw_lns_fixed_advance_pc   = 9;
+
+//extended opcodes
+constexpr unsigned char dw_lne_end_sequence = 1;
+constexpr unsigned char dw_lne_set_address  = 2;
+constexpr unsigned char dw_lne_define_file  = 3;
+
+//entry formats of dwarf 5
+constexpr std::uint64_t dw_lnct_path            = 1;
+constexpr std::uint64_t dw_lnct_directory_index = 2;
+
+constexpr std::uint64_t dw_form_block     = 0x09;
+constexpr std::uint64_t dw_form_block1    = 0x0a;
+constexpr std::uint64_t dw_form_data1     = 0x0b;
+constexpr std::uint64_t dw_form_data2     = 0x05;
+constexpr std::uint64_t dw_form_data4     = 0x06;
+constexpr std::uint64_t dw_form_data8     = 0x07;
+constexpr std::uint64_t dw_form_data16    = 0x1e;
+constexpr std::uint64_t dw_form_string    = 0x08;
+constexpr std::uint64_t dw_form_strp      = 0x0e;
+constexpr std::uint64_t dw_form_line_strp = 0x1f;
+constexpr std::uint64_t dw_form_udata     = 0x0f;
+
+std::string join(const std::string & dir, const std::string & file)
+{
+    if (dir.empty() || boost::filesystem::path(file).is_absolute())
+        return file;
+    return (boost::filesystem::path(dir) / file).string();
+}
+
+}
+
+line_table::line_table(const elf_file & elf)
+{
+    auto sec = elf.find_section(".debug_line");
+    if (sec == nullptr)
+        throw elf_error("no .debug_line section");
+
+    //without a .debug_info the paths of the older versions stay relative.
+    std::unordered_map<std::uint64_t, std::string> comp_dirs;
+    try
+    {
+        comp_dirs = debug_info::compilation_dirs(elf);
+    }
+    catch (elf_error &)
+    {
+    }
+
+    auto sd = elf.data(*sec);
+    const char * ptr = sd.data;
+    const char * end = sd.data + sd.size;
+    while (ptr < end)
+    {
+        auto itr = comp_dirs.find(static_cast<std::uint64_t>(ptr - sd.data));
+        _read_unit(elf, ptr, end, itr != comp_dirs.end() ? itr->second : std::string());
+    }
+
+    //at the same address the end of a sequence comes before the start of the next one, so the latter is found.
+    std::stable_sort(_entries.begin(), _entries.end(),
+            [](const line_entry & lhs, const line_entry & rhs)
+            {
+                if (lhs.address != rhs.address)
+                    return lhs.address < rhs.address;
+                return lhs.end_sequence && !rhs.end_sequence;
+            });
+}
+
+void line_table::_read_unit(const elf_file & elf, const char * & ptr, const char * end, const std::string & comp_dir)
+{
+    dwarf_reader rd{elf, ptr, end, ".debug_line"};
+
+    std::size_t offset_size = 4u;
+    auto unit_length = rd.u(4);
+    if (unit_length == 0xffffffffu)
+    {
+        offset_size = 8u;
+        unit_length = rd.u(8);
+    }
+    rd.check(unit_length);
+    const char * unit_end = rd.ptr + unit_length;
+    ptr = unit_end;
+    rd.end = unit_end;
+
+    auto version = rd.u(2);
+    if ((version < 2) || (version > 5))
+        throw elf_error("unsupported .debug_line version " + std::to_string(version));
+
+    std::size_t address_size = elf.is64() ? 8u : 4u;
+    if (version >= 5)
+    {
+        address_size = rd.u(1);
+        rd.u(1); //segment selector size
+    }
+
+    auto header_length = rd.u(offset_size);
+    rd.check(header_length);
+    const char * program = rd.ptr + header_length;
+
+    auto min_inst_length = rd.u(1);
+    if (version >= 4)
+        rd.u(1); //maximum operations per instruction, only relevant for VLIW
+    rd.u(1); //default_is_stmt
+    auto line_base   = static_cast<std::int8_t>(rd.u(1));
+    auto line_range  = rd.u(1);
+    auto opcode_base = rd.u(1);
+    if (line_range == 0)
+        throw elf_error("invalid line_range in .debug_line");
+
+    std::vector<std::uint8_t> opcode_lengths(opcode_base > 0 ? opcode_base - 1 : 0);
+    for (auto & ol : opcode_lengths)
+        ol = static_cast<std::uint8_t>(rd.u(1));
+
+    std::vector<std::string> dirs;
+    //the index in _files of the files of this unit
+    std::vector<std::uint32_t> files;
+
+    auto add_file = [&](const std::string & name, std::uint64_t dir)
+    {
+        files.push_back(static_cast<std::uint32_t>(_files.size()));
+        _files.push_back(join(dir < dirs.size() ? dirs[dir] : std::string(), name));
+    };
+
+    if (version >= 5)
+    {
+        auto read_form = [&](std::uint64_t form, std::string * str, std::uint64_t * value)
+        {
+            switch (form)
+            {
+            case dw_form_string:    if (str) *str = rd.str(); else rd.str(); break;
+            case dw_form_line_strp: {auto off = rd.u(offset_size); if (str) *str = string_at(elf, ".debug_line_str", off);} break;
+            case dw_form_strp:      {auto off = rd.u(offset_size); if (str) *str = string_at(elf, ".debug_str", off);} break;
+            case dw_form_udata:     {auto v = rd.uleb(); if (value) *value = v;} break;
+            case dw_form_data1:     {auto v = rd.u(1); if (value) *value = v;} break;
+            case dw_form_data2:     {auto v = rd.u(2); if (value) *value = v;} break;
+            case dw_form_data4:     {auto v = rd.u(4); if (value) *value = v;} break;
+            case dw_form_data8:     {auto v = rd.u(8); if (value) *value = v;} break;
+            case dw_form_data16:    rd.skip(16); break;
+            case dw_form_block:     rd.skip(rd.uleb()); break;
+            case dw_form_block1:    rd.skip(rd.u(1)); break;
+            default:
+                throw elf_error("unsupported form " + std::to_string(form) + " in .debug_line");
+            }
+        };
+
+        auto read_entries = [&](auto && on_entry)
+        {
+            std::vector<std::pair<std::uint64_t, std::uint64_t>> format(rd.u(1));
+            for (auto & f : format)
+            {
+                f.first  = rd.uleb();
+                f.second = rd.uleb();
+            }
+            auto count = rd.uleb();
+            for (auto i = 0u; i < count; i++)
+            {
+                std::string path;
+                std::uint64_t dir = 0u;
+                for (auto & f : format)
+                {
+                    if (f.first == dw_lnct_path)
+                        read_form(f.second, &path, nullptr);
+                    else if (f.first == dw_lnct_directory_index)
+                        read_form(f.second, nullptr, &dir);
+                    else
+                        read_form(f.second, nullptr, nullptr);
+                }
+                on_entry(path, dir);
+            }
+        };
+
+        //the first directory is the compilation directory, the others might be relative to it.
+        read_entries([&](const std::string & path, std::uint64_t)
+                     {
+                        dirs.push_back(dirs.empty() ? path : join(dirs.front(), path));
+                     });
+        read_entries(add_file);
+    }
+    else
+    {
+        //the compilation directory is the one of the unit, the others might be relative to it.
+        dirs.push_back(comp_dir);
+        for (auto dir = rd.str(); !dir.empty(); dir = rd.str())
+            dirs.push_back(join(comp_dir, dir));
+
+        //the files are counted from 1
+        files.push_back(0u);
+        for (auto name = rd.str(); !name.empty(); name = rd.str())
+        {
+            auto dir = rd.uleb();
+            rd.uleb(); //modification time
+            rd.uleb(); //length
+            add_file(name, dir);
+        }
+        if (_files.empty())
+            _files.emplace_back();
+    }
+
+    rd.ptr = program;
+
+    std::uint64_t address = 0u;
+    std::uint64_t file = 1u;
+    std::int64_t  line = 1;
+
+    auto sequence_begin = _entries.size();
+
+    auto emit = [&](bool end_sequence)
+    {
+        //rows at the end address of their sequence are empty, and would hide the next sequence after sorting.
+        if (end_sequence)
+            while ((_entries.size() > sequence_begin) && (_entries.back().address == address))
+                _entries.pop_back();
+
+        auto idx = (file < files.size()) ? files[file] : 0u;
+        _entries.push_back(line_entry{address, idx, static_cast<std::uint32_t>(line), end_sequence});
+    };
+    auto reset = [&]
+    {
+        address = 0u;
+        file = 1u;
+        line = 1;
+        sequence_begin = _entries.size();
+    };
+
+    while (rd.ptr < rd.end)
+    {
+        auto opcode = static_cast<unsigned char>(rd.u(1));
+        if (opcode >= opcode_base) //special opcode
+        {
+            auto adjusted = opcode - opcode_base;
+            address += (adjusted / line_range) * min_inst_length;
+            line    += line_base + static_cast<std::int64_t>(adjusted % line_range);
+            emit(false);
+        }
+        else if (opcode == 0) //extended opcode
+        {
+            auto len = rd.uleb();
+            rd.check(len);
+            const char * next = rd.ptr + len;
+            if (len > 0)
+            {
+                auto sub = static_cast<unsigned char>(rd.u(1));
+                switch (sub)
+                {
+                case dw_lne_end_sequence:
+                    emit(true);
+                    reset();
+                    break;
+                case dw_lne_set_address:
+                    address = rd.u(std::min<std::size_t>(len - 1, address_size));
+                    break;
+                case dw_lne_define_file:
+                {
+                    auto name = rd.str();
+                    auto dir = rd.uleb();
+                    add_file(name, dir);
+                    break;
+                }
+                default:
+                    break;
+                }
+            }
+            rd.ptr = next;
+        }
+        else switch (opcode)
+        {
+        case dw_lns_copy:
+            emit(false);
+            break;
+        case dw_lns_advance_pc:
+            address += rd.uleb() * min_inst_length;
+            break;
+        case dw_lns_advance_line:
+            line += rd.sleb();
+            break;
+        case dw_lns_set_file:
+            file = rd.uleb();
+            break;
+        case dw_lns_const_add_pc:
+            address += ((255u - opcode_base) / line_range) * min_inst_length;
+            break;
+        case dw_lns_fixed_advance_pc:
+            address += rd.u(2);
+            break;
+        default: //the operands of all other standard opcodes are uleb.
+            for (auto i = 0u; i < opcode_lengths.at(opcode - 1); i++)
+                rd.uleb();
+            break;
+        }
+    }
+}
+
+const line_entry * line_table::find(std::uint64_t address) const
+{
+    auto itr = std::upper_bound(_entries.begin(), _entries.end(), address,
+                                [](std::uint64_t addr, const line_entry & le){return addr < le.address;});
+    if (itr == _entries.begin())
+        return nullptr;
+    --itr;
+    if (itr->end_sequence)
+        return nullptr;
+    return &*itr;
+}
+
+}}
@@ -0,0 +1,53 @@
+/**
+ * @file   elf/line_table.hpp
+ * @date   19.10.2026
+ * @author Klemens D. Morgenstern
+ *
+
+ This header provides the address to source line table of an ELF file, decoded from the `.debug_line` section
+ (DWARF 2 to 5). It's built once, so every lookup is a binary search instead of asking addr2line.
+ Before DWARF 5 the compilation directory is taken from `.debug_info`, so the paths are absolute like in the later versions.
+
+ */
+#ifndef METAL_ELF_LINE_TABLE_HPP_
+#define METAL_ELF_LINE_TABLE_HPP_
+
+#include "elf_file.hpp"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace metal { namespace elf {
+
+///A row of the line table, it is valid up to the address of the next row.
+struct line_entry
+{
+    std::uint64_t address;
+    std::uint32_t file;
+    std::uint32_t line;
+    bool end_sequence;
+};
+
+class line_table
+{
+    std::vector<std::string> _files;
+    std::vector<line_entry>  _entries;
+
+    void _read_unit(const elf_file & elf, const char * & ptr, const char * end, const std::string & comp_dir);
+public:
+    ///Throws an elf_error, if the file has no or a malformed `.debug_line` section.
+    explicit line_table(const elf_file & elf);
+
+    bool empty() const {return _entries.empty();}
+
+    ///The row containing the address or nullptr, if it's not covered by the table.
+    const line_entry * find(std::uint64_t address) const;
+    const std::string & file(const line_entry & le) const {return _files.at(le.file);}
+    ///All rows, sorted by address.
+    const std::vector<line_entry> & entries() const {return _entries;}
+};
+
+}}
+
+#endif /* METAL_ELF_LINE_TABLE_HPP_ */
@@ -18,12 +18,17 @@
 #include <metal/debug/frame.hpp>
 #include <metal/debug/plugin.hpp>
 
+#include <algorithm>
 #include <unordered_map>
 
 #include <iostream>
 #include <fstream>
 
 #include "calltrace/sink.hpp"
+#include "calltrace/event_buffer.hpp"
+#include "calltrace/target_layout.hpp"
+#include "calltrace/registry.hpp"
+#include "calltrace/symbol_cache.hpp"
 
 using namespace metal::debug;
 using namespace std;
@@ -36,34 +41,75 @@ bool log_all = false;
 bool profile = false;
 bool minimal = false;
 bool manual_dis = false;
+bool target_check = false;
 int ct_depth = -1;
+metal::sink::hrf_options hrf_options;
+int flush_interval = 100;
+std::string symbol_binary;
+std::string symbol_cache_path;
+bool symbol_preload = false;
+double tick_us = 1.0;
 
 
 
 struct metal_calltrace : break_point
 {
-    std::unordered_map<std::uint64_t, boost::optional<address_info>> addr_map;
+    symbol_cache addr_map;
+    bool relocated = false;
 
-    std::vector<calltrace_clone> cts;
+    calltrace_registry cts;
 
     bool timestamp_available = true;
 
+    //only used if the target buffers the calls.
+    boost::optional<calltrace_event_buffer> event_buffer;
+    bool buffered_timestamp = false;
+
+    //the layout of the calltraces, to read them from memory.
+    boost::optional<calltrace_layout> ct_layout;
+    bool ct_layout_unavailable = false;
+
+    //the layout of the results, if the target verifies the calltraces.
+    boost::optional<calltrace_state_layout> state_layout;
+    bool state_layout_unavailable = false;
+
     //buffered version
     boost::optional<address_info> addr2line(frame & fr, std::uint64_t pos)
     {
-        auto itr = addr_map.find(pos);
-        if (itr != addr_map.end())
-            return itr->second;
-        else
-            return addr_map.emplace(pos, fr.addr2line(pos)).first->second;
+        return addr_map.get(pos, [&](std::uint64_t addr){return fr.addr2line(addr);});
+    }
+
+    metal_calltrace(const std::string & id = "__metal_profile") : break_point(id)
+    {
+        if (!symbol_binary.empty())
+            addr_map.open(symbol_binary, symbol_cache_path, symbol_preload, "__metal_profile");
+        else if (!symbol_cache_path.empty())
+            std::cerr << "metal.calltrace.error the symbol cache requires --metal-calltrace-binary" << std::endl;
+    }
+
+    ~metal_calltrace()
+    {
+        addr_map.save();
+        //the sink might outlive the file stream it writes to.
+        if (data_sink)
+            data_sink->flush();
     }
 
-    metal_calltrace() : break_point("__metal_profile")
+    //done at every stop, so the addresses are relocated before any of them gets resolved.
+    void prepare_symbols(frame & fr)
     {
+        //the cache is linked, the target reports run-time addresses, so a PIE needs the load bias.
+        if (addr_map.needs_anchor() && !relocated)
+        {
+            relocated = true;
+            addr_map.relocate(std::stoull(fr.print("(unsigned long long)&__metal_profile").value));
+        }
     }
 
     void invoke(frame & fr, const string & file, int line) override
     {
+        prepare_symbols(fr);
+
         auto arg = fr.arg_list(0);
         if (arg.value == "metal_enter")
             enter(fr);
@@ -75,124 +121,215 @@ struct metal_calltrace : break_point
             reset(fr);
     }
 
+    //the target records the calls in a buffer, so they're all processed at once.
+    void flush(frame & fr)
+    {
+        prepare_symbols(fr);
+        if (!event_buffer)
+        {
+            event_buffer.emplace(fr);
+            buffered_timestamp = profile && timestamp(fr);
+        }
+
+        auto address = std::stoull(fr.arg_list(0).value, nullptr, 16);
+        for (auto & ev : event_buffer->read(fr, address))
+        {
+            //the conditions of the breakpoint cannot be applied to the buffered calls.
+            if ((!log_all && cts.empty()) || ((ct_depth >= 0) && (ev.depth > ct_depth)))
+                continue;
+
+            auto ts = buffered_timestamp ? boost::make_optional(ev.timestamp) : boost::none;
+            if (ev.enter)
+                enter(fr, ev.this_fn, ev.call_site, ts, ev.depth, ev.thread);
+            else
+                exit (fr, ev.this_fn, ev.call_site, ts, ev.depth, ev.thread);
+        }
+    }
+
+    //the target passes the depth & thread of the call, which the depth condition of the break-point relies on, too.
+    std::pair<int, std::uint64_t> depth_and_thread(frame & fr)
+    {
+        return {std::stoi(fr.arg_list(3).value), std::stoull(fr.arg_list(4).value)};
+    }
 
     void enter(frame & fr)
     {
-        auto function_arg = fr.arg_list(1);
-        auto callsite_arg = fr.arg_list(2);
+        auto function_ptr = std::stoull(fr.arg_list(1).value, nullptr, 16);
+        auto callsite_ptr = std::stoull(fr.arg_list(2).value, nullptr, 16);
+        auto ts = timestamp(fr);
+        auto dt = depth_and_thread(fr);
 
-        auto function_ptr = std::stoull(function_arg.value, nullptr, 16);
-        auto callsite_ptr = std::stoull(callsite_arg.value, nullptr, 16);
+        enter(fr, function_ptr, callsite_ptr, ts, dt.first, dt.second);
+    }
 
+    void enter(frame & fr, std::uint64_t function_ptr, std::uint64_t callsite_ptr, const boost::optional<std::uint64_t> & ts, int depth, std::uint64_t thread)
+    {
         auto function_loc = addr2line(fr, function_ptr);
         auto callsite_loc = addr2line(fr, callsite_ptr);
 
-        auto ts = timestamp(fr);
-
         if (!minimal)
-            data_sink->enter(function_ptr, function_loc, callsite_ptr,  callsite_loc, ts);
+            data_sink->enter(function_ptr, function_loc, callsite_ptr,  callsite_loc, ts, thread);
 
         if (cts.empty())
             return;
 
-        int depth = std::stoi(fr.print("__metal_calltrace_depth").value);
-
-        for (auto & ct : cts)
-        {
-            if (ct.inactive() &&
-               (ct.fn().address == function_ptr) &&
-               ((ct.repeat() > ct.repeated()) || (ct.repeat() == 0)))
-            {
-                if (ct.to_skip())
-                    ct.add_skipped();
-                else
-                    ct.start(depth);
-            }
-            else if (ct.my_child(depth))
-            {
-                if (!ct.check(function_ptr))
+        cts.enter(function_ptr, depth, thread,
+                [&](calltrace_clone & ct)
                 {
-                    if (ct.ovl())
-                        //log the overflow
-                        data_sink->overflow(ct, function_ptr, function_loc);
-                    else
-                        //log the error
-                        data_sink->mismatch(ct, function_ptr, function_loc);
-                }
-            }
-        }
+                    if (!ct.check(function_ptr))
+                    {
+                        if (ct.ovl())
+                            //log the overflow
+                            data_sink->overflow(ct, function_ptr, function_loc);
+                        else
+                            //log the error
+                            data_sink->mismatch(ct, function_ptr, function_loc);
+                    }
+                });
     }
     void exit(frame & fr)
     {
-        auto function_arg = fr.arg_list(1);
-        auto callsite_arg = fr.arg_list(2);
+        auto function_ptr = std::stoull(fr.arg_list(1).value, nullptr, 16);
+        auto callsite_ptr = std::stoull(fr.arg_list(2).value, nullptr, 16);
+        auto ts = timestamp(fr);
+        auto dt = depth_and_thread(fr);
 
-        auto function_ptr = std::stoull(function_arg.value, nullptr, 16);
-        auto callsite_ptr = std::stoull(callsite_arg.value, nullptr, 16);
+        exit(fr, function_ptr, callsite_ptr, ts, dt.first, dt.second);
+    }
 
+    void exit(frame & fr, std::uint64_t function_ptr, std::uint64_t callsite_ptr, const boost::optional<std::uint64_t> & ts, int depth, std::uint64_t thread)
+    {
         auto function_loc = addr2line(fr, function_ptr);
         auto callsite_loc = addr2line(fr, callsite_ptr);
 
-        auto ts = timestamp(fr);
         if (!minimal)
-            data_sink->exit(function_ptr, function_loc, callsite_ptr,  callsite_loc, ts);
+            data_sink->exit(function_ptr, function_loc, callsite_ptr,  callsite_loc, ts, thread);
 
         if (cts.empty())
             return;
 
-        int depth = std::stoi(fr.print("__metal_calltrace_depth").value);
-
-        for (auto & ct : cts)
-        {
-            if (ct.my_depth(depth))
-            {
-                int pos = ct.current_position();
-                if (!ct.stop()) //log the incomplete
-                    data_sink->incomplete(ct, pos);
-            }
-        }
+        cts.exit(depth, thread,
+                [&](calltrace_clone & ct)
+                {
+                    int pos = ct.current_position();
+                    if (!ct.stop()) //log the incomplete
+                        data_sink->incomplete(ct, pos);
+                });
     }
-    void set(frame & fr)
+    //the descriptor of a calltrace read field by field, if the target doesn't provide the byte order.
+    calltrace_descriptor read_calltrace(frame & fr, const std::string & ct_ptr)
     {
-        auto ct_ptr = fr.arg_list(1).value;
         auto ct_str = "((struct metal_calltrace_*)"+ ct_ptr +")";
 
-        calltrace_clone_entry fn;
-        fn.address = std::stoull(fr.print(ct_str + "->fn").value, nullptr, 16);
-        fn.info    = addr2line(fr, fn.address);
+        calltrace_descriptor cd;
+        cd.fn = std::stoull(fr.print(ct_str + "->fn").value, nullptr, 16);
 
         auto sz = std::stoull(fr.print(ct_str + "->content_size").value);
-        std::vector<calltrace_clone_entry> content;
-        content.reserve(sz);
-
+        cd.content.reserve(sz);
         for (auto i = 0u; i<sz; i++)
+            cd.content.push_back(std::stoull(fr.print(ct_str + "->content[" + std::to_string(i) + "]").value, nullptr, 16));
+
+        cd.repeat = std::stoi(fr.print(ct_str + "->repeat").value);
+        cd.skip   = std::stoi(fr.print(ct_str + "->skip").value);
+        return cd;
+    }
+
+    void set(frame & fr)
+    {
+        auto ct_ptr = fr.arg_list(1).value;
+        auto ct_addr = std::stoull(ct_ptr, nullptr, 16);
+
+        if (!ct_layout && !ct_layout_unavailable)
         {
-            auto p = std::stoull(fr.print(ct_str + "->content[" + std::to_string(i) + "]").value, nullptr, 16);
-            if (p != 0)
+            try
+            {
+                ct_layout.emplace(fr);
+            }
+            catch (metal::debug::interpreter_error & ie) //built without the marker.
             {
-                auto fn = addr2line(fr, p);
-                content.emplace_back(p, std::move(fn));
+                ct_layout_unavailable = true;
             }
+        }
+
+        auto cd = ct_layout ? ct_layout->read(fr, ct_addr) : read_calltrace(fr, ct_ptr);
+
+        calltrace_clone_entry fn{cd.fn, addr2line(fr, cd.fn)};
+
+        std::vector<calltrace_clone_entry> content;
+        content.reserve(cd.content.size());
+        for (auto p : cd.content)
+        {
+            if (p != 0)
+                content.emplace_back(p, addr2line(fr, p));
             else
                 content.emplace_back(p, boost::none);
         }
 
-        auto repeat = std::stoi(fr.print(ct_str + "->repeat").value);
-        auto skip   = std::stoi(fr.print(ct_str + "->skip").value);
-        cts.emplace_back(std::stoull(ct_ptr, nullptr, 16), std::move(fn), std::move(content), repeat, skip);
-        data_sink->set(cts.back(), timestamp(fr));
+        auto & ct = cts.add(calltrace_clone(ct_addr, std::move(fn), std::move(content), cd.repeat, cd.skip));
+        data_sink->set(ct, timestamp(fr));
 
     }
     void reset(frame & fr)
     {
         auto ct_ptr = std::stoull(fr.arg_list(1).value, nullptr, 16);
 
-        auto itr = cts.begin();
-        while ((itr != std::find_if(itr, cts.end(), [&](const calltrace_clone & cc){return cc.location() == ct_ptr;})))
+        if (target_check)
+            cts.remove_until(ct_ptr, [&](calltrace_clone & cc){check_target(fr, cc);});
+        else
+            cts.remove_until(ct_ptr, [&](const calltrace_clone & cc){data_sink->reset(cc, cc.errors(), timestamp(fr));});
+    }
+
+    //the state of a calltrace read field by field, if the target doesn't provide the byte order.
+    calltrace_state read_state(frame & fr, std::uint64_t address)
+    {
+        auto ct_str = "((struct metal_calltrace_*)"+ std::to_string(address) +")";
+
+        calltrace_state cs;
+        cs.repeated       = std::stoi(fr.print(ct_str + "->repeated").value);
+        cs.errored        = std::stoi(fr.print(ct_str + "->errored").value);
+        cs.error_type     = static_cast<calltrace_error>(std::stoi(fr.print(ct_str + "->error_type").value));
+        cs.error_position = std::stoi(fr.print(ct_str + "->error_position").value);
+        cs.error_fn       = std::stoull(fr.print("(unsigned long long)" + ct_str + "->error_fn").value);
+        return cs;
+    }
+
+    //the target verified the calltrace itself, so only the first error it recorded gets reported.
+    void check_target(frame & fr, calltrace_clone & cc)
+    {
+        if (!state_layout && !state_layout_unavailable)
+        {
+            try
+            {
+                state_layout.emplace(fr);
+            }
+            catch (metal::debug::interpreter_error & ie) //built without the marker.
+            {
+                state_layout_unavailable = true;
+            }
+        }
+
+        auto cs = state_layout ? state_layout->read(fr, cc.location()) : read_state(fr, cc.location());
+
+        switch (cs.error_type)
         {
-            data_sink->reset(*itr, itr->errors(), timestamp(fr));
-            cts.erase(itr);
+        case calltrace_error::mismatch:
+            //the position is checked before it gets incremented, previous() yields the expected function.
+            cc.load(cs.repeated, cs.errored, cs.error_position + 1);
+            data_sink->mismatch(cc, cs.error_fn, addr2line(fr, cs.error_fn));
+            break;
+        case calltrace_error::overflow:
+            cc.load(cs.repeated, cs.errored, cs.error_position);
+            data_sink->overflow(cc, cs.error_fn, addr2line(fr, cs.error_fn));
+            break;
+        case calltrace_error::incomplete:
+            cc.load(cs.repeated, cs.errored, cs.error_position);
+            data_sink->incomplete(cc, cs.error_position);
+            break;
+        default:
+            cc.load(cs.repeated, cs.errored, 0);
         }
+
+        data_sink->reset(cc, cs.errored, timestamp(fr));
     }
 
     boost::optional<std::uint64_t> timestamp(frame &fr)
@@ -237,6 +374,21 @@ struct metal_calltrace : break_point
 
 
 
+/**The break-point of a target buffering the calls, which only exists if built with METAL_CALLTRACE_BUFFER_SIZE.
+ * It is separate from __metal_profile, so its conditions don't apply to the flush.
+ */
+struct metal_calltrace_flush : break_point
+{
+    metal_calltrace & ct;
+
+    metal_calltrace_flush(metal_calltrace & ct) : break_point("__metal_calltrace_flush_buffer"), ct(ct) {}
+
+    void invoke(frame & fr, const string &, int) override
+    {
+        ct.flush(fr);
+    }
+};
+
 boost::optional<std::ofstream> fstr;
 
 std::ostream * sink_str = & std::cout;
@@ -246,23 +398,41 @@ void metal_dbg_setup_bps(vector<unique_ptr<metal::debug::break_point>> & bps)
 {
     if (!sink_file.empty())
     {
-        fstr.emplace(sink_file);
+        fstr.emplace(sink_file, (format == "bin") ? (std::ios::out | std::ios::binary) : std::ios::out);
         sink_str = &*fstr;
     }
+    hrf_options.flush_interval = std::chrono::milliseconds(flush_interval);
+
     //ok, we setup the logger
     if (format.empty() || (format == "hrf"))
-        data_sink = get_hrf_sink(*sink_str);
+        data_sink = get_hrf_sink(*sink_str, hrf_options);
     else if (format == "json")
         data_sink = get_json_sink(*sink_str);
+    else if (format == "ndjson")
+        data_sink = get_json_sink(*sink_str, true);
+    else if (format == "bin")
+        data_sink = get_bin_sink(*sink_str);
+    else if (format == "chrome")
+        data_sink = get_chrome_sink(*sink_str, tick_us);
+    else if (auto ps = get_profile_sink(*sink_str, format))
+        data_sink = ps;
     else
         std::cerr << "Unknown format \"" << format << "\"" << std::endl;
 
-    bps.push_back(make_unique<metal_calltrace>());
-    if (!log_all || (ct_depth >= 0)) //conditions
+    //the target verifies the calls, we only need to know about the calltraces, which have their own function.
+    bps.push_back(make_unique<metal_calltrace>(target_check ? "__metal_calltrace_changed" : "__metal_profile"));
+    auto & ct = static_cast<metal_calltrace&>(*bps.back());
+    if (target_check)
+    {
+        if (log_all)
+            std::cerr << "metal.calltrace.error --metal-calltrace-all is ignored with --metal-calltrace-target-check" << std::endl;
+        log_all = false;
+    }
+    else if (!log_all || (ct_depth >= 0)) //conditions
     {
         std::string condition;
         if (ct_depth >= 0)
-            condition = "__metal_calltrace_depth <= " + std::to_string(ct_depth);
+            condition = "depth <= " + std::to_string(ct_depth);
 
         if (!log_all)
         {
@@ -274,6 +444,10 @@ void metal_dbg_setup_bps(vector<unique_ptr<metal::debug::break_point>> & bps)
         bps.back()->set_condition(condition);
     }
 
+    //the target verifies the buffered calls itself.
+    if (!target_check)
+        bps.push_back(make_unique<metal_calltrace_flush>(ct));
+
 
 }
 
@@ -284,10 +458,20 @@ void metal_dbg_setup_options(boost::program_options::options_description & op)
     op.add_options()
                    ("metal-calltrace-manual-disable", po::bool_switch(&manual_dis), "manually disabling for the timestamp")
                    ("metal-calltrace-sink",      po::value<string>(&sink_file),  "test data sink")
-                   ("metal-calltrace-format",    po::value<string>(&format),     "format [hrf, json]")
+                   ("metal-calltrace-format",    po::value<string>(&format),     "format [hrf, json, ndjson, folded, profile, profile-json, bin, chrome]")
                    ("metal-calltrace-all",       po::bool_switch(&log_all),      "log all calls")
                    ("metal-calltrace-timestamp", po::bool_switch(&profile),      "enable profiling")
                    ("metal-calltrace-minimal",   po::bool_switch(&minimal),      "only output the result of the actual calltraces")
+                   ("metal-calltrace-target-check", po::bool_switch(&target_check), "let the target verify the calltraces and only stop at set & reset, the target should be built with METAL_CALLTRACE_TARGET_CHECK")
+                   ("metal-calltrace-flush-size",     po::value<std::size_t>(&hrf_options.flush_size)->default_value(hrf_options.flush_size),
+                                                      "size of the hrf output buffer in bytes")
+                   ("metal-calltrace-flush-interval", po::value<int>(&flush_interval)->default_value(flush_interval),
+                                                      "interval in ms after which buffered hrf output is written with the next line, 0 writes every line")
+                   ("metal-calltrace-output-thread",  po::bool_switch(&hrf_options.writer_thread), "write the hrf output from a separate thread, which also writes it after the interval without a next line")
+                   ("metal-calltrace-binary",       po::value<string>(&symbol_binary),     "the binary the symbol cache belongs to")
+                   ("metal-calltrace-symbol-cache", po::value<string>(&symbol_cache_path), "file or directory of the symbol cache, default is next to the binary")
+                   ("metal-calltrace-symbol-preload", po::bool_switch(&symbol_preload),    "add all functions of the binary to the cache from its symbol & line table")
+                   ("metal-calltrace-tick-us",   po::value<double>(&tick_us)->default_value(tick_us), "microseconds per timestamp tick in the chrome format")
                    ("metal-calltrace-depth",     po::value<int>(&ct_depth)->default_value(-1), "maximum depth of the calltrace recording")
                    ;
 }
@@ -0,0 +1,128 @@
+/**
+ * @file   metal-sampler.cpp
+ * @date   19.10.2026
+ * @author Klemens D. Morgenstern
+ *
+
+ */
+
+#include <boost/dll/alias.hpp>
+#include <boost/optional.hpp>
+#include <boost/program_options.hpp>
+#include <metal/debug/break_point.hpp>
+#include <metal/debug/frame.hpp>
+#include <metal/debug/plugin.hpp>
+#include <metal/debug/sampler.hpp>
+
+#include <fmt/format.h>
+
+#include <fstream>
+#include <iostream>
+#include <unordered_map>
+
+#include "sink/call_graph.hpp"
+
+using namespace metal::debug;
+using namespace std;
+
+std::string sink_file;
+std::string format;
+int interval = 10000;
+bool full_stack = false;
+
+boost::optional<std::ofstream> fstr;
+std::ostream * sink_str = & std::cout;
+
+/** The sampler interrupts the program periodically and aggregates where it was interrupted.
+ * Without the full stack, only the function of the program counter is recorded, which is already in the stop record.
+ */
+struct metal_sampler : sampler
+{
+    metal::sink::call_graph graph{"metal.sampler"};
+    //the functions are identified by name, since the entry point isn't known from a sample.
+    std::unordered_map<std::string, std::uint64_t> ids;
+
+    metal_sampler(std::chrono::microseconds interval) : sampler(interval)
+    {
+        graph.count_name = "samples";
+        graph.ticks = true;
+        graph.addresses = false;
+    }
+
+    std::uint64_t id(const std::string & func, const boost::optional<std::uint64_t> & addr)
+    {
+        auto name = func.empty() ? fmt::format("0x{:x}", addr.value_or(0u)) : func;
+        auto itr = ids.find(name);
+        if (itr != ids.end())
+            return itr->second;
+
+        auto res = ids.size();
+        ids.emplace(name, res);
+        graph.set_name(res, name);
+        return res;
+    }
+
+    void sample(frame & fr, std::uint64_t pc) override
+    {
+        std::vector<std::uint64_t> path;
+        if (full_stack)
+        {
+            auto bt = fr.backtrace();
+            path.reserve(bt.size());
+            for (auto itr = bt.rbegin(); itr != bt.rend(); itr++)
+                path.push_back(id(itr->func, itr->addr));
+        }
+        else
+            path.push_back(id(fr.id(), pc));
+
+        auto idx = graph.root;
+        for (auto fn : path)
+        {
+            idx = graph.child(idx, fn);
+            graph[idx].calls++;
+            graph[idx].inclusive++;
+        }
+        if (idx != graph.root)
+            graph[idx].exclusive++;
+    }
+
+    ~metal_sampler()
+    {
+        if (format == "folded")
+            graph.write_folded(*sink_str);
+        else if (format == "profile-json")
+            graph.write_json(*sink_str);
+        else
+            graph.write_report(*sink_str);
+        sink_str->flush();
+    }
+};
+
+void metal_dbg_setup_bps(vector<unique_ptr<metal::debug::break_point>> &)
+{
+}
+
+void metal_dbg_setup_samplers(vector<unique_ptr<metal::debug::sampler>> & samplers)
+{
+    if (!sink_file.empty())
+    {
+        fstr.emplace(sink_file);
+        sink_str = &*fstr;
+    }
+
+    if (!format.empty() && (format != "profile") && (format != "folded") && (format != "profile-json"))
+        std::cerr << "Unknown format \"" << format << "\"" << std::endl;
+
+    samplers.push_back(make_unique<metal_sampler>(std::chrono::microseconds(interval)));
+}
+
+void metal_dbg_setup_options(boost::program_options::options_description & op)
+{
+    namespace po = boost::program_options;
+    op.add_options()
+                   ("metal-sampler-sink",     po::value<string>(&sink_file), "profile data sink")
+                   ("metal-sampler-format",   po::value<string>(&format),    "format [profile, folded, profile-json]")
+                   ("metal-sampler-interval", po::value<int>(&interval)->default_value(interval), "time between the samples in microseconds")
+                   ("metal-sampler-stack",    po::bool_switch(&full_stack),  "record the full stack of every sample, instead of only the function")
+                   ;
+}
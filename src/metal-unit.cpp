@@ -18,10 +18,13 @@
 #include <metal/debug/frame.hpp>
 #include <metal/debug/plugin.hpp>
 
+#include <chrono>
+#include <stdexcept>
 #include <iostream>
 #include <fstream>
 
 #include "unit/sink.hpp"
+#include "unit/shard.hpp"
 
 using namespace metal::debug;
 using namespace std;
@@ -456,6 +459,35 @@ struct result_sink :  boost::variant<free_t*, range_t*, case_t*>
 };
 
 bool no_exit_code = true;
+bool timing = false;
+bool timestamp_available = true;
+
+boost::optional<std::uint64_t> target_timestamp(frame & fr)
+{
+    if (!timestamp_available)
+        return boost::none;
+
+    try
+    {
+        return std::stoull(fr.print("metal_timestamp()").value);
+    }
+    catch (metal::debug::interpreter_error &) //that means it's not available.
+    {
+        data_sink->timestamp_unavailable();
+        timestamp_available = false;
+    }
+    return boost::none;
+}
+
+int jobs = 1;
+int shard_index = 0;
+std::string shard_file;
+std::vector<std::string> runner_args;
+shard_t sharding;
+
+std::ostream * sink_str = & std::cout;
+metal::sink::hrf_options hrf_options;
+int flush_interval = 100;
 
 struct session_t
 {
@@ -467,12 +499,20 @@ struct session_t
     result_sink sink = free;
     summary_t summary;
 
+    int case_index = -1;
+
+    std::chrono::steady_clock::time_point case_start;
+    boost::optional<std::uint64_t> case_ticks;
+
+    void skip_case    (frame & fr);
+    void merge_shards ();
     void enter_case   (frame & fr);
     void exit_case    (frame & fr);
     void enter_ranged (frame & fr);
     void exit_ranged  (frame & fr);
     void log          (frame & fr) { data_sink->log(file(fr), line(fr), str(fr, 0)); }
     void checkpoint   (frame & fr) { data_sink->checkpoint(file(fr), line(fr)); }
+    void benchmark    (frame & fr);
     void message      (frame & fr) { sink.check(fr, &data_sink_t::message, str(fr, 0)); }
     void plain        (frame & fr) { sink.check(fr, &data_sink_t::plain, str(fr, 0)); }
     void predicate    (frame & fr) { sink.check(fr, &data_sink_t::predicate, str(fr, 0), str(fr, 1)); }
@@ -578,6 +618,19 @@ struct session_t
 
     void report       (frame & fr)
     {
+        if (sharding.active())
+        {
+            sharding.close_free(case_index + 1);
+            if (!sharding.coordinator())
+            {
+                sharding.finish();
+                return;
+            }
+            merge_shards();
+            //the errors of the other instances need to show up in the exit code of the target.
+            if (summary.errors)
+                set_error(fr);
+        }
         summary += free;
 
         data_sink->report(
@@ -592,21 +645,86 @@ struct session_t
     }
 };
 
+void session_t::skip_case(frame & fr)
+{
+    auto bt = fr.backtrace();
+    auto itr = find_if(bt.cbegin(), bt.cend(), [](const backtrace_elem & elem)
+            {
+                return boost::algorithm::trim_copy(elem.func) == "__metal_call";
+            });
+
+    //without the frame the case would be executed by several instances, so that's an error.
+    if (itr == bt.cend())
+        throw std::runtime_error("metal.unit: cannot skip the test case, __metal_call is not in the backtrace, "
+                                 "it might have been inlined");
+
+    fr.select(itr->cnt);
+    fr.return_();
+}
+
+void session_t::merge_shards()
+{
+    statistic cases;
+    for (auto & c : sharding.collect())
+    {
+        *sink_str << c.content;
+        if (c.is_case)
+        {
+            cases.executed += c.executed;
+            cases.warnings += c.warnings;
+            cases.errors   += c.errors;
+        }
+    }
+    //the remaining output goes directly into the sink.
+    data_sink = get_hrf_sink(*sink_str, hrf_options);
+    static_cast<statistic&>(summary) = cases;
+}
+
 void session_t::enter_case   (frame & fr)
 {
     auto id = str(fr, 0);
+
+    if (sharding.active())
+    {
+        sharding.close_free(++case_index);
+        if (!sharding.owns(case_index))
+        {
+            skip_case(fr);
+            return;
+        }
+    }
+
     case_ = case_t{*this, id};
 
     sink = *case_;
 
     data_sink->enter_case(file(fr), line(fr), id);
+
+    if (timing)
+    {
+        case_ticks = target_timestamp(fr);
+        case_start = std::chrono::steady_clock::now();
+    }
 }
 
 void session_t::exit_case    (frame & fr)
 {
     auto id = str(fr, 0);
 
+    if (timing)
+    {
+        auto host = std::chrono::steady_clock::now() - case_start;
+        auto ticks = target_timestamp(fr);
+        if (ticks && case_ticks)
+            *ticks -= *case_ticks;
+        else
+            ticks = boost::none;
+
+        data_sink->case_timing(id, std::chrono::duration_cast<std::chrono::microseconds>(host).count(), ticks);
+    }
+
     data_sink->exit_case(file(fr), line(fr), id, case_->executed, case_->warnings, case_->errors);
+    sharding.close_case(case_index, case_->executed, case_->warnings, case_->errors);
 
     summary += *case_;
 
@@ -616,6 +734,32 @@ void session_t::exit_case    (frame & fr)
 
 }
 
+void session_t::benchmark(frame & fr)
+{
+    auto name = str(fr, 0);
+    auto code = str(fr, 2);
+    if (!condition(fr)) //no iterations
+    {
+        data_sink->benchmark(file(fr), line(fr), name, code, 0, 0, 0., 0);
+        return;
+    }
+
+    //the statistic is kept in the variables of the METAL_BENCHMARK block, so it's just one stop.
+    auto vals = print_from_frame(fr, false, 1, "__metal_bm_iterations", "__metal_bm_min", "__metal_bm_sum", "__metal_bm_max");
+    try
+    {
+        auto iterations = std::stoull(vals[0].value);
+        auto sum        = std::stoull(vals[2].value);
+        data_sink->benchmark(file(fr), line(fr), name, code, iterations,
+                             std::stoull(vals[1].value), static_cast<double>(sum) / iterations, std::stoull(vals[3].value));
+    }
+    catch (std::logic_error &)
+    {
+        data_sink->flush();
+        std::cerr << file(fr) << '(' << line(fr) << ") error: cannot obtain the results of benchmark [" << name << "]" << std::endl;
+    }
+}
+
 void session_t::enter_ranged (frame & fr)
 {
     if (sink.type() == boost::typeindex::type_id<case_t*>())
@@ -624,6 +768,7 @@ void session_t::enter_ranged (frame & fr)
         range = range_t(*boost::get<free_t*>(sink));
     else
     {
+        data_sink->flush();
         std::cerr << file(fr) << '(' << line(fr) << ") critical error: "
                 "Twice enter into ranged test, check your test!!" << std::endl;
         return;
@@ -670,6 +815,7 @@ void case_t::cancel(frame & fr)
         error_handler::cancel(fr);
 
     sess->summary += *this;
+    sharding.close_case(sess->case_index, executed, warnings, errors);
     //reset the pointer.
     sess->sink = sess->free;
     sess->case_ = boost::none;
@@ -684,6 +830,19 @@ struct metal_test_backend : break_point
     {
     }
 
+    ~metal_test_backend()
+    {
+        if (data_sink)
+            data_sink->flush();
+        //main was canceled, so the report was not reached.
+        if (sharding.active() && sharding.coordinator())
+        {
+            sharding.close_free(session.case_index + 1);
+            for (auto & c : sharding.collect())
+                *sink_str << c.content;
+        }
+    }
+
     void invoke(frame & fr, const string & file, int line) override
     {
         auto oper = fr.arg_list(1).value;
@@ -712,6 +871,7 @@ struct metal_test_backend : break_point
         else if (oper == "__metal_oper_no_exec"      ) session.no_exec      (fr);
         else if (oper == "__metal_oper_exec"         ) session.exec         (fr);
         else if (oper == "__metal_oper_report"       ) session.report       (fr);
+        else if (oper == "__metal_oper_benchmark"    ) session.benchmark    (fr);
 
     }
 };
@@ -720,21 +880,38 @@ std::string sink_file;
 std::string format;
 boost::optional<std::ofstream> fstr;
 
-std::ostream * sink_str = & std::cout;
-
 
 void metal_dbg_setup_bps(vector<unique_ptr<metal::debug::break_point>> & bps)
 {
-    if (!sink_file.empty())
+    if (!sink_file.empty() && shard_file.empty())
     {
         fstr.emplace(sink_file);
         sink_str = &*fstr;
     }
+
+    if ((jobs > 1) && !(format.empty() || (format == "hrf")))
+    {
+        std::cerr << "metal-test-jobs is only available for the hrf format, executing sequentially" << std::endl;
+        jobs = 1;
+    }
+
+    hrf_options.flush_interval = std::chrono::milliseconds(flush_interval);
+
     //ok, we setup the logger
-    if (format.empty() || (format == "hrf"))
-        data_sink = get_hrf_sink(*sink_str);
+    if (jobs > 1)
+    {
+        sharding.setup(jobs, shard_index, shard_file, runner_args);
+        //the shard buffer is collected after every case, so every record needs to be in it right away.
+        metal::sink::hrf_options shard_options;
+        shard_options.flush_size = 0;
+        data_sink = get_hrf_sink(sharding.buffer(), shard_options);
+    }
+    else if (format.empty() || (format == "hrf"))
+        data_sink = get_hrf_sink(*sink_str, hrf_options);
     else if (format == "json")
         data_sink = get_json_sink(*sink_str);
+    else if (format == "ndjson")
+        data_sink = get_json_sink(*sink_str, true);
     else
         std::cerr << "Unknown format \"" << format << "\"" << std::endl;
 
@@ -742,12 +919,30 @@ void metal_dbg_setup_bps(vector<unique_ptr<metal::debug::break_point>> & bps)
 }
 
 
+void metal_dbg_setup_args(const std::vector<std::string> & args)
+{
+    runner_args = args;
+}
+
 void metal_dbg_setup_options(boost::program_options::options_description & op)
 {
     namespace po = boost::program_options;
     op.add_options()
                    ("metal-test-no-exit-code", po::bool_switch(&no_exit_code), "disable exit-code")
                    ("metal-test-sink",         po::value<string>(&sink_file),  "test data sink")
-                   ("metal-test-format",       po::value<string>(&format),     "format [hrf, json]")
+                   ("metal-test-format",       po::value<string>(&format),     "format [hrf, json, ndjson]")
+                   ("metal-test-timing",       po::bool_switch(&timing),       "measure the duration of each test case")
+                   ("metal-test-flush-size",     po::value<std::size_t>(&hrf_options.flush_size)->default_value(hrf_options.flush_size),
+                                                 "size of the hrf output buffer in bytes")
+                   ("metal-test-flush-interval", po::value<int>(&flush_interval)->default_value(flush_interval),
+                                                 "interval in ms after which buffered hrf output is written with the next line, 0 writes every line")
+                   ("metal-test-output-thread",  po::bool_switch(&hrf_options.writer_thread), "write the hrf output from a separate thread, which also writes it after the interval without a next line")
+                   ("metal-test-jobs",         po::value<int>(&jobs)->default_value(1), "execute the test cases in n parallel debugger instances. "
+                                                                            "The cases are skipped by returning from __metal_call, which must not be inlined, "
+                                                                            "so the cases must not depend on the side effects of each other. "
+                                                                            "Not available with the ptrace backend or a response or config file, "
+                                                                            "the log & the other sinks of an instance are suffixed with .shard-<n>")
+                   ("metal-test-shard",        po::value<int>(&shard_index)->default_value(0), "index of the parallel instance [internal]")
+                   ("metal-test-shard-file",   po::value<string>(&shard_file), "result file of the parallel instance [internal]")
                    ;
 }
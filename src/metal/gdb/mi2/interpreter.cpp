@@ -23,6 +23,7 @@
 
 #include <boost/algorithm/string/predicate.hpp>
 #include <istream>
+#include <memory>
 #include <iostream>
 #include <sstream>
 
@@ -51,6 +52,13 @@ constexpr bool needs_record()
     return sizeof...(Args) > 0;
 }
 
+//the answer to an interrupt might come with any of the following outputs.
+template<>
+constexpr bool needs_record<std::uint64_t&, bool&>()
+{
+    return false;
+}
+
 template<typename ...Args>
 void interpreter::_work_impl(Args&&...args)
 {
@@ -127,6 +135,7 @@ void interpreter::_work() {_work_impl();}
 void interpreter::_work(std::uint64_t token, result_class rc) { _work_impl(token, rc); }
 //void interpreter::_work(const std::function<void(const result_output&)> & func) {_work_impl(func); }
 void interpreter::_work(std::uint64_t token, const std::function<void(const result_output&)> & func) {_work_impl(token, func);}
+void interpreter::_work(std::uint64_t token, bool & pending) {_work_impl(token, pending);}
 
 async_result interpreter::wait_for_stop()
 {
@@ -150,6 +159,65 @@ async_result interpreter::wait_for_stop()
     return pr;
 }
 
+async_result interpreter::wait_for_stop(boost::asio::deadline_timer & interrupt_timer)
+{
+    async_result pr;
+    _in_buf.clear();
+
+    //the timer handler might already be queued when this function returns, so it must not refer to the stack.
+    struct interrupt_state
+    {
+        bool done = false;
+        bool stopped = false;
+        bool pending = false;
+        bool sent = false;
+        std::string command;
+    };
+    auto st = std::make_shared<interrupt_state>();
+
+    auto l = [&](const async_output& ao)
+             {
+                if ((ao.type == async_output::exec) &&
+                    (ao.class_ == "stopped"))
+                {
+                    st->stopped = true;
+                    //an interrupted target might not report a reason.
+                    auto itr = std::find_if(ao.results.begin(), ao.results.end(), [](const result & r){return r.variable == "reason";});
+                    if (itr != ao.results.end())
+                        pr.reason = itr->value_.as_string();
+                    pr.content.clear();
+                    std::copy_if(ao.results.begin(), ao.results.end(), std::back_inserter(pr.content),
+                                    [](const result & r){return r.variable != "reason";});
+                }
+             };
+
+    boost::signals2::scoped_connection conn = _async_sink.connect(l);
+
+    auto token = _token_gen++;
+    st->command = std::to_string(token) + "-exec-interrupt\n";
+
+    interrupt_timer.async_wait(
+            [this, st](const boost::system::error_code & ec)
+            {
+                if (ec || st->done || st->stopped)
+                    return;
+                st->pending = true;
+                st->sent = true;
+                asio::async_write(_in, asio::buffer(st->command), [st](const boost::system::error_code &, std::size_t){});
+                if (_debug)
+                    _fwd << st->command;
+            });
+
+    //the answer to the interrupt must be read, even if the program stopped for another reason before.
+    while (!st->stopped || st->pending)
+        _work(token, st->pending);
+
+    st->done = true;
+    interrupt_timer.cancel();
+    pr.interrupted = st->sent;
+    return pr;
+}
+
 void interpreter::_handle_record(const std::string& line, const boost::optional<std::uint64_t> &token, const result_output & sr)
 {
     BOOST_THROW_EXCEPTION( unexpected_record(line) );
@@ -189,6 +257,19 @@ void interpreter::_handle_record(const std::string& line, const boost::optional<
 }
 
 
+void interpreter::_handle_record(const std::string& line, const boost::optional<std::uint64_t> &token, const result_output & sr,
+                    std::uint64_t expected_token, bool & pending)
+{
+    if (!token)
+        BOOST_THROW_EXCEPTION( mismatched_token(expected_token, 0) );
+
+    if (*token != expected_token)
+        BOOST_THROW_EXCEPTION( mismatched_token(expected_token, *token) );
+
+    //an error means the program stopped before the interrupt arrived, which is fine.
+    pending = false;
+}
+
 void interpreter::_handle_async_output(const async_output & ao)
 {
     _async_sink(ao);
@@ -63,6 +63,7 @@ void process::_run_impl(boost::asio::yield_context &yield_)
         interpreter.target_select_remote(_remote);
 
     _init_bps(interpreter);
+    _init_samplers(interpreter);
     _start(interpreter);
 
 
@@ -144,6 +145,65 @@ void process::_init_bps(mi2::interpreter & interpreter)
     }
 }
 
+void process::_init_samplers(mi2::interpreter & interpreter)
+{
+    if (_samplers.empty())
+        return;
+
+    //the interrupt needs to be sent while the program is running.
+    try
+    {
+        interpreter.gdb_set("mi-async", "on");
+    }
+    catch (mi2::interpreter_error & ie) //older versions of gdb
+    {
+        interpreter.gdb_set("target-async", "on");
+    }
+}
+
+mi2::async_result process::_wait_for_stop(mi2::interpreter & interpreter)
+{
+    if (_samplers.empty())
+        return interpreter.wait_for_stop();
+
+    auto itr = std::min_element(_samplers.begin(), _samplers.end(),
+                    [](const std::unique_ptr<metal::debug::sampler> & lhs, const std::unique_ptr<metal::debug::sampler> & rhs)
+                    {
+                        return lhs->interval() < rhs->interval();
+                    });
+
+    _sample_timer.expires_from_now(boost::posix_time::microseconds((*itr)->interval().count()));
+    return interpreter.wait_for_stop(_sample_timer);
+}
+
+bool process::_is_sample(const mi2::async_result & val) const
+{
+    //only the interrupt sent by the runner is a sample, not a SIGINT of the program itself.
+    if (_samplers.empty() || !val.interrupted)
+        return false;
+    if (val.reason.empty())
+        return true;
+    if (val.reason != "signal-received")
+        return false;
+
+    auto itr = std::find_if(val.content.begin(), val.content.end(), [](const mi2::result & r){return r.variable == "signal-name";});
+    return (itr != val.content.end()) && (itr->value_.as_string() == "SIGINT");
+}
+
+void process::_handle_sample(mi2::interpreter & interpreter, const mi2::async_result & val)
+{
+    auto frame = mi2::parse_result<mi2::frame>(mi2::find(val.content, "frame").as_tuple());
+
+    std::string id;
+    if (frame.func)
+        id = *frame.func;
+
+    mi2::frame_impl fi{std::move(id), {}, *this, interpreter, _log};
+
+    for (auto & s : _samplers)
+        s->sample(fi, frame.addr ? *frame.addr : 0u);
+}
+
 void process::_start(mi2::interpreter & interpreter)
 {
     if (_init_scripts.empty() && _remote.empty())
@@ -157,12 +217,20 @@ void process::_start(mi2::interpreter & interpreter)
 
 void process::_handle_bps  (mi2::interpreter & interpreter)
 {
-    auto val = interpreter.wait_for_stop();
+    auto val = _wait_for_stop(interpreter);
 
     std::unordered_map<std::uint64_t, std::vector<std::string>> arg_name_map;
 
     while(val.reason != "exited")
     {
+        //a sample is no progress of the program, so it mustn't keep a hanging program alive.
+        if (_is_sample(val))
+        {
+            _handle_sample(interpreter, val);
+            interpreter.exec_continue();
+            val = _wait_for_stop(interpreter);
+            continue;
+        }
         reset_timer();
         if (val.reason != "breakpoint-hit") //temporary
         {
@@ -244,7 +312,7 @@ void process::_handle_bps  (mi2::interpreter & interpreter)
             return;
         interpreter.exec_continue();
 
-        val = interpreter.wait_for_stop();
+        val = _wait_for_stop(interpreter);
     }
 
     if (val.reason == "exited-normally")
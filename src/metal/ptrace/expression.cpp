@@ -0,0 +1,1187 @@
+/**
+ * @file   metal/ptrace/expression.cpp
+ * @date   19.10.2026
+ * @author Klemens D. Morgenstern
+ *
+
+ */
+
+#include "expression.hpp"
+
+#include <metal/debug/interpreter.hpp>
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <iomanip>
+#include <limits>
+#include <sstream>
+
+namespace metal { namespace ptrace {
+
+using metal::debug::interpreter_error;
+
+namespace
+{
+
+struct token
+{
+    enum kind_t {end, identifier, literal, punct} kind;
+    std::string text;
+    std::uint64_t number = 0u;
+    double floating = 0.;
+    bool is_unsigned = false;
+    bool is_char = false;
+    bool is_float = false;
+    bool is_single = false; ///<A float literal, i.e. with the f suffix.
+};
+
+const char * const punctuators[] =
+{
+    "->", "<<", ">>", "<=", ">=", "==", "!=", "&&", "||",
+    "(", ")", "[", "]", ".", "&", "*", "+", "-", "!", "~", "/", "%", "<", ">", "^", "|"
+};
+
+bool ident_char(char c)
+{
+    return std::isalnum(static_cast<unsigned char>(c)) || (c == '_');
+}
+
+char unescape(const std::string & expr, std::size_t & i)
+{
+    char c = expr.at(i++);
+    if (c != '\\')
+        return c;
+
+    c = expr.at(i++);
+    switch (c)
+    {
+    case 'n': return '\n';
+    case 't': return '\t';
+    case 'r': return '\r';
+    case 'a': return '\a';
+    case 'b': return '\b';
+    case 'f': return '\f';
+    case 'v': return '\v';
+    case 'e': return '\033';
+    default:
+        break;
+    }
+    if ((c < '0') || (c > '7'))
+        return c;
+
+    int value = c - '0';
+    for (int n = 0; (n < 2) && (i < expr.size()) && (expr[i] >= '0') && (expr[i] <= '7'); n++)
+        value = value * 8 + (expr[i++] - '0');
+    return static_cast<char>(value);
+}
+
+std::vector<token> tokenize(const std::string & expr)
+{
+    std::vector<token> res;
+    std::size_t i = 0u;
+    while (i < expr.size())
+    {
+        const char c = expr[i];
+        if (std::isspace(static_cast<unsigned char>(c)))
+            i++;
+        else if (std::isalpha(static_cast<unsigned char>(c)) || (c == '_'))
+        {
+            auto begin = i;
+            //qualified names, e.g. ns::value are one identifier.
+            while ((i < expr.size()) && (ident_char(expr[i]) ||
+                    ((expr.compare(i, 2, "::") == 0) && ((i + 2) < expr.size()) && ident_char(expr[i + 2]))))
+                i += (expr[i] == ':') ? 2 : 1;
+            res.push_back(token{token::identifier, expr.substr(begin, i - begin)});
+        }
+        else if (std::isdigit(static_cast<unsigned char>(c)) ||
+                 ((c == '.') && ((i + 1) < expr.size()) && std::isdigit(static_cast<unsigned char>(expr[i + 1]))))
+        {
+            auto begin = i;
+            const bool hex = (expr.compare(i, 2, "0x") == 0) || (expr.compare(i, 2, "0X") == 0);
+            while ((i < expr.size()) && (ident_char(expr[i]) || (expr[i] == '.')))
+            {
+                //the sign of an exponent, e.g. 1e-5
+                if (!hex && ((expr[i] == 'e') || (expr[i] == 'E')) && ((i + 1) < expr.size()) && ((expr[i + 1] == '-') || (expr[i + 1] == '+')))
+                    i++;
+                i++;
+            }
+            token t{token::literal, expr.substr(begin, i - begin)};
+
+            auto digits = t.text;
+            std::size_t len = 0u;
+            if (!hex && (digits.find_first_of(".eE") != std::string::npos))
+            {
+                t.is_float = true;
+                if (!digits.empty() && std::strchr("fFlL", digits.back()))
+                {
+                    t.is_single = std::tolower(static_cast<unsigned char>(digits.back())) == 'f';
+                    digits.pop_back();
+                }
+                try
+                {
+                    t.floating = std::stod(digits, &len);
+                }
+                catch (std::exception &)
+                {
+                    len = 0u;
+                }
+            }
+            else
+            {
+                while (!digits.empty() && std::strchr("uUlL", digits.back()))
+                {
+                    if (std::tolower(static_cast<unsigned char>(digits.back())) == 'u')
+                        t.is_unsigned = true;
+                    digits.pop_back();
+                }
+
+                //stoull doesn't know the binary prefix of C++14.
+                const bool bin = (digits.size() > 2u) && (digits[0] == '0') && ((digits[1] == 'b') || (digits[1] == 'B'));
+                try
+                {
+                    t.number = bin ? std::stoull(digits.substr(2), &len, 2) : std::stoull(digits, &len, 0);
+                    if (bin)
+                        len += 2u;
+                }
+                catch (std::exception &)
+                {
+                    len = 0u;
+                }
+            }
+            if (digits.empty() || (len != digits.size()))
+                throw interpreter_error("Invalid number \"" + t.text + "\".");
+            res.push_back(std::move(t));
+        }
+        else if (c == '\'')
+        {
+            auto begin = i++;
+            token t{token::literal, ""};
+            t.is_char = true;
+            t.number = static_cast<unsigned char>(unescape(expr, i));
+            if ((i >= expr.size()) || (expr[i] != '\''))
+                throw interpreter_error("Unmatched single quote.");
+            i++;
+            t.text = expr.substr(begin, i - begin);
+            res.push_back(std::move(t));
+        }
+        else
+        {
+            auto itr = std::find_if(std::begin(punctuators), std::end(punctuators),
+                                    [&](const char * p){return expr.compare(i, std::strlen(p), p) == 0;});
+            if (itr == std::end(punctuators))
+                throw interpreter_error(std::string("Invalid character '") + c + "' in expression.");
+            res.push_back(token{token::punct, *itr});
+            i += std::strlen(*itr);
+        }
+    }
+    res.push_back(token{token::end, ""});
+    return res;
+}
+
+const char * const type_keywords[] =
+{
+    "struct", "union", "enum", "class", "const", "volatile", "signed", "unsigned",
+    "void", "char", "short", "int", "long", "float", "double", "bool", "_Bool"
+};
+
+bool is_type_keyword(const std::string & word)
+{
+    return std::find(std::begin(type_keywords), std::end(type_keywords), word) != std::end(type_keywords);
+}
+
+std::string hex(std::uint64_t value)
+{
+    std::ostringstream ss;
+    ss << "0x" << std::hex << value;
+    return ss.str();
+}
+
+std::string binary(std::uint64_t value)
+{
+    if (value == 0u)
+        return "0";
+    std::string res;
+    for (; value != 0u; value >>= 1)
+        res.push_back((value & 1u) ? '1' : '0');
+    std::reverse(res.begin(), res.end());
+    return res;
+}
+
+std::string escape(unsigned char c, char quote)
+{
+    switch (c)
+    {
+    case '\n': return "\\n";
+    case '\t': return "\\t";
+    case '\r': return "\\r";
+    case '\a': return "\\a";
+    case '\b': return "\\b";
+    case '\f': return "\\f";
+    case '\v': return "\\v";
+    case '\\': return "\\\\";
+    default:
+        break;
+    }
+    if (c == static_cast<unsigned char>(quote))
+        return std::string("\\") + quote;
+    if ((c >= 0x20) && (c < 0x7F))
+        return std::string(1, static_cast<char>(c));
+
+    char buf[8];
+    std::snprintf(buf, sizeof(buf), "\\%03o", c);
+    return buf;
+}
+
+std::uint64_t mask(std::uint64_t value, std::size_t size)
+{
+    return size >= 8u ? value : (value & ((std::uint64_t(1) << (size * 8u)) - 1u));
+}
+
+std::uint64_t sign_extend(std::uint64_t value, std::size_t size)
+{
+    if ((size < 8u) && (size > 0u) && (value & (std::uint64_t(1) << (size * 8u - 1u))))
+        value |= ~std::uint64_t(0) << (size * 8u);
+    return value;
+}
+
+}
+
+struct evaluator::parser
+{
+    evaluator & ev;
+    elf::debug_info & info;
+    std::vector<token> tokens;
+    std::size_t pos = 0u;
+
+    const token & peek(std::size_t ahead = 0u) const
+    {
+        return tokens[std::min(pos + ahead, tokens.size() - 1u)];
+    }
+    bool is(const char * p, std::size_t ahead = 0u) const
+    {
+        return (peek(ahead).kind == token::punct) && (peek(ahead).text == p);
+    }
+
+    [[noreturn]] void syntax_error() const
+    {
+        std::string rest;
+        for (auto i = pos; i < tokens.size(); i++)
+            rest += tokens[i].text;
+        throw interpreter_error("A syntax error in expression, near `" + rest + "'.");
+    }
+
+    void expect(const char * p)
+    {
+        if (!is(p))
+            syntax_error();
+        pos++;
+    }
+
+    std::string identifier()
+    {
+        if (peek().kind != token::identifier)
+            syntax_error();
+        return tokens[pos++].text;
+    }
+
+    bool is_type_start(std::size_t ahead)
+    {
+        auto & t = peek(ahead);
+        if (t.kind != token::identifier)
+            return false;
+        if (is_type_keyword(t.text))
+            return true;
+        return (info.find_type(t.text) != elf::no_type) && !ev._target.lookup(t.text);
+    }
+
+    const elf::type_entry * type_of(std::size_t idx) const
+    {
+        idx = info.resolve(idx);
+        return idx == elf::no_type ? nullptr : &info.type(idx);
+    }
+
+    std::size_t int_type()   {return ev.builtin_type({"int"});}
+    std::size_t long_type()  {return ev.builtin_type({"long"});}
+    std::size_t ulong_type() {return ev.builtin_type({"unsigned", "long"});}
+
+    std::size_t parse_type()
+    {
+        std::vector<std::string> words;
+        while ((peek().kind == token::identifier) && !is("*"))
+        {
+            auto & w = tokens[pos++].text;
+            if ((w != "const") && (w != "volatile"))
+                words.push_back(w);
+        }
+        if (words.empty())
+            syntax_error();
+
+        std::size_t type = elf::no_type;
+        if ((words.size() == 2u) && ((words[0] == "struct") || (words[0] == "union") || (words[0] == "enum") || (words[0] == "class")))
+        {
+            type = info.find_type(words[0] + " " + words[1]);
+            if (type == elf::no_type)
+                type = info.find_type(words[1]);
+            if (type == elf::no_type)
+                throw interpreter_error("No " + words[0] + " type named " + words[1] + ".");
+        }
+        else if ((words.size() == 1u) && (words[0] == "void"))
+            type = elf::no_type;
+        else
+        {
+            if (words.size() == 1u)
+                type = info.find_type(words[0]);
+            if (type == elf::no_type)
+                type = ev.builtin_type(words);
+        }
+
+        while (is("*"))
+        {
+            pos++;
+            type = info.pointer_to(type);
+            while ((peek().kind == token::identifier) && ((peek().text == "const") || (peek().text == "volatile")))
+                pos++;
+        }
+        return type;
+    }
+
+    value parse()
+    {
+        auto v = parse_binary(0);
+        if (peek().kind != token::end)
+            syntax_error();
+        return v;
+    }
+
+    static int precedence(const token & t)
+    {
+        if (t.kind != token::punct)
+            return 0;
+        static const std::pair<const char*, int> ops[] =
+        {
+            {"||", 1}, {"&&", 2}, {"|", 3}, {"^", 4}, {"&", 5}, {"==", 6}, {"!=", 6},
+            {"<", 7}, {">", 7}, {"<=", 7}, {">=", 7}, {"<<", 8}, {">>", 8},
+            {"+", 9}, {"-", 9}, {"*", 10}, {"/", 10}, {"%", 10}
+        };
+        for (auto & op : ops)
+            if (t.text == op.first)
+                return op.second;
+        return 0;
+    }
+
+    value parse_binary(int min_precedence)
+    {
+        auto lhs = parse_unary();
+        while (true)
+        {
+            auto prec = precedence(peek());
+            if ((prec == 0) || (prec <= min_precedence))
+                return lhs;
+            auto op = tokens[pos++].text;
+            auto rhs = parse_binary(prec);
+            lhs = binary(op, lhs, rhs);
+        }
+    }
+
+    value parse_unary()
+    {
+        if (is("+"))
+        {
+            pos++;
+            return parse_unary();
+        }
+        if (is("-") || is("~") || is("!"))
+        {
+            auto op = tokens[pos++].text;
+            auto v = ev.referent(parse_unary());
+            auto t = type_of(v.type);
+            if (op == "!")
+                return ev.make_integer(int_type(), (t && (t->kind == elf::type_kind::base) && (t->encoding == elf::dw_ate_float))
+                                                    ? (ev.as_double(v) == 0.0) : (ev.as_integer(v) == 0u));
+            if (t && (t->kind == elf::type_kind::base) && (t->encoding == elf::dw_ate_float))
+            {
+                if (op == "~")
+                    throw interpreter_error("Argument to complement operation not an integer, boolean.");
+                return ev.cast_float(v.type, -ev.as_double(v));
+            }
+            auto type = promoted(v.type);
+            auto n = ev.as_integer(v);
+            return ev.make_integer(type, op == "-" ? (~n + 1u) : ~n);
+        }
+        if (is("*"))
+        {
+            pos++;
+            return deref(parse_unary());
+        }
+        if (is("&"))
+        {
+            pos++;
+            auto v = ev.referent(parse_unary());
+            if (!v.address)
+                throw interpreter_error("Attempt to take address of value not located in memory.");
+            return ev.make_integer(info.pointer_to(v.type), *v.address);
+        }
+        if ((peek().kind == token::identifier) && (peek().text == "sizeof"))
+        {
+            pos++;
+            std::size_t type;
+            if (is("(") && is_type_start(1u))
+            {
+                pos++;
+                type = parse_type();
+                expect(")");
+            }
+            else
+                type = ev.referent(parse_unary()).type;
+            return ev.make_integer(ulong_type(), info.size_of(type));
+        }
+        if (is("(") && is_type_start(1u))
+        {
+            pos++;
+            auto type = parse_type();
+            expect(")");
+            return ev.cast(type, parse_unary());
+        }
+        return parse_postfix(parse_primary());
+    }
+
+    value parse_primary()
+    {
+        auto & t = peek();
+        if (t.kind == token::literal)
+        {
+            pos++;
+            if (t.is_char)
+                return ev.make_integer(ev.builtin_type({"char"}), t.number);
+            if (t.is_float)
+                return ev.cast_float(ev.builtin_type({t.is_single ? "float" : "double"}), t.floating);
+            bool fits_int = t.is_unsigned ? (t.number <= std::numeric_limits<std::uint32_t>::max())
+                                          : (t.number <= static_cast<std::uint64_t>(std::numeric_limits<std::int32_t>::max()));
+            std::vector<std::string> words;
+            if (t.is_unsigned)
+                words.push_back("unsigned");
+            words.push_back(fits_int ? "int" : "long");
+            return ev.make_integer(ev.builtin_type(words), t.number);
+        }
+        if (t.kind == token::identifier)
+        {
+            auto name = tokens[pos++].text;
+            if ((name == "true") || (name == "false"))
+                return ev.make_integer(ev.builtin_type({"bool"}), name == "true");
+            if (auto v = ev._target.lookup(name))
+                return *v;
+            if (auto en = info.find_enumerator(name))
+                return ev.make_integer(en->second, static_cast<std::uint64_t>(en->first));
+            throw interpreter_error("No symbol \"" + name + "\" in current context.");
+        }
+        if (is("("))
+        {
+            pos++;
+            auto v = parse_binary(0);
+            expect(")");
+            return v;
+        }
+        syntax_error();
+    }
+
+    value parse_postfix(value v)
+    {
+        while (true)
+        {
+            if (is("["))
+            {
+                pos++;
+                auto idx = ev.as_integer(parse_binary(0));
+                expect("]");
+                v = subscript(v, static_cast<std::int64_t>(idx));
+            }
+            else if (is("."))
+            {
+                pos++;
+                v = member(v, identifier());
+            }
+            else if (is("->"))
+            {
+                pos++;
+                v = member(deref(v), identifier());
+            }
+            else if (is("("))
+                throw interpreter_error("Calling functions is not supported by the ptrace backend.");
+            else
+                return v;
+        }
+    }
+
+    value deref(value v)
+    {
+        v = ev.referent(v);
+        auto t = type_of(v.type);
+        if (t && (t->kind == elf::type_kind::pointer))
+        {
+            value res;
+            res.type = t->target;
+            res.address = ev.as_integer(v);
+            return res;
+        }
+        if (t && (t->kind == elf::type_kind::array) && v.address)
+        {
+            value res;
+            res.type = t->target;
+            res.address = v.address;
+            return res;
+        }
+        throw interpreter_error("Attempt to take contents of a non-pointer value.");
+    }
+
+    value slice(const value & v, std::size_t type, std::uint64_t offset)
+    {
+        value res;
+        res.type = type;
+        if (v.address)
+            res.address = *v.address + offset;
+        else
+        {
+            auto data = ev.content(v);
+            auto size = info.size_of(type);
+            if ((offset + size) > data.size())
+                throw interpreter_error("no such vector element");
+            res.bytes.assign(data.begin() + offset, data.begin() + offset + size);
+        }
+        return res;
+    }
+
+    value subscript(value v, std::int64_t idx)
+    {
+        v = ev.referent(v);
+        auto t = type_of(v.type);
+        if (t && (t->kind == elf::type_kind::array))
+        {
+            auto offset = static_cast<std::uint64_t>(idx) * info.size_of(t->target);
+            return slice(v, t->target, offset);
+        }
+        if (t && (t->kind == elf::type_kind::pointer))
+        {
+            value res;
+            res.type = t->target;
+            res.address = ev.as_integer(v) + static_cast<std::uint64_t>(idx) * info.size_of(t->target);
+            return res;
+        }
+        throw interpreter_error("cannot subscript something that is not an array or pointer");
+    }
+
+    //anonymous structs & unions are searched, too.
+    bool find_member(std::size_t type, const std::string & name, std::uint64_t & offset, std::size_t & member_type)
+    {
+        auto t = type_of(type);
+        if (!t || (t->kind != elf::type_kind::structure))
+            return false;
+        for (auto & m : t->members)
+        {
+            if (m.name == name)
+            {
+                offset += m.offset;
+                member_type = m.type;
+                return true;
+            }
+            auto inner = offset + m.offset;
+            if (m.name.empty() && find_member(m.type, name, inner, member_type))
+            {
+                offset = inner;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    value member(value v, const std::string & name)
+    {
+        v = ev.referent(v);
+        auto t = type_of(v.type);
+        if (!t || (t->kind != elf::type_kind::structure))
+            throw interpreter_error("Attempt to extract a component of a value that is not a structure.");
+
+        std::uint64_t offset = 0u;
+        std::size_t type = elf::no_type;
+        if (!find_member(v.type, name, offset, type))
+            throw interpreter_error("There is no member named " + name + ".");
+        return slice(v, type, offset);
+    }
+
+    bool is_float(const elf::type_entry * t) const
+    {
+        return t && (t->kind == elf::type_kind::base) && (t->encoding == elf::dw_ate_float);
+    }
+    bool is_pointer(const elf::type_entry * t) const
+    {
+        return t && ((t->kind == elf::type_kind::pointer) || (t->kind == elf::type_kind::array));
+    }
+
+    //integer promotion, everything smaller than int becomes an int.
+    std::size_t promoted(std::size_t type)
+    {
+        auto t = type_of(type);
+        if (!t || (t->kind == elf::type_kind::pointer))
+            return type;
+        auto size = info.size_of(type);
+        if (size < 4u)
+            return int_type();
+        if (size == 4u)
+            return ev.is_signed(type) ? int_type() : ev.builtin_type({"unsigned", "int"});
+        return ev.is_signed(type) ? long_type() : ulong_type();
+    }
+
+    value binary(const std::string & op, value lhs, value rhs)
+    {
+        lhs = ev.referent(lhs);
+        rhs = ev.referent(rhs);
+        auto lt = type_of(lhs.type);
+        auto rt = type_of(rhs.type);
+
+        if ((op == "&&") || (op == "||"))
+        {
+            bool l = is_float(lt) ? (ev.as_double(lhs) != 0.0) : (ev.as_integer(lhs) != 0u);
+            bool r = is_float(rt) ? (ev.as_double(rhs) != 0.0) : (ev.as_integer(rhs) != 0u);
+            return ev.make_integer(int_type(), op == "&&" ? (l && r) : (l || r));
+        }
+
+        if (is_float(lt) || is_float(rt))
+        {
+            auto a = ev.as_double(lhs);
+            auto b = ev.as_double(rhs);
+            if (op == "==") return ev.make_integer(int_type(), a == b);
+            if (op == "!=") return ev.make_integer(int_type(), a != b);
+            if (op == "<")  return ev.make_integer(int_type(), a <  b);
+            if (op == ">")  return ev.make_integer(int_type(), a >  b);
+            if (op == "<=") return ev.make_integer(int_type(), a <= b);
+            if (op == ">=") return ev.make_integer(int_type(), a >= b);
+
+            auto type = ev.builtin_type({"double"});
+            if (op == "+") return ev.cast_float(type, a + b);
+            if (op == "-") return ev.cast_float(type, a - b);
+            if (op == "*") return ev.cast_float(type, a * b);
+            if (op == "/") return ev.cast_float(type, a / b);
+            throw interpreter_error("Integer only operation " + op + ".");
+        }
+
+        //pointer arithmetic
+        if (is_pointer(lt) || is_pointer(rt))
+        {
+            auto ptr_type = [&](const elf::type_entry * t, std::size_t type)
+                {
+                    return t->kind == elf::type_kind::array ? info.pointer_to(t->target) : type;
+                };
+            if (is_pointer(lt) && !is_pointer(rt) && ((op == "+") || (op == "-")))
+            {
+                auto n = ev.as_integer(rhs) * info.size_of(lt->target);
+                auto p = ev.as_integer(lhs);
+                return ev.make_integer(ptr_type(lt, lhs.type), op == "+" ? p + n : p - n);
+            }
+            if (!is_pointer(lt) && is_pointer(rt) && (op == "+"))
+                return ev.make_integer(ptr_type(rt, rhs.type), ev.as_integer(rhs) + ev.as_integer(lhs) * info.size_of(rt->target));
+            if (is_pointer(lt) && is_pointer(rt) && (op == "-"))
+            {
+                auto size = std::max<std::uint64_t>(info.size_of(lt->target), 1u);
+                auto diff = static_cast<std::int64_t>(ev.as_integer(lhs) - ev.as_integer(rhs)) / static_cast<std::int64_t>(size);
+                return ev.make_integer(long_type(), static_cast<std::uint64_t>(diff));
+            }
+        }
+
+        //the usual arithmetic conversions: the larger size and unsigned if one of them is.
+        auto lp = promoted(lhs.type);
+        auto rp = promoted(rhs.type);
+        auto size = std::max(info.size_of(lp), info.size_of(rp));
+        bool is_unsigned = (!ev.is_signed(lp) && (info.size_of(lp) == size)) || (!ev.is_signed(rp) && (info.size_of(rp) == size));
+        auto type = size > 4u ? (is_unsigned ? ulong_type() : long_type())
+                              : (is_unsigned ? ev.builtin_type({"unsigned", "int"}) : int_type());
+
+        auto a = mask(ev.as_integer(lhs), size);
+        auto b = mask(ev.as_integer(rhs), size);
+        auto sa = static_cast<std::int64_t>(sign_extend(a, size));
+        auto sb = static_cast<std::int64_t>(sign_extend(b, size));
+
+        auto compare = [&](auto && cmp)
+            {
+                return ev.make_integer(int_type(), is_unsigned ? cmp(a, b) : cmp(sa, sb));
+            };
+
+        if (op == "==") return ev.make_integer(int_type(), a == b);
+        if (op == "!=") return ev.make_integer(int_type(), a != b);
+        if (op == "<")  return compare([](auto x, auto y){return x <  y;});
+        if (op == ">")  return compare([](auto x, auto y){return x >  y;});
+        if (op == "<=") return compare([](auto x, auto y){return x <= y;});
+        if (op == ">=") return compare([](auto x, auto y){return x >= y;});
+        if (op == "+")  return ev.make_integer(type, a + b);
+        if (op == "-")  return ev.make_integer(type, a - b);
+        if (op == "*")  return ev.make_integer(type, a * b);
+        if (op == "&")  return ev.make_integer(type, a & b);
+        if (op == "|")  return ev.make_integer(type, a | b);
+        if (op == "^")  return ev.make_integer(type, a ^ b);
+        if (op == "<<") return ev.make_integer(type, a << (b & 63u));
+        if (op == ">>") return ev.make_integer(type, is_unsigned ? (a >> (b & 63u)) : static_cast<std::uint64_t>(sa >> (b & 63u)));
+
+        if (b == 0u)
+            throw interpreter_error("Division by zero");
+        if (op == "/") return ev.make_integer(type, is_unsigned ? a / b : static_cast<std::uint64_t>(sa / sb));
+        if (op == "%") return ev.make_integer(type, is_unsigned ? a % b : static_cast<std::uint64_t>(sa % sb));
+        syntax_error();
+    }
+};
+
+value evaluator::evaluate(const std::string & expression)
+{
+    parser p{*this, _info, tokenize(expression)};
+    return p.parse();
+}
+
+std::size_t evaluator::builtin_type(const std::vector<std::string> & words)
+{
+    int longs = 0;
+    bool is_unsigned = false, is_signed = false, is_char = false, is_short = false;
+    std::string other;
+    for (auto & w : words)
+    {
+        if (w == "long")          longs++;
+        else if (w == "unsigned") is_unsigned = true;
+        else if (w == "signed")   is_signed = true;
+        else if (w == "char")     is_char = true;
+        else if (w == "short")    is_short = true;
+        else if (w == "int")      ;
+        else if (!other.empty() || ((w != "float") && (w != "double") && (w != "bool") && (w != "_Bool")))
+            throw interpreter_error("No symbol \"" + w + "\" in current context.");
+        else
+            other = w;
+    }
+
+    //the names as used by gcc
+    std::string name;
+    std::uint64_t size;
+    std::uint32_t encoding;
+    if (other == "bool" || other == "_Bool")
+    {
+        name = other;
+        size = 1u;
+        encoding = elf::dw_ate_boolean;
+    }
+    else if (other == "float" || other == "double")
+    {
+        name = longs ? "long double" : other;
+        size = longs ? 16u : (other == "float" ? 4u : 8u);
+        encoding = elf::dw_ate_float;
+    }
+    else if (is_char)
+    {
+        name = is_unsigned ? "unsigned char" : (is_signed ? "signed char" : "char");
+        size = 1u;
+        encoding = is_unsigned ? elf::dw_ate_unsigned_char : elf::dw_ate_signed_char;
+    }
+    else
+    {
+        if (is_short)
+        {
+            name = is_unsigned ? "short unsigned int" : "short int";
+            size = 2u;
+        }
+        else if (longs >= 2)
+        {
+            name = is_unsigned ? "long long unsigned int" : "long long int";
+            size = 8u;
+        }
+        else if (longs == 1)
+        {
+            name = is_unsigned ? "long unsigned int" : "long int";
+            size = 8u;
+        }
+        else
+        {
+            name = is_unsigned ? "unsigned int" : "int";
+            size = 4u;
+        }
+        encoding = is_unsigned ? elf::dw_ate_unsigned : elf::dw_ate_signed;
+    }
+
+    auto idx = _info.find_type(name);
+    if (idx != elf::no_type)
+        return idx;
+
+    elf::type_entry te;
+    te.kind = elf::type_kind::base;
+    te.name = name;
+    te.size = size;
+    te.encoding = encoding;
+    return _info.add_type(std::move(te));
+}
+
+bool evaluator::is_signed(std::size_t type) const
+{
+    type = _info.resolve(type);
+    if (type == elf::no_type)
+        return false;
+    auto & t = _info.type(type);
+    if (t.kind == elf::type_kind::base)
+        return (t.encoding == elf::dw_ate_signed) || (t.encoding == elf::dw_ate_signed_char) || (t.encoding == elf::dw_ate_float);
+    if (t.kind == elf::type_kind::enumeration)
+    {
+        if (t.target != elf::no_type)
+            return is_signed(t.target);
+        return std::any_of(t.enumerators.begin(), t.enumerators.end(), [](const elf::enumerator & e){return e.value < 0;});
+    }
+    return false;
+}
+
+std::vector<std::uint8_t> evaluator::content(const value & val)
+{
+    auto size = _info.size_of(val.type);
+    if (val.address)
+    {
+        auto data = _target.read_memory(*val.address, size);
+        if (data.size() < size)
+            throw interpreter_error("Cannot access memory at address " + hex(*val.address + data.size()));
+        return data;
+    }
+    if (val.reg)
+    {
+        auto reg = _target.read_register(*val.reg);
+        std::vector<std::uint8_t> data(std::min<std::uint64_t>(size, sizeof(reg)));
+        for (std::size_t i = 0u; i < data.size(); i++)
+            data[i] = static_cast<std::uint8_t>(reg >> (i * 8u));
+        return data;
+    }
+    return val.bytes;
+}
+
+value evaluator::referent(const value & val)
+{
+    auto t = _info.resolve(val.type);
+    if ((t == elf::no_type) || (_info.type(t).kind != elf::type_kind::reference))
+        return val;
+
+    auto data = content(val);
+    std::uint64_t addr = 0u;
+    for (std::size_t i = 0u; i < data.size(); i++)
+        addr |= static_cast<std::uint64_t>(data[i]) << (i * 8u);
+
+    value res;
+    res.type = _info.type(t).target;
+    res.address = addr;
+    return res;
+}
+
+std::uint64_t evaluator::as_integer(const value & val_)
+{
+    auto val = referent(val_);
+    auto t = _info.resolve(val.type);
+    if (t == elf::no_type)
+        throw interpreter_error("Attempt to use a type name as an expression");
+
+    auto & te = _info.type(t);
+    switch (te.kind)
+    {
+    case elf::type_kind::array:
+    case elf::type_kind::function:
+        if (!val.address)
+            throw interpreter_error("Attempt to take address of value not located in memory.");
+        return *val.address; //decays to a pointer
+    case elf::type_kind::structure:
+        throw interpreter_error("Invalid cast.");
+    case elf::type_kind::base:
+        if (te.encoding == elf::dw_ate_float)
+            return static_cast<std::uint64_t>(static_cast<std::int64_t>(as_double(val)));
+        break;
+    default:
+        break;
+    }
+
+    auto data = content(val);
+    std::uint64_t res = 0u;
+    for (std::size_t i = 0u; (i < data.size()) && (i < sizeof(res)); i++)
+        res |= static_cast<std::uint64_t>(data[i]) << (i * 8u);
+    return is_signed(t) ? sign_extend(res, data.size()) : res;
+}
+
+double evaluator::as_double(const value & val_)
+{
+    auto val = referent(val_);
+    auto t = _info.resolve(val.type);
+    if ((t == elf::no_type) || (_info.type(t).kind != elf::type_kind::base) || (_info.type(t).encoding != elf::dw_ate_float))
+    {
+        auto n = as_integer(val);
+        return is_signed(t) ? static_cast<double>(static_cast<std::int64_t>(n)) : static_cast<double>(n);
+    }
+
+    auto data = content(val);
+    switch (data.size())
+    {
+    case sizeof(float):
+    {
+        float f;
+        std::memcpy(&f, data.data(), sizeof(f));
+        return f;
+    }
+    case sizeof(double):
+    {
+        double d;
+        std::memcpy(&d, data.data(), sizeof(d));
+        return d;
+    }
+    default:
+    {
+        long double ld = 0.0;
+        std::memcpy(&ld, data.data(), std::min(data.size(), sizeof(ld)));
+        return static_cast<double>(ld);
+    }
+    }
+}
+
+value evaluator::make_integer(std::size_t type, std::uint64_t v)
+{
+    value res;
+    res.type = type;
+    res.bytes.resize(std::min<std::uint64_t>(_info.size_of(type), sizeof(v)));
+    for (std::size_t i = 0u; i < res.bytes.size(); i++)
+        res.bytes[i] = static_cast<std::uint8_t>(v >> (i * 8u));
+    return res;
+}
+
+value evaluator::cast_float(std::size_t type, double d)
+{
+    value res;
+    res.type = type;
+    res.bytes.resize(_info.size_of(type));
+    if (res.bytes.size() == sizeof(float))
+    {
+        float f = static_cast<float>(d);
+        std::memcpy(res.bytes.data(), &f, sizeof(f));
+    }
+    else if (res.bytes.size() == sizeof(double))
+        std::memcpy(res.bytes.data(), &d, sizeof(d));
+    else
+    {
+        long double ld = d;
+        std::memcpy(res.bytes.data(), &ld, std::min(res.bytes.size(), sizeof(ld)));
+    }
+    return res;
+}
+
+value evaluator::cast(std::size_t type, const value & val_)
+{
+    auto val = referent(val_);
+    auto t = _info.resolve(type);
+    if (t == elf::no_type)
+        return value{};
+
+    auto & te = _info.type(t);
+    switch (te.kind)
+    {
+    case elf::type_kind::base:
+        if (te.encoding == elf::dw_ate_float)
+            return cast_float(type, as_double(val));
+        if (te.encoding == elf::dw_ate_boolean)
+        {
+            auto vt = _info.resolve(val.type);
+            bool b = (vt != elf::no_type) && (_info.type(vt).kind == elf::type_kind::base) && (_info.type(vt).encoding == elf::dw_ate_float)
+                        ? as_double(val) != 0.0 : as_integer(val) != 0u;
+            return make_integer(type, b);
+        }
+        return make_integer(type, as_integer(val));
+    case elf::type_kind::pointer:
+    case elf::type_kind::enumeration:
+        return make_integer(type, as_integer(val));
+    default:
+        break;
+    }
+
+    //aggregates can only be "casted" to the same size.
+    if (_info.size_of(type) != _info.size_of(val.type))
+        throw interpreter_error("Invalid cast.");
+    auto res = val;
+    res.type = type;
+    return res;
+}
+
+void evaluator::assign(const value & lhs_, const value & rhs)
+{
+    auto lhs = referent(lhs_);
+    if (!lhs.address && !lhs.reg)
+        throw interpreter_error("Left operand of assignment is not an lvalue.");
+
+    auto data = cast(lhs.type, rhs).bytes;
+    if (data.empty())
+        data = content(referent(rhs)); //an aggregate of the same size.
+
+    if (lhs.address)
+        _target.write_memory(*lhs.address, data);
+    else
+    {
+        //only the lower part is replaced, e.g. edi of rdi.
+        auto reg = _target.read_register(*lhs.reg);
+        for (std::size_t i = 0u; (i < data.size()) && (i < sizeof(reg)); i++)
+        {
+            reg &= ~(std::uint64_t(0xFF) << (i * 8u));
+            reg |= static_cast<std::uint64_t>(data[i]) << (i * 8u);
+        }
+        _target.write_register(*lhs.reg, reg);
+    }
+}
+
+bool evaluator::is_char(std::size_t type) const
+{
+    type = _info.resolve(type);
+    if (type == elf::no_type)
+        return false;
+    auto & t = _info.type(type);
+    return (t.kind == elf::type_kind::base) && (t.size == 1u) &&
+           ((t.encoding == elf::dw_ate_signed_char) || (t.encoding == elf::dw_ate_unsigned_char));
+}
+
+std::string evaluator::format(const value & val, bool bitwise, int depth)
+{
+    auto t = _info.resolve(val.type);
+    if (t == elf::no_type)
+        return "void";
+
+    auto & te = _info.type(t);
+    switch (te.kind)
+    {
+    case elf::type_kind::reference:
+    {
+        auto r = referent(val);
+        return "@" + hex(*r.address) + ": " + format(r, bitwise, depth + 1);
+    }
+    case elf::type_kind::base:
+    {
+        if (te.encoding == elf::dw_ate_float)
+        {
+            std::ostringstream ss;
+            ss << std::setprecision(te.size == sizeof(float) ? 9 : 17) << as_double(val);
+            return ss.str();
+        }
+        auto n = as_integer(val);
+        if (bitwise)
+            return binary(mask(n, te.size));
+        if (te.encoding == elf::dw_ate_boolean)
+            return n == 0u ? "false" : (n == 1u ? "true" : std::to_string(n));
+        if (is_signed(t))
+        {
+            auto s = std::to_string(static_cast<std::int64_t>(n));
+            return is_char(t) ? (s + " '" + escape(static_cast<unsigned char>(n), '\'') + "'") : s;
+        }
+        return is_char(t) ? (std::to_string(n) + " '" + escape(static_cast<unsigned char>(n), '\'') + "'") : std::to_string(n);
+    }
+    case elf::type_kind::pointer:
+    case elf::type_kind::function:
+        return bitwise ? binary(as_integer(val)) : hex(as_integer(val));
+    case elf::type_kind::enumeration:
+    {
+        auto n = as_integer(val);
+        if (bitwise)
+            return binary(mask(n, _info.size_of(t)));
+        auto itr = std::find_if(te.enumerators.begin(), te.enumerators.end(),
+                                [&](const elf::enumerator & e){return static_cast<std::uint64_t>(e.value) == n;});
+        return itr != te.enumerators.end() ? itr->name : std::to_string(static_cast<std::int64_t>(n));
+    }
+    case elf::type_kind::structure:
+    {
+        if (depth > 8)
+            return "{...}";
+        auto data = content(val);
+        std::string res = "{";
+        bool first = true;
+        for (auto & m : te.members)
+        {
+            if (!first)
+                res += ", ";
+            first = false;
+            value mv;
+            mv.type = m.type;
+            auto size = _info.size_of(m.type);
+            if ((m.offset + size) <= data.size())
+                mv.bytes.assign(data.begin() + m.offset, data.begin() + m.offset + size);
+            if (!m.name.empty())
+                res += m.name + " = ";
+            res += format(mv, bitwise, depth + 1);
+        }
+        return res + "}";
+    }
+    case elf::type_kind::array:
+    {
+        auto data = content(val);
+        if (is_char(te.target) && !bitwise)
+        {
+            std::string res = "\"";
+            for (auto c : data)
+            {
+                if (c == 0u)
+                    break;
+                res += escape(c, '"');
+            }
+            return res + "\"";
+        }
+
+        constexpr std::size_t limit = 200u;
+        auto size = _info.size_of(te.target);
+        std::string res = "{";
+        for (std::size_t i = 0u; (size > 0u) && ((i + 1u) * size <= data.size()); i++)
+        {
+            if (i == limit)
+            {
+                res += "...";
+                break;
+            }
+            if (i > 0u)
+                res += ", ";
+            value ev;
+            ev.type = te.target;
+            ev.bytes.assign(data.begin() + i * size, data.begin() + (i + 1u) * size);
+            res += format(ev, bitwise, depth + 1);
+        }
+        return res + "}";
+    }
+    default:
+        return "<unavailable>";
+    }
+}
+
+metal::debug::var evaluator::to_var(const value & val_, bool bitwise)
+{
+    metal::debug::var res;
+    res.cstring.ellipsis = false;
+
+    auto val = val_;
+    auto t = _info.resolve(val.type);
+    if ((t != elf::no_type) && (_info.type(t).kind == elf::type_kind::reference))
+    {
+        val = referent(val);
+        res.ref = *val.address;
+        t = _info.resolve(val.type);
+    }
+
+    res.value = format(val, bitwise);
+    //like the gdb backend, a plain char is only its number, without the character literal.
+    if (!bitwise && (t != elf::no_type) && (_info.type(t).kind == elf::type_kind::base) && is_char(t))
+        res.value.erase(std::min(res.value.find(' '), res.value.size()));
+
+    if (!bitwise && (t != elf::no_type) && (_info.type(t).kind == elf::type_kind::pointer) && is_char(_info.type(t).target))
+    {
+        auto addr = as_integer(val);
+        //read in chunks, so the end of a mapping does not fail the read.
+        constexpr std::size_t chunk = 64u, limit = 4096u;
+        while (addr != 0u)
+        {
+            auto data = _target.read_memory(addr, chunk);
+            auto nul = std::find(data.begin(), data.end(), std::uint8_t(0));
+            res.cstring.value.append(data.begin(), nul);
+            if ((nul != data.end()) || (data.size() < chunk))
+                break;
+            if (res.cstring.value.size() >= limit)
+            {
+                res.cstring.ellipsis = true;
+                break;
+            }
+            addr += chunk;
+        }
+    }
+    return res;
+}
+
+}}
@@ -0,0 +1,85 @@
+/**
+ * @file   metal/ptrace/expression.hpp
+ * @date   19.10.2026
+ * @author Klemens D. Morgenstern
+ *
+
+ The evaluation of the expressions passed to frame::print & frame::set, without a debugger.
+ It covers the C subset the plugins use: variables, literals, enumerators, members, subscripts,
+ the unary & binary operators, casts and sizeof. Function calls are not supported.
+
+ */
+#ifndef METAL_PTRACE_EXPRESSION_HPP_
+#define METAL_PTRACE_EXPRESSION_HPP_
+
+#include "../../elf/debug_info.hpp"
+
+#include <metal/debug/frame.hpp>
+
+#include <boost/optional.hpp>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace metal { namespace ptrace {
+
+///A value of the target. It's either an lvalue in memory or in a register, or a temporary.
+struct value
+{
+    std::size_t type = elf::no_type;
+    boost::optional<std::uint64_t> address;
+    boost::optional<std::size_t>   reg;     ///<The offset of the register in user_regs_struct.
+    std::vector<std::uint8_t> bytes;        ///<The content of a temporary.
+};
+
+///The access to the stopped program, as needed by the evaluator.
+struct expression_target
+{
+    virtual std::vector<std::uint8_t> read_memory(std::uint64_t addr, std::size_t size) = 0;
+    virtual void write_memory(std::uint64_t addr, const std::vector<std::uint8_t> &vec) = 0;
+    virtual std::uint64_t read_register(std::size_t reg) = 0;
+    virtual void write_register(std::size_t reg, std::uint64_t value) = 0;
+    ///Find a variable of the selected frame, a global variable or a function.
+    virtual boost::optional<value> lookup(const std::string & id) = 0;
+protected:
+    ~expression_target() = default;
+};
+
+class evaluator
+{
+    elf::debug_info & _info;
+    expression_target & _target;
+
+    struct parser;
+public:
+    evaluator(elf::debug_info & info, expression_target & target) : _info(info), _target(target) {}
+
+    ///Throws a metal::debug::interpreter_error, if the expression is invalid or not supported.
+    value evaluate(const std::string & expression);
+    void assign(const value & lhs, const value & rhs);
+
+    ///The value as gdb would print it, plus the c-string of a char pointer and the address of a reference.
+    metal::debug::var to_var(const value & val, bool bitwise = false);
+    std::string format(const value & val, bool bitwise = false, int depth = 0);
+
+    std::vector<std::uint8_t> content(const value & val);
+    ///The value of an integer, enum or pointer, sign-extended.
+    std::uint64_t as_integer(const value & val);
+    double as_double(const value & val);
+    value make_integer(std::size_t type, std::uint64_t v);
+    value cast_float(std::size_t type, double d);
+    ///The conversion of a cast expression, i.e. `(type)val`.
+    value cast(std::size_t type, const value & val);
+    ///The referenced object, if it's a reference, the value itself otherwise.
+    value referent(const value & val);
+
+    ///The type of a builtin like `unsigned long`, added to the debug info if not used by the program.
+    std::size_t builtin_type(const std::vector<std::string> & words);
+    bool is_signed(std::size_t type) const;
+    bool is_char(std::size_t type) const;
+};
+
+}}
+
+#endif /* METAL_PTRACE_EXPRESSION_HPP_ */
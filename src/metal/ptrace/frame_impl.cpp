@@ -0,0 +1,646 @@
+/**
+ * @file   metal/ptrace/frame_impl.cpp
+ * @date   19.10.2026
+ * @author Klemens D. Morgenstern
+ *
+
+ */
+
+#include "frame_impl.hpp"
+
+#include <boost/core/demangle.hpp>
+
+#include <sys/ptrace.h>
+#include <sys/types.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cstring>
+#include <system_error>
+
+namespace metal { namespace ptrace {
+
+using metal::debug::interpreter_error;
+
+target_info::target_info(const std::string & exe) : elf(exe)
+{
+    functions = elf.function_symbols();
+    for (auto & f : functions)
+        f.name = boost::core::demangle(f.name.c_str());
+    std::sort(functions.begin(), functions.end(),
+              [](const elf::symbol & lhs, const elf::symbol & rhs){return lhs.value < rhs.value;});
+
+    //a program without debug information can still be run, it only has no source locations & variables.
+    try
+    {
+        lines.emplace(elf);
+    }
+    catch (elf::elf_error &)
+    {
+    }
+    try
+    {
+        info = elf::debug_info(elf);
+    }
+    catch (elf::elf_error &)
+    {
+    }
+    try
+    {
+        frames.emplace(elf);
+    }
+    catch (elf::elf_error &)
+    {
+    }
+}
+
+const elf::symbol * target_info::find_function(std::uint64_t addr) const
+{
+    auto itr = std::upper_bound(functions.begin(), functions.end(), addr,
+                                [](std::uint64_t a, const elf::symbol & s){return a < s.value;});
+    if (itr == functions.begin())
+        return nullptr;
+    --itr;
+    return (addr < itr->value + itr->size) ? &*itr : nullptr;
+}
+
+std::string plain_name(const std::string & name)
+{
+    if (name.empty() || (name.back() != ')'))
+        return name;
+
+    int depth = 0;
+    for (auto i = name.size(); i-- > 0u;)
+    {
+        if (name[i] == ')')
+            depth++;
+        else if ((name[i] == '(') && (--depth == 0))
+            return name.substr(0, i);
+    }
+    return name;
+}
+
+namespace
+{
+
+//the registers used for the integer arguments, by the SysV ABI.
+const std::size_t int_arg_regs[] =
+{
+    offsetof(user_regs_struct, rdi), offsetof(user_regs_struct, rsi), offsetof(user_regs_struct, rdx),
+    offsetof(user_regs_struct, rcx), offsetof(user_regs_struct, r8),  offsetof(user_regs_struct, r9)
+};
+
+constexpr std::size_t sse_arg_regs = 8u;
+
+const std::pair<const char*, std::size_t> register_names[] =
+{
+    {"rax", offsetof(user_regs_struct, rax)}, {"rbx", offsetof(user_regs_struct, rbx)},
+    {"rcx", offsetof(user_regs_struct, rcx)}, {"rdx", offsetof(user_regs_struct, rdx)},
+    {"rsi", offsetof(user_regs_struct, rsi)}, {"rdi", offsetof(user_regs_struct, rdi)},
+    {"rbp", offsetof(user_regs_struct, rbp)}, {"rsp", offsetof(user_regs_struct, rsp)},
+    {"r8",  offsetof(user_regs_struct, r8)},  {"r9",  offsetof(user_regs_struct, r9)},
+    {"r10", offsetof(user_regs_struct, r10)}, {"r11", offsetof(user_regs_struct, r11)},
+    {"r12", offsetof(user_regs_struct, r12)}, {"r13", offsetof(user_regs_struct, r13)},
+    {"r14", offsetof(user_regs_struct, r14)}, {"r15", offsetof(user_regs_struct, r15)},
+    {"rip", offsetof(user_regs_struct, rip)}, {"eflags", offsetof(user_regs_struct, eflags)},
+    {"cs",  offsetof(user_regs_struct, cs)},  {"ss",  offsetof(user_regs_struct, ss)},
+    {"ds",  offsetof(user_regs_struct, ds)},  {"es",  offsetof(user_regs_struct, es)},
+    {"fs",  offsetof(user_regs_struct, fs)},  {"gs",  offsetof(user_regs_struct, gs)},
+    {"fs_base", offsetof(user_regs_struct, fs_base)}, {"gs_base", offsetof(user_regs_struct, gs_base)}
+};
+
+//the callee-saved registers by their DWARF number, rbp is restored through the frame pointers.
+const std::pair<unsigned int, std::size_t> callee_saved_regs[] =
+{
+    {3u,  offsetof(user_regs_struct, rbx)},
+    {12u, offsetof(user_regs_struct, r12)}, {13u, offsetof(user_regs_struct, r13)},
+    {14u, offsetof(user_regs_struct, r14)}, {15u, offsetof(user_regs_struct, r15)}
+};
+
+constexpr unsigned int dwarf_rbp = 6u;
+constexpr unsigned int dwarf_rsp = 7u;
+
+constexpr std::size_t max_frames = 256u;
+
+}
+
+frame_impl::frame_impl(process & proc, int tid)
+    : metal::debug::frame("", {}), proc(proc), tid(tid), _evaluator(_info(), *this)
+{
+    _read_regs();
+    _id = _current().func;
+}
+
+elf::debug_info & frame_impl::_info()
+{
+    return proc._target->info;
+}
+
+void frame_impl::load_args()
+{
+    auto & st = _current();
+    auto fn = _function(st);
+    if (fn == nullptr)
+        return;
+
+    std::vector<value> locations;
+    if (st.at_entry)
+        locations = _arg_locations(*fn);
+
+    _arg_list.clear();
+    for (std::size_t i = 0u; i < fn->parameters.size(); i++)
+    {
+        auto & p = fn->parameters[i];
+        metal::debug::arg a;
+        a.id = p.name;
+        a.cstring.ellipsis = false;
+        try
+        {
+            auto val = st.at_entry ? boost::make_optional(locations.at(i)) : _variable(*fn, st, p);
+            if (val)
+                static_cast<metal::debug::var&>(a) = _evaluator.to_var(*val);
+            else
+                a.value = "<optimized out>";
+        }
+        catch (interpreter_error & ie)
+        {
+            a.value = std::string("<error: ") + ie.what() + ">";
+        }
+        _arg_list.push_back(std::move(a));
+    }
+}
+
+void frame_impl::_read_regs()
+{
+    if (::ptrace(PTRACE_GETREGS, tid, nullptr, &_regs) != 0)
+        throw std::system_error(errno, std::system_category(), "PTRACE_GETREGS");
+}
+
+void frame_impl::_write_regs()
+{
+    if (::ptrace(PTRACE_SETREGS, tid, nullptr, &_regs) != 0)
+        throw std::system_error(errno, std::system_category(), "PTRACE_SETREGS");
+    _frames.clear();
+}
+
+boost::optional<std::uint64_t> frame_impl::_read64(std::uint64_t addr)
+{
+    auto data = proc._read_memory(addr, sizeof(std::uint64_t));
+    if (data.size() < sizeof(std::uint64_t))
+        return boost::none;
+    std::uint64_t value;
+    std::memcpy(&value, data.data(), sizeof(value));
+    return value;
+}
+
+void frame_impl::_unwind()
+{
+    _frames.clear();
+    auto & target = *proc._target;
+    auto bias = proc._load_bias;
+
+    auto name_of = [&](std::uint64_t where) -> std::string
+        {
+            if (auto sym = target.find_function(where))
+                return plain_name(sym->name);
+            if (auto fn = target.info.find_function(where))
+                return fn->name;
+            return "??";
+        };
+
+    state st;
+    st.pc    = _regs.rip;
+    st.where = st.pc - bias;
+    st.func  = name_of(st.where);
+
+    //the position in the prologue, i.e. if `push rbp; mov rbp, rsp` was executed yet.
+    enum {entry, pushed, body} position = body;
+    if (auto sym = target.find_function(st.where))
+    {
+        auto start = sym->value + bias;
+        auto code = proc._read_memory(start, 8u);
+        std::size_t push = 0u;
+        const std::uint8_t endbr64[] = {0xF3, 0x0F, 0x1E, 0xFA};
+        if ((code.size() >= 4u) && std::equal(std::begin(endbr64), std::end(endbr64), code.begin()))
+            push = 4u;
+
+        if ((push < code.size()) && (code[push] == 0x55))
+        {
+            if (st.pc <= start + push)
+                position = entry;
+            else if (st.pc == start + push + 1u)
+                position = pushed;
+        }
+        else if (st.pc == start)
+            position = entry;
+    }
+    auto instr = proc._read_memory(st.pc, 1u);
+    if (!instr.empty() && (instr[0] == 0xC3)) //ret, after the frame was left.
+        position = entry;
+
+    st.at_entry = (position == entry);
+    switch (position)
+    {
+    case entry:
+        st.cfa = _regs.rsp + 8u;
+        st.ret = _read64(_regs.rsp).value_or(0u);
+        st.caller_rbp = _regs.rbp;
+        st.rbp = st.cfa - 16u;
+        break;
+    case pushed:
+        st.cfa = _regs.rsp + 16u;
+        st.ret = _read64(_regs.rsp + 8u).value_or(0u);
+        st.caller_rbp = _read64(_regs.rsp).value_or(0u);
+        st.rbp = _regs.rsp;
+        break;
+    case body:
+        st.cfa = _regs.rbp + 16u;
+        st.ret = _read64(_regs.rbp + 8u).value_or(0u);
+        st.caller_rbp = _read64(_regs.rbp).value_or(0u);
+        st.rbp = _regs.rbp;
+        break;
+    }
+    _frames.push_back(st);
+
+    //the outer frames are past their prologue, so the frame pointers are valid.
+    while ((_frames.size() < max_frames) && (st.func != "main") && (st.ret != 0u) && (st.caller_rbp != 0u))
+    {
+        state next;
+        next.pc    = st.ret;
+        next.where = st.ret - 1u - bias;
+        if (!target.find_function(next.where) && !target.info.find_function(next.where))
+            break;
+        next.func     = name_of(next.where);
+        next.at_entry = false;
+        next.rbp      = st.caller_rbp;
+        next.cfa      = next.rbp + 16u;
+
+        auto ret = _read64(next.rbp + 8u);
+        auto rbp = _read64(next.rbp);
+        if (!ret || !rbp)
+            break;
+        next.ret = *ret;
+        next.caller_rbp = *rbp;
+        _frames.push_back(next);
+        st = std::move(next);
+    }
+}
+
+const frame_impl::state & frame_impl::_current()
+{
+    if (_frames.empty())
+        _unwind();
+    return _frames.at(std::min(_selected, _frames.size() - 1u));
+}
+
+const elf::function * frame_impl::_function(const state & st) const
+{
+    return proc._target->info.find_function(st.where);
+}
+
+boost::optional<value> frame_impl::_variable(const elf::function & fn, const state & st, const elf::variable & var)
+{
+    value res;
+    res.type = var.type;
+    if (var.address)
+        res.address = *var.address + proc._load_bias;
+    else if (var.frame_offset)
+        res.address = (fn.frame_base_cfa ? st.cfa : st.rbp) + *var.frame_offset;
+    else
+        return boost::none;
+    return res;
+}
+
+std::vector<value> frame_impl::_arg_locations(const elf::function & fn)
+{
+    auto & info = _info();
+    std::vector<value> res;
+    std::size_t next_int = 0u, next_sse = 0u;
+    auto stack = _current().cfa;
+
+    boost::optional<user_fpregs_struct> fpregs;
+    auto read_sse = [&](std::size_t idx)
+        {
+            if (!fpregs)
+            {
+                fpregs.emplace();
+                if (::ptrace(PTRACE_GETFPREGS, tid, nullptr, &*fpregs) != 0)
+                    throw std::system_error(errno, std::system_category(), "PTRACE_GETFPREGS");
+            }
+            std::vector<std::uint8_t> data(8u);
+            std::memcpy(data.data(), &fpregs->xmm_space[idx * 4u], data.size());
+            return data;
+        };
+
+    for (auto & p : fn.parameters)
+    {
+        value v;
+        v.type = p.type;
+        auto size = info.size_of(p.type);
+        auto t = info.resolve(p.type);
+        auto kind = (t == elf::no_type) ? elf::type_kind::base : info.type(t).kind;
+
+        bool is_float = (kind == elf::type_kind::base) && (t != elf::no_type) && (info.type(t).encoding == elf::dw_ate_float);
+
+        if (is_float && (size <= 8u) && (next_sse < sse_arg_regs))
+        {
+            v.bytes = read_sse(next_sse++);
+            v.bytes.resize(size);
+        }
+        else if ((kind == elf::type_kind::structure) && (size <= 16u))
+        {
+            //small structs are split into eight-bytes, each passed in a general purpose or a sse register.
+            std::size_t eightbytes = (size + 7u) / 8u;
+            std::vector<bool> sse(eightbytes, true);
+            for (auto & m : info.type(t).members)
+            {
+                auto mt = info.resolve(m.type);
+                bool m_float = (mt != elf::no_type) && (info.type(mt).kind == elf::type_kind::base)
+                                && (info.type(mt).encoding == elf::dw_ate_float);
+                if (!m_float && (m.offset / 8u < eightbytes))
+                    sse[m.offset / 8u] = false;
+            }
+            auto ints = static_cast<std::size_t>(std::count(sse.begin(), sse.end(), false));
+            if ((next_int + ints <= 6u) && (next_sse + (eightbytes - ints) <= sse_arg_regs))
+            {
+                for (std::size_t i = 0u; i < eightbytes; i++)
+                {
+                    std::vector<std::uint8_t> data;
+                    if (sse[i])
+                        data = read_sse(next_sse++);
+                    else
+                    {
+                        auto reg = read_register(int_arg_regs[next_int++]);
+                        data.resize(8u);
+                        std::memcpy(data.data(), &reg, data.size());
+                    }
+                    v.bytes.insert(v.bytes.end(), data.begin(), data.end());
+                }
+                v.bytes.resize(size);
+            }
+            else
+            {
+                v.address = stack;
+                stack += eightbytes * 8u;
+            }
+        }
+        else if ((kind == elf::type_kind::structure) || is_float)
+        {
+            //passed in memory, i.e. large structs & long double
+            v.address = stack;
+            stack += (size + 7u) / 8u * 8u;
+        }
+        else if (next_int < 6u)
+            v.reg = int_arg_regs[next_int++];
+        else
+        {
+            v.address = stack;
+            stack += 8u;
+        }
+        res.push_back(std::move(v));
+    }
+    return res;
+}
+
+boost::optional<value> frame_impl::lookup(const std::string & id)
+{
+    auto & st = _current();
+    if (auto fn = _function(st))
+    {
+        //the innermost block is the last one, so a local variable shadows the outer ones.
+        for (auto itr = fn->locals.rbegin(); itr != fn->locals.rend(); itr++)
+            if ((itr->name == id) && (itr->low_pc <= st.where) && (st.where < itr->high_pc))
+                return _variable(*fn, st, *itr);
+
+        for (std::size_t i = 0u; i < fn->parameters.size(); i++)
+            if (fn->parameters[i].name == id)
+                return st.at_entry ? _arg_locations(*fn).at(i) : _variable(*fn, st, fn->parameters[i]);
+    }
+
+    auto & info = _info();
+    if (auto gl = info.find_global(id))
+    {
+        value res;
+        res.type = gl->type;
+        res.address = *gl->address + proc._load_bias;
+        return res;
+    }
+
+    auto & functions = proc._target->functions;
+    auto itr = std::find_if(functions.begin(), functions.end(),
+                            [&](const elf::symbol & s){return (s.name == id) || (plain_name(s.name) == id);});
+    if (itr != functions.end())
+    {
+        if (_function_type == elf::no_type)
+        {
+            elf::type_entry te;
+            te.kind = elf::type_kind::function;
+            te.size = 1u;
+            _function_type = info.add_type(std::move(te));
+        }
+        value res;
+        res.type = _function_type;
+        res.address = itr->value + proc._load_bias;
+        return res;
+    }
+    return boost::none;
+}
+
+std::uint64_t frame_impl::read_register(std::size_t reg)
+{
+    std::uint64_t value;
+    std::memcpy(&value, reinterpret_cast<const char*>(&_regs) + reg, sizeof(value));
+    return value;
+}
+
+void frame_impl::write_register(std::size_t reg, std::uint64_t value)
+{
+    std::memcpy(reinterpret_cast<char*>(&_regs) + reg, &value, sizeof(value));
+    _write_regs();
+}
+
+boost::optional<metal::debug::address_info> frame_impl::addr2line(std::uint64_t addr) const
+{
+    return proc._addr2line(addr);
+}
+
+std::unordered_map<std::string, std::uint64_t> frame_impl::regs()
+{
+    std::unordered_map<std::string, std::uint64_t> res;
+    for (auto & r : register_names)
+        res.emplace(r.first, read_register(r.second));
+
+    //the registers of an outer frame, as far as they are known.
+    if (_selected > 0u)
+    {
+        auto & st = _current();
+        res["rip"] = st.pc;
+        res["rbp"] = st.rbp;
+        res["rsp"] = _frames.at(_selected - 1u).cfa;
+    }
+    return res;
+}
+
+void frame_impl::set(const std::string &var, const std::string & val)
+{
+    auto lhs = _evaluator.evaluate(var);
+    auto rhs = _evaluator.evaluate(val);
+    _evaluator.assign(lhs, rhs);
+}
+
+void frame_impl::set(const std::string &var, std::size_t idx, const std::string & val)
+{
+    set(var + "[" + std::to_string(idx) + "]", val);
+}
+
+boost::optional<metal::debug::var> frame_impl::call(const std::string &)
+{
+    throw interpreter_error("Calling functions is not supported by the ptrace backend.");
+}
+
+metal::debug::var frame_impl::print(const std::string & id, bool bitwise)
+{
+    return _evaluator.to_var(_evaluator.evaluate(id), bitwise);
+}
+
+bool frame_impl::condition(const std::string & expr)
+{
+    auto val = _evaluator.referent(_evaluator.evaluate(expr));
+    auto t = _info().resolve(val.type);
+    if ((t != elf::no_type) && (_info().type(t).kind == elf::type_kind::base) && (_info().type(t).encoding == elf::dw_ate_float))
+        return _evaluator.as_double(val) != 0.0;
+    return _evaluator.as_integer(val) != 0u;
+}
+
+void frame_impl::return_(const std::string & value)
+{
+    auto st = _current();
+    if (_selected > 0u)
+        _restore_callee_saved();
+
+    //the return type is not known, so only integers & pointers are returned, in rax.
+    if (!value.empty())
+        _regs.rax = _evaluator.as_integer(_evaluator.evaluate(value));
+
+    _regs.rip = st.ret;
+    _regs.rsp = st.cfa;
+    _regs.rbp = st.caller_rbp;
+    _write_regs();
+    _selected = 0u;
+}
+
+void frame_impl::_restore_callee_saved()
+{
+    auto & target = *proc._target;
+    if (!target.frames)
+        throw interpreter_error("Returning from frame " + std::to_string(_selected) + " requires the .eh_frame section.");
+
+    //a register saved by several frames is taken from the outermost one, the inner ones saved the value it set.
+    std::vector<std::pair<std::size_t, std::uint64_t>> restored;
+    for (std::size_t i = 0u; i <= _selected; i++)
+    {
+        auto & st = _frames.at(i);
+        if (st.at_entry) //nothing was saved yet.
+            continue;
+
+        elf::frame_rules rules;
+        try
+        {
+            rules = target.frames->rules(st.where);
+        }
+        catch (elf::elf_error & ee)
+        {
+            throw interpreter_error("Cannot return through " + st.func + ": " + ee.what());
+        }
+
+        //the unwinder follows the frame pointers, which is only valid if the CFA agrees.
+        boost::optional<std::uint64_t> base;
+        if (!rules.cfa_expression && (rules.cfa_register == dwarf_rbp))
+            base = (i == 0u) ? _regs.rbp : st.rbp;
+        else if (!rules.cfa_expression && (rules.cfa_register == dwarf_rsp) && (i == 0u))
+            base = _regs.rsp;
+        if (!base || (*base + rules.cfa_offset != st.cfa))
+            throw interpreter_error("Cannot return through " + st.func + ", it doesn't use a frame pointer.");
+
+        for (auto & cs : callee_saved_regs)
+        {
+            if (std::find(rules.unsupported.begin(), rules.unsupported.end(), cs.first) != rules.unsupported.end())
+                throw interpreter_error("Cannot return through " + st.func + ", the register rule is not supported.");
+
+            auto itr = std::find_if(rules.saved.begin(), rules.saved.end(),
+                                    [&](const elf::saved_register & sr){return sr.reg == cs.first;});
+            if (itr == rules.saved.end())
+                continue;
+
+            auto value = _read64(st.cfa + itr->offset);
+            if (!value)
+                throw interpreter_error("Cannot read the saved registers of " + st.func + ".");
+            restored.emplace_back(cs.second, *value);
+        }
+    }
+
+    for (auto & r : restored)
+        std::memcpy(reinterpret_cast<char*>(&_regs) + r.first, &r.second, sizeof(r.second));
+}
+
+void frame_impl::set_exit(int code)
+{
+    proc.set_exit(code);
+}
+
+void frame_impl::select(int frame)
+{
+    if (_frames.empty())
+        _unwind();
+    if ((frame < 0) || (static_cast<std::size_t>(frame) >= _frames.size()))
+        throw interpreter_error("No frame at level " + std::to_string(frame) + ".");
+    _selected = static_cast<std::size_t>(frame);
+}
+
+std::vector<metal::debug::backtrace_elem> frame_impl::backtrace()
+{
+    if (_frames.empty())
+        _unwind();
+
+    std::vector<metal::debug::backtrace_elem> res;
+    res.reserve(_frames.size());
+    int cnt = 0;
+    for (auto & st : _frames)
+    {
+        metal::debug::backtrace_elem be;
+        be.cnt  = cnt++;
+        be.addr = st.pc;
+        be.func = st.func;
+        be.loc.line = -1;
+        if (auto ai = proc._addr2line(st.where + proc._load_bias))
+        {
+            be.loc.file = ai->file;
+            be.loc.line = static_cast<int>(ai->line);
+        }
+        res.push_back(std::move(be));
+    }
+    return res;
+}
+
+void frame_impl::disable(const metal::debug::break_point & bp)
+{
+    proc._disable(bp);
+}
+
+void frame_impl::enable(const metal::debug::break_point & bp)
+{
+    proc._enable(bp);
+}
+
+std::vector<std::uint8_t> frame_impl::read_memory(std::uint64_t addr, std::size_t size)
+{
+    return proc._read_memory(addr, size);
+}
+
+void frame_impl::write_memory(std::uint64_t addr, const std::vector<std::uint8_t> &vec)
+{
+    proc._write_memory(addr, vec);
+}
+
+}}
@@ -0,0 +1,117 @@
+/**
+ * @file   metal/ptrace/frame_impl.hpp
+ * @date   19.10.2026
+ * @author Klemens D. Morgenstern
+ *
+
+ The frame of the ptrace backend. The arguments are read from the registers & the stack as laid out by the
+ SysV ABI at the entry of a function, the outer frames are found through the frame pointers.
+ Returning from an outer frame restores the registers the inner frames saved, as described by the `.eh_frame`.
+
+ */
+#ifndef METAL_PTRACE_FRAME_IMPL_HPP_
+#define METAL_PTRACE_FRAME_IMPL_HPP_
+
+#include <metal/ptrace/process.hpp>
+
+#include "expression.hpp"
+#include "../../elf/elf_file.hpp"
+#include "../../elf/call_frame.hpp"
+#include "../../elf/line_table.hpp"
+
+#include <sys/user.h>
+
+namespace metal { namespace ptrace {
+
+///What is known about the program, loaded once.
+struct target_info
+{
+    elf::elf_file elf;
+    ///The function symbols sorted by address, with demangled names.
+    std::vector<elf::symbol> functions;
+    boost::optional<elf::line_table> lines;
+    elf::debug_info info;
+    ///Only needed to restore the registers saved by the outer frames.
+    boost::optional<elf::call_frame_info> frames;
+
+    explicit target_info(const std::string & exe);
+
+    ///The symbol of the function containing the link-time address or nullptr.
+    const elf::symbol * find_function(std::uint64_t addr) const;
+};
+
+///The name without the parameter list, i.e. `f` for `f(int*)`.
+std::string plain_name(const std::string & name);
+
+struct frame_impl : metal::debug::frame, expression_target
+{
+    frame_impl(process & proc, int tid);
+    ///Read the arguments, only done once the break-point stops, i.e. after the condition.
+    void load_args();
+
+    boost::optional<metal::debug::address_info> addr2line(std::uint64_t addr) const override;
+    std::unordered_map<std::string, std::uint64_t> regs() override;
+    void set(const std::string &var, const std::string & val) override;
+    void set(const std::string &var, std::size_t idx, const std::string & val) override;
+    boost::optional<metal::debug::var> call(const std::string & cl) override;
+    metal::debug::var print(const std::string & id, bool bitwise) override;
+    void return_(const std::string & value) override;
+    void set_exit(int code) override;
+    void select(int frame) override;
+    std::vector<metal::debug::backtrace_elem> backtrace() override;
+    std::ostream & log() override {return proc.log();}
+    metal::debug::interpreter & interpreter() override {return _interpreter;}
+
+    void disable(const metal::debug::break_point & bp) override;
+    void enable (const metal::debug::break_point & bp) override;
+
+    std::vector<std::uint8_t> read_memory(std::uint64_t addr, std::size_t size) override;
+    void write_memory(std::uint64_t addr, const std::vector<std::uint8_t> &vec) override;
+
+    std::uint64_t read_register(std::size_t reg) override;
+    void write_register(std::size_t reg, std::uint64_t value) override;
+    boost::optional<value> lookup(const std::string & id) override;
+
+    ///Evaluate the condition of a break-point.
+    bool condition(const std::string & expr);
+
+    process & proc;
+    const int tid;
+private:
+    //an unwound frame, all addresses are run-time addresses.
+    struct state
+    {
+        std::uint64_t pc;
+        std::uint64_t cfa;        ///<The stack pointer before the call, i.e. above the return address.
+        std::uint64_t rbp;        ///<The frame pointer of this function.
+        std::uint64_t caller_rbp;
+        std::uint64_t ret;
+        std::uint64_t where;      ///<The link-time address to look up, i.e. the call for an outer frame.
+        bool at_entry;            ///<Nothing has been pushed yet, so the parameters are still in the registers.
+        std::string func;
+    };
+
+    metal::debug::interpreter _interpreter;
+    evaluator _evaluator;
+    user_regs_struct _regs;
+    std::vector<state> _frames;
+    std::size_t _selected = 0u;
+    std::size_t _function_type = elf::no_type;
+
+    void _read_regs();
+    void _write_regs();
+    void _unwind();
+    const state & _current();
+    const elf::function * _function(const state & st) const;
+    boost::optional<value> _variable(const elf::function & fn, const state & st, const elf::variable & var);
+    boost::optional<std::uint64_t> _read64(std::uint64_t addr);
+    ///The location of the parameters at the entry of a function, by the SysV ABI.
+    std::vector<value> _arg_locations(const elf::function & fn);
+    elf::debug_info & _info();
+    ///Restore the registers the frames up to the selected one saved, before returning from it.
+    void _restore_callee_saved();
+};
+
+}}
+
+#endif /* METAL_PTRACE_FRAME_IMPL_HPP_ */
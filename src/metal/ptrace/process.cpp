@@ -0,0 +1,748 @@
+/**
+ * @file   metal/ptrace/process.cpp
+ * @date   19.10.2026
+ * @author Klemens D. Morgenstern
+ *
+
+ */
+
+#include <metal/ptrace/process.hpp>
+#include "frame_impl.hpp"
+
+#include <boost/filesystem/operations.hpp>
+
+#include <sys/personality.h>
+#include <sys/ptrace.h>
+#include <sys/syscall.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+#include <sys/wait.h>
+#include <elf.h>
+#include <signal.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <system_error>
+
+using std::endl;
+
+namespace metal {
+namespace ptrace {
+
+namespace
+{
+
+constexpr std::uint8_t int3 = 0xCC;
+
+bool peek(int pid, std::uint64_t addr, std::uint64_t & word)
+{
+    errno = 0;
+    auto value = ::ptrace(PTRACE_PEEKDATA, pid, addr, nullptr);
+    if (errno != 0)
+        return false;
+    word = static_cast<std::uint64_t>(value);
+    return true;
+}
+
+bool poke(int pid, std::uint64_t addr, std::uint64_t word)
+{
+    return ::ptrace(PTRACE_POKEDATA, pid, addr, word) == 0;
+}
+
+void cont(int tid, int sig)
+{
+    ::ptrace(PTRACE_CONT, tid, nullptr, sig);
+}
+
+//the signals gdb passes to the program without stopping.
+bool is_pass_through(int sig)
+{
+    switch (sig)
+    {
+    case SIGALRM:
+    case SIGURG:
+    case SIGIO:
+    case SIGVTALRM:
+    case SIGPROF:
+    case SIGCHLD:
+    case SIGWINCH:
+        return true;
+    default:
+        return false;
+    }
+}
+
+}
+
+process::process(const std::string & exe) : _exe(exe), _target(new target_info(exe))
+{
+}
+
+process::~process()
+{
+    _end_watchdog();
+    if ((_pid > 0) && !_finished)
+        _kill();
+}
+
+void process::_launch()
+{
+    auto path = boost::filesystem::absolute(_exe).string();
+
+    //everything is allocated before the fork.
+    std::vector<std::string> args{path};
+    args.insert(args.end(), _args.begin(), _args.end());
+    std::vector<char*> argv;
+    for (auto & a : args)
+        argv.push_back(&a.front());
+    argv.push_back(nullptr);
+
+    auto pid = ::fork();
+    if (pid < 0)
+        throw std::system_error(errno, std::system_category(), "fork");
+
+    if (pid == 0)
+    {
+        ::ptrace(PTRACE_TRACEME, 0, nullptr, nullptr);
+        //like gdb, so the addresses are the same in every run.
+        ::personality(ADDR_NO_RANDOMIZE);
+        ::execv(path.c_str(), argv.data());
+        ::_exit(127);
+    }
+
+    _pid = pid;
+    int status = 0;
+    if ((::waitpid(pid, &status, 0) != pid) || !WIFSTOPPED(status))
+    {
+        _finished = true;
+        BOOST_THROW_EXCEPTION(std::runtime_error("Failed to launch " + _exe));
+    }
+    ::ptrace(PTRACE_SETOPTIONS, pid, nullptr, PTRACE_O_EXITKILL | PTRACE_O_TRACECLONE);
+    _threads.insert(pid);
+
+    //the load bias of a PIE is the difference between the actual & the linked entry point.
+    std::ifstream auxv{"/proc/" + std::to_string(pid) + "/auxv", std::ios::binary};
+    std::uint64_t entry[2];
+    while (auxv.read(reinterpret_cast<char*>(entry), sizeof(entry)) && (entry[0] != AT_NULL))
+        if (entry[0] == AT_ENTRY)
+            _load_bias = entry[1] - _target->elf.entry();
+
+    if (_enable_debug)
+        _log << "Started " << path << " with pid " << pid << ", load bias 0x" << std::hex << _load_bias << std::dec << endl;
+}
+
+void process::_init_bps()
+{
+    for (auto & bp : _break_points)
+    {
+        _log << "\nSetting Breakpoint " << bp->identifier() << endl;
+        _set_breakpoint(*bp);
+    }
+}
+
+void process::_set_breakpoint(break_point & bp)
+{
+    auto & target = *_target;
+    auto & id = bp.identifier();
+
+    //the link-time addresses
+    std::vector<std::uint64_t> addrs;
+    std::string file;
+    int line = -1;
+
+    auto colon = id.rfind(':');
+    bool is_location = (colon != std::string::npos) && (colon > 0u) && (colon + 1u < id.size()) && (id[colon - 1u] != ':')
+                && std::all_of(id.begin() + colon + 1u, id.end(), [](char c){return (c >= '0') && (c <= '9');});
+
+    if (is_location && target.lines)
+    {
+        auto name = id.substr(0u, colon);
+        auto ln = static_cast<std::uint32_t>(std::stoul(id.substr(colon + 1u)));
+
+        auto matches = [&](const std::string & f)
+            {
+                return (f == name) || ((f.size() > name.size()) && (f.compare(f.size() - name.size(), name.size(), name) == 0)
+                                        && (f[f.size() - name.size() - 1u] == '/'));
+            };
+
+        //the first address of the line in every function it's part of.
+        std::map<const elf::symbol*, std::uint64_t> first;
+        for (auto & le : target.lines->entries())
+        {
+            if (le.end_sequence || (le.line != ln) || !matches(target.lines->file(le)))
+                continue;
+            auto sym = target.find_function(le.address);
+            auto itr = first.find(sym);
+            if (itr == first.end())
+                first.emplace(sym, le.address);
+            else
+                itr->second = std::min(itr->second, le.address);
+            if (file.empty())
+                file = target.lines->file(le);
+        }
+        for (auto & f : first)
+            addrs.push_back(f.second);
+        line = static_cast<int>(ln);
+    }
+    else if (!is_location)
+    {
+        //the name can be with the parameter list, e.g. `f(int*)`, without or the plain symbol.
+        for (auto & sym : target.functions)
+            if ((sym.name == id) || (plain_name(sym.name) == id))
+                addrs.push_back(sym.value);
+
+        if (addrs.size() == 1u)
+            if (auto ai = _addr2line(addrs.front() + _load_bias))
+            {
+                file = ai->file;
+                line = static_cast<int>(ai->line);
+            }
+    }
+
+    std::sort(addrs.begin(), addrs.end());
+    addrs.erase(std::unique(addrs.begin(), addrs.end()), addrs.end());
+
+    if (addrs.empty())
+    {
+        _log << "Breakpoint " << id << " not found" << endl << endl;
+        bp.set_not_found();
+        return;
+    }
+
+    for (auto addr : addrs)
+    {
+        auto & ins = _insertions[addr + _load_bias];
+        ins.break_points.push_back(&bp);
+        _insert(addr + _load_bias, ins);
+    }
+
+    if (addrs.size() == 1u)
+    {
+        bp.set_at(addrs.front() + _load_bias, file, line);
+        _log << "Set here: " << file << ":" << line << endl << endl;
+    }
+    else
+    {
+        std::string func = id;
+        bp.set_multiple(addrs.front() + _load_bias, func, static_cast<int>(addrs.size()));
+        _log << "Set multiple breakpoints: " << func << ":" << addrs.size() << endl << endl;
+    }
+}
+
+void process::_insert(std::uint64_t addr, insertion & ins)
+{
+    if (ins.inserted)
+        return;
+    std::uint64_t word;
+    if (!peek(_pid, addr, word))
+        BOOST_THROW_EXCEPTION(std::runtime_error("Cannot insert breakpoint at address " + std::to_string(addr)));
+    ins.original = static_cast<std::uint8_t>(word & 0xFFu);
+    poke(_pid, addr, (word & ~std::uint64_t(0xFFu)) | int3);
+    ins.inserted = true;
+}
+
+void process::_remove(std::uint64_t addr, insertion & ins)
+{
+    if (!ins.inserted)
+        return;
+    std::uint64_t word;
+    if (peek(_pid, addr, word))
+        poke(_pid, addr, (word & ~std::uint64_t(0xFFu)) | ins.original);
+    ins.inserted = false;
+}
+
+std::vector<std::uint8_t> process::_read_memory(std::uint64_t addr, std::size_t size)
+{
+    std::vector<std::uint8_t> res(size);
+    iovec local {res.data(), size};
+    iovec remote{reinterpret_cast<void*>(addr), size};
+    auto n = ::process_vm_readv(_pid, &local, 1, &remote, 1, 0);
+
+    //e.g. if process_vm_readv is not permitted.
+    if (n < 0)
+    {
+        n = 0;
+        std::uint64_t word;
+        while ((static_cast<std::size_t>(n) < size) && peek(_pid, addr + n, word))
+        {
+            auto len = std::min(sizeof(word), size - n);
+            std::memcpy(res.data() + n, &word, len);
+            n += len;
+        }
+    }
+    res.resize(static_cast<std::size_t>(n));
+
+    //the break-points are not part of the program.
+    for (auto itr = _insertions.lower_bound(addr); (itr != _insertions.end()) && (itr->first < addr + res.size()); itr++)
+        if (itr->second.inserted)
+            res[itr->first - addr] = itr->second.original;
+    return res;
+}
+
+void process::_write_memory(std::uint64_t addr, const std::vector<std::uint8_t> & vec)
+{
+    auto data = vec;
+    for (auto itr = _insertions.lower_bound(addr); (itr != _insertions.end()) && (itr->first < addr + data.size()); itr++)
+        if (itr->second.inserted)
+        {
+            itr->second.original = data[itr->first - addr];
+            data[itr->first - addr] = int3;
+        }
+
+    iovec local {data.data(), data.size()};
+    iovec remote{reinterpret_cast<void*>(addr), data.size()};
+    auto n = ::process_vm_writev(_pid, &local, 1, &remote, 1, 0);
+    if ((n >= 0) && (static_cast<std::size_t>(n) == data.size()))
+        return;
+
+    //read-only pages, e.g. code, can only be written with ptrace.
+    for (std::size_t i = 0u; i < data.size(); i += sizeof(std::uint64_t))
+    {
+        std::uint64_t word = 0u;
+        auto len = std::min(sizeof(word), data.size() - i);
+        if (((len < sizeof(word)) && !peek(_pid, addr + i, word)) ||
+                (std::memcpy(&word, data.data() + i, len), !poke(_pid, addr + i, word)))
+        {
+            std::ostringstream ss;
+            ss << "Cannot access memory at address 0x" << std::hex << (addr + i);
+            throw metal::debug::interpreter_error(ss.str());
+        }
+    }
+}
+
+void process::_disable(const break_point & bp)
+{
+    _disabled.insert(&bp);
+    for (auto & ins : _insertions)
+    {
+        auto & bps = ins.second.break_points;
+        if (std::find(bps.begin(), bps.end(), &bp) == bps.end())
+            continue;
+        if (std::all_of(bps.begin(), bps.end(), [this](const break_point * p){return _disabled.count(p) > 0u;}))
+            _remove(ins.first, ins.second);
+    }
+}
+
+void process::_enable(const break_point & bp)
+{
+    _disabled.erase(&bp);
+    for (auto & ins : _insertions)
+    {
+        auto & bps = ins.second.break_points;
+        if (std::find(bps.begin(), bps.end(), &bp) != bps.end())
+            _insert(ins.first, ins.second);
+    }
+}
+
+boost::optional<metal::debug::address_info> process::_addr2line(std::uint64_t addr) const
+{
+    auto & target = *_target;
+    auto where = addr - _load_bias;
+    if (!target.lines)
+        return boost::none;
+    auto le = target.lines->find(where);
+    if (le == nullptr)
+        return boost::none;
+
+    metal::debug::address_info ai;
+    ai.file = target.lines->file(*le);
+    ai.line = le->line;
+    if (!ai.file.empty() && (ai.file.front() == '/'))
+        ai.full_name = ai.file;
+    if (auto sym = target.find_function(where))
+    {
+        ai.function = sym->name; //demangled with the parameters, like gdb.
+        ai.offset = where - sym->value;
+    }
+    return ai;
+}
+
+void process::_handle_breakpoint(int tid, std::uint64_t addr)
+{
+    //the program continues at the int3, i.e. after the break-point.
+    user_regs_struct regs;
+    ::ptrace(PTRACE_GETREGS, tid, nullptr, &regs);
+    regs.rip = addr;
+    ::ptrace(PTRACE_SETREGS, tid, nullptr, &regs);
+
+    std::string file;
+    int line = -1;
+    if (auto ai = _addr2line(addr))
+    {
+        file = ai->file;
+        line = static_cast<int>(ai->line);
+    }
+
+    //all-stop like gdb, the other threads mustn't run while the break-point is handled & removed for the step.
+    _stop_threads(tid);
+
+    frame_impl fr{*this, tid};
+    if (_enable_debug)
+        _log << "Breakpoint hit at 0x" << std::hex << addr << std::dec << " in " << fr.id() << endl;
+
+    bool args_loaded = false;
+    auto bps = _insertions[addr].break_points;
+    for (auto bp : bps)
+    {
+        if (_disabled.count(bp) > 0u)
+            continue;
+        if (auto & cond = bp->condition())
+        {
+            //gdb stops on an invalid condition, too.
+            try
+            {
+                if (!fr.condition(*cond))
+                    continue;
+            }
+            catch (std::exception & e)
+            {
+                _log << "Error in condition of " << bp->identifier() << ": " << e.what() << endl;
+            }
+        }
+        if (!args_loaded)
+        {
+            fr.load_args();
+            args_loaded = true;
+        }
+        bp->invoke(fr, file, line);
+        if (_exited)
+            return;
+    }
+
+    //the break-point might have been disabled or returned from.
+    ::ptrace(PTRACE_GETREGS, tid, nullptr, &regs);
+    auto & ins = _insertions[addr];
+    int sig = 0;
+    if ((regs.rip == addr) && ins.inserted)
+        sig = _step_over(tid, addr);
+    _resume_threads(tid, sig);
+}
+
+int process::_step_over(int tid, std::uint64_t addr)
+{
+    auto & ins = _insertions[addr];
+    _remove(addr, ins);
+
+    int sig = 0;
+    while (true)
+    {
+        ::ptrace(PTRACE_SINGLESTEP, tid, nullptr, nullptr);
+        int status = 0;
+        if (::waitpid(tid, &status, __WALL) != tid)
+            break;
+        if (!WIFSTOPPED(status))
+        {
+            //exited during the step, e.g. killed by the timeout.
+            _thread_exited(tid, status);
+            return 0;
+        }
+        auto s = WSTOPSIG(status);
+        if ((s == SIGTRAP) && ((status >> 16) == 0))
+            break;
+        if ((s == SIGSTOP) && _sample_pending.exchange(false))
+            continue;
+        if ((status >> 16) == 0)
+            sig = s; //delivered after the step.
+    }
+
+    _insert(addr, ins);
+    return sig;
+}
+
+void process::_stop_threads(int tid)
+{
+    for (auto itr = _threads.begin(); itr != _threads.end();)
+    {
+        auto t = *itr++;
+        if (t == tid)
+            continue;
+
+        ::syscall(SYS_tgkill, _pid, t, SIGSTOP);
+        while (true)
+        {
+            int status = 0;
+            if (::waitpid(t, &status, __WALL) != t)
+                break;
+            if (!WIFSTOPPED(status))
+            {
+                _thread_exited(t, status);
+                break;
+            }
+            auto sig = WSTOPSIG(status);
+            //a pending sample of the main thread might be merged into this stop, so it's dropped.
+            if ((sig == SIGSTOP) && ((status >> 16) == 0))
+            {
+                if (t == _pid)
+                    _sample_pending = false;
+                break;
+            }
+
+            //the thread stopped for another reason first, the SIGSTOP is still pending & stops it right away.
+            if ((status >> 16) == 0)
+            {
+                user_regs_struct regs;
+                ::ptrace(PTRACE_GETREGS, t, nullptr, &regs);
+                auto ins = _insertions.find(regs.rip - 1u);
+                //it hits the break-point again, once it continues.
+                if ((sig == SIGTRAP) && (ins != _insertions.end()) && ins->second.inserted)
+                {
+                    regs.rip = ins->first;
+                    ::ptrace(PTRACE_SETREGS, t, nullptr, &regs);
+                }
+                else
+                    _resume_signals[t] = sig;
+            }
+            cont(t, 0);
+        }
+    }
+}
+
+void process::_resume_threads(int tid, int sig)
+{
+    if (_finished)
+        return;
+
+    for (auto t : _threads)
+    {
+        auto s = (t == tid) ? sig : 0;
+        auto itr = _resume_signals.find(t);
+        if (itr != _resume_signals.end())
+        {
+            s = itr->second;
+            _resume_signals.erase(itr);
+        }
+        cont(t, s);
+    }
+}
+
+void process::_thread_exited(int tid, int status)
+{
+    _threads.erase(tid);
+    _resume_signals.erase(tid);
+    if (tid != _pid)
+        return;
+
+    if (WIFEXITED(status))
+        set_exit(WEXITSTATUS(status));
+    _finished = true;
+}
+
+void process::_handle_sample(int tid)
+{
+    frame_impl fr{*this, tid};
+    user_regs_struct regs;
+    ::ptrace(PTRACE_GETREGS, tid, nullptr, &regs);
+
+    for (auto & s : _samplers)
+        s->sample(fr, regs.rip);
+}
+
+void process::_handle_bps()
+{
+    while (!_finished)
+    {
+        int status = 0;
+        auto tid = ::waitpid(-1, &status, __WALL);
+        if (tid < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            break;
+        }
+
+        if (WIFEXITED(status) || WIFSIGNALED(status))
+        {
+            _threads.erase(tid);
+            if (tid != _pid)
+                continue;
+
+            _finished = true;
+            if (WIFEXITED(status))
+                this->set_exit(WEXITSTATUS(status));
+            else if (_timed_out)
+            {
+                _log << "...Timeout..." << endl;
+                _exit_code = 1;
+            }
+            else
+                _log << "Terminated by signal " << ::strsignal(WTERMSIG(status)) << endl;
+            return;
+        }
+        if (!WIFSTOPPED(status))
+            continue;
+
+        auto sig = WSTOPSIG(status);
+
+        //a new thread reports a SIGSTOP first.
+        if (_threads.count(tid) == 0u)
+        {
+            _threads.insert(tid);
+            if (sig == SIGSTOP)
+            {
+                cont(tid, 0);
+                continue;
+            }
+        }
+        //ptrace events, i.e. clone.
+        if ((status >> 16) != 0)
+        {
+            cont(tid, 0);
+            continue;
+        }
+
+        if (sig == SIGTRAP)
+        {
+            user_regs_struct regs;
+            ::ptrace(PTRACE_GETREGS, tid, nullptr, &regs);
+            auto itr = _insertions.find(regs.rip - 1u);
+            if ((itr != _insertions.end()) && itr->second.inserted)
+            {
+                reset_timer();
+                _handle_breakpoint(tid, itr->first);
+                if (_exited) //manual exit, as set by _exit breakpoint
+                    return;
+                continue;
+            }
+        }
+
+        //a sample doesn't reset the timer, otherwise a sampled program would never time out.
+        if ((sig == SIGSTOP) && _sample_pending.exchange(false))
+        {
+            _handle_sample(tid);
+            if (_exited)
+                return;
+            cont(tid, 0);
+            continue;
+        }
+
+        //the SIGSTOP of the all-stop, if the thread stopped for another reason before it arrived.
+        if (sig == SIGSTOP)
+        {
+            cont(tid, 0);
+            continue;
+        }
+
+        if (is_pass_through(sig))
+        {
+            cont(tid, sig);
+            continue;
+        }
+
+        _log << "Received signal " << ::strsignal(sig) << endl;
+        _log << "unknown stop reason" << std::endl;
+        return;
+    }
+}
+
+void process::_kill()
+{
+    ::kill(_pid, SIGKILL);
+    int status;
+    while (::waitpid(-1, &status, __WALL) > 0)
+        ;
+    _finished = true;
+}
+
+void process::_start_watchdog()
+{
+    reset_timer();
+
+    std::chrono::microseconds interval{0};
+    if (!_samplers.empty())
+        interval = (*std::min_element(_samplers.begin(), _samplers.end(),
+                        [](const std::unique_ptr<metal::debug::sampler> & lhs, const std::unique_ptr<metal::debug::sampler> & rhs)
+                        {
+                            return lhs->interval() < rhs->interval();
+                        }))->interval();
+
+    _watchdog = std::thread(
+        [this, interval]
+        {
+            using clock = std::chrono::steady_clock;
+            auto next_sample = clock::now() + interval;
+
+            std::unique_lock<std::mutex> lock{_mutex};
+            while (!_stop_watchdog)
+            {
+                auto wake = clock::time_point::max();
+                if (_time_out > 0)
+                    wake = _deadline;
+                if (interval.count() > 0)
+                    wake = std::min(wake, next_sample);
+
+                if (wake == clock::time_point::max())
+                    _cv.wait(lock);
+                else
+                    _cv.wait_until(lock, wake);
+
+                if (_stop_watchdog)
+                    break;
+
+                auto now = clock::now();
+                if ((_time_out > 0) && (now >= _deadline))
+                {
+                    _timed_out = true;
+                    ::kill(_pid, SIGKILL);
+                    break;
+                }
+                //the sample is taken when the main thread stops.
+                if ((interval.count() > 0) && (now >= next_sample))
+                {
+                    if (!_sample_pending.exchange(true))
+                        ::syscall(SYS_tgkill, _pid, _pid, SIGSTOP);
+                    next_sample = now + interval;
+                }
+            }
+        });
+}
+
+void process::_end_watchdog()
+{
+    {
+        std::lock_guard<std::mutex> lock{_mutex};
+        _stop_watchdog = true;
+    }
+    _cv.notify_all();
+    if (_watchdog.joinable())
+        _watchdog.join();
+}
+
+void process::reset_timer()
+{
+    {
+        std::lock_guard<std::mutex> lock{_mutex};
+        _deadline = std::chrono::steady_clock::now() + std::chrono::seconds(_time_out);
+    }
+    _cv.notify_all();
+}
+
+void process::run()
+{
+    _log << "Starting run" << endl << endl;
+    _launch();
+    _init_bps();
+    _start_watchdog();
+
+    try
+    {
+        cont(_pid, 0);
+        _handle_bps();
+    }
+    catch (...)
+    {
+        _end_watchdog();
+        _kill();
+        throw;
+    }
+
+    _end_watchdog();
+    if (!_finished)
+        _kill();
+}
+
+} /* namespace ptrace */
+} /* namespace metal */
@@ -21,8 +21,15 @@
 #include <string>
 #include <vector>
 #include <iostream>
+#include <memory>
 
 #include <metal/gdb/process.hpp>
+#if defined(METAL_RUNNER_PTRACE)
+#include <metal/ptrace/process.hpp>
+#define METAL_RUNNER_BACKENDS "[gdb, ptrace]"
+#else
+#define METAL_RUNNER_BACKENDS "[gdb]"
+#endif
 
 namespace po = boost::program_options;
 namespace bp = boost::process;
@@ -39,6 +46,7 @@ struct options_t
     bool help;
     bool debug;
     string dbg;
+    string backend;
     string exe;
     string log;
     string other_logs;
@@ -47,6 +55,7 @@ struct options_t
     vector<string> dbg_args;
     vector<string> other_cmds;
     vector<fs::path> dlls;
+    vector<string> cmd_line;
 
     string remote;
     vector<boost::dll::shared_library> plugins;
@@ -106,6 +115,7 @@ struct options_t
     void parse(int argc, char** argv)
     {
         my_binary = argv[0];
+        cmd_line.assign(argv + 1, argv + argc);
 
 #if defined(BOOST_WINDOWS_API)
         //we assume it's an exe on windows.
@@ -170,6 +180,7 @@ struct options_t
             ("exe,E",         value<string>(&exe),                                "executable to run")
             ("args,A",        value<vector<string>>(&args),                       "Arguments passed to the target")
             ("dbg,G",         value<string>(&dbg)->default_value("gdb"),          "dbg command"  )
+            ("backend,B",     value<string>(&backend)->default_value("gdb"),      "debugger backend " METAL_RUNNER_BACKENDS)
             ("dbg-args,U",    value<vector<string>>(&dbg_args)->multitoken(),     "dbg arguments")
             ("source-dir,S",  value<string>(&source_folder),                      "directory to look for source source folder")
             ("other,O",       value<vector<string>>(&other_cmds)->multitoken(),   "other processes")
@@ -263,21 +274,46 @@ int main(int argc, char * argv[])
         }
     }
     fs::path dbg = opt.dbg;
+    std::unique_ptr<metal::debug::process> proc_ptr;
+
+    if (opt.backend == "gdb")
+    {
 #if defined(BOOST_WINDOWS_API)
-    //we assume it's an exe on windows.
-    if (dbg.extension().empty())
-        dbg += ".exe";
-#endif    
+        //we assume it's an exe on windows.
+        if (dbg.extension().empty())
+            dbg += ".exe";
+#endif
 
-    if ((opt.vm.count("dbg") == 0))
-        dbg = bp::search_path("gdb");
-    else if (!fs::exists(dbg) && !fs::exists(dbg = bp::search_path(opt.dbg)))
-        std::cerr << "Debugger binary " << dbg << " not found" << std::endl;
+        if ((opt.vm.count("dbg") == 0))
+            dbg = bp::search_path("gdb");
+        else if (!fs::exists(dbg) && !fs::exists(dbg = bp::search_path(opt.dbg)))
+            std::cerr << "Debugger binary " << dbg << " not found" << std::endl;
 
-    if (!opt.source_folder.empty())
-        opt.dbg_args.push_back("--directory=" + opt.source_folder);
+        if (!opt.source_folder.empty())
+            opt.dbg_args.push_back("--directory=" + opt.source_folder);
 
-    metal::gdb::process proc(dbg, opt.exe, opt.dbg_args);
+        proc_ptr = std::make_unique<metal::gdb::process>(dbg, opt.exe, opt.dbg_args);
+    }
+#if defined(METAL_RUNNER_PTRACE)
+    else if (opt.backend == "ptrace")
+    {
+        //the program is run directly, there's no debugger to connect or to script.
+        if (!opt.remote.empty() || !opt.init_scripts.empty())
+        {
+            std::cerr << "The ptrace backend supports neither --remote nor --init-script" << std::endl;
+            return 1;
+        }
+        dbg = "ptrace";
+        proc_ptr = std::make_unique<metal::ptrace::process>(opt.exe);
+    }
+#endif
+    else
+    {
+        std::cerr << "Unknown debugger backend '" << opt.backend << "'" << std::endl;
+        return 1;
+    }
+
+    auto & proc = *proc_ptr;
 
     if (!opt.log.empty())
         proc.set_log(opt.log);
@@ -326,10 +362,21 @@ int main(int argc, char * argv[])
 
     for (auto & lib : opt.plugins)
     {
+        if (lib.has("metal_dbg_setup_args"))
+            boost::dll::import<void(const std::vector<std::string>&)>(lib, "metal_dbg_setup_args")(opt.cmd_line);
+
         auto f = boost::dll::import<void(std::vector<std::unique_ptr<metal::debug::break_point>>&)>(lib, "metal_dbg_setup_bps");
         std::vector<std::unique_ptr<metal::debug::break_point>> vec;
         f(vec);
         proc.add_break_points(std::move(vec));
+
+        if (lib.has("metal_dbg_setup_samplers"))
+        {
+            auto s = boost::dll::import<void(std::vector<std::unique_ptr<metal::debug::sampler>>&)>(lib, "metal_dbg_setup_samplers");
+            std::vector<std::unique_ptr<metal::debug::sampler>> samplers;
+            s(samplers);
+            proc.add_samplers(std::move(samplers));
+        }
     }
     if (!proc.running())
     {
@@ -17,6 +17,11 @@
 #include <boost/tokenizer.hpp>
 #include <memory>
 #include <iterator>
+#include <chrono>
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <thread>
 
 #include <boost/algorithm/string/case_conv.hpp>
 #include <boost/optional.hpp>
@@ -29,8 +34,10 @@
 #include <boost/algorithm/string/trim_all.hpp>
 
 #include "serial/implementation.hpp"
+#include "serial/live_input.hpp"
 #include "serial/core_functions.hpp"
 #include "serial/test_functions.hpp"
+#include "serial/profile_functions.hpp"
 
 #if defined(BOOST_WINDOWS_API)
 #include <fcntl.h>
@@ -61,7 +68,12 @@ struct options_t
 
     std::string comp;
     std::string binary;
-    std::string input;
+    std::vector<std::string> inputs;
+    unsigned int baud_rate = 0u;
+    unsigned short listen_port = 0u;
+    int input_timeout = 0;
+    unsigned int jobs = 0u;
+    fs::path output_dir;
 
     fs::path log_file;
 
@@ -136,6 +148,7 @@ struct options_t
         po::notify(vm);
 
         metal_serial_test_setup_options(desc);
+        metal_serial_profile_setup_options(desc);
 
         for (auto & dll : dlls)
         {
@@ -177,11 +190,19 @@ struct options_t
                 ("compiler,C", po::value<string>(&comp), "compiler [gcc, clang]")
                 ("response-file", po::value<string>(), "can be specified with '@name', too")
                 ("config-file,E", po::value<string>(), "config file")
-                ("addr2line,A",  po::value<fs::path>(&addr2line)->default_value("addr2line"), "Custom addr2line command")
+                ("addr2line,A",  po::value<fs::path>(&addr2line), "use this addr2line command instead of the line table of the binary")
                 ("source-dir,S", po::value<fs::path>(&source_dir), "root of the source directory")
                 ("log,L",   po::value<fs::path>(&log_file), "log file (instead of stderrr)")
                 ("ignore-exit-code", po::bool_switch(&ignore_exit_code), "ignore the exit code")
-                ("input,I" , po::value<std::string>(&input), "input file, instead of stdin");
+                ("input,I" , po::value<std::vector<std::string>>(&inputs)->multitoken(),
+                             "input file, instead of stdin. This can be a serial device or a named pipe, too. "
+                             "Several inputs of the same binary are decoded in parallel")
+                ("baud-rate",  po::value<unsigned int>(&baud_rate), "baud rate of the serial device given as input")
+                ("listen",     po::value<unsigned short>(&listen_port), "wait for the input on this tcp port of localhost, e.g. from qemu -serial tcp:")
+                ("input-timeout", po::value<int>(&input_timeout)->default_value(input_timeout),
+                                  "end a live input, if no data arrived in this many ms. 0 waits until the end of it")
+                ("jobs,j",       po::value<unsigned int>(&jobs), "number of inputs decoded at the same time, the number of cores by default")
+                ("output-dir,O", po::value<fs::path>(&output_dir), "directory of the outputs of several inputs, named after them");
 
 
         pos.add("binary", 1);
@@ -196,6 +217,113 @@ struct options_t
     }
 };
 
+//a file is mapped, a device or named pipe read as the data arrives.
+byte_source open_input(const options_t & opt, const std::string & input, std::unique_ptr<live_input> & live)
+{
+    const std::chrono::milliseconds input_timeout{opt.input_timeout};
+    auto st = fs::status(input).type();
+    if (st == fs::character_file)
+        live = open_serial_port(input, opt.baud_rate, input_timeout);
+#if !defined(BOOST_WINDOWS_API)
+    else if (st == fs::fifo_file)
+        live = open_fifo(input, input_timeout);
+#endif
+    if (live)
+        return byte_source(*live);
+    return byte_source(fs::path(input));
+}
+
+//decodes every input on one of the threads, the locations & sources are loaded once for all.
+int run_inputs(const options_t & opt, const std::unordered_map<std::string, metal::serial::plugin_function_t> & macros)
+{
+    auto index = load_location_index(opt.binary, opt.source_dir, opt.addr2line, macros);
+    if (!index)
+        return 2;
+
+    //the output of each input goes into a file named after it, duplicates get the position appended.
+    std::vector<fs::path> outputs;
+    for (auto i = 0u; i < opt.inputs.size(); i++)
+    {
+        auto name = fs::path(opt.inputs[i]).filename().string();
+        auto duplicate = std::count_if(opt.inputs.begin(), opt.inputs.end(),
+                                       [&](const std::string & in){return fs::path(in).filename() == name;}) > 1;
+        outputs.push_back(opt.output_dir / (duplicate ? name + "." + std::to_string(i) + ".out" : name + ".out"));
+    }
+
+    struct result_t
+    {
+        int exit_code = 2;
+        metal_serial_test_summary summary;
+    };
+    std::vector<result_t> results(opt.inputs.size());
+    std::atomic<std::size_t> next{0u};
+
+    auto run = [&]
+    {
+        for (auto i = next++; i < opt.inputs.size(); i = next++)
+        {
+            auto & input = opt.inputs[i];
+            fs::ofstream out{outputs[i]};
+            set_printf_stream(out);
+            metal_serial_test_begin_stream(out);
+            metal_serial_profile_begin_stream();
+            try
+            {
+                std::unique_ptr<live_input> live;
+                auto src = open_input(opt, input, live);
+
+                int version;
+                char nullchar{0};
+                int intLength;
+                int ptrLength;
+                endianess_t endianess;
+                std::uint64_t init_loc;
+                if (init_session(src, version, nullchar, intLength, ptrLength, endianess, init_loc))
+                    results[i].exit_code = run_serial(*index, src, version, nullchar, intLength, ptrLength,
+                                                      init_loc, endianess, opt.ignore_exit_code);
+            }
+            catch (parser_exception & pe)
+            {
+                std::cerr << input << ": Parser error " << pe.what() << std::endl;
+            }
+            catch (std::exception & e)
+            {
+                std::cerr << input << ": Exception [" << boost::core::demangle(typeid(e).name())
+                          << "] thrown: '" << e.what() << "'" << std::endl;
+            }
+            results[i].summary = metal_serial_test_end_stream();
+            set_printf_stream(std::cout);
+        }
+    };
+
+    const auto thread_cnt = std::min<std::size_t>(opt.jobs != 0u ? opt.jobs : std::max(std::thread::hardware_concurrency(), 1u),
+                                                  opt.inputs.size());
+    std::vector<std::thread> threads;
+    for (auto i = 1u; i < thread_cnt; i++)
+        threads.emplace_back(run);
+    run();
+    for (auto & thr : threads)
+        thr.join();
+
+    //the merged summary, the exit code is the first one that's not zero.
+    int exit_code = 0;
+    metal_serial_test_summary total;
+    for (auto i = 0u; i < results.size(); i++)
+    {
+        auto & res = results[i];
+        cout << opt.inputs[i] << " -> " << outputs[i].string() << ": exit code " << res.exit_code << ", "
+             << res.summary.executed << " executed, " << res.summary.errors << " errors, " << res.summary.warnings << " warnings" << endl;
+        total.executed += res.summary.executed;
+        total.errors   += res.summary.errors;
+        total.warnings += res.summary.warnings;
+        if (exit_code == 0)
+            exit_code = res.exit_code;
+    }
+    cout << results.size() << " inputs: " << total.executed << " executed, " << total.errors << " errors, "
+         << total.warnings << " warnings" << endl;
+    return exit_code;
+}
+
 int main(int argc, char **argv)
 {
     options_t opt;
@@ -220,40 +348,83 @@ int main(int argc, char **argv)
             std::cerr.rdbuf(logstream->rdbuf());
         }
 
-        boost::optional<fs::ifstream> fstream;
-        if (!opt.input.empty())
-            fstream.emplace(opt.input, std::fstream::in | std::fstream::binary);
 
         //hack cin to accept binary data, otherwise the EOF token screws this program.
 #if defined(BOOST_WINDOWS_API)
         _setmode(_fileno(stdin), _O_BINARY);
 #else
-        std::cin.rdbuf(new __gnu_cxx::stdio_filebuf<char>(STDIN_FILENO, std::ios::in | std::ios::binary));
+        std::cin.rdbuf(new __gnu_cxx::stdio_filebuf<char>(STDIN_FILENO, std::ios::in | std::ios::binary, byte_source::block_size));
 #endif
         std::freopen(nullptr, "rb", stdin);
-        auto itr = fstream ? iterator_t(*fstream) : iterator_t(std::cin);
-        const iterator_t end;
-
-        char nullchar{0};
-        int intLength;
-        int ptrLength;
-        endianess_t endianess;
-
-        std::uint64_t init_loc;
-        if (!init_session(itr, end, nullchar, intLength, ptrLength, endianess, init_loc))
-            return 2;
 
         std::unordered_map<std::string, metal::serial::plugin_function_t> macros;
         metal_serial_test_setup_entries(macros);
+        metal_serial_profile_setup_entries(macros);
+
+        std::unordered_map<std::string, metal::serial::plugin_function_t> plugin_macros;
         for (auto & lib : opt.plugins)
         {
             auto f = boost::dll::import<void(std::unordered_map<std::string, metal::serial::plugin_function_t> &)>(lib, "metal_serial_setup_entries");
-            f(macros);
+            f(plugin_macros);
+        }
+        //the plugins don't know about several inputs, so their calls are serialized.
+        static std::mutex plugin_mutex;
+        for (auto & pm : plugin_macros)
+        {
+            if (opt.inputs.size() > 1u)
+                macros.emplace(pm.first,
+                        [func = std::move(pm.second)](session & s, const std::vector<std::string> & args, const std::string & file, int line)
+                        {
+                            std::lock_guard<std::mutex> lock{plugin_mutex};
+                            func(s, args, file, line);
+                        });
+            else
+                macros.emplace(pm.first, std::move(pm.second));
         }
         macros.emplace("METAL_SERIAL_PRINTF", printf_impl);
         macros.emplace("METAL_SERIAL_EXIT",   exit_impl);
-        return run_serial(opt.binary, opt.source_dir, opt.addr2line, itr, end, nullchar, intLength,
-                          ptrLength, macros, init_loc, endianess, opt.ignore_exit_code);
+
+        if (opt.inputs.size() > 1u)
+        {
+            if (opt.vm.count("listen"))
+            {
+                cerr << "--listen can't be combined with several inputs" << endl;
+                return 2;
+            }
+            auto res = run_inputs(opt, macros);
+            metal_serial_profile_write();
+            return res;
+        }
+
+        //a file is mapped, stdin read in blocks, live inputs are read as their data arrives.
+        std::unique_ptr<live_input> live;
+        boost::optional<byte_source> src;
+        if (opt.vm.count("listen"))
+        {
+            live = listen_tcp(opt.listen_port, std::chrono::milliseconds(opt.input_timeout));
+            src.emplace(*live);
+        }
+        else if (!opt.inputs.empty())
+            src.emplace(open_input(opt, opt.inputs.front(), live));
+        else
+            src.emplace(std::cin);
+
+        int version;
+        char nullchar{0};
+        int intLength;
+        int ptrLength;
+        endianess_t endianess;
+
+        std::uint64_t init_loc;
+        if (!init_session(*src, version, nullchar, intLength, ptrLength, endianess, init_loc))
+            return 2;
+
+        auto index = load_location_index(opt.binary, opt.source_dir, opt.addr2line, macros);
+        if (!index)
+            return 2;
+        auto res = run_serial(*index, *src, version, nullchar, intLength, ptrLength, init_loc, endianess, opt.ignore_exit_code);
+        metal_serial_profile_write();
+        return res;
     }
     catch (parser_exception & pe)
     {
@@ -0,0 +1,75 @@
+/**
+ * @file   serial/byte_source.cpp
+ * @date   19.10.2026
+ * @author Klemens D. Morgenstern
+ *
+ */
+
+#include "byte_source.hpp"
+
+#include <boost/filesystem/operations.hpp>
+#include <boost/interprocess/file_mapping.hpp>
+
+#include <algorithm>
+#include <cstring>
+
+byte_source::byte_source(std::streambuf & buf) : _buf(&buf), _block(block_size)
+{
+    _pos = _end = _block.data();
+}
+
+byte_source::byte_source(const boost::filesystem::path & file)
+{
+    namespace bi = boost::interprocess;
+    //an empty file cannot be mapped, but it's just an input without any data.
+    if (boost::filesystem::file_size(file) == 0u)
+        return;
+
+    bi::file_mapping fm{file.string().c_str(), bi::read_only};
+    _region = bi::mapped_region{fm, bi::read_only};
+    _pos = static_cast<const char*>(_region.get_address());
+    _end = _pos + _region.get_size();
+}
+
+bool byte_source::_refill(std::size_t size)
+{
+    if (_buf == nullptr) //a mapped file is complete.
+        return false;
+
+    //move the unread rest to the front
+    const std::size_t rest = _end - _pos;
+    if (_block.size() < size)
+    {
+        std::vector<char> block(std::max(size, block_size));
+        std::memcpy(block.data(), _pos, rest);
+        _block = std::move(block);
+    }
+    else
+        std::memmove(_block.data(), _pos, rest);
+
+    _pos = _block.data();
+    _end = _pos + rest;
+
+    if (_on_read)
+        _on_read();
+
+    //read what's needed, which might block with a live input, then take what's there already.
+    auto have = rest;
+    while (have < size)
+    {
+        auto got = _buf->sgetn(_block.data() + have, size - have);
+        if (got <= 0)
+            break;
+        have += got;
+    }
+
+    if (have >= size)
+    {
+        auto avail = _buf->in_avail();
+        if (avail > 0)
+            have += _buf->sgetn(_block.data() + have, std::min<std::streamsize>(avail, _block.size() - have));
+    }
+
+    _end = _pos + have;
+    return have >= size;
+}
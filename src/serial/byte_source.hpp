@@ -0,0 +1,60 @@
+/**
+ * @file   serial/byte_source.hpp
+ * @date   19.10.2026
+ * @author Klemens D. Morgenstern
+ *
+
+ The input of metal.serial. A file is mapped into memory, a stream (i.e. stdin) is read in blocks,
+ so the fields can be decoded directly from the bytes.
+
+ */
+
+#ifndef METAL_SERIAL_BYTE_SOURCE_HPP
+#define METAL_SERIAL_BYTE_SOURCE_HPP
+
+#include <boost/filesystem/path.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+
+#include <cstddef>
+#include <functional>
+#include <istream>
+#include <vector>
+
+class byte_source
+{
+    std::streambuf * _buf = nullptr;
+    std::vector<char> _block;
+    boost::interprocess::mapped_region _region;
+
+    const char * _pos = nullptr;
+    const char * _end = nullptr;
+    std::function<void()> _on_read;
+
+    bool _refill(std::size_t size);
+public:
+    constexpr static std::size_t block_size = 1u << 16;
+
+    explicit byte_source(std::istream & is) : byte_source(*is.rdbuf()) {}
+    explicit byte_source(std::streambuf & buf);
+    explicit byte_source(const boost::filesystem::path & file);
+
+    byte_source(byte_source &&) = default;
+    byte_source& operator=(byte_source &&) = default;
+
+    ///Makes sure `size` bytes are available at data(), false if the input ends before.
+    bool require(std::size_t size)
+    {
+        return (static_cast<std::size_t>(_end - _pos) >= size) || _refill(size);
+    }
+
+    bool at_end() {return !require(1u);}
+
+    ///Called before a block is read from the stream, i.e. when the input read so far is decoded and the read might block.
+    void on_read(std::function<void()> func) {_on_read = std::move(func);}
+
+    ///Valid until the next call of require.
+    const char * data() const {return _pos;}
+    void consume(std::size_t size) {_pos += size;}
+};
+
+#endif //METAL_SERIAL_BYTE_SOURCE_HPP
@@ -9,40 +9,275 @@
 #include "core_functions.hpp"
 #include <boost/format.hpp>
 #include <boost/algorithm/string/predicate.hpp>
+#include <fmt/format.h>
 
-void printf_impl(metal::serial::session& session, const std::vector<std::string> & args, const std::string & file, int line)
+#include <cctype>
+#include <cstring>
+#include <iterator>
+#include <unordered_map>
+
+static thread_local std::ostream * printf_stream = &std::cout;
+
+void set_printf_stream(std::ostream & os)
+{
+    printf_stream = &os;
+}
+
+void flush_printf()
+{
+    printf_stream->flush();
+}
+
+namespace
 {
-    auto format = args.at(0);
-    format.pop_back();
-    format.erase(format.begin());
-    boost::format ft(format);
 
-    for (auto itr = args.begin() + 1; itr< args.end(); itr++)
+enum class printf_arg {byte, int_, uint, str, ptr, memory};
+
+//a METAL_SERIAL_PRINTF location translated into fmt specs, done once per location.
+struct printf_plan
+{
+    struct segment
     {
-        auto & arg = *itr;
+        std::string text; //the literal text before the argument
+        std::string spec; //the fmt replacement field of the argument
+        std::string zero_spec; //the stream doesn't write the base prefix of a zero, if set it's used for that.
+        printf_arg arg;
+        bool as_unsigned; //negative values are printed as two's complement in hex & octal, as the stream does.
+    };
+
+    std::vector<printf_arg> args;
+    std::vector<segment> segments;
+    std::string tail;
+    //the format uses something that only boost.format provides, e.g. positional arguments.
+    bool use_boost_format = false;
+};
+
+bool is_integer(printf_arg arg)
+{
+    return (arg == printf_arg::int_) || (arg == printf_arg::uint) || (arg == printf_arg::ptr);
+}
+
+//translates the printf directives, mirroring what boost.format does with them. false if it's not supported.
+bool translate(const std::string & format, printf_plan & plan)
+{
+    std::string text;
+    std::size_t arg_idx = 0u;
+    std::size_t pos = 0u;
+    const auto size = format.size();
+
+    auto digits = [&]
+    {
+        std::string res;
+        while ((pos < size) && std::isdigit(static_cast<unsigned char>(format[pos])))
+            res += format[pos++];
+        return res;
+    };
+
+    while (pos < size)
+    {
+        auto c = format[pos++];
+        if (c != '%')
+        {
+            text += c;
+            continue;
+        }
+        if ((pos < size) && (format[pos] == '%'))
+        {
+            text += '%';
+            pos++;
+            continue;
+        }
+
+        bool left = false, zero = false, plus = false, alt = false;
+        for (; pos < size; pos++)
+        {
+            if      (format[pos] == '-') left = true;
+            else if (format[pos] == '0') zero = true;
+            else if (format[pos] == '+') plus = true;
+            else if (format[pos] == '#') alt  = true;
+            else
+                break;
+        }
+        auto width = digits();
+        std::string precision;
+        if ((pos < size) && (format[pos] == '.'))
+        {
+            pos++;
+            precision = digits();
+            if (precision.empty())
+                precision = "0";
+        }
+        while ((pos < size) && std::strchr("hlLqjzt", format[pos]))
+            pos++;
+
+        //%1%, %|1$|, %1$d, %*d, %p, %c etc. are left to boost.format
+        if ((pos >= size) || !std::strchr("diuoxXseEfFgGaA", format[pos]) || (arg_idx >= plan.args.size()))
+            return false;
+        const auto conv = format[pos++];
+        const auto arg = plan.args[arg_idx++];
+        const bool integer = is_integer(arg);
+        const bool base = (conv == 'x') || (conv == 'X') || (conv == 'o');
 
+        //a precision is the minimum of digits for integers, and a showpos is handled differently on unsigned values.
+        if (!precision.empty() || (plus && (!integer || (arg != printf_arg::int_) || base)))
+            return false;
+
+        auto make_spec = [&](bool prefix)
+        {
+            std::string spec = "{:";
+            if (integer)
+            {
+                if (left)
+                    spec += '<';
+                else if (!zero && !width.empty())
+                    spec += '>';
+                if (plus)
+                    spec += '+';
+                if (prefix)
+                    spec += '#';
+                if (zero && !left && !width.empty())
+                    spec += '0';
+                spec += width;
+                if (base)
+                    spec += conv;
+            }
+            else //the type is ignored for chars & strings, only the padding is applied.
+            {
+                if (zero && !left && !width.empty())
+                    spec += '0';
+                if (!width.empty())
+                    spec += left ? '<' : '>';
+                spec += width;
+            }
+            return spec + '}';
+        };
+
+        const bool prefix = integer && alt && base;
+        plan.segments.push_back(printf_plan::segment{std::move(text), make_spec(prefix), prefix ? make_spec(false) : std::string(),
+                                                     arg, base && (arg == printf_arg::int_)});
+        text.clear();
+    }
+
+    //boost.format throws for too few or too many arguments, so that's left to it.
+    if (arg_idx != plan.args.size())
+        return false;
+
+    plan.tail = std::move(text);
+    return true;
+}
+
+printf_plan make_plan(const std::vector<std::string> & args)
+{
+    printf_plan plan;
+    for (auto itr = args.begin() + 1; itr < args.end(); itr++)
+    {
+        auto & arg = *itr;
         if (boost::starts_with(arg, "BYTE"))
-            ft = ft % session.get_char();
+            plan.args.push_back(printf_arg::byte);
         else if (boost::starts_with(arg, "INT"))
-            ft = ft % session.get_int();
+            plan.args.push_back(printf_arg::int_);
         else if (boost::starts_with(arg, "UINT"))
-            ft = ft % session.get_uint();
+            plan.args.push_back(printf_arg::uint);
         else if (boost::starts_with(arg, "STR"))
-            ft = ft % session.get_str();
+            plan.args.push_back(printf_arg::str);
         else if (boost::starts_with(arg, "PTR"))
-            ft = ft % session.get_ptr();
+            plan.args.push_back(printf_arg::ptr);
         else if (boost::starts_with(arg, "MEMORY"))
+            plan.args.push_back(printf_arg::memory);
+    }
+
+    auto format = args.at(0);
+    format.pop_back();
+    format.erase(format.begin());
+
+    if (!translate(format, plan))
+    {
+        plan.segments.clear();
+        plan.tail = std::move(format);
+        plan.use_boost_format = true;
+    }
+    return plan;
+}
+
+//the macro arguments belong to the location, so their address identifies it.
+thread_local std::unordered_map<const std::vector<std::string>*, printf_plan> printf_plans;
+thread_local fmt::memory_buffer printf_buffer;
+
+template<typename T>
+void format_arg(const printf_plan::segment & seg, T value)
+{
+    auto & spec = (!seg.zero_spec.empty() && (value == T())) ? seg.zero_spec : seg.spec;
+    fmt::vformat_to(std::back_inserter(printf_buffer), spec, fmt::make_format_args(value));
+}
+
+}
+
+void printf_impl(metal::serial::session& session, const std::vector<std::string> & args, const std::string & file, int line)
+{
+    auto itr = printf_plans.find(&args);
+    if (itr == printf_plans.end())
+        itr = printf_plans.emplace(&args, make_plan(args)).first;
+    auto & plan = itr->second;
+
+    printf_buffer.clear();
+    if (plan.use_boost_format)
+    {
+        boost::format ft(plan.tail);
+        for (auto arg : plan.args)
+            switch (arg)
+            {
+                case printf_arg::byte:   ft = ft % session.get_char(); break;
+                case printf_arg::int_:   ft = ft % session.get_int();  break;
+                case printf_arg::uint:   ft = ft % session.get_uint(); break;
+                case printf_arg::str:    ft = ft % session.get_str();  break;
+                case printf_arg::ptr:    ft = ft % session.get_ptr();  break;
+                case printf_arg::memory:
+                {
+                    auto raw = session.get_raw();
+                    ft = ft % std::string(raw.begin(), raw.end());
+                    break;
+                }
+            }
+        auto str = ft.str();
+        printf_buffer.append(str.data(), str.data() + str.size());
+    }
+    else
+        for (auto & seg : plan.segments)
         {
-            auto raw = session.get_raw();
-            ft = ft % std::string(raw.begin(), raw.end());
+            printf_buffer.append(seg.text.data(), seg.text.data() + seg.text.size());
+            switch (seg.arg)
+            {
+                case printf_arg::byte: format_arg(seg, session.get_char()); break;
+                case printf_arg::int_:
+                    if (seg.as_unsigned)
+                        format_arg(seg, static_cast<std::uint64_t>(session.get_int()));
+                    else
+                        format_arg(seg, session.get_int());
+                    break;
+                case printf_arg::uint: format_arg(seg, session.get_uint()); break;
+                case printf_arg::str:  format_arg(seg, session.get_str());  break;
+                case printf_arg::ptr:  format_arg(seg, session.get_ptr());  break;
+                case printf_arg::memory:
+                {
+                    auto raw = session.get_raw();
+                    format_arg(seg, std::string(raw.begin(), raw.end()));
+                    break;
+                }
+            }
         }
-    }
-    std::cout << ft << std::endl;
+
+    if (!plan.use_boost_format)
+        printf_buffer.append(plan.tail.data(), plan.tail.data() + plan.tail.size());
+    printf_buffer.push_back('\n');
+    //the stream is flushed by the decoding loop, when it's done with the input read so far.
+    printf_stream->write(printf_buffer.data(), printf_buffer.size());
 }
 
 void exit_impl  (metal::serial::session& session, const std::vector<std::string> & args, const std::string & file, int line)
 {
     auto code = session.get_int();
+    //the printf output comes before the exit message.
+    printf_stream->flush();
     std::cerr << "Exiting serial execution with " << code << std::endl;
     session.set_exit(code);
 }
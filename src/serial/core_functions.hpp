@@ -9,10 +9,16 @@
 #define METAL_TEST_CORE_FUNCTIONS_HPP
 
 #include <metal/serial/session.hpp>
+#include <ostream>
 
 void printf_impl(metal::serial::session&, const std::vector<std::string> &, const std::string & file, int line);
 void exit_impl  (metal::serial::session&, const std::vector<std::string> &, const std::string & file, int line);
 
+///Redirects the printf output of the calling thread, i.e. into the output of the input it decodes.
+void set_printf_stream(std::ostream & os);
+///Flushes the printf output of the calling thread, done when the input is idle, not for every line.
+void flush_printf();
+
 
 
 
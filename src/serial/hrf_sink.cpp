@@ -18,14 +18,6 @@ inline static const char* msg_word(bool cond)
     return cond ? static_cast<const char*>(" succeeded") : static_cast<const char*>(" failed") ;
 }
 
-inline static const char* bw_str(bool bitwise)
-{
-    if (bitwise)
-        return " bitwise";
-    else
-        return "";
-}
-
 inline static const char* descr(level_t lvl)
 {
     switch (lvl)
@@ -39,125 +31,131 @@ inline static const char* descr(level_t lvl)
     }
 }
 
-static std::string descr( const std::string & str)
-{
-    return " [" + str + "]: ";
-}
-
-
 struct hrf_sink_t : data_sink_t
 {
-    std::ostream * os = &std::cout;
+    metal::sink::hrf_stream os;
 
     std::string group{"__metal_call"};
 
-    std::ostream & loc(const std::string & file, int line)
+    hrf_sink_t(std::ostream & os, const metal::sink::hrf_options & options) : os(os, options) {}
+
+    metal::sink::hrf_stream & loc(const std::string & file, int line)
     {
-        return *os << boost::replace_all_copy(file, "\\\\", "\\") << '(' << line << ')';
+        return os.print("{}({})", boost::replace_all_copy(file, "\\\\", "\\"), line);
     }
 
-    std::ostream & check(const std::string & file, int line, bool condition, level_t lvl)
+    metal::sink::hrf_stream & check(const std::string & file, int line, bool condition, level_t lvl)
     {
-        return loc(file, line) << descr(lvl) << msg_word(condition);
+        return loc(file, line).print("{}{}", descr(lvl), msg_word(condition));
+    }
+
+    void summary(int executed, int warnings, int errors)
+    {
+        os.print("{{ executed : {}, warnings : {}, errors : {}}}", executed, warnings, errors);
+        os.end_record();
+    }
+
+    void comparison(const std::string & file, int line, bool condition, level_t lvl, const char * type, const char * oper,
+                    const std::string & lhs, const std::string &rhs, const std::string & lhs_val, const std::string & rhs_val)
+    {
+        check(file, line, condition, lvl).print(" [{}]: {} {} {}; [{} {} {}]", type, lhs, oper, rhs, lhs_val, oper, rhs_val);
+        os.end_record();
     }
 
     virtual ~hrf_sink_t() = default;
 
     void enter_case(const std::string & file, int line, const std::string & id) override
     {
-        loc(file, line) << " entering test case ["<<  id <<  "]" << endl;
+        loc(file, line).print(" entering test case [{}]", id).end_record();
     }
     void exit_case (const std::string & file, int line, const std::string & id, int executed, int warnings, int errors) override
     {
-        loc(file, line) << " exiting test case ["<<  id <<  "]: "
-                                                            "{ executed : " << executed <<
-                        ", warnings : " << warnings <<
-                        ", errors : " << errors << "}" << endl;
+        loc(file, line).print(" exiting test case [{}]: ", id);
+        summary(executed, warnings, errors);
     }
     void report (int free_executed, int free_warnings, int free_errors,
                  int executed, int warnings, int errors) override
     {
         if (free_executed)
-            *os << "free tests "
-                << ": { executed : " << free_executed
-                << ", warnings : " << free_warnings
-                <<   ", errors : " << free_errors << "}" << endl;
+        {
+            os.write("free tests : ");
+            summary(free_executed, free_warnings, free_errors);
+        }
 
-        *os << "full test report"
-            << ": { executed : " << executed
-            << ", warnings : " << warnings
-            <<   ", errors : " << errors << "}" << endl;
+        os.write("full test report: ");
+        summary(executed, warnings, errors);
+        os.flush();
     }
 
     void log        (const std::string & file, int line, const std::string & message) override
     {
-        loc(file, line) << " log : " << message << endl;
+        loc(file, line).print(" log : {}", message).end_record();
     }
     void checkpoint (const std::string & file, int line) override
     {
-        loc(file, line) << " checkpoint" << endl;
+        loc(file, line).write(" checkpoint").end_record();
     }
 
     void message(const std::string & file, int line, bool condition, level_t lvl, const std::string & message) override
     {
-        check(file, line, condition, lvl) << " [message]: " << message << endl;
+        check(file, line, condition, lvl).print(" [message]: {}", message).end_record();
     }
     void plain  (const std::string & file, int line, bool condition, level_t lvl, const std::string & message) override
     {
-        check(file, line, condition, lvl) << " [expression]: " << message << endl;
+        check(file, line, condition, lvl).print(" [expression]: {}", message).end_record();
     }
 
     void equal     (const std::string & file, int line, bool condition, level_t lvl,
                     const std::string & lhs, const std::string &rhs, const std::string & lhs_val, const std::string & rhs_val) override
     {
-
-        check(file, line, condition, lvl) << descr("equality") << "; [" << lhs_val << " == " << rhs_val << "]" << endl;
+        check(file, line, condition, lvl).print(" [equality]: ; [{} == {}]", lhs_val, rhs_val).end_record();
     }
 
     void not_equal (const std::string & file, int line, bool condition, level_t lvl,
                     const std::string & lhs, const std::string &rhs, const std::string & lhs_val, const std::string & rhs_val) override
     {
-        check(file, line, condition, lvl) << descr("equality") << lhs + " != " + rhs
-                                          << "; [" << lhs_val << " != " << rhs_val << "]" << endl;
+        comparison(file, line, condition, lvl, "equality", "!=", lhs, rhs, lhs_val, rhs_val);
     }
 
     void ge        (const std::string & file, int line, bool condition, level_t lvl,
                     const std::string & lhs, const std::string &rhs, const std::string & lhs_val, const std::string & rhs_val) override
     {
-        check(file, line, condition, lvl) << descr("comparison") << lhs + " >= " + rhs
-                                          << "; [" << lhs_val << " >= " << rhs_val << "]" << endl;
+        comparison(file, line, condition, lvl, "comparison", ">=", lhs, rhs, lhs_val, rhs_val);
     }
 
     void greater   (const std::string & file, int line, bool condition, level_t lvl,
                     const std::string & lhs, const std::string &rhs, const std::string & lhs_val, const std::string & rhs_val) override
     {
-        check(file, line, condition, lvl) << " [comparison]: " << (lhs + " > "  + rhs) << "; [" << lhs_val << " > " << rhs_val << "]" << endl;
+        comparison(file, line, condition, lvl, "comparison", ">", lhs, rhs, lhs_val, rhs_val);
     }
 
     void le        (const std::string & file, int line, bool condition, level_t lvl,
                     const std::string & lhs, const std::string &rhs, const std::string & lhs_val, const std::string & rhs_val) override
     {
-        check(file, line, condition, lvl) << descr("comparison") << (lhs + " <= " + rhs)
-                                          << "; [" << lhs_val << " <= " << rhs_val << "]" << endl;
+        comparison(file, line, condition, lvl, "comparison", "<=", lhs, rhs, lhs_val, rhs_val);
     }
 
     void lesser    (const std::string & file, int line, bool condition, level_t lvl,
                     const std::string & lhs, const std::string &rhs, const std::string & lhs_val, const std::string & rhs_val) override
     {
-        check(file, line, condition, lvl) << " [comparison]: " << (lhs + " < "  + rhs) << "; [" << lhs_val << " < " << rhs_val << "]" << endl;
+        comparison(file, line, condition, lvl, "comparison", "<", lhs, rhs, lhs_val, rhs_val);
     }
 
     void no_execute   (const std::string & file, int line, level_t lvl) override
     {
-        check(file, line, false, lvl) << " do not execute." << endl;
+        check(file, line, false, lvl).write(" do not execute.").end_record();
     }
 };
 
 boost::optional<hrf_sink_t> hrf_sink;
 
-data_sink_t * serial_get_hrf_sink(std::ostream & os)
+data_sink_t * serial_get_hrf_sink(std::ostream & os, const metal::sink::hrf_options & options)
 {
-    hrf_sink.emplace();
-    hrf_sink->os = &os;
+    hrf_sink.emplace(os, options);
     return &*hrf_sink;
-}
\ No newline at end of file
+}
+
+std::unique_ptr<data_sink_t> serial_make_hrf_sink(std::ostream & os, const metal::sink::hrf_options & options)
+{
+    return std::make_unique<hrf_sink_t>(os, options);
+}
@@ -7,7 +7,6 @@
 
 #include "implementation.hpp"
 #include <boost/spirit/home/x3.hpp>
-#include <boost/spirit/home/x3/binary/binary.hpp>
 #include <boost/process/pipe.hpp>
 #include <boost/process/io.hpp>
 #include <boost/process/child.hpp>
@@ -15,10 +14,19 @@
 #include <boost/process/search_path.hpp>
 #include <iostream>
 #include <boost/algorithm/string/trim_all.hpp>
-#include <boost/filesystem/fstream.hpp>
-
+#include <boost/filesystem/operations.hpp>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+#include "../elf/line_table.hpp"
+#include "core_functions.hpp"
+
+#include <algorithm>
+#include <cstring>
 #include <fstream>
+#include <memory>
+#include <mutex>
 #include <regex>
+#include <thread>
 
 namespace bp = boost::process;
 
@@ -27,20 +35,43 @@ namespace x3 = boost::spirit::x3;
 using namespace metal::serial;
 using namespace std;
 
-bool init_session(iterator_t & itr, const iterator_t & end, char & nullchar,
+bool init_session(byte_source & src, int & version, char & nullchar,
                   int & intLength, int & ptrLength, endianess_t &endianess,  std::uint64_t &init_loc)
 {
-    int idx = 0;
+    //parse the header, the versions only differ in the last character
+    const std::string version_prefix = "__metal_serial_version_";
+    auto header_error = [](const char * what)
+    {
+        std::cerr << "Header parsing failed " << what << std::endl;
+        return false;
+    };
+
+    //a field is the length, the content and the null char.
+    auto read_field = [&](int & length, std::vector<char> & token)
+    {
+        if (!src.require(1u))
+            return false;
+        length = static_cast<unsigned char>(src.data()[0]);
+        if (!src.require(length + 2u) || (src.data()[length + 1] != nullchar))
+            return false;
+        token.assign(src.data() + 1, src.data() + 1 + length);
+        src.consume(length + 2u);
+        return true;
+    };
+
+    if (!src.require(version_prefix.size() + 1u) || !std::equal(version_prefix.begin(), version_prefix.end(), src.data()))
+        return header_error("version");
+    version = src.data()[version_prefix.size()] - '0';
+    if ((version != 0) && (version != 1))
+        return header_error("version");
+    src.consume(version_prefix.size() + 1u);
+
     std::vector<char> intToken;
     std::vector<char> ptrToken;
-    //parse the header
-#define check_parser(itr, end, rule, value) if (!x3::parse(itr, end, rule, value)) { std::cerr << "Header parsing failed " << #rule << std::endl; return 1;}
-
-    check_parser(itr, end, x3::lexeme[_METAL_SERIAL_VERSION_STRING] >> x3::byte_, intLength); //not considering the nullchar currentls
-    check_parser(itr, end, x3::repeat(intLength)[x3::byte_] >> x3::byte_(nullchar), intToken);
-    check_parser(itr, end, x3::byte_, ptrLength);
-    check_parser(itr, end, x3::repeat(ptrLength)[x3::byte_] >> x3::byte_(nullchar), ptrToken);
-#undef check_parser
+    if (!read_field(intLength, intToken))
+        return header_error("int token");
+    if (!read_field(ptrLength, ptrToken))
+        return header_error("init location");
 
     //0b11001100
     //  11000011
@@ -94,7 +125,7 @@ const auto parenthesized_code_def = '(' >> *((x3::char_ - x3::char_("()")) | par
 BOOST_SPIRIT_DEFINE(parenthesized_code);
 
 
-bool parse_macro(string::const_iterator itr, string::const_iterator end,
+bool parse_macro(const char * itr, const char * end,
                  std::string & macro_name, std::vector<std::string> &args)
 {
     args.clear();
@@ -132,85 +163,148 @@ bool parse_macro(string::const_iterator itr, string::const_iterator end,
 
 }
 
+//a source file mapped into memory, the line starts are only searched up to the highest line requested.
 struct loaded_file
 {
-    string content;
-    vector<std::size_t> linestarts;
+    boost::interprocess::mapped_region region;
+    const char * begin = nullptr;
+    const char * end   = nullptr;
+    vector<std::size_t> linestarts{0u, 0u};
 
-    auto line(std::size_t line) {return content.cbegin() + linestarts.at(line);}
-    auto end() {return content.cend();}
+    explicit loaded_file(const fs::path & pth)
+    {
+        namespace bi = boost::interprocess;
+        //an empty file cannot be mapped
+        if (fs::file_size(pth) == 0u)
+            return;
+
+        bi::file_mapping fm{pth.string().c_str(), bi::read_only};
+        region = bi::mapped_region{fm, bi::read_only};
+        begin = static_cast<const char*>(region.get_address());
+        end   = begin + region.get_size();
+    }
 
-    loaded_file(string && str) : content(std::move(str))
+    const char * line(std::size_t line)
     {
-        linestarts.push_back(0);
-        linestarts.push_back(0);
-        for (std::size_t idx = 0u; idx < content.size(); idx++)
-            if (content[idx] == '\n')
-                linestarts.push_back(idx+1);
+        while (linestarts.size() <= line)
+        {
+            auto pos = begin + linestarts.back();
+            auto nl = (pos != end) ? static_cast<const char*>(std::memchr(pos, '\n', end - pos)) : nullptr;
+            if (nl == nullptr)
+                throw std::out_of_range("line " + std::to_string(line) + " is past the end of the file");
+            linestarts.push_back((nl - begin) + 1);
+        }
+        return begin + linestarts[line];
     }
-    loaded_file() = default;
-    loaded_file(loaded_file&&) = default;
-    loaded_file& operator=(loaded_file&&) = default;
 };
 
+//a location in the binary, parsed once and looked up for every record written from it.
+struct serial_location
+{
+    std::string file_name;
+    int line_number = 0;
+    std::string macro_name;
+    std::vector<std::string> macro_args;
+    const metal::serial::plugin_function_t * func = nullptr;
+};
 
-
-int run_serial(const std::string binary, const boost::filesystem::path &source_dir, const boost::filesystem::path addr2line,
-               iterator_t &itr, const iterator_t &end, char nullchar, int intLength, int ptrLength,
-               const std::unordered_map<std::string, metal::serial::plugin_function_t> &macros, std::uint64_t init_loc,
-               endianess_t endianess, bool ignore_exit_code)
+//the locations of a binary, built once and shared by all inputs decoded with it.
+struct location_index
 {
+    const std::string binary;
+    const fs::path source_dir;
+    const std::unordered_map<std::string, metal::serial::plugin_function_t> & macros;
+
+    boost::optional<metal::elf::elf_file> elf;
+    boost::optional<metal::elf::line_table> lines;
+
     bp::ipstream pin;
     bp::opstream pout;
-    bp::child ch(bp::search_path(addr2line), "--exe=" + binary, bp::std_in < pout, bp::std_out > pin,
-                 bp::std_err > stderr);
+    boost::optional<bp::child> ch;
 
-    if (!ch.running()) {
-        std::cerr << "addr2line not started (" << bp::search_path(addr2line) << ")" << std::endl;
-        return 2;
+    //the file names are interned at their first lookup, a file that wasn't found is kept as nullptr.
+    std::unordered_map<std::string, std::size_t> file_ids;
+    std::unordered_map<std::string, std::size_t> absolute_ids;
+    std::vector<std::unique_ptr<loaded_file>> files;
+
+    //indexed at startup and read-only afterwards, so it's looked up without a lock.
+    std::unordered_map<std::uint64_t, serial_location> locations;
+
+    //locations that weren't indexed at startup, i.e. with addr2line, are parsed when they occur first.
+    std::mutex lazy_mutex;
+    std::unordered_map<std::uint64_t, serial_location> lazy_locations;
+
+    location_index(const std::string & binary, const fs::path & source_dir,
+                   const std::unordered_map<std::string, metal::serial::plugin_function_t> & macros)
+        : binary(binary), source_dir(source_dir), macros(macros)
+    {
+    }
+
+    ~location_index()
+    {
+        if (ch)
+            pout.pipe().close();
     }
-    else
-        ch.detach();
-    pout << std::hex;
 
-    unordered_map<fs::path, loaded_file> file_buffer;
+    bool load(const fs::path & addr2line);
 
-    auto load_file = [&](fs::path &pth)
+    std::size_t file_id(const std::string & file_name)
     {
+        auto itr = file_ids.find(file_name);
+        if (itr != file_ids.end())
+            return itr->second;
+
+        fs::path pth = file_name;
         if (fs::exists(source_dir / pth))
             pth = source_dir / pth;
+
+        auto id = files.size();
         if (!fs::exists(pth))
         {
             std::cerr << "Source file " << pth << " not found" << std::endl;
-            return false;
+            files.emplace_back();
         }
-        pth = fs::absolute(pth);
-
-        string line;
-        vector<string> st; st.push_back("/** INVALID LINE **/"); //to start at one
-        fs::ifstream istr(pth);
-        ostringstream str;
-        str << istr.rdbuf();
-
-        file_buffer.emplace(pth, str.str());
-        return true;
-    };
+        else
+        {
+            //different names of the same file, e.g. relative to different directories, share the mapping.
+            auto atr = absolute_ids.find(fs::absolute(pth).string());
+            if (atr != absolute_ids.end())
+                id = atr->second;
+            else
+            {
+                absolute_ids.emplace(fs::absolute(pth).string(), id);
+                files.push_back(std::make_unique<loaded_file>(pth));
+            }
+        }
+        file_ids.emplace(file_name, id);
+        return id;
+    }
 
-    auto get_line = [&](fs::path pth, int line) -> boost::iterator_range<typename string::const_iterator>
+    boost::iterator_range<const char*> get_line(const std::string & file_name, int line)
     {
-        if (file_buffer.count(pth) == 0)
-            if (!load_file(pth))
-                return {};
+        auto & fn = files[file_id(file_name)];
+        if (!fn)
+            return {};
 
-        auto & fn = file_buffer[pth];
-
-        return boost::make_iterator_range(fn.line(line), fn.end());
-    };
+        return boost::make_iterator_range(fn->line(line), fn->end);
+    }
 
-    std::string file_name;
-    int line_number;
-    auto get_loc = [&, addr2lineRegex = std::regex{"^((?:\\w:)?[^:]+):(\\d+)(?:\\s+\\(discriminator \\d+\\))?\\s*"}](std::uint64_t location)
+    bool get_loc(std::uint64_t location, std::string & file_name, int & line_number)
     {
+        if (lines)
+        {
+            auto le = lines->find(location);
+            if ((le != nullptr) && (le->line != 0u))
+            {
+                file_name = lines->file(*le);
+                line_number = static_cast<int>(le->line);
+                return true;
+            }
+            std::cerr << "No line information for 0x" << std::hex << location << std::dec << std::endl;
+            return false;
+        }
+
+        static const std::regex addr2lineRegex{"^((?:\\w:)?[^:]+):(\\d+)(?:\\s+\\(discriminator \\d+\\))?\\s*"};
         std::string line;
         std::smatch match;
 
@@ -224,55 +318,215 @@ int run_serial(const std::string binary, const boost::filesystem::path &source_d
         else
             std::cerr << "Error reading from addr2line '" << line << "'" << std::endl;
         return false;
-    };
+    }
 
-    std::string macro_name;
-    std::vector<std::string> macro_args;
+    void set_func(serial_location & sl)
+    {
+        auto itr = macros.find(sl.macro_name);
+        sl.func = (itr != macros.end()) ? &itr->second : nullptr;
+    }
 
-    auto parse_loc = [&](std::uint64_t location)
+    const serial_location * find(std::uint64_t location)
     {
-        if (get_loc(location))
+        auto itr = locations.find(location);
+        if (itr != locations.end())
+            return &itr->second;
+
+        std::lock_guard<std::mutex> lock{lazy_mutex};
+        auto ltr = lazy_locations.find(location);
+        if (ltr != lazy_locations.end())
+            return &ltr->second;
+
+        serial_location sl;
+        if (!get_loc(location, sl.file_name, sl.line_number))
+            return nullptr;
+
+        auto range = get_line(sl.file_name, sl.line_number);
+        if (!parse_macro(range.begin(), range.end(), sl.macro_name, sl.macro_args))
+            return nullptr;
+
+        set_func(sl);
+        return &lazy_locations.emplace(location, std::move(sl)).first->second;
+    }
+
+    //version 1 writes the locations as index into this table.
+    bool location_table(int ptrLength, std::vector<std::uint64_t> & table) const
+    {
+        auto sec = elf ? elf->find_section("metal_serial_locations") : nullptr;
+        if (sec == nullptr)
         {
-            auto range = get_line(file_name, line_number);
-            return parse_macro(range.begin(), range.end(), macro_name,  macro_args);
+            std::cerr << "No metal_serial_locations section in " << binary << std::endl;
+            return false;
         }
-        else
+        if ((ptrLength < 1) || (ptrLength > 8))
+        {
+            std::cerr << "Invalid pointer size " << ptrLength << std::endl;
             return false;
-    };
+        }
+        auto sd = elf->data(*sec);
+        for (auto pos = 0u; (pos + ptrLength) <= sd.size; pos += ptrLength)
+            table.push_back(elf->read(sd.data + pos, ptrLength));
+        return true;
+    }
+};
+
+bool location_index::load(const fs::path & addr2line)
+{
+    try
+    {
+        elf.emplace(binary);
+    }
+    catch (metal::elf::elf_error & ee)
+    {
+        std::cerr << "Could not read " << binary << " (" << ee.what() << ")" << std::endl;
+    }
+
+    //the locations are resolved from the line table of the binary, unless an addr2line command is given.
+    std::vector<metal::elf::symbol> location_symbols;
+    if (addr2line.empty() && elf)
+    {
+        try
+        {
+            lines.emplace(*elf);
+            if (lines->empty())
+            {
+                std::cerr << "No line information in " << binary << ", falling back to addr2line" << std::endl;
+                lines.reset();
+            }
+            else //the labels of _METAL_SERIAL_WRITE_LOCATION, i.e. __metal_serial_<counter>
+            {
+                const std::string prefix = "__metal_serial_";
+                location_symbols = elf->symbols_with_prefix(prefix);
+                location_symbols.erase(
+                        std::remove_if(location_symbols.begin(), location_symbols.end(),
+                            [&](const metal::elf::symbol & sym)
+                            {
+                                return (sym.name.size() == prefix.size())
+                                    || !std::all_of(sym.name.begin() + prefix.size(), sym.name.end(),
+                                                    [](char c){return (c >= '0') && (c <= '9');});
+                            }),
+                        location_symbols.end());
+            }
+        }
+        catch (metal::elf::elf_error & ee)
+        {
+            std::cerr << "Could not read the line table of " << binary << " (" << ee.what() << "), falling back to addr2line" << std::endl;
+        }
+    }
+
+    if (!lines)
+    {
+        auto exe = bp::search_path(addr2line.empty() ? fs::path("addr2line") : addr2line);
+        ch.emplace(exe, "--exe=" + binary, bp::std_in < pout, bp::std_out > pin, bp::std_err > stderr);
+
+        if (!ch->running()) {
+            std::cerr << "addr2line not started (" << exe << ")" << std::endl;
+            return false;
+        }
+        else
+            ch->detach();
+        pout << std::hex;
+    }
+
+    if (!location_symbols.empty())
+    {
+        //the lookup & file loading is sequential, the parsing is distributed over the cores.
+        std::vector<serial_location> indexed(location_symbols.size());
+        std::vector<boost::iterator_range<const char*>> ranges(location_symbols.size());
+        std::vector<char> parsed(location_symbols.size(), false);
+
+        for (auto i = 0u; i < location_symbols.size(); i++)
+        {
+            auto le = lines->find(location_symbols[i].value);
+            if ((le == nullptr) || (le->line == 0u))
+                continue;
+
+            indexed[i].file_name   = lines->file(*le);
+            indexed[i].line_number = static_cast<int>(le->line);
+            try
+            {
+                ranges[i] = get_line(indexed[i].file_name, indexed[i].line_number);
+            }
+            catch (std::out_of_range &) {} //the source doesn't match the binary, this gets reported if the location is used.
+        }
+
+        auto parse_range = [&](std::size_t begin, std::size_t step)
+        {
+            for (auto i = begin; i < ranges.size(); i += step)
+                if (!ranges[i].empty())
+                    parsed[i] = parse_macro(ranges[i].begin(), ranges[i].end(), indexed[i].macro_name, indexed[i].macro_args);
+        };
+
+        const std::size_t thread_cnt = std::min<std::size_t>(std::max(std::thread::hardware_concurrency(), 1u), ranges.size());
+        std::vector<std::thread> threads;
+        for (auto i = 1u; i < thread_cnt; i++)
+            threads.emplace_back(parse_range, i, thread_cnt);
+        parse_range(0u, thread_cnt);
+        for (auto & thr : threads)
+            thr.join();
+
+        locations.reserve(location_symbols.size());
+        for (auto i = 0u; i < location_symbols.size(); i++)
+            if (parsed[i])
+            {
+                set_func(indexed[i]);
+                locations.emplace(location_symbols[i].value, std::move(indexed[i]));
+            }
+    }
+    return true;
+}
+
+std::shared_ptr<location_index> load_location_index(const std::string & binary, const boost::filesystem::path & source_dir,
+                                                    const boost::filesystem::path & addr2line,
+                                                    const std::unordered_map<std::string, metal::serial::plugin_function_t> & macros)
+{
+    auto idx = std::make_shared<location_index>(binary, source_dir, macros);
+    if (!idx->load(addr2line))
+        return nullptr;
+    return idx;
+}
+
+int run_serial(location_index & index, byte_source & src, int version, char nullchar, int intLength, int ptrLength,
+               std::uint64_t init_loc, endianess_t endianess, bool ignore_exit_code)
+{
+    std::vector<std::uint64_t> location_table;
+    if ((version == 1) && !index.location_table(ptrLength, location_table))
+        return 2;
 
     //alright, verify the code location
-    if (parse_loc(init_loc))
+    if (auto init = index.find(init_loc))
     {
-        if ((macro_name != "METAL_SERIAL_INIT") || !macro_args.empty())
+        if ((init->macro_name != "METAL_SERIAL_INIT") || !init->macro_args.empty())
         {
-            std::cerr << "Could not verify start sequence '" << macro_name << "', " << macro_args.size()  << std::endl;
+            std::cerr << "Could not verify start sequence '" << init->macro_name << "', " << init->macro_args.size()  << std::endl;
             return 2;
         }
-        std::cerr << "Initializing metal serial from " << file_name << ":" << line_number << std::endl;
+        std::cerr << "Initializing metal serial from " << init->file_name << ":" << init->line_number << std::endl;
     }
     else
         return 2;
 
-    std::unique_ptr<session> session_p = build_session(itr, end, nullchar, intLength, ptrLength, endianess);
-    while ((itr != end) && !get_exited(session_p))
+    std::unique_ptr<session> session_p = build_session(src, version, nullchar, intLength, ptrLength, endianess,
+                                                           std::move(location_table));
+    //the printf output is flushed once the input read so far is decoded, i.e. before waiting for more.
+    src.on_read(&flush_printf);
+    //the exit is checked first, a live input would otherwise wait for data after it.
+    while (!get_exited(session_p) && !src.at_end())
     {
         set_session_loc(session_p, "**unknown location**", 00);
-        auto loc = session_p->get_ptr();
-        if (!parse_loc(loc))
+        auto loc = index.find(get_location(session_p));
+        if (!loc)
             return 2;
-        set_session_loc(session_p, file_name, line_number);
-        if (macros.count(macro_name) == 0)
+        set_session_loc(session_p, loc->file_name, loc->line_number);
+        if (loc->func == nullptr)
         {
-            std::cerr << file_name << "(" << line_number << ") macro not found: '" << macro_name << "'" << std::endl;
+            std::cerr << loc->file_name << "(" << loc->line_number << ") macro not found: '" << loc->macro_name << "'" << std::endl;
             return 2;
         }
-        auto & func = macros.at(macro_name);
-        func(*session_p, macro_args, file_name, line_number);
+        (*loc->func)(*session_p, loc->macro_args, loc->file_name, loc->line_number);
     }
 
-
-    pout.pipe().close();
-
+    flush_printf();
     if (auto exit_code = get_exited(session_p))
         return ignore_exit_code ? 0 : *exit_code;
 
@@ -282,8 +536,7 @@ int run_serial(const std::string binary, const boost::filesystem::path &source_d
 
 struct session_impl : metal::serial::session
 {
-    iterator_t & itr;
-    const iterator_t & end;
+    byte_source & src;
     const char nullChar;
     const size_t ptr_size;
 
@@ -303,209 +556,217 @@ struct session_impl : metal::serial::session
             throw parser_exception(msg + " from " + source_file + ":" + to_string(line));
     }
 
-    session_impl(iterator_t & itr, const iterator_t  & end, const char nullChar, size_t ptr_size)
-            : itr(itr), end(end), nullChar(nullChar), ptr_size(ptr_size) {}
+    session_impl(byte_source & src, const char nullChar, size_t ptr_size)
+            : src(src), nullChar(nullChar), ptr_size(ptr_size) {}
 
-    std::string get_str() override final
-    {
-        auto size = *itr;
-        std::string res;
-        check_parser(x3::parse(itr, end, x3::omit[x3::byte_(size)] >> x3::repeat(size)[x3::char_]
-                                                                   >> x3::omit[x3::byte_(nullChar)], res),
-                     "Failed to parse string.");
-        return res;
-    }
+    virtual std::uint64_t get_location() = 0;
+};
 
-    std::vector<char> get_raw() override
+
+boost::optional<int> get_exited(std::unique_ptr<metal::serial::session> & session)
+{
+    return static_cast<session_impl*>(session.get())->exited;
+}
+
+std::uint64_t get_location(std::unique_ptr<metal::serial::session> & session)
+{
+    return static_cast<session_impl*>(session.get())->get_location();
+}
+
+//version 0: every value is the size, the content and the null char.
+//the byte order is a template parameter, so the loads of the integers are resolved at compile time.
+template<endianess_t endianess_>
+struct session_impl_endian final : session_impl
+{
+    using session_impl::session_impl;
+    endianess_t endianess() override {return endianess_;}
+
+    //the length of the next field
+    std::size_t peek_size(const char * msg)
     {
-        auto size = *itr;
-        std::vector<char> res;
-        check_parser(x3::parse(itr, end, x3::omit[x3::byte_(size)] >> x3::repeat(size)[x3::byte_]
-                                                                   >> x3::omit[x3::byte_(nullChar)], res),
-                     "Failed to parse raw data.");
-        return res;
+        check_parser(src.require(1u), msg);
+        return static_cast<unsigned char>(src.data()[0]);
     }
 
-
-    std::uint8_t get_uint8() override final
+    //returns the content of the field.
+    const char * field(std::size_t size, const char * msg)
     {
-        std::uint8_t  res{0};
-        check_parser(x3::parse(itr, end, x3::omit[x3::byte_(1)] >> x3::byte_ >> x3::omit[x3::byte_(nullChar)], res), "Can't parse uint8_t");
-        return res;
+        check_parser(src.require(size + 2u)
+                     && (static_cast<unsigned char>(src.data()[0]) == size)
+                     && (src.data()[size + 1u] == nullChar), msg);
+        auto content = src.data() + 1;
+        src.consume(size + 2u);
+        return content;
     }
-    std::int8_t  get_int8() override final
+
+    template<typename T>
+    T get_integer(const char * msg)
     {
-        std::int8_t  res{0};
-        check_parser(x3::parse(itr, end, x3::omit[x3::byte_(1)] >> x3::byte_ >> x3::omit[x3::byte_(nullChar)], res), "Can't parse uint8_t");
-        return res;
+        auto content = field(sizeof(T), msg);
+        std::uint64_t value = 0u;
+        for (auto i = 0u; i < sizeof(T); i++)
+        {
+            auto idx = (endianess_ == endianess_t::little_endian) ? (sizeof(T) - i - 1) : i;
+            value = (value << 8) | static_cast<unsigned char>(content[idx]);
+        }
+        return static_cast<T>(value);
     }
 
-    char get_char() override final
+    std::string get_str() override
     {
-        char res{0};
-        check_parser(x3::parse(itr, end, x3::omit[x3::byte_(1)] >> x3::char_ >> x3::omit[x3::byte_(nullChar)], res), "Can't parse uint8_t");
-        return res;
+        auto size = peek_size("Failed to parse string.");
+        auto content = field(size, "Failed to parse string.");
+        return std::string(content, content + size);
     }
 
-    bool get_bool() override final
+    std::vector<char> get_raw() override
     {
-        bool res{0};
-        check_parser(x3::parse(itr, end, x3::omit[x3::byte_(1)] >> x3::byte_ >> x3::omit[x3::byte_(nullChar)], res), "Can't parse bool");
-        return res;
+        auto size = peek_size("Failed to parse raw data.");
+        auto content = field(size, "Failed to parse raw data.");
+        return std::vector<char>(content, content + size);
     }
 
-    std:: int64_t get_int()  override final
+    std::uint8_t get_uint8() override {return static_cast<std::uint8_t>(*field(1u, "Can't parse uint8_t"));}
+    std::int8_t  get_int8()  override {return static_cast<std::int8_t> (*field(1u, "Can't parse int8_t"));}
+    char         get_char()  override {return *field(1u, "Can't parse char");}
+    bool         get_bool()  override {return *field(1u, "Can't parse bool") != '\0';}
+
+    std::uint16_t get_uint16() override {return get_integer<std::uint16_t>("Can't parse uint16_t");}
+    std::int16_t  get_int16()  override {return get_integer<std::int16_t> ("Can't parse int16_t");}
+    std::uint32_t get_uint32() override {return get_integer<std::uint32_t>("Can't parse uint32_t");}
+    std::int32_t  get_int32()  override {return get_integer<std::int32_t> ("Can't parse int32_t");}
+    std::uint64_t get_uint64() override {return get_integer<std::uint64_t>("Can't parse uint64_t");}
+    std::int64_t  get_int64()  override {return get_integer<std::int64_t> ("Can't parse int64_t");}
+
+    std:: int64_t get_int()  override
     {
-        switch (*itr)
+        auto size = peek_size("Unable to read int");
+        switch (size)
         {
-            case 1: return get_int8();
-            case 2: return get_int16();
-            case 4: return get_int32();
-            case 8: return get_int64();
+            case 1: return get_integer<std::int8_t> ("Can't parse int8_t");
+            case 2: return get_integer<std::int16_t>("Can't parse int16_t");
+            case 4: return get_integer<std::int32_t>("Can't parse int32_t");
+            case 8: return get_integer<std::int64_t>("Can't parse int64_t");
             default:
-                check_parser(false ,"Unable to read int of size " + std::to_string(*itr));
+                check_parser(false ,"Unable to read int of size " + std::to_string(size));
                 return 0ll;
         }
     }
 
-    std::uint64_t get_uint() override final
+    std::uint64_t get_uint() override
     {
-        switch (*itr)
+        auto size = peek_size("Unable to read unsigned int");
+        switch (size)
         {
-            case 1: return get_uint8();
-            case 2: return get_uint16();
-            case 4: return get_uint32();
-            case 8: return get_uint64();
+            case 1: return get_integer<std::uint8_t> ("Can't parse uint8_t");
+            case 2: return get_integer<std::uint16_t>("Can't parse uint16_t");
+            case 4: return get_integer<std::uint32_t>("Can't parse uint32_t");
+            case 8: return get_integer<std::uint64_t>("Can't parse uint64_t");
             default:
-                check_parser(false ,"Unable to read unsigned int of size " + std::to_string(*itr));
+                check_parser(false ,"Unable to read unsigned int of size " + std::to_string(size));
                 return 0ull;
         }
     }
 
-    std::uint64_t get_ptr() override final
+    std::uint64_t get_ptr() override
     {
         switch (ptr_size)
         {
-            case 1: return get_uint8();
-            case 2: return get_uint16();
-            case 4: return get_uint32();
-            case 8: return get_uint64();
+            case 1: return get_integer<std::uint8_t> ("Can't parse pointer");
+            case 2: return get_integer<std::uint16_t>("Can't parse pointer");
+            case 4: return get_integer<std::uint32_t>("Can't parse pointer");
+            case 8: return get_integer<std::uint64_t>("Can't parse pointer");
             default:
-                check_parser(false ,"Unable to read pointer of size " + std::to_string(*itr));
+                check_parser(false ,"Unable to read pointer of size " + std::to_string(ptr_size));
                 return 0ull;
         }
     }
-};
 
-
-boost::optional<int> get_exited(std::unique_ptr<metal::serial::session> & session)
-{
-    return static_cast<session_impl*>(session.get())->exited;
-}
-
-
-template<endianess_t endianess_>
-struct session_impl_endian final : session_impl
-{
-    using session_impl::session_impl;
-    endianess_t endianess() {return endianess_;}
-
-    std::uint16_t get_uint16() override;
-    std::int16_t  get_int16()  override;
-    std::uint32_t get_uint32() override;
-    std::int32_t  get_int32()  override;
-    std::uint64_t get_uint64() override;
-    std::int64_t  get_int64()  override;
+    std::uint64_t get_location() override {return get_ptr();}
 };
 
-template<> std::uint16_t session_impl_endian<endianess_t::big_endian>::get_uint16()
+//version 1: bytes are written as is, integers as LEB128 varints (zig-zag encoded if signed), strings & memory with
+//a varint length and locations as index into the `metal_serial_locations` table of the binary.
+struct session_impl_varint final : session_impl
 {
-    std::uint16_t res{0};
-    check_parser(x3::parse(itr, end, x3::omit[x3::byte_(2)] >> x3::big_word >> x3::omit[x3::byte_(nullChar)], res), "Can't parse uint16_t");
-
-    return res;
-}
+    const endianess_t endianess_;
+    const std::vector<std::uint64_t> location_table;
 
-template<> std::int16_t  session_impl_endian<endianess_t::big_endian>::get_int16()
-{
-    std::int16_t  res{0};
-    check_parser(x3::parse(itr, end, x3::omit[x3::byte_(2)] >> x3::big_word >> x3::omit[x3::byte_(nullChar)], res), "Can't parse int16_t");
-    return res;
-}
-
-template<> std::uint32_t session_impl_endian<endianess_t::big_endian>::get_uint32()
-{
-    std::uint32_t res{0};
-    check_parser(x3::parse(itr, end, x3::omit[x3::byte_(4)] >> x3::big_dword >> x3::omit[x3::byte_(nullChar)], res), "Can't parse uint32_t");
-    return res;
-}
-
-template<> std::int32_t  session_impl_endian<endianess_t::big_endian>::get_int32()
-{
-    std::int32_t  res{0};
-    check_parser(x3::parse(itr, end, x3::omit[x3::byte_(4)] >> x3::big_dword >> x3::omit[x3::byte_(nullChar)], res), "Can't parse int32_t");
-
-    return res;
-}
-
-template<> std::uint64_t session_impl_endian<endianess_t::big_endian>::get_uint64()
-{
-    std::uint64_t res{0};
-    check_parser(x3::parse(itr, end,  x3::omit[x3::byte_(8)] >> x3::big_qword >>  x3::omit[x3::byte_(nullChar)], res), "Can't parse uint64_t");
-    return res;
-}
+    session_impl_varint(byte_source & src, const char nullChar, size_t ptr_size, endianess_t endianess,
+                        std::vector<std::uint64_t> && location_table)
+        : session_impl(src, nullChar, ptr_size), endianess_(endianess), location_table(std::move(location_table))
+    {
+    }
 
-template<> std::int64_t  session_impl_endian<endianess_t::big_endian>::get_int64()
-{
-    std::int64_t  res{0};
-    check_parser(x3::parse(itr, end, x3::omit[x3::byte_(8)] >> x3::big_qword >> x3::omit[x3::byte_(nullChar)], res), "Can't parse int64_t");
-    return res;
-}
+    endianess_t endianess() override {return endianess_;}
 
+    char byte(const char * msg)
+    {
+        check_parser(src.require(1u), msg);
+        auto c = src.data()[0];
+        src.consume(1u);
+        return c;
+    }
 
-template<> std::uint16_t session_impl_endian<endianess_t::little_endian>::get_uint16()
-{
-    std::uint16_t res{0};
-    check_parser(x3::parse(itr, end, x3::omit[x3::byte_(2)] >> x3::little_word >> x3::omit[x3::byte_(nullChar)], res), "Can't parse uint16_t");
+    std::uint64_t varint(const char * msg)
+    {
+        std::uint64_t value = 0u;
+        for (int shift = 0; shift < 64; shift += 7)
+        {
+            auto c = static_cast<unsigned char>(byte(msg));
+            value |= static_cast<std::uint64_t>(c & 0x7Fu) << shift;
+            if ((c & 0x80u) == 0u)
+                return value;
+        }
+        check_parser(false, msg);
+        return 0u;
+    }
 
-    return res;
-}
+    std::int64_t zigzag(const char * msg)
+    {
+        auto value = varint(msg);
+        return static_cast<std::int64_t>((value >> 1) ^ (~(value & 1u) + 1u));
+    }
 
-template<> std::int16_t  session_impl_endian<endianess_t::little_endian>::get_int16()
-{
-    std::int16_t  res{0};
-    check_parser(x3::parse(itr, end, x3::omit[x3::byte_(2)] >> x3::little_word >> x3::omit[x3::byte_(nullChar)], res), "Can't parse int16_t");
-    return res;
-}
+    std::vector<char> bytes(const char * msg)
+    {
+        auto size = varint(msg);
+        check_parser(src.require(size), msg);
+        std::vector<char> res(src.data(), src.data() + size);
+        src.consume(size);
+        return res;
+    }
 
-template<> std::uint32_t session_impl_endian<endianess_t::little_endian>::get_uint32()
-{
-    std::uint32_t res{0};
-    check_parser(x3::parse(itr, end, x3::omit[x3::byte_(4)] >> x3::little_dword >> x3::omit[x3::byte_(nullChar)], res), "Can't parse uint32_t");
-    return res;
-}
+    std::string get_str() override
+    {
+        auto raw = bytes("Failed to parse string.");
+        return std::string(raw.begin(), raw.end());
+    }
+    std::vector<char> get_raw() override {return bytes("Failed to parse raw data.");}
 
-template<> std::int32_t  session_impl_endian<endianess_t::little_endian>::get_int32()
-{
-    std::int32_t  res{0};
-    check_parser(x3::parse(itr, end, x3::omit[x3::byte_(4)] >> x3::little_dword >> x3::omit[x3::byte_(nullChar)], res), "Can't parse int32_t");
+    std::uint8_t get_uint8() override {return static_cast<std::uint8_t>(byte("Can't parse uint8_t"));}
+    std::int8_t  get_int8()  override {return static_cast<std::int8_t> (byte("Can't parse int8_t"));}
+    char         get_char()  override {return byte("Can't parse char");}
+    bool         get_bool()  override {return byte("Can't parse bool") != '\0';}
 
-    return res;
-}
+    std::uint16_t get_uint16() override {return static_cast<std::uint16_t>(varint("Can't parse uint16_t"));}
+    std::int16_t  get_int16()  override {return static_cast<std::int16_t> (zigzag("Can't parse int16_t"));}
+    std::uint32_t get_uint32() override {return static_cast<std::uint32_t>(varint("Can't parse uint32_t"));}
+    std::int32_t  get_int32()  override {return static_cast<std::int32_t> (zigzag("Can't parse int32_t"));}
+    std::uint64_t get_uint64() override {return varint("Can't parse uint64_t");}
+    std::int64_t  get_int64()  override {return zigzag("Can't parse int64_t");}
 
-template<> std::uint64_t session_impl_endian<endianess_t::little_endian>::get_uint64()
-{
-    std::uint64_t res{0};
-    check_parser(x3::parse(itr, end, x3::omit[x3::byte_(8)] >> x3::little_qword >> x3::omit[x3::byte_(nullChar)], res), "Can't parse uint64_t");
-    return res;
-}
+    std:: int64_t get_int()  override {return zigzag("Unable to read int");}
+    std::uint64_t get_uint() override {return varint("Unable to read unsigned int");}
+    std::uint64_t get_ptr()  override {return varint("Can't parse pointer");}
 
-template<> std::int64_t  session_impl_endian<endianess_t::little_endian>::get_int64()
-{
-    std::int64_t  res{0};
-    check_parser(x3::parse(itr, end, x3::omit[x3::byte_(8)] >> x3::little_qword >> x3::omit[x3::byte_(nullChar)], res), "Can't parse int64_t");
-    return res;
-}
+    std::uint64_t get_location() override
+    {
+        auto idx = varint("Can't parse location");
+        check_parser(idx < location_table.size(), "Invalid location index " + std::to_string(idx));
+        return location_table[idx];
+    }
+};
 
 void set_session_loc(std::unique_ptr<session> & session, const std::string& file_name, int line_number)
 {
@@ -515,12 +776,14 @@ void set_session_loc(std::unique_ptr<session> & session, const std::string& file
 }
 
 
-std::unique_ptr<session> build_session(iterator_t & itr, const iterator_t & end, char nullchar, int int_length,
-                                       int ptr_length, endianess_t endianess)
+std::unique_ptr<session> build_session(byte_source & src, int version, char nullchar, int int_length,
+                                       int ptr_length, endianess_t endianess, std::vector<std::uint64_t> location_table)
 {
-    if (endianess == endianess_t::little_endian)
-        return make_unique<session_impl_endian<endianess_t::little_endian>>(itr, end, nullchar, ptr_length);
+    if (version == 1)
+        return make_unique<session_impl_varint>(src, nullchar, ptr_length, endianess, std::move(location_table));
+    else if (endianess == endianess_t::little_endian)
+        return make_unique<session_impl_endian<endianess_t::little_endian>>(src, nullchar, ptr_length);
     else
-        return make_unique<session_impl_endian<endianess_t::big_endian>>(itr, end, nullchar, ptr_length);
+        return make_unique<session_impl_endian<endianess_t::big_endian>>(src, nullchar, ptr_length);
 
-}
\ No newline at end of file
+}
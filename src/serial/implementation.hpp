@@ -10,10 +10,11 @@
 
 #include <metal/serial/session.hpp>
 #include <iterator>
+#include <memory>
 #include <boost/filesystem/path.hpp>
-#include <boost/spirit/home/support/multi_pass.hpp>
 #include <boost/optional.hpp>
 #include <boost/functional/hash.hpp>
+#include "byte_source.hpp"
 
 namespace std
 {
@@ -26,21 +27,28 @@ template<> struct hash<boost::filesystem::path>
 };
 }
 
-using iterator_t = boost::spirit::multi_pass<std::istreambuf_iterator<char>>;
 struct parser_exception : std::runtime_error {using std::runtime_error::runtime_error;};
 
-bool init_session(iterator_t & itr, const iterator_t & end, char & nullchar,
+bool init_session(byte_source & src, int & version, char & nullchar,
                   int & intLength, int & ptrLength, metal::serial::endianess_t &endianess, std::uint64_t &init_loc);
 
-int run_serial(const std::string binary, const boost::filesystem::path &source_dir, const boost::filesystem::path addr2line,
-               iterator_t &itr, const iterator_t &end, char nullchar, int intLength, int ptrLength,
-               const std::unordered_map<std::string, metal::serial::plugin_function_t> &macros, std::uint64_t init_loc,
-               metal::serial::endianess_t endianess, bool ignore_exit_code);
+///The locations & sources of the binary. It's loaded once and can be used by several inputs at the same time.
+struct location_index;
 
-std::unique_ptr<metal::serial::session> build_session(iterator_t & itr, const iterator_t & end, char nullchar,
-                                                      int int_length, int ptr_length, metal::serial::endianess_t endianess);
+std::shared_ptr<location_index> load_location_index(const std::string & binary, const boost::filesystem::path & source_dir,
+                                                    const boost::filesystem::path & addr2line,
+                                                    const std::unordered_map<std::string, metal::serial::plugin_function_t> & macros);
+
+int run_serial(location_index & index, byte_source & src, int version, char nullchar, int intLength, int ptrLength,
+               std::uint64_t init_loc, metal::serial::endianess_t endianess, bool ignore_exit_code);
+
+std::unique_ptr<metal::serial::session> build_session(byte_source & src, int version, char nullchar,
+                                                      int int_length, int ptr_length, metal::serial::endianess_t endianess,
+                                                      std::vector<std::uint64_t> location_table = {});
 
 void set_session_loc(std::unique_ptr<metal::serial::session> & session, const std::string& file_name, int line_number);
 boost::optional<int> get_exited(std::unique_ptr<metal::serial::session> & session);
+///The address of the next location, written as pointer in version 0 and as index in version 1.
+std::uint64_t get_location(std::unique_ptr<metal::serial::session> & session);
 
 #endif //METAL_SERIAL_IMPLEMENTATION_HPP
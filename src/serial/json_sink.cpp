@@ -7,17 +7,12 @@
 
  */
 #include "sink.hpp"
+#include "../sink/json_stream.hpp"
 #include <iostream>
-#include <stack>
 
 #include <boost/algorithm/string/replace.hpp>
 #include <boost/optional.hpp>
 
-#include <rapidjson/rapidjson.h>
-#include <rapidjson/document.h>
-#include <rapidjson/filewritestream.h>
-#include <rapidjson/prettywriter.h>
-
 using namespace std;
 
 inline static const char* descr(level_t lvl)
@@ -33,253 +28,228 @@ inline static const char* descr(level_t lvl)
     }
 }
 
-namespace rj = rapidjson;
-
 struct json_sink_t : data_sink_t
 {
-    std::ostream * os = &std::cout;
+    metal::sink::json_stream js;
 
-    rj::Document doc;
-    std::stack<rj::Value> vals;
+    //number of open cases
+    int depth = 0;
 
-
-    rj::Value steal()
+    json_sink_t(std::ostream & os, bool ndjson) : js(os, ndjson)
     {
-        if (vals.empty())
-        {
-            rj::Value val;
-            val.SetObject();
-            return val;
-        }
-        else
-        {
-            auto val = std::move(vals.top());
-            vals.pop();
-            return val;
-        }
+        js.nested([](auto & w)
+                {
+                    w.StartObject();
+                    w.Key("content");
+                    w.StartArray();
+                });
     }
-    void repush(rj::Value && val)
+
+    template<typename Writer>
+    static void loc(Writer & w, const std::string & file, int line)
     {
-        if (vals.empty())
-        {
-            doc["content"].PushBack(std::move(val), doc.GetAllocator());
-        }
-        else
-            vals.top()["content"].PushBack(std::move(val), doc.GetAllocator());
+        w.Key("file"); w.String(boost::replace_all_copy(file, "\\\\", "\\"));
+        w.Key("line"); w.Int(line);
     }
 
-    void add_to_array(rj::Value && val)
+    template<typename Writer>
+    static void check(Writer & w, const std::string & file, int line, bool condition, level_t lvl)
     {
-        if (vals.size())
-            vals.top()["content"].GetArray().PushBack(std::move(val), doc.GetAllocator());
-        else
-        {
-            if (!doc.HasMember("content"))
-            {
-                rj::Value val;
-                val.SetArray();
-                doc.AddMember("content", std::move(val), doc.GetAllocator());
-            }
-            doc["content"].GetArray().PushBack(std::move(val), doc.GetAllocator());
-        }
+        loc(w, file, line);
+        w.Key("condition"); w.Bool(condition);
+        w.Key("lvl");       w.String(descr(lvl));
     }
 
-    rj::Value loc(const std::string & file, int line)
+    template<typename Writer>
+    static void summary(Writer & w, const char * name, int executed, int warnings, int errors)
     {
-        rj::Value val;
-        val.SetObject();
-        val.AddMember("file", boost::replace_all_copy(file, "\\\\", "\\"), doc.GetAllocator());
-        val.AddMember("line", line, doc.GetAllocator());
-        return val;
+        w.Key(name);
+        w.StartObject();
+        w.Key("executed"); w.Int(executed);
+        w.Key("warnings"); w.Int(warnings);
+        w.Key("errors");   w.Int(errors);
+        w.EndObject();
     }
 
-    rj::Value check(const std::string & file, int line, bool condition, level_t lvl)
+    ///Write a value into the content of the current case.
+    template<typename Func>
+    void entry(const char * type, Func && func)
     {
-        auto val = loc(file, line);
-        val.AddMember("condition", condition, doc.GetAllocator());
-        val.AddMember("lvl",      rj::StringRef(descr(lvl)), doc.GetAllocator());
-
-        return val;
+        js.event([&](auto & w)
+                {
+                    w.StartObject();
+                    w.Key("type"); w.String(type);
+                    func(w);
+                    w.EndObject();
+                });
     }
 
     virtual ~json_sink_t() = default;
 
     void enter_case(const std::string & file, int line, const std::string & id) override
     {
-        auto val = loc(file, line);
-        val.AddMember("type", "case", doc.GetAllocator());
-        val.AddMember("id", id, doc.GetAllocator());
-
-        rj::Value arr;
-        arr.SetArray();
-        val.AddMember("content", std::move(arr), doc.GetAllocator());
-
-        vals.emplace(std::move(val));
+        depth++;
+        if (js.ndjson())
+            entry("enter_case", [&](auto & w)
+                    {
+                        loc(w, file, line);
+                        w.Key("id"); w.String(id);
+                    });
+        else
+            js.nested([&](auto & w)
+                    {
+                        w.StartObject();
+                        loc(w, file, line);
+                        w.Key("type"); w.String("case");
+                        w.Key("id");   w.String(id);
+                        w.Key("content");
+                        w.StartArray();
+                    });
     }
     void exit_case (const std::string & file, int line, const std::string & id, int executed, int warnings, int errors) override
     {
-        auto val = steal();
-        {
-            rj::Value sum;
-            sum.SetObject();
-            sum.AddMember("executed", executed, doc.GetAllocator());
-            sum.AddMember("warnings", warnings, doc.GetAllocator());
-            sum.AddMember("errors",   errors  , doc.GetAllocator());
-            val.AddMember("summary", std::move(sum), doc.GetAllocator());
-        }
-        val.AddMember("result", "exit", doc.GetAllocator());
-        //   add_to_array(std::move(val));
-
-        repush(std::move(val));
+        if (js.ndjson())
+            entry("exit_case", [&](auto & w)
+                    {
+                        summary(w, "summary", executed, warnings, errors);
+                        w.Key("result"); w.String("exit");
+                    });
+        else
+            js.nested([&](auto & w)
+                    {
+                        if (depth > 0)
+                            w.EndArray();
+                        else
+                            w.StartObject();
+                        summary(w, "summary", executed, warnings, errors);
+                        w.Key("result"); w.String("exit");
+                        w.EndObject();
+                    });
+        if (depth > 0)
+            depth--;
     }
     void report (int free_executed, int free_warnings, int free_errors,
                  int executed, int warnings, int errors) override
     {
-        if (free_executed)
-        {
-            rj::Value val;
-            val.SetObject();
-            val.AddMember("executed", free_executed, doc.GetAllocator());
-            val.AddMember("warnings", free_warnings, doc.GetAllocator());
-            val.AddMember("errors",   free_errors  , doc.GetAllocator());
+        auto impl = [&](auto & w)
+                {
+                    if (free_executed)
+                        summary(w, "free_tests", free_executed, free_warnings, free_errors);
+                    summary(w, "summary", executed, warnings, errors);
+                };
 
-            doc.AddMember("free_tests", std::move(val), doc.GetAllocator());
-        }
-
-        {
-            rj::Value val;
-            val.SetObject();
-            val.AddMember("executed", executed, doc.GetAllocator());
-            val.AddMember("warnings", warnings, doc.GetAllocator());
-            val.AddMember("errors",   errors  , doc.GetAllocator());
-
-            doc.AddMember("summary", std::move(val), doc.GetAllocator());
-        }
-        rj::StringBuffer buffer;
-        rj::PrettyWriter<rapidjson::StringBuffer> writer(buffer);
-
-        doc.Accept(writer);
-        *os << buffer.GetString() << std::endl;
+        if (js.ndjson())
+            entry("report", impl);
+        else
+            js.nested([&](auto & w)
+                    {
+                        for (; depth > 0; depth--)
+                        {
+                            w.EndArray();
+                            w.EndObject();
+                        }
+                        w.EndArray();
+                        impl(w);
+                        w.EndObject();
+                    });
+        js.flush();
     }
 
     void log        (const std::string & file, int line, const std::string & message) override
     {
-        auto val = loc(file, line);
-        val.AddMember("type", "message",  doc.GetAllocator());
-        val.AddMember("message", message, doc.GetAllocator());
-        add_to_array(std::move(val));
-
+        entry("message", [&](auto & w)
+                {
+                    loc(w, file, line);
+                    w.Key("message"); w.String(message);
+                });
     }
     void checkpoint (const std::string & file, int line) override
     {
-        auto val = loc(file, line);
-        val.AddMember("type", "checkpoint", doc.GetAllocator());
-        add_to_array(std::move(val));
+        entry("checkpoint", [&](auto & w){ loc(w, file, line); });
     }
 
     void message(const std::string & file, int line, bool condition, level_t lvl, const std::string & message) override
     {
-        auto val = check(file, line, condition, lvl);
-        val.AddMember("type",  "message",  doc.GetAllocator());
-        val.AddMember("message",  message, doc.GetAllocator());
-        add_to_array(std::move(val));
+        entry("message", [&](auto & w)
+                {
+                    check(w, file, line, condition, lvl);
+                    w.Key("message"); w.String(message);
+                });
     }
     void plain  (const std::string & file, int line, bool condition, level_t lvl, const std::string & message) override
     {
-        auto val = check(file, line, condition, lvl);
-        val.AddMember("type",    "plain",  doc.GetAllocator());
-        val.AddMember("message",  message, doc.GetAllocator());
-        add_to_array(std::move(val));
+        entry("plain", [&](auto & w)
+                {
+                    check(w, file, line, condition, lvl);
+                    w.Key("message"); w.String(message);
+                });
+    }
+
+    void comparison(const char * type, const std::string & file, int line, bool condition, level_t lvl,
+                    const std::string & lhs, const std::string &rhs, const std::string & lhs_val, const std::string & rhs_val)
+    {
+        entry(type, [&](auto & w)
+                {
+                    check(w, file, line, condition, lvl);
+                    w.Key("lhs");     w.String(lhs);
+                    w.Key("rhs");     w.String(rhs);
+                    w.Key("lhs_val"); w.String(lhs_val);
+                    w.Key("rhs_val"); w.String(rhs_val);
+                });
     }
 
     void equal     (const std::string & file, int line, bool condition, level_t lvl,
                     const std::string & lhs, const std::string &rhs, const std::string & lhs_val, const std::string & rhs_val) override
     {
-        auto val = check(file, line, condition, lvl);
-        val.AddMember("type", "equal",  doc.GetAllocator());
-        val.AddMember("lhs",        lhs,       doc.GetAllocator());
-        val.AddMember("rhs",        rhs,       doc.GetAllocator());
-        val.AddMember("lhs_val",    lhs_val,       doc.GetAllocator());
-        val.AddMember("rhs_val",    rhs_val,       doc.GetAllocator());
-        add_to_array(std::move(val));
+        comparison("equal", file, line, condition, lvl, lhs, rhs, lhs_val, rhs_val);
     }
 
     void not_equal (const std::string & file, int line, bool condition, level_t lvl,
                     const std::string & lhs, const std::string &rhs, const std::string & lhs_val, const std::string & rhs_val) override
     {
-        auto val = check(file, line, condition, lvl);
-        val.AddMember("type", "not_equal",  doc.GetAllocator());
-        val.AddMember("lhs",       lhs,       doc.GetAllocator());
-        val.AddMember("rhs",       rhs,       doc.GetAllocator());
-        val.AddMember("lhs_val",   lhs_val,       doc.GetAllocator());
-        val.AddMember("rhs_val",   rhs_val,       doc.GetAllocator());
-        add_to_array(std::move(val));
+        comparison("not_equal", file, line, condition, lvl, lhs, rhs, lhs_val, rhs_val);
     }
 
     void ge        (const std::string & file, int line, bool condition, level_t lvl,
                     const std::string & lhs, const std::string &rhs, const std::string & lhs_val, const std::string & rhs_val) override
     {
-        auto val = check(file, line, condition, lvl);
-        val.AddMember("type", "ge",  doc.GetAllocator());
-        val.AddMember("lhs",       lhs,       doc.GetAllocator());
-        val.AddMember("rhs",       rhs,       doc.GetAllocator());
-        val.AddMember("lhs_val",       lhs_val,       doc.GetAllocator());
-        val.AddMember("rhs_val",       rhs_val,       doc.GetAllocator());
-        add_to_array(std::move(val));
+        comparison("ge", file, line, condition, lvl, lhs, rhs, lhs_val, rhs_val);
     }
 
     void greater   (const std::string & file, int line, bool condition, level_t lvl,
                     const std::string & lhs, const std::string &rhs, const std::string & lhs_val, const std::string & rhs_val) override
     {
-        auto val = check(file, line, condition, lvl);
-        val.AddMember("type", "greater",  doc.GetAllocator());
-        val.AddMember("lhs",       lhs,       doc.GetAllocator());
-        val.AddMember("rhs",       rhs,       doc.GetAllocator());
-        val.AddMember("lhs_val",       lhs_val,       doc.GetAllocator());
-        val.AddMember("rhs_val",       rhs_val,       doc.GetAllocator());
-        add_to_array(std::move(val));
+        comparison("greater", file, line, condition, lvl, lhs, rhs, lhs_val, rhs_val);
     }
 
     void le        (const std::string & file, int line, bool condition, level_t lvl,
                     const std::string & lhs, const std::string &rhs, const std::string & lhs_val, const std::string & rhs_val) override
     {
-        auto val = check(file, line, condition, lvl);
-        val.AddMember("type", "le",  doc.GetAllocator());
-        val.AddMember("lhs",       lhs,       doc.GetAllocator());
-        val.AddMember("rhs",       rhs,       doc.GetAllocator());
-        val.AddMember("lhs_val",       lhs_val,       doc.GetAllocator());
-        val.AddMember("rhs_val",       rhs_val,       doc.GetAllocator());
-        add_to_array(std::move(val));
+        comparison("le", file, line, condition, lvl, lhs, rhs, lhs_val, rhs_val);
     }
 
     void lesser    (const std::string & file, int line, bool condition, level_t lvl,
                     const std::string & lhs, const std::string &rhs, const std::string & lhs_val, const std::string & rhs_val) override
     {
-        auto val = check(file, line, condition, lvl);
-        val.AddMember("type", "lesser",  doc.GetAllocator());
-        val.AddMember("lhs",       lhs,       doc.GetAllocator());
-        val.AddMember("rhs",       rhs,       doc.GetAllocator());
-        val.AddMember("lhs_val",       lhs_val,       doc.GetAllocator());
-        val.AddMember("rhs_val",       rhs_val,       doc.GetAllocator());
-        add_to_array(std::move(val));
+        comparison("lesser", file, line, condition, lvl, lhs, rhs, lhs_val, rhs_val);
     }
 
     void no_execute   (const std::string & file, int line, level_t lvl) override
     {
-        auto val = check(file, line, false, lvl);
-        val.AddMember("type", "no_execute_check", doc.GetAllocator());
-
-        add_to_array(std::move(val));
+        entry("no_execute_check", [&](auto & w){ check(w, file, line, false, lvl); });
     }
 };
 
 
 boost::optional<json_sink_t> json_sink;
 
-data_sink_t * serial_get_json_sink(std::ostream & os)
+data_sink_t * serial_get_json_sink(std::ostream & os, bool ndjson)
 {
-    json_sink.emplace();
-    json_sink->os = &os;
-    json_sink->doc.SetObject();
+    json_sink.emplace(os, ndjson);
     return &*json_sink;
-}
\ No newline at end of file
+}
+
+std::unique_ptr<data_sink_t> serial_make_json_sink(std::ostream & os, bool ndjson)
+{
+    return std::make_unique<json_sink_t>(os, ndjson);
+}
@@ -0,0 +1,184 @@
+/**
+ * @file   serial/live_input.cpp
+ * @date   19.10.2026
+ * @author Klemens D. Morgenstern
+ *
+ */
+
+#include "live_input.hpp"
+#include "byte_source.hpp"
+
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/serial_port.hpp>
+
+#if !defined(BOOST_WINDOWS_API)
+#include <boost/asio/posix/stream_descriptor.hpp>
+#include <fcntl.h>
+#endif
+
+#include <iostream>
+#include <stdexcept>
+
+namespace asio = boost::asio;
+
+live_input::live_input(std::chrono::milliseconds timeout) : _buffer(byte_source::block_size), _timeout(timeout)
+{
+}
+
+bool live_input::_run_with_timeout(const std::function<void(std::function<void()>)> & start)
+{
+    bool timed_out = false;
+    start([this]{_timer.cancel();});
+
+    if (_timeout.count() > 0)
+    {
+        _timer.expires_from_now(_timeout);
+        _timer.async_wait([&](const boost::system::error_code & ec)
+                          {
+                              if (!ec)
+                              {
+                                  timed_out = true;
+                                  _cancel();
+                              }
+                          });
+    }
+
+    _io_service.reset();
+    _io_service.run();
+    return !timed_out;
+}
+
+live_input::int_type live_input::underflow()
+{
+    if (_eof)
+        return traits_type::eof();
+
+    boost::system::error_code ec;
+    std::size_t size = 0u;
+    auto completed = _run_with_timeout(
+            [&](std::function<void()> done)
+            {
+                _async_read_some(_buffer.data(), _buffer.size(),
+                        [&, done](const boost::system::error_code & ec_, std::size_t size_)
+                        {
+                            ec = ec_;
+                            size = size_;
+                            done();
+                        });
+            });
+
+    //data that arrived together with the timeout is still used.
+    if (size == 0u)
+    {
+        _eof = true;
+        if (!completed)
+            std::cerr << "No input received for " << _timeout.count() << "ms" << std::endl;
+        else if (ec && (ec != asio::error::eof))
+            std::cerr << "Error reading the input: " << ec.message() << std::endl;
+        return traits_type::eof();
+    }
+
+    setg(_buffer.data(), _buffer.data(), _buffer.data() + size);
+    return traits_type::to_int_type(*gptr());
+}
+
+namespace
+{
+
+template<typename Stream>
+struct live_stream : live_input
+{
+    Stream stream{_io_service};
+
+    using live_input::live_input;
+
+    void _async_read_some(char * data, std::size_t size, read_handler handler) override
+    {
+        stream.async_read_some(asio::buffer(data, size), std::move(handler));
+    }
+
+    void _cancel() override
+    {
+        boost::system::error_code ec;
+        stream.cancel(ec);
+    }
+};
+
+struct tcp_input final : live_stream<asio::ip::tcp::socket>
+{
+    asio::ip::tcp::acceptor acceptor{_io_service};
+
+    using live_stream<asio::ip::tcp::socket>::live_stream;
+
+    void _cancel() override
+    {
+        boost::system::error_code ec;
+        if (acceptor.is_open())
+            acceptor.cancel(ec);
+        live_stream<asio::ip::tcp::socket>::_cancel();
+    }
+
+    void accept(unsigned short port)
+    {
+        acceptor.open(asio::ip::tcp::v4());
+        acceptor.set_option(asio::ip::tcp::acceptor::reuse_address(true));
+        acceptor.bind({asio::ip::address_v4::loopback(), port});
+        acceptor.listen(1);
+
+        boost::system::error_code ec;
+        auto completed = _run_with_timeout(
+                [&](std::function<void()> done)
+                {
+                    acceptor.async_accept(stream,
+                            [&, done](const boost::system::error_code & ec_)
+                            {
+                                ec = ec_;
+                                done();
+                            });
+                });
+
+        if (!completed && !stream.is_open())
+            throw std::runtime_error("No connection on port " + std::to_string(port) + " within "
+                                     + std::to_string(timeout().count()) + "ms");
+        if (ec)
+            throw boost::system::system_error(ec, "accept on port " + std::to_string(port));
+
+        //only one target connects, so the port is free again.
+        acceptor.close();
+    }
+};
+
+}
+
+std::unique_ptr<live_input> open_serial_port(const std::string & device, unsigned int baud_rate,
+                                             std::chrono::milliseconds timeout)
+{
+    auto in = std::make_unique<live_stream<asio::serial_port>>(timeout);
+    //the port is put into raw mode, so the binary data passes unaltered.
+    in->stream.open(device);
+    if (baud_rate != 0u)
+        in->stream.set_option(asio::serial_port::baud_rate(baud_rate));
+    return in;
+}
+
+#if !defined(BOOST_WINDOWS_API)
+
+std::unique_ptr<live_input> open_fifo(const boost::filesystem::path & path, std::chrono::milliseconds timeout)
+{
+    auto fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        throw boost::system::system_error(errno, boost::system::system_category(), "open " + path.string());
+
+    auto in = std::make_unique<live_stream<asio::posix::stream_descriptor>>(timeout);
+    in->stream.assign(fd);
+    return in;
+}
+
+#endif
+
+std::unique_ptr<live_input> listen_tcp(unsigned short port, std::chrono::milliseconds timeout)
+{
+    auto in = std::make_unique<tcp_input>(timeout);
+    in->accept(port);
+    return in;
+}
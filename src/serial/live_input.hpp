@@ -0,0 +1,65 @@
+/**
+ * @file   serial/live_input.hpp
+ * @date   19.10.2026
+ * @author Klemens D. Morgenstern
+ *
+ *
+
+ Live inputs of metal.serial, i.e. a serial device (or pty), a named pipe or a local tcp port (e.g. qemu's `-serial tcp:`).
+ They are streambufs, so the byte_source reads them like stdin, but every read returns what has arrived so far.
+
+ The input ends at the end of the stream or, if a timeout is set, when no data arrived in that time.
+
+ */
+
+#ifndef METAL_SERIAL_LIVE_INPUT_HPP
+#define METAL_SERIAL_LIVE_INPUT_HPP
+
+#include <boost/asio/io_service.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <boost/filesystem/path.hpp>
+#include <boost/system/error_code.hpp>
+
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <streambuf>
+#include <string>
+#include <vector>
+
+class live_input : public std::streambuf
+{
+    std::vector<char> _buffer;
+    std::chrono::milliseconds _timeout;
+    bool _eof = false;
+protected:
+    boost::asio::io_service _io_service;
+    boost::asio::steady_timer _timer{_io_service};
+
+    using read_handler = std::function<void(const boost::system::error_code &, std::size_t)>;
+
+    virtual void _async_read_some(char * data, std::size_t size, read_handler handler) = 0;
+    virtual void _cancel() = 0;
+
+    ///Runs the io_service until the operation started by `start` is done or the timeout expired, false for the latter.
+    bool _run_with_timeout(const std::function<void(std::function<void()>)> & start);
+
+    int_type underflow() override;
+public:
+    explicit live_input(std::chrono::milliseconds timeout);
+    virtual ~live_input() = default;
+
+    std::chrono::milliseconds timeout() const {return _timeout;}
+};
+
+///Opens a serial device with the given baud rate, 0 keeps the configuration of the device.
+std::unique_ptr<live_input> open_serial_port(const std::string & device, unsigned int baud_rate,
+                                             std::chrono::milliseconds timeout);
+#if !defined(BOOST_WINDOWS_API)
+///Opens a named pipe, this waits for the writing side.
+std::unique_ptr<live_input> open_fifo(const boost::filesystem::path & path, std::chrono::milliseconds timeout);
+#endif
+///Waits for one connection on the port of the loopback interface.
+std::unique_ptr<live_input> listen_tcp(unsigned short port, std::chrono::milliseconds timeout);
+
+#endif //METAL_SERIAL_LIVE_INPUT_HPP
@@ -0,0 +1,254 @@
+/**
+ * @file   serial/profile_functions.cpp
+ * @date   19.10.2026
+ * @author Klemens D. Morgenstern
+ *
+ */
+
+#include "profile_functions.hpp"
+#include "../sink/call_graph.hpp"
+#include "../sink/json_stream.hpp"
+
+#include <boost/optional.hpp>
+#include <boost/program_options.hpp>
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <limits>
+#include <mutex>
+
+inline namespace serial_profile_globals
+{
+    std::string profile_sink_file;
+    std::string profile_format;
+}
+
+namespace
+{
+
+struct region_stats
+{
+    std::string name;
+    //every duration is kept for the percentiles.
+    std::vector<std::uint64_t> durations;
+    std::uint64_t total = 0u;
+    std::uint64_t min = std::numeric_limits<std::uint64_t>::max();
+    std::uint64_t max = 0u;
+
+    void add(std::uint64_t duration)
+    {
+        durations.push_back(duration);
+        total += duration;
+        min = std::min(min, duration);
+        max = std::max(max, duration);
+    }
+};
+
+struct open_region
+{
+    std::size_t node;
+    std::uint64_t children;
+};
+
+//the regions of all inputs are merged, so they're guarded by a mutex.
+std::mutex profile_mutex;
+std::vector<region_stats> regions;
+std::unordered_map<std::string, std::size_t> region_ids;
+metal::sink::call_graph graph{"metal.serial"};
+
+thread_local std::vector<open_region> open_regions;
+
+std::size_t region_id(const std::string & name)
+{
+    auto itr = region_ids.find(name);
+    if (itr != region_ids.end())
+        return itr->second;
+
+    auto id = regions.size();
+    regions.emplace_back();
+    regions.back().name = name;
+    region_ids.emplace(name, id);
+    graph.set_name(id, name);
+    return id;
+}
+
+void begin_region(const std::string & name)
+{
+    std::lock_guard<std::mutex> lock{profile_mutex};
+    auto id = region_id(name);
+    auto node = graph.child(open_regions.empty() ? graph.root : open_regions.back().node, id);
+    graph[node].calls++;
+    open_regions.push_back({node, 0u});
+}
+
+void end_region(const std::string & name, std::uint64_t duration, const std::string & file, int line)
+{
+    std::lock_guard<std::mutex> lock{profile_mutex};
+    auto id = region_id(name);
+    regions[id].add(duration);
+
+    auto itr = std::find_if(open_regions.rbegin(), open_regions.rend(),
+                            [&](const open_region & reg){return graph[reg.node].fn == id;});
+    if (itr == open_regions.rend())
+    {
+        std::cerr << file << "(" << line << ") end of profile region " << name << " without a begin" << std::endl;
+        return;
+    }
+
+    //regions above it were not ended, so they're closed without a duration.
+    open_regions.erase(itr.base(), open_regions.end());
+    auto reg = open_regions.back();
+    open_regions.pop_back();
+
+    graph[reg.node].add(duration, duration - std::min(duration, reg.children));
+    if (!open_regions.empty())
+        open_regions.back().children += duration;
+}
+
+//nearest rank of the sorted durations
+std::uint64_t percentile(const std::vector<std::uint64_t> & sorted, unsigned int pct)
+{
+    if (sorted.empty())
+        return 0u;
+    auto rank = (sorted.size() * pct + 99u) / 100u;
+    return sorted[std::max<std::size_t>(rank, 1u) - 1u];
+}
+
+struct region_summary
+{
+    const region_stats * stats;
+    std::uint64_t mean, p50, p90, p99;
+};
+
+std::vector<region_summary> summarize()
+{
+    std::vector<region_summary> res;
+    for (auto & reg : regions)
+    {
+        auto sorted = reg.durations;
+        std::sort(sorted.begin(), sorted.end());
+        res.push_back({&reg, sorted.empty() ? 0u : reg.total / sorted.size(),
+                       percentile(sorted, 50u), percentile(sorted, 90u), percentile(sorted, 99u)});
+    }
+    //the most time first.
+    std::stable_sort(res.begin(), res.end(),
+                     [](const region_summary & lhs, const region_summary & rhs){return lhs.stats->total > rhs.stats->total;});
+    return res;
+}
+
+void write_report(std::ostream & os)
+{
+    fmt::memory_buffer buf;
+    auto out = std::back_inserter(buf);
+    fmt::format_to(out, "metal.serial profile of {} regions, in timestamp ticks\n", regions.size());
+    fmt::format_to(out, "{:>10} {:>14} {:>10} {:>10} {:>10} {:>10} {:>10} {:>10}  {}\n",
+                   "count", "total", "min", "mean", "p50", "p90", "p99", "max", "region");
+    for (auto & rs : summarize())
+    {
+        auto & reg = *rs.stats;
+        fmt::format_to(out, "{:>10} {:>14} {:>10} {:>10} {:>10} {:>10} {:>10} {:>10}  {}\n",
+                       reg.durations.size(), reg.total, reg.durations.empty() ? 0u : reg.min, rs.mean,
+                       rs.p50, rs.p90, rs.p99, reg.max, reg.name);
+    }
+    os.write(buf.data(), buf.size());
+}
+
+void write_json(std::ostream & os)
+{
+    metal::sink::json_stream js(os, false);
+    js.nested([&](auto & w)
+            {
+                w.StartObject();
+                w.Key("regions");
+                w.StartArray();
+                for (auto & rs : summarize())
+                {
+                    auto & reg = *rs.stats;
+                    w.StartObject();
+                    w.Key("region"); w.String(reg.name);
+                    w.Key("count");  w.Uint64(reg.durations.size());
+                    w.Key("total");  w.Uint64(reg.total);
+                    w.Key("min");    w.Uint64(reg.durations.empty() ? 0u : reg.min);
+                    w.Key("mean");   w.Uint64(rs.mean);
+                    w.Key("p50");    w.Uint64(rs.p50);
+                    w.Key("p90");    w.Uint64(rs.p90);
+                    w.Key("p99");    w.Uint64(rs.p99);
+                    w.Key("max");    w.Uint64(reg.max);
+                    w.EndObject();
+                }
+                w.EndArray();
+                w.EndObject();
+            });
+}
+
+}
+
+void metal_serial_profile_begin(metal::serial::session& session, const std::vector<std::string> & args, const std::string & file, int line)
+{
+    begin_region(args.at(0));
+}
+
+void metal_serial_profile_end(metal::serial::session& session, const std::vector<std::string> & args, const std::string & file, int line)
+{
+    end_region(args.at(0), session.get_uint(), file, line);
+}
+
+void metal_serial_profile_scope(metal::serial::session& session, const std::vector<std::string> & args, const std::string & file, int line)
+{
+    bool enter = session.get_bool(); //true == entering, false == leaving
+    if (enter)
+        begin_region(args.at(0));
+    else
+        end_region(args.at(0), session.get_uint(), file, line);
+}
+
+void metal_serial_profile_setup_entries(std::unordered_map<std::string,metal::serial::plugin_function_t> & map)
+{
+    graph.ticks = true;
+    graph.addresses = false;
+
+    map.emplace("METAL_SERIAL_PROFILE_BEGIN", &metal_serial_profile_begin);
+    map.emplace("METAL_SERIAL_PROFILE_END",   &metal_serial_profile_end);
+    map.emplace("METAL_SERIAL_PROFILE_SCOPE", &metal_serial_profile_scope);
+}
+
+void metal_serial_profile_begin_stream()
+{
+    open_regions.clear();
+}
+
+void metal_serial_profile_write()
+{
+    if (regions.empty() && profile_sink_file.empty() && profile_format.empty())
+        return;
+
+    boost::optional<std::ofstream> fstr;
+    std::ostream * os = &std::cout;
+    if (!profile_sink_file.empty())
+    {
+        fstr.emplace(profile_sink_file);
+        os = &*fstr;
+    }
+
+    if (profile_format.empty() || (profile_format == "hrf"))
+        write_report(*os);
+    else if (profile_format == "json")
+        write_json(*os);
+    else if (profile_format == "folded")
+        graph.write_folded(*os);
+    else
+        std::cerr << "Unknown profile format \"" << profile_format << "\"" << std::endl;
+    os->flush();
+}
+
+void metal_serial_profile_setup_options(boost::program_options::options_description & op)
+{
+    namespace po = boost::program_options;
+    op.add_options()
+            ("metal-profile-sink",   po::value<std::string>(&profile_sink_file), "profile output, written at the end")
+            ("metal-profile-format", po::value<std::string>(&profile_format),    "profile format [hrf, json, folded]. folded is the input of flamegraph.pl")
+            ;
+}
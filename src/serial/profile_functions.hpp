@@ -0,0 +1,25 @@
+/**
+ * @file   serial/profile_functions.hpp
+ * @date   19.10.2026
+ * @author Klemens D. Morgenstern
+ *
+
+ The host side of the METAL_SERIAL_PROFILE macros. The durations are aggregated per region (i.e. by name) and
+ the nesting of the regions is kept as call tree, which is written at the end of the run.
+
+ */
+
+#ifndef METAL_SERIAL_PROFILE_FUNCTIONS_HPP
+#define METAL_SERIAL_PROFILE_FUNCTIONS_HPP
+
+#include <metal/serial/session.hpp>
+
+void metal_serial_profile_setup_entries(std::unordered_map<std::string,metal::serial::plugin_function_t> & map);
+void metal_serial_profile_setup_options(boost::program_options::options_description & po);
+
+///The regions of all inputs are aggregated, but every input has its own stack of open regions.
+void metal_serial_profile_begin_stream();
+///Writes the profile, if any region was recorded or an output was requested.
+void metal_serial_profile_write();
+
+#endif //METAL_SERIAL_PROFILE_FUNCTIONS_HPP
@@ -9,6 +9,8 @@
 #ifndef SERIAL_SINK_HPP_
 #define SERIAL_SINK_HPP_
 
+#include "../sink/hrf_stream.hpp"
+#include <memory>
 #include <ostream>
 
 enum class level_t
@@ -19,6 +21,8 @@ enum class level_t
 
 struct data_sink_t
 {
+    virtual ~data_sink_t() = default;
+
     virtual void enter_case(const std::string & file, int line, const std::string & id) = 0;
     virtual void exit_case (const std::string & file, int line, const std::string & id, int executed, int warnings, int errors) = 0;
 
@@ -52,8 +56,12 @@ struct data_sink_t
     virtual void no_execute   (const std::string & file, int line, level_t lvl) = 0;
 };
 
-data_sink_t * serial_get_hrf_sink (std::ostream & os);
-data_sink_t * serial_get_json_sink(std::ostream & os);
+data_sink_t * serial_get_hrf_sink (std::ostream & os, const metal::sink::hrf_options & options = {});
+data_sink_t * serial_get_json_sink(std::ostream & os, bool ndjson = false);
+
+///A sink owned by the caller, i.e. one for every input if several are decoded at once.
+std::unique_ptr<data_sink_t> serial_make_hrf_sink (std::ostream & os, const metal::sink::hrf_options & options = {});
+std::unique_ptr<data_sink_t> serial_make_json_sink(std::ostream & os, bool ndjson = false);
 
 
 #endif /* SINK_HPP_ */
@@ -21,7 +21,10 @@ inline namespace serial_test_globals
     bool no_exit_code{false};
     std::ostream *sink_str = &std::cout;
     bool state{true};
-    data_sink_t *data_sink = nullptr;
+    //every thread decoding an input has its own
+    thread_local data_sink_t *data_sink = nullptr;
+    metal::sink::hrf_options hrf_options;
+    int flush_interval = 100;
 }
 struct statistic
 {
@@ -30,9 +33,10 @@ struct statistic
     int warnings = 0;
 };
 
-static statistic free_tests;
-static statistic all_tests;
-static std::stack<std::pair<std::string, statistic>> current_test_cases;
+static thread_local statistic free_tests;
+static thread_local statistic all_tests;
+static thread_local std::stack<std::pair<std::string, statistic>> current_test_cases;
+static thread_local std::unique_ptr<data_sink_t> stream_sink;
 
 static void add_assertion(bool condition)
 {
@@ -235,11 +239,21 @@ void metal_serial_test_setup_entries(std::unordered_map<std::string,metal::seria
         assert(fstr);
     }
 
+    hrf_options.flush_interval = std::chrono::milliseconds(flush_interval);
+    //the printf output goes to std::cout directly, so the test output must not be held back.
+    if (sink_str == &std::cout)
+    {
+        hrf_options.flush_size = 0;
+        hrf_options.writer_thread = false;
+    }
+
     //ok, we setup the logger
     if (format.empty() || (format == "hrf"))
-        data_sink = serial_get_hrf_sink(*sink_str);
+        data_sink = serial_get_hrf_sink(*sink_str, hrf_options);
     else if (format == "json")
         data_sink = serial_get_json_sink(*sink_str);
+    else if (format == "ndjson")
+        data_sink = serial_get_json_sink(*sink_str, true);
     else
         std::cerr << "Unknown format \"" << format << "\"" << std::endl;
 
@@ -269,12 +283,49 @@ void metal_serial_test_setup_entries(std::unordered_map<std::string,metal::seria
 
 }
 
+void metal_serial_test_begin_stream(std::ostream & os)
+{
+    free_tests = statistic{};
+    all_tests  = statistic{};
+    current_test_cases = {};
+
+    //the printf output goes into the same stream, so the test output must not be held back.
+    auto options = hrf_options;
+    options.flush_size = 0;
+    options.writer_thread = false;
+
+    if (format == "json")
+        stream_sink = serial_make_json_sink(os);
+    else if (format == "ndjson")
+        stream_sink = serial_make_json_sink(os, true);
+    else
+        stream_sink = serial_make_hrf_sink(os, options);
+    data_sink = stream_sink.get();
+}
+
+metal_serial_test_summary metal_serial_test_end_stream()
+{
+    data_sink = nullptr;
+    stream_sink.reset();
+
+    metal_serial_test_summary summary;
+    summary.executed = all_tests.executed;
+    summary.errors   = all_tests.errors;
+    summary.warnings = all_tests.warnings;
+    return summary;
+}
+
 void metal_serial_test_setup_options(boost::program_options::options_description & op)
 {
     namespace po = boost::program_options;
     op.add_options()
             ("metal-test-no-exit-code", po::bool_switch(&no_exit_code),      "disable exit-code")
             ("metal-test-sink",         po::value<std::string>(&sink_file),  "test data sink")
-            ("metal-test-format",       po::value<std::string>(&format),     "format [hrf, json]")
+            ("metal-test-format",       po::value<std::string>(&format),     "format [hrf, json, ndjson]")
+            ("metal-test-flush-size",     po::value<std::size_t>(&hrf_options.flush_size)->default_value(hrf_options.flush_size),
+                                          "size of the hrf output buffer in bytes, if written to a file")
+            ("metal-test-flush-interval", po::value<int>(&flush_interval)->default_value(flush_interval),
+                                          "interval in ms after which buffered hrf output is written, 0 writes every line")
+            ("metal-test-output-thread",  po::bool_switch(&hrf_options.writer_thread), "write the hrf output from a separate thread")
             ;
 }
@@ -9,9 +9,21 @@
 #define METAL_SERIAL_TEST_FUNCTIONS_HPP
 
 #include <metal/serial/session.hpp>
+#include <ostream>
 
 void metal_serial_test_setup_entries(std::unordered_map<std::string,metal::serial::plugin_function_t> & map);
 void metal_serial_test_setup_options(boost::program_options::options_description & po);
 
+struct metal_serial_test_summary
+{
+    int executed = 0;
+    int errors   = 0;
+    int warnings = 0;
+};
+
+///Several inputs are decoded by a thread each, every one with its own sink in the configured format & statistic.
+void metal_serial_test_begin_stream(std::ostream & os);
+metal_serial_test_summary metal_serial_test_end_stream();
+
 
 #endif //METAL_SERIAL_TEST_FUNCTIONS_HPP
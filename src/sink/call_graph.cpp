@@ -0,0 +1,188 @@
+/**
+ * @file   sink/call_graph.cpp
+ * @date   19.10.2026
+ * @author Klemens D. Morgenstern
+ *
+
+ */
+
+#include "call_graph.hpp"
+#include "json_stream.hpp"
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <iterator>
+
+namespace metal { namespace sink {
+
+constexpr std::size_t call_graph::root;
+
+std::size_t call_graph::child(std::size_t parent, std::uint64_t fn)
+{
+    auto itr = _nodes[parent].children.find(fn);
+    if (itr != _nodes[parent].children.end())
+        return itr->second;
+
+    auto idx = _nodes.size();
+    _nodes[parent].children.emplace(fn, idx);
+    _nodes.emplace_back(fn, parent);
+    return idx;
+}
+
+void call_graph::set_name(std::uint64_t fn, const std::string & name)
+{
+    if (_names.count(fn) == 0)
+        _names.emplace(fn, name);
+}
+
+const std::string & call_graph::name(std::uint64_t fn)
+{
+    auto itr = _names.find(fn);
+    if (itr == _names.end())
+        itr = _names.emplace(fn, fmt::format("0x{:x}", fn)).first;
+    return itr->second;
+}
+
+bool call_graph::_recursive(std::size_t idx) const
+{
+    auto fn = _nodes[idx].fn;
+    for (auto p = _nodes[idx].parent; p != root; p = _nodes[p].parent)
+        if (_nodes[p].fn == fn)
+            return true;
+    return false;
+}
+
+std::map<std::uint64_t, call_graph::function_stats> call_graph::functions() const
+{
+    std::map<std::uint64_t, function_stats> res;
+    for (auto idx = 1u; idx < _nodes.size(); idx++)
+    {
+        auto & nd = _nodes[idx];
+        auto & fs = res[nd.fn];
+        fs.calls += nd.calls;
+        fs.exclusive += nd.exclusive;
+        //the time of recursive calls is already included in the outermost one.
+        if (!_recursive(idx))
+            fs.inclusive += nd.inclusive;
+        fs.min = std::min(fs.min, nd.min);
+        fs.max = std::max(fs.max, nd.max);
+    }
+    return res;
+}
+
+std::map<std::pair<std::uint64_t, std::uint64_t>, call_graph::edge_stats> call_graph::edges() const
+{
+    std::map<std::pair<std::uint64_t, std::uint64_t>, edge_stats> res;
+    for (auto idx = 1u; idx < _nodes.size(); idx++)
+    {
+        auto & nd = _nodes[idx];
+        if (nd.parent == root)
+            continue;
+        auto & es = res[{_nodes[nd.parent].fn, nd.fn}];
+        es.calls += nd.calls;
+        es.inclusive += nd.inclusive;
+    }
+    return res;
+}
+
+void call_graph::write_folded(std::ostream & os)
+{
+    //the paths are built from the parents, which are always before the child.
+    std::vector<std::string> paths(_nodes.size());
+    fmt::memory_buffer buf;
+    for (auto idx = 1u; idx < _nodes.size(); idx++)
+    {
+        auto & nd = _nodes[idx];
+        auto nm = name(nd.fn);
+        std::replace(nm.begin(), nm.end(), ';', ':');
+        paths[idx] = (nd.parent == root) ? nm : (paths[nd.parent] + ";" + nm);
+
+        if (_weight(nd) > 0u)
+            fmt::format_to(std::back_inserter(buf), "{} {}\n", paths[idx], _weight(nd));
+    }
+    os.write(buf.data(), buf.size());
+}
+
+void call_graph::write_report(std::ostream & os)
+{
+    auto fns = functions();
+    std::vector<std::pair<std::uint64_t, function_stats>> sorted(fns.begin(), fns.end());
+    std::stable_sort(sorted.begin(), sorted.end(),
+            [&](const std::pair<std::uint64_t, function_stats> & lhs, const std::pair<std::uint64_t, function_stats> & rhs)
+            {
+                return ticks ? (lhs.second.exclusive > rhs.second.exclusive) : (lhs.second.calls > rhs.second.calls);
+            });
+
+    fmt::memory_buffer buf;
+    auto out = std::back_inserter(buf);
+    fmt::format_to(out, "{} profile of {} functions in {} call paths{}\n",
+                   title, fns.size(), _nodes.size() - 1, ticks ? "" : ", without timestamps");
+    fmt::format_to(out, "{:>10} {:>14} {:>14} {:>10} {:>10}  {}\n", count_name, "inclusive", "exclusive", "min", "max", "function");
+    for (auto & p : sorted)
+    {
+        auto & fs = p.second;
+        fmt::format_to(out, "{:>10} {:>14} {:>14} {:>10} {:>10}  {}\n", fs.calls, fs.inclusive, fs.exclusive,
+                       fs.max == 0u ? 0u : fs.min, fs.max, name(p.first));
+    }
+
+    fmt::format_to(out, "\n{:>10} {:>14}  {}\n", count_name, "inclusive", "caller -> callee");
+    for (auto & e : edges())
+        fmt::format_to(out, "{:>10} {:>14}  {} -> {}\n", e.second.calls, e.second.inclusive, name(e.first.first), name(e.first.second));
+
+    os.write(buf.data(), buf.size());
+}
+
+void call_graph::write_json(std::ostream & os)
+{
+    json_stream js(os, false);
+    js.nested([&](auto & w)
+            {
+                auto fn = [&](const char * key, std::uint64_t fn)
+                    {
+                        w.Key(key);
+                        if (addresses)
+                            w.Uint64(fn);
+                        else
+                            w.String(this->name(fn));
+                    };
+
+                w.StartObject();
+                w.Key("ticks"); w.Bool(ticks);
+                w.Key("functions");
+                w.StartArray();
+                for (auto & p : this->functions())
+                {
+                    auto & fs = p.second;
+                    w.StartObject();
+                    if (addresses)
+                    {
+                        w.Key("address");   w.Uint64(p.first);
+                    }
+                    w.Key("function");  w.String(this->name(p.first));
+                    w.Key(count_name.c_str()); w.Uint64(fs.calls);
+                    w.Key("inclusive"); w.Uint64(fs.inclusive);
+                    w.Key("exclusive"); w.Uint64(fs.exclusive);
+                    w.Key("min");       w.Uint64(fs.max == 0u ? 0u : fs.min);
+                    w.Key("max");       w.Uint64(fs.max);
+                    w.EndObject();
+                }
+                w.EndArray();
+
+                w.Key("edges");
+                w.StartArray();
+                for (auto & e : this->edges())
+                {
+                    w.StartObject();
+                    fn("caller", e.first.first);
+                    fn("callee", e.first.second);
+                    w.Key(count_name.c_str()); w.Uint64(e.second.calls);
+                    w.Key("inclusive"); w.Uint64(e.second.inclusive);
+                    w.EndObject();
+                }
+                w.EndArray();
+                w.EndObject();
+            });
+}
+
+}}
@@ -0,0 +1,110 @@
+/**
+ * @file   sink/call_graph.hpp
+ * @date   19.10.2026
+ * @author Klemens D. Morgenstern
+ *
+
+ This header provides the call tree used by the profiling sinks. Every distinct call path is a node,
+ so the memory is bounded by the number of call paths, not by the number of calls or samples.
+ It can be written as folded stacks for flamegraphs, as a text report or as a json summary.
+
+ */
+#ifndef METAL_SINK_CALL_GRAPH_HPP_
+#define METAL_SINK_CALL_GRAPH_HPP_
+
+#include <cstdint>
+#include <limits>
+#include <map>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace metal { namespace sink {
+
+class call_graph
+{
+public:
+    struct node
+    {
+        std::uint64_t fn;
+        std::size_t parent;
+        std::unordered_map<std::uint64_t, std::size_t> children;
+
+        std::uint64_t calls = 0u;
+        std::uint64_t inclusive = 0u;
+        std::uint64_t exclusive = 0u;
+        std::uint64_t min = std::numeric_limits<std::uint64_t>::max();
+        std::uint64_t max = 0u;
+
+        node(std::uint64_t fn, std::size_t parent) : fn(fn), parent(parent) {}
+
+        ///Add the duration of one call.
+        void add(std::uint64_t inclusive_, std::uint64_t exclusive_)
+        {
+            inclusive += inclusive_;
+            exclusive += exclusive_;
+            if (inclusive_ < min) min = inclusive_;
+            if (inclusive_ > max) max = inclusive_;
+        }
+    };
+
+    struct function_stats
+    {
+        std::uint64_t calls = 0u;
+        std::uint64_t inclusive = 0u;
+        std::uint64_t exclusive = 0u;
+        std::uint64_t min = std::numeric_limits<std::uint64_t>::max();
+        std::uint64_t max = 0u;
+    };
+
+    struct edge_stats
+    {
+        std::uint64_t calls = 0u;
+        std::uint64_t inclusive = 0u;
+    };
+
+    ///The prefix of the report, e.g. metal.calltrace.
+    std::string title;
+    ///What the calls of a node are, e.g. calls or samples.
+    std::string count_name{"calls"};
+    ///If the inclusive & exclusive values were recorded. Otherwise the number of calls is used as weight.
+    bool ticks = false;
+    ///If the keys of the functions are their addresses, which are then written to the json output.
+    bool addresses = true;
+
+    call_graph(const std::string & title) : title(title) {}
+
+    constexpr static std::size_t root = 0u;
+
+    ///Get the node of the call of `fn` from `parent`, it gets created if it doesn't exist yet.
+    std::size_t child(std::size_t parent, std::uint64_t fn);
+
+    node & operator[](std::size_t idx) {return _nodes[idx];}
+    const node & operator[](std::size_t idx) const {return _nodes[idx];}
+    std::size_t size() const {return _nodes.size();}
+
+    ///Set the name of the function, if it doesn't have one yet. Functions without a name are shown by address.
+    void set_name(std::uint64_t fn, const std::string & name);
+    const std::string & name(std::uint64_t fn);
+
+    ///Aggregated per function, the recursive calls are only included once in the inclusive value.
+    std::map<std::uint64_t, function_stats> functions() const;
+    ///Aggregated per caller -> callee.
+    std::map<std::pair<std::uint64_t, std::uint64_t>, edge_stats> edges() const;
+
+    void write_folded(std::ostream & os);
+    void write_report(std::ostream & os);
+    void write_json  (std::ostream & os);
+private:
+    //the root has the index 0, a node is always created after its parent.
+    std::vector<node> _nodes{node{0u, 0u}};
+    std::unordered_map<std::uint64_t, std::string> _names;
+
+    std::uint64_t _weight(const node & nd) const {return ticks ? nd.exclusive : nd.calls;}
+    bool _recursive(std::size_t idx) const;
+};
+
+}}
+
+#endif /* METAL_SINK_CALL_GRAPH_HPP_ */
@@ -0,0 +1,157 @@
+/**
+ * @file   sink/hrf_stream.cpp
+ * @date   19.10.2026
+ * @author Klemens D. Morgenstern
+ *
+ */
+#include "hrf_stream.hpp"
+
+#include <algorithm>
+#include <deque>
+
+namespace metal { namespace sink {
+
+class hrf_writer_thread
+{
+    std::ostream & _os;
+    std::mutex _mutex;
+    std::condition_variable _cv;
+    std::deque<std::string> _queue;
+    bool _done = false;
+    bool _busy = false;
+    std::thread _thread;
+
+    void _run()
+    {
+        std::unique_lock<std::mutex> lock{_mutex};
+        while (true)
+        {
+            _cv.wait(lock, [this]{return _done || !_queue.empty();});
+            if (_queue.empty()) //so it's done
+                return;
+
+            auto data = std::move(_queue.front());
+            _queue.pop_front();
+            auto last = _queue.empty();
+            _busy = true;
+
+            lock.unlock();
+            _os.write(data.data(), data.size());
+            if (last)
+                _os.flush();
+            lock.lock();
+
+            _busy = false;
+            if (_queue.empty())
+                _cv.notify_all();
+        }
+    }
+public:
+    hrf_writer_thread(std::ostream & os) : _os(os), _thread([this]{_run();}) {}
+
+    void push(std::string && data)
+    {
+        {
+            std::lock_guard<std::mutex> lock{_mutex};
+            _queue.push_back(std::move(data));
+        }
+        _cv.notify_all();
+    }
+
+    ///Block until everything pushed so far is written.
+    void wait()
+    {
+        std::unique_lock<std::mutex> lock{_mutex};
+        _cv.wait(lock, [this]{return !_busy && _queue.empty();});
+    }
+
+    ~hrf_writer_thread()
+    {
+        {
+            std::lock_guard<std::mutex> lock{_mutex};
+            _done = true;
+        }
+        _cv.notify_all();
+        _thread.join();
+    }
+};
+
+hrf_stream::hrf_stream(std::ostream & os, const hrf_options & options) : _os(os), _options(options)
+{
+    if (_options.writer_thread)
+        _writer.reset(new hrf_writer_thread(os));
+    //without the writer thread the interval is checked when a record is finished, so nothing needs a lock.
+    _timed = _options.writer_thread && (_options.flush_interval.count() > 0);
+    if (_timed)
+        _timer = std::thread([this]{_run_timer();});
+}
+
+hrf_stream::~hrf_stream()
+{
+    if (_timed)
+    {
+        {
+            std::lock_guard<std::mutex> lock{_mutex};
+            _done = true;
+        }
+        _cv.notify_all();
+        _timer.join();
+    }
+
+    _finished = _buffer.size();
+    _write_out();
+    //joins after writing the remaining buffers.
+    _writer.reset();
+}
+
+void hrf_stream::flush()
+{
+    {
+        auto lock = _lock();
+        _finished = _buffer.size();
+        _write_out();
+    }
+    if (_writer)
+        _writer->wait();
+}
+
+void hrf_stream::_run_timer()
+{
+    std::unique_lock<std::mutex> lock{_mutex};
+    while (!_done)
+    {
+        if (_finished == 0u)
+        {
+            _cv.wait(lock);
+            continue;
+        }
+        auto due = _last_flush + _options.flush_interval;
+        if (std::chrono::steady_clock::now() >= due)
+            _write_out();
+        else
+            _cv.wait_until(lock, due);
+    }
+}
+
+//the lock must be held if there's a timer, only the finished records are written, the current one stays in the buffer.
+void hrf_stream::_write_out()
+{
+    _last_flush = std::chrono::steady_clock::now();
+    if (_finished == 0u)
+        return;
+
+    if (_writer)
+        _writer->push(std::string(_buffer.data(), _finished));
+    else
+    {
+        _os.write(_buffer.data(), _finished);
+        _os.flush();
+    }
+
+    auto rest = _buffer.size() - _finished;
+    std::copy(_buffer.data() + _finished, _buffer.data() + _buffer.size(), _buffer.data());
+    _buffer.resize(rest);
+    _finished = 0u;
+}
+
+}}
@@ -0,0 +1,118 @@
+/**
+ * @file   sink/hrf_stream.hpp
+ * @date   19.10.2026
+ * @author Klemens D. Morgenstern
+ *
+
+ This header provides the output stream of the human readable sinks. The records are formatted into a buffer, which
+ is only written when it exceeds a size threshold, when a record is finished after the time threshold or when the sink
+ is destroyed. Optionally the full buffers can be handed to a writer thread, then a timer thread also writes the
+ finished records once they are older than the time threshold, even if no further record follows.
+
+ */
+#ifndef METAL_SINK_HRF_STREAM_HPP_
+#define METAL_SINK_HRF_STREAM_HPP_
+
+#include <fmt/format.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+
+namespace metal { namespace sink {
+
+struct hrf_options
+{
+    ///Write the buffer when it exceeds this size.
+    std::size_t flush_size = 64 * 1024;
+    ///Write the finished records when one is finished this long after the last write. Zero writes every record.
+    std::chrono::milliseconds flush_interval{100};
+    ///Write the output from a separate thread, the interval is then kept by a timer, which requires locking the buffer.
+    bool writer_thread = false;
+};
+
+class hrf_writer_thread;
+
+class hrf_stream
+{
+    std::ostream & _os;
+    hrf_options _options;
+    fmt::memory_buffer _buffer;
+    std::chrono::steady_clock::time_point _last_flush = std::chrono::steady_clock::now();
+    std::unique_ptr<hrf_writer_thread> _writer;
+
+    //the timer thread shares the buffer, it only writes the finished records. Without it nothing is locked.
+    bool _timed = false;
+    std::mutex _mutex;
+    std::condition_variable _cv;
+    std::size_t _finished = 0u;
+    bool _done = false;
+    std::thread _timer;
+
+    std::unique_lock<std::mutex> _lock()
+    {
+        return _timed ? std::unique_lock<std::mutex>{_mutex} : std::unique_lock<std::mutex>{};
+    }
+    void _write_out();
+    void _run_timer();
+public:
+    hrf_stream(std::ostream & os, const hrf_options & options = {});
+    hrf_stream(const hrf_stream &) = delete;
+    ~hrf_stream();
+
+    template<typename ...Args>
+    hrf_stream & print(const char * format, const Args & ... args)
+    {
+        auto lock = _lock();
+        fmt::format_to(std::back_inserter(_buffer), format, args...);
+        return *this;
+    }
+
+    hrf_stream & write(char c)
+    {
+        auto lock = _lock();
+        _buffer.push_back(c);
+        return *this;
+    }
+    hrf_stream & write(const char * str)        { return write(str, std::char_traits<char>::length(str)); }
+    hrf_stream & write(const std::string & str) { return write(str.data(), str.size()); }
+    hrf_stream & write(const char * str, std::size_t size)
+    {
+        auto lock = _lock();
+        _buffer.append(str, str + size);
+        return *this;
+    }
+
+    ///Finish a line and write the buffer if it exceeds the size or the interval passed, otherwise the timer writes it.
+    void end_record()
+    {
+        auto lock = _lock();
+        _buffer.push_back('\n');
+        const bool wake = _finished == 0u;
+        _finished = _buffer.size();
+        if ((_buffer.size() >= _options.flush_size) || (_options.flush_interval.count() <= 0))
+            _write_out();
+        else if (!_timed)
+        {
+            if ((std::chrono::steady_clock::now() - _last_flush) >= _options.flush_interval)
+                _write_out();
+        }
+        else if (wake) //the timer waits for the first record after a write.
+        {
+            lock.unlock();
+            _cv.notify_all();
+        }
+    }
+
+    ///Write out the buffer and wait until it reached the stream.
+    void flush();
+};
+
+}}
+
+#endif /* METAL_SINK_HRF_STREAM_HPP_ */
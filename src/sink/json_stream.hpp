@@ -0,0 +1,116 @@
+/**
+ * @file   sink/json_stream.hpp
+ * @date   19.10.2026
+ * @author Klemens D. Morgenstern
+ *
+
+ This header provides the streaming json writer used by the json sinks of the plugins. Instead of building a document
+ for the whole run, the values are written as soon as they are complete, through a buffer of a fixed size.
+ In ndjson mode every event is written as a separate document in one line.
+
+ */
+#ifndef METAL_SINK_JSON_STREAM_HPP_
+#define METAL_SINK_JSON_STREAM_HPP_
+
+#include <rapidjson/rapidjson.h>
+#include <rapidjson/writer.h>
+#include <rapidjson/prettywriter.h>
+
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace metal { namespace sink {
+
+///Output stream for the rapidjson writers, that writes to a std::ostream in blocks.
+class json_ostream
+{
+    std::ostream & _os;
+    std::vector<char> _buffer;
+public:
+    typedef char Ch;
+
+    constexpr static std::size_t capacity = 64 * 1024;
+
+    json_ostream(std::ostream & os) : _os(os)
+    {
+        _buffer.reserve(capacity);
+    }
+    json_ostream(const json_ostream & ) = delete;
+
+    ~json_ostream()
+    {
+        write_out();
+    }
+
+    void Put(char c)
+    {
+        _buffer.push_back(c);
+        if (_buffer.size() >= capacity)
+            write_out();
+    }
+
+    //the writer flushes after every root value, i.e. after every line in ndjson mode, so this is left to the buffer.
+    void Flush() {}
+
+    void write_out()
+    {
+        if (_buffer.empty())
+            return;
+        _os.write(_buffer.data(), _buffer.size());
+        _os.flush();
+        _buffer.clear();
+    }
+
+    //not needed for output, but required by the rapidjson stream concept.
+    char Peek() const { RAPIDJSON_ASSERT(false); return '\0'; }
+    char Take()       { RAPIDJSON_ASSERT(false); return '\0'; }
+    std::size_t Tell() const { RAPIDJSON_ASSERT(false); return 0u; }
+    char* PutBegin()  { RAPIDJSON_ASSERT(false); return nullptr; }
+    std::size_t PutEnd(char*) { RAPIDJSON_ASSERT(false); return 0u; }
+};
+
+/** The streaming writer. The nested output is pretty printed into one document, the ndjson output is compact.
+ *
+ * The sinks write their events through `event` and the surrounding structure (i.e. the opening and closing of
+ * the document and of the nested objects) through `nested`, which is ignored in ndjson mode.
+ */
+class json_stream
+{
+    json_ostream _out;
+    rapidjson::PrettyWriter<json_ostream> _pretty{_out};
+    rapidjson::Writer<json_ostream>       _line;
+    bool _ndjson;
+public:
+    json_stream(std::ostream & os, bool ndjson) : _out(os), _ndjson(ndjson) {}
+
+    bool ndjson() const {return _ndjson;}
+
+    ///Write one complete value. In ndjson mode it's written into a line of its own.
+    template<typename Func>
+    void event(Func && func)
+    {
+        if (_ndjson)
+        {
+            _line.Reset(_out);
+            func(_line);
+            _out.Put('\n');
+        }
+        else
+            func(_pretty);
+    }
+
+    ///Write a part of the nested document, this does nothing in ndjson mode.
+    template<typename Func>
+    void nested(Func && func)
+    {
+        if (!_ndjson)
+            func(_pretty);
+    }
+
+    void flush() { _out.write_out(); }
+};
+
+}}
+
+#endif /* METAL_SINK_JSON_STREAM_HPP_ */
@@ -52,236 +52,257 @@ static std::string ranged(int idx, std::string && st)
     return "**range**[" + to_string(idx) + "]";
 }
 
-static std::string descr(bool bw, const std::string & str)
+inline static const char* bw_word(bool bw)
 {
-    if (bw)
-        return " [bitwise " + str + "]: ";
-    else
-        return " [" + str + "]: ";
+    return bw ? static_cast<const char*>("bitwise ") : static_cast<const char*>("") ;
 }
 
-static std::string bitpre(bool bw, const std::string & str)
+inline static const char* bitpre(bool bw)
 {
-    if (bw)
-        return "0b" + str;
-    else
-        return str;
+    return bw ? static_cast<const char*>("0b") : static_cast<const char*>("") ;
 }
 
 struct hrf_sink_t : data_sink_t
 {
-    std::ostream * os = &std::cout;
+    metal::sink::hrf_stream os;
 
     std::string group{"__metal_call"};
 
-    std::ostream & loc(const std::string & file, int line)
+    hrf_sink_t(std::ostream & os, const metal::sink::hrf_options & options) : os(os, options) {}
+
+    metal::sink::hrf_stream & loc(const std::string & file, int line)
+    {
+        return os.print("{}({})", boost::replace_all_copy(file, "\\\\", "\\"), line);
+    }
+
+    metal::sink::hrf_stream & check(const std::string & file, int line, bool condition, level_t lvl, bool critical)
+    {
+        return loc(file, line).print("{}{}{}", crit_word(critical), descr(lvl), msg_word(condition));
+    }
+
+    void summary(int executed, int warnings, int errors)
+    {
+        os.print("{{ executed : {}, warnings : {}, errors : {}}}", executed, warnings, errors);
+        os.end_record();
+    }
+
+    void comparison(const std::string & file, int line, bool condition, level_t lvl, bool critical, int index, bool bw,
+                    const char * type, const char * oper,
+                    const std::string & lhs, const std::string &rhs, const std::string & lhs_val, const std::string & rhs_val)
     {
-        return *os << boost::replace_all_copy(file, "\\\\", "\\") << '(' << line << ')';
+        check(file, line, condition, lvl, critical)
+                .print(" [{}{}]: {}; [{}{} {} {}{}]", bw_word(bw), type, ranged(index, lhs + " " + oper + " " + rhs),
+                       bitpre(bw), lhs_val, oper, bitpre(bw), rhs_val);
+        os.end_record();
     }
 
-    std::ostream & check(const std::string & file, int line, bool condition, level_t lvl, bool critical)
+    void closeness(const std::string & file, int line, bool condition, level_t lvl, bool critical, int index,
+                   const std::string & lhs, const std::string &rhs, const std::string & tolerance,
+                   const std::string & lhs_val, const std::string & rhs_val, const std::string& tolerance_val,
+                   const char * marker, const char * open, const char * close)
     {
-        return loc(file, line) << crit_word(critical) << descr(lvl) << msg_word(condition);
+        check(file, line, condition, lvl, critical)
+                .print(" [equality]: {}{}; [{}{} == {} +/- {}{}]", ranged(index, lhs + " == " + rhs + " +/- " + tolerance),
+                       marker, open, lhs_val, rhs_val, tolerance_val, close);
+        os.end_record();
     }
 
     virtual ~hrf_sink_t() = default;
+    void flush() override
+    {
+        os.flush();
+    }
     void start() override
     {
-        *os << "starting test execution" << std::endl;
+        os.write("starting test execution").end_record();
     }
     void cancel_func(const std::string & file, int line, const std::string & id, int executed, int warnings, int errors)
     {
-        loc(file, line) << " report: cancel test case [" << id << "]: "
-                     "{ executed : " << executed <<
-                     ", warnings : " << warnings <<
-                     ", errors : " << errors << "}" << endl;
+        loc(file, line).print(" report: cancel test case [{}]: ", id);
+        summary(executed, warnings, errors);
     }
     void cancel_main  (const std::string & file, int line, int executed, int warnings, int errors) override
     {
-        loc(file, line) << " report: canceling main: "
-                         "{ executed : " << executed <<
-                         ", warnings : " << warnings <<
-                         ", errors : " << errors << "}" << endl;
+        loc(file, line).write(" report: canceling main: ");
+        summary(executed, warnings, errors);
+        os.flush();
     }
     void continue_main(const std::string & file, int line, int executed, int warnings, int errors) override
     {
-        loc(file, line) << " report: continuing in main: "
-                         "{ executed : " << executed <<
-                         ", warnings : " << warnings <<
-                         ", errors : " << errors << "}" << endl;
+        loc(file, line).write(" report: continuing in main: ");
+        summary(executed, warnings, errors);
     }
 
     void enter_range (const std::string & file, int line, const std::string & descr) override
     {
-        loc(file, line) << " report: entering ranged test [" << descr << "]" << endl;
+        loc(file, line).print(" report: entering ranged test [{}]", descr).end_record();
     }
     void enter_range_mismatch (const std::string & file, int line,
                                const std::string & descr, const std::string & lhs, const std::string& rhs) override
     {
-        loc(file, line) << " error entering ranged test [" << descr << "] with mismatch: "
-                        << lhs << " != " << rhs << endl;
+        loc(file, line).print(" error entering ranged test [{}] with mismatch: {} != {}", descr, lhs, rhs).end_record();
     }
 
     void exit_range  (const std::string & file, int line, int executed, int warnings, int errors) override
     {
-        loc(file, line) <<  " exiting ranged test: "
-                            "{ executed : " << executed <<
-                            ", warnings : " << warnings <<
-                            ", errors : " << errors << "}" << endl;
+        loc(file, line).write(" exiting ranged test: ");
+        summary(executed, warnings, errors);
     }
 
     void cancel_case (const std::string & id, int executed, int warnings, int errors) override
     {
-        *os << "    "
-                "canceling test case ["<<  id <<  "]: "
-                          "{ executed : " << executed <<
-                          ", warnings : " << warnings <<
-                          ", errors : " << errors << "}" << endl;
+        os.print("    canceling test case [{}]: ", id);
+        summary(executed, warnings, errors);
     }
 
     void enter_case(const std::string & file, int line, const std::string & id) override
     {
-        loc(file, line) << " entering test case ["<<  id <<  "]" << endl;
+        loc(file, line).print(" entering test case [{}]", id).end_record();
     }
     void exit_case (const std::string & file, int line, const std::string & id, int executed, int warnings, int errors) override
     {
-        loc(file, line) << " exiting test case ["<<  id <<  "]: "
-                          "{ executed : " << executed <<
-                          ", warnings : " << warnings <<
-                          ", errors : " << errors << "}" << endl;
+        loc(file, line).print(" exiting test case [{}]: ", id);
+        summary(executed, warnings, errors);
+    }
+    void case_timing(const std::string & id, std::uint64_t host_us, const boost::optional<std::uint64_t> & target_ticks) override
+    {
+        os.print("    timing of test case [{}]: {{ host : {}us", id, host_us);
+        if (target_ticks)
+            os.print(", target : {} ticks", *target_ticks);
+        os.write('}').end_record();
+    }
+    void timestamp_unavailable() override
+    {
+        os.write("metal_timestamp() is not available, target timing is disabled").end_record();
     }
     void report (int free_executed, int free_warnings, int free_errors,
                  int executed, int warnings, int errors) override
     {
         if (free_executed)
-            *os << "free tests "
-                         << ": { executed : " << free_executed
-                         << ", warnings : " << free_warnings
-                         <<   ", errors : " << free_errors << "}" << endl;
+        {
+            os.write("free tests : ");
+            summary(free_executed, free_warnings, free_errors);
+        }
 
-        *os << "full test report"
-             << ": { executed : " << executed
-             << ", warnings : " << warnings
-             <<   ", errors : " << errors << "}" << endl;
+        os.write("full test report: ");
+        summary(executed, warnings, errors);
+        os.flush();
     }
 
     void log        (const std::string & file, int line, const std::string & message) override
     {
-        loc(file, line) << " log : " << message << endl;
+        loc(file, line).print(" log : {}", message).end_record();
     }
     void checkpoint (const std::string & file, int line) override
     {
-        loc(file, line) << " checkpoint" << endl;
+        loc(file, line).write(" checkpoint").end_record();
+    }
+    void benchmark  (const std::string & file, int line, const std::string & name, const std::string &,
+                     std::uint64_t iterations, std::uint64_t min, double mean, std::uint64_t max) override
+    {
+        loc(file, line).print(" benchmark [{}]: {{ iterations : {}, min : {}, mean : {:g}, max : {}}}",
+                              name, iterations, min, mean, max).end_record();
     }
 
     void message(const std::string & file, int line, bool condition, level_t lvl, bool critical, int, const std::string & message) override
     {
-        check(file, line, condition, lvl, critical) << " [message]: " << message << endl;
+        check(file, line, condition, lvl, critical).print(" [message]: {}", message).end_record();
     }
     void plain  (const std::string & file, int line, bool condition, level_t lvl, bool critical, int, const std::string & message) override
     {
-        check(file, line, condition, lvl, critical) << " [expression]: " << message << endl;
+        check(file, line, condition, lvl, critical).print(" [expression]: {}", message).end_record();
     }
 
     void predicate  (const std::string & file, int line, bool condition, level_t lvl, bool critical, int,
                      const std::string & name, const std::string &args) override
     {
-        check(file, line, condition, lvl, critical) << " [predicate]: " << name << '(' << args << ')' << endl;
+        check(file, line, condition, lvl, critical).print(" [predicate]: {}({})", name, args).end_record();
     }
     void equal     (const std::string & file, int line, bool condition, level_t lvl, bool critical, int index, bool bw,
                     const std::string & lhs, const std::string &rhs, const std::string & lhs_val, const std::string & rhs_val) override
     {
-
-        check(file, line, condition, lvl, critical) << descr(bw, "equality") << ranged(index, lhs + " == " + rhs)
-                                                    << "; [" << bitpre(bw, lhs_val) << " == " << bitpre(bw, rhs_val) << "]" << endl;
+        comparison(file, line, condition, lvl, critical, index, bw, "equality", "==", lhs, rhs, lhs_val, rhs_val);
     }
 
     void not_equal (const std::string & file, int line, bool condition, level_t lvl, bool critical, int index, bool bw,
                     const std::string & lhs, const std::string &rhs, const std::string & lhs_val, const std::string & rhs_val) override
     {
-        check(file, line, condition, lvl, critical) << descr(bw, "equality") << ranged(index, lhs + " != " + rhs)
-                                                    << "; [" << bitpre(bw, lhs_val) << " != " << bitpre(bw, rhs_val) << "]" << endl;
+        comparison(file, line, condition, lvl, critical, index, bw, "equality", "!=", lhs, rhs, lhs_val, rhs_val);
     }
 
     void close     (const std::string & file, int line, bool condition, level_t lvl, bool critical, int index,
                     const std::string & lhs, const std::string &rhs, const std::string & tolerance,
                     const std::string & lhs_val, const std::string & rhs_val, const std::string& tolerance_val) override
     {
-        check(file, line, condition, lvl, critical) << " [equality]: " << ranged(index, lhs + " == " + rhs + " +/- " + tolerance)
-                         << "; [" << lhs_val << " == " << rhs_val << " +/- " << tolerance_val << "]" << endl;
+        closeness(file, line, condition, lvl, critical, index, lhs, rhs, tolerance, lhs_val, rhs_val, tolerance_val, "", "", "");
     }
 
     void close_rel (const std::string & file, int line, bool condition, level_t lvl, bool critical, int index,
                     const std::string & lhs, const std::string &rhs, const std::string & tolerance,
                     const std::string & lhs_val, const std::string & rhs_val, const std::string& tolerance_val) override
     {
-        check(file, line, condition, lvl, critical) << " [equality]: " << ranged(index, lhs + " == " + rhs + " +/- " + tolerance)
-                         << "~; [ " << lhs_val << " == " << rhs_val << " +/- " << tolerance_val << " ~ ]" << endl;
+        closeness(file, line, condition, lvl, critical, index, lhs, rhs, tolerance, lhs_val, rhs_val, tolerance_val, "~", " ", " ~ ");
     }
 
     void close_per (const std::string & file, int line, bool condition, level_t lvl, bool critical, int index,
                     const std::string & lhs, const std::string &rhs, const std::string & tolerance,
                     const std::string & lhs_val, const std::string & rhs_val, const std::string& tolerance_val) override
     {
-        check(file, line, condition, lvl, critical) << " [equality]: " << ranged(index, lhs + " == " + rhs + " +/- " + tolerance)
-                         << "%; [ " << lhs_val << " == " << rhs_val << " +/- " << tolerance_val << " % ]" << endl;
+        closeness(file, line, condition, lvl, critical, index, lhs, rhs, tolerance, lhs_val, rhs_val, tolerance_val, "%", " ", " % ");
     }
 
     void ge        (const std::string & file, int line, bool condition, level_t lvl, bool critical, int index, bool bw,
                     const std::string & lhs, const std::string &rhs, const std::string & lhs_val, const std::string & rhs_val) override
     {
-        check(file, line, condition, lvl, critical) << descr(bw, "comparison") << ranged(index, lhs + " >= " + rhs)
-                                                    << "; [" << bitpre(bw, lhs_val) << " >= " << bitpre(bw, rhs_val) << "]" << endl;
+        comparison(file, line, condition, lvl, critical, index, bw, "comparison", ">=", lhs, rhs, lhs_val, rhs_val);
     }
 
     void greater   (const std::string & file, int line, bool condition, level_t lvl, bool critical, int index,
                     const std::string & lhs, const std::string &rhs, const std::string & lhs_val, const std::string & rhs_val) override
     {
-        check(file, line, condition, lvl, critical) << " [comparison]: " << ranged(index, lhs + " > "  + rhs) << "; [" << lhs_val << " > " << rhs_val << "]" << endl;
+        comparison(file, line, condition, lvl, critical, index, false, "comparison", ">", lhs, rhs, lhs_val, rhs_val);
     }
 
     void le        (const std::string & file, int line, bool condition, level_t lvl, bool critical, int index, bool bw,
                     const std::string & lhs, const std::string &rhs, const std::string & lhs_val, const std::string & rhs_val) override
     {
-        check(file, line, condition, lvl, critical) << descr(bw, "comparison") << ranged(index, lhs + " <= " + rhs)
-                                                    << "; [" << bitpre(bw, lhs_val) << " <= " << bitpre(bw, rhs_val) << "]" << endl;
+        comparison(file, line, condition, lvl, critical, index, bw, "comparison", "<=", lhs, rhs, lhs_val, rhs_val);
     }
 
     void lesser    (const std::string & file, int line, bool condition, level_t lvl, bool critical, int index,
                     const std::string & lhs, const std::string &rhs, const std::string & lhs_val, const std::string & rhs_val) override
     {
-        check(file, line, condition, lvl, critical) << " [comparison]: " << ranged(index, lhs + " < "  + rhs) << "; [" << lhs_val << " < " << rhs_val << "]" << endl;
+        comparison(file, line, condition, lvl, critical, index, false, "comparison", "<", lhs, rhs, lhs_val, rhs_val);
     }
 
     void exception (const std::string & file, int line, bool condition, level_t lvl, bool critical, int,
                     const std::string & got, const std::string & expected) override
     {
-        check(file, line, condition, lvl, critical) << " throw exception [" << expected << "] got [" << got << "]" <<  endl;
+        check(file, line, condition, lvl, critical).print(" throw exception [{}] got [{}]", expected, got).end_record();
     }
 
     void any_exception(const std::string & file, int line, bool condition, level_t lvl, bool critical, int) override
     {
-        check(file, line, condition, lvl, critical) << " throw any exception." << endl;
+        check(file, line, condition, lvl, critical).write(" throw any exception.").end_record();
     }
     void no_exception (const std::string & file, int line, bool condition, level_t lvl, bool critical, int) override
     {
-        check(file, line, condition, lvl, critical) << " throw no exception." << endl;
+        check(file, line, condition, lvl, critical).write(" throw no exception.").end_record();
     }
     void no_execute   (const std::string & file, int line, bool condition, level_t lvl, bool critical, int) override
     {
-        check(file, line, condition, lvl, critical) << " do not execute." << endl;
+        check(file, line, condition, lvl, critical).write(" do not execute.").end_record();
     }
     void execute      (const std::string & file, int line, bool condition, level_t lvl, bool critical, int) override
     {
-        check(file, line, condition, lvl, critical) << " do execute." << endl;
+        check(file, line, condition, lvl, critical).write(" do execute.").end_record();
     }
 };
 
 boost::optional<hrf_sink_t> hrf_sink;
 
-data_sink_t * get_hrf_sink(std::ostream & os)
+data_sink_t * get_hrf_sink(std::ostream & os, const metal::sink::hrf_options & options)
 {
-    hrf_sink.emplace();
-    hrf_sink->os = &os;
+    hrf_sink.emplace(os, options);
     return &*hrf_sink;
-}
\ No newline at end of file
+}
@@ -7,17 +7,12 @@
 
  */
 #include "sink.hpp"
+#include "../sink/json_stream.hpp"
 #include <iostream>
-#include <stack>
 
 #include <boost/algorithm/string/replace.hpp>
 #include <boost/optional.hpp>
 
-#include <rapidjson/rapidjson.h>
-#include <rapidjson/document.h>
-#include <rapidjson/filewritestream.h>
-#include <rapidjson/prettywriter.h>
-
 using namespace std;
 
 inline static const char* descr(level_t lvl)
@@ -33,467 +28,489 @@ inline static const char* descr(level_t lvl)
     }
 }
 
-namespace rj = rapidjson;
-
 struct json_sink_t : data_sink_t
 {
-    std::ostream * os = &std::cout;
+    metal::sink::json_stream js;
 
-    rj::Document doc;
-    std::stack<rj::Value> vals;
+    //number of open cases & ranges
+    int depth = 0;
 
+    struct timing_t
+    {
+        std::uint64_t host_us;
+        boost::optional<std::uint64_t> target_ticks;
+    };
+    boost::optional<timing_t> timing;
 
-    rj::Value steal()
+    json_sink_t(std::ostream & os, bool ndjson) : js(os, ndjson) {}
+
+    template<typename Writer>
+    static void loc(Writer & w, const std::string & file, int line)
     {
-        if (vals.empty())
-        {
-            rj::Value val;
-            val.SetObject();
-            return val;
-        }
-        else
-        {
-            auto val = std::move(vals.top());
-            vals.pop();
-            return val;
-        }
+        w.Key("file"); w.String(boost::replace_all_copy(file, "\\\\", "\\"));
+        w.Key("line"); w.Int(line);
     }
-    void repush(rj::Value && val)
+
+    template<typename Writer>
+    static void check(Writer & w, const std::string & file, int line, bool condition, level_t lvl, bool critical, int idx)
     {
-        if (vals.empty())
+        loc(w, file, line);
+        w.Key("condition"); w.Bool(condition);
+        w.Key("lvl");       w.String(descr(lvl));
+        w.Key("critical");  w.Bool(critical);
+
+        if (idx != -1)
         {
-            doc["content"].PushBack(std::move(val), doc.GetAllocator());
+            w.Key("index"); w.Int(idx);
         }
-        else
-            vals.top()["content"].PushBack(std::move(val), doc.GetAllocator());
     }
 
-    void add_to_array(rj::Value && val)
+    template<typename Writer>
+    static void summary(Writer & w, const char * name, int executed, int warnings, int errors)
     {
-        if (vals.size())
-            vals.top()["content"].GetArray().PushBack(std::move(val), doc.GetAllocator());
-        else
-        {
-            if (!doc.HasMember("content"))
-            {
-                rj::Value val;
-                val.SetArray();
-                doc.AddMember("content", std::move(val), doc.GetAllocator());
-            }
-            doc["content"].GetArray().PushBack(std::move(val), doc.GetAllocator());
-        }
+        w.Key(name);
+        w.StartObject();
+        w.Key("executed"); w.Int(executed);
+        w.Key("warnings"); w.Int(warnings);
+        w.Key("errors");   w.Int(errors);
+        w.EndObject();
     }
 
-    rj::Value loc(const std::string & file, int line)
+    ///Write a value into the content of the current case or range.
+    template<typename Func>
+    void entry(const char * type, Func && func)
     {
-        rj::Value val;
-        val.SetObject();
-        val.AddMember("file", boost::replace_all_copy(file, "\\\\", "\\"), doc.GetAllocator());
-        val.AddMember("line", line, doc.GetAllocator());
-        return val;
+        js.event([&](auto & w)
+                {
+                    w.StartObject();
+                    w.Key("type"); w.String(type);
+                    func(w);
+                    w.EndObject();
+                });
     }
 
-    rj::Value check(const std::string & file, int line, bool condition, level_t lvl, bool critical, int idx)
+    ///Open a case or range, the content follows until it gets closed.
+    template<typename Func>
+    void open_scope(const char * type, Func && func)
     {
-        auto val = loc(file, line);
-        val.AddMember("condition", condition, doc.GetAllocator());
-        val.AddMember("lvl",      rj::StringRef(descr(lvl)), doc.GetAllocator());
-        val.AddMember("critical", critical, doc.GetAllocator());
+        depth++;
+        if (js.ndjson())
+            js.event([&](auto & w)
+                    {
+                        w.StartObject();
+                        w.Key("type"); w.String(std::string("enter_") + type);
+                        func(w);
+                        w.EndObject();
+                    });
+        else
+            js.nested([&](auto & w)
+                    {
+                        w.StartObject();
+                        func(w);
+                        w.Key("type"); w.String(type);
+                        w.Key("content");
+                        w.StartArray();
+                    });
+    }
+
+    ///Close the current case or range. If there is none, an object is written into the root content.
+    template<typename Func>
+    void close_scope(const char * type, int executed, int warnings, int errors, Func && func)
+    {
+        auto impl = [&](auto & w)
+                {
+                    summary(w, "summary", executed, warnings, errors);
+                    if (timing)
+                    {
+                        w.Key("timing");
+                        w.StartObject();
+                        w.Key("host_us"); w.Uint64(timing->host_us);
+                        if (timing->target_ticks)
+                        {
+                            w.Key("target_ticks"); w.Uint64(*timing->target_ticks);
+                        }
+                        w.EndObject();
+                    }
+                    func(w);
+                    w.EndObject();
+                };
+
+        if (js.ndjson())
+            js.event([&](auto & w)
+                    {
+                        w.StartObject();
+                        w.Key("type"); w.String(type);
+                        impl(w);
+                    });
+        else
+            js.nested([&](auto & w)
+                    {
+                        if (depth > 0)
+                            w.EndArray();
+                        else
+                            w.StartObject();
+                        impl(w);
+                    });
 
-        if (idx != -1)
-            val.AddMember("index", idx, doc.GetAllocator());
+        timing = boost::none;
+        if (depth > 0)
+            depth--;
+    }
 
-        return val;
+    ///Close all open cases & ranges and the root content.
+    void close_all()
+    {
+        js.nested([&](auto & w)
+                {
+                    for (; depth > 0; depth--)
+                    {
+                        w.EndArray();
+                        w.EndObject();
+                    }
+                    w.EndArray();
+                });
+        depth = 0;
+    }
+
+    void finish()
+    {
+        js.nested([&](auto & w){ w.EndObject(); });
+        js.flush();
     }
 
     virtual ~json_sink_t() = default;
+    void flush() override
+    {
+        js.flush();
+    }
     void start() override
     {
-        doc.SetObject();
+        js.nested([&](auto & w)
+                {
+                    w.StartObject();
+                    w.Key("content");
+                    w.StartArray();
+                });
     }
     void cancel_func(const std::string & file, int line, const std::string & id, int executed, int warnings, int errors) override
     {
-        auto val = steal();
-        {
-            rj::Value sum;
-            sum.SetObject();
-            sum.AddMember("executed", executed, doc.GetAllocator());
-            sum.AddMember("warnings", warnings, doc.GetAllocator());
-            sum.AddMember("errors",   errors  , doc.GetAllocator());
-            val.AddMember("summary", std::move(sum), doc.GetAllocator());
-        }
-        val.AddMember("result", "cancel", doc.GetAllocator());
-        val.AddMember("exit_id", id,      doc.GetAllocator());
-        val.AddMember("exit_location", loc(file, line), doc.GetAllocator());
-        repush(std::move(val));
+        close_scope("cancel_func", executed, warnings, errors, [&](auto & w)
+                {
+                    w.Key("result");  w.String("cancel");
+                    w.Key("exit_id"); w.String(id);
+                    w.Key("exit_location");
+                    w.StartObject(); loc(w, file, line); w.EndObject();
+                });
     }
     void cancel_main  (const std::string & file, int line, int executed, int warnings, int errors) override
     {
-        while (!vals.empty())
-            repush(steal());
-
-        auto &val = doc;
+        auto impl = [&](auto & w)
+                {
+                    summary(w, "summary", executed, warnings, errors);
+                    w.Key("exit_type"); w.String("from_main");
+                    w.Key("result");    w.String("cancel");
+                    w.Key("exit_location");
+                    w.StartObject(); loc(w, file, line); w.EndObject();
+                };
+
+        if (js.ndjson())
+            js.event([&](auto & w)
+                    {
+                        w.StartObject();
+                        w.Key("type"); w.String("cancel_main");
+                        impl(w);
+                        w.EndObject();
+                    });
+        else
         {
-            rj::Value sum;
-            sum.SetObject();
-            sum.AddMember("executed", executed, doc.GetAllocator());
-            sum.AddMember("warnings", warnings, doc.GetAllocator());
-            sum.AddMember("errors",   errors  , doc.GetAllocator());
-            val.AddMember("summary", std::move(sum), doc.GetAllocator());
+            close_all();
+            js.nested(impl);
         }
-        val.AddMember("exit_type", "from_main", doc.GetAllocator());
-
-        val.AddMember("result", "cancel", doc.GetAllocator());
-        val.AddMember("exit_location", loc(file, line), doc.GetAllocator());
+        //the report will not be reached.
+        finish();
     }
     void continue_main(const std::string & file, int line, int executed, int warnings, int errors) override
     {
-        auto val = steal();
-        {
-            rj::Value sum;
-            sum.SetObject();
-            sum.AddMember("executed", executed, doc.GetAllocator());
-            sum.AddMember("warnings", warnings, doc.GetAllocator());
-            sum.AddMember("errors",   errors  , doc.GetAllocator());
-            val.AddMember("summary", std::move(sum), doc.GetAllocator());
-        }
-        val.AddMember("exit_type", "to_main", doc.GetAllocator());
-
-        val.AddMember("result", "cancel", doc.GetAllocator());
-        val.AddMember("exit_location", loc(file, line), doc.GetAllocator());
-
-        repush(std::move(val));
+        close_scope("continue_main", executed, warnings, errors, [&](auto & w)
+                {
+                    w.Key("exit_type"); w.String("to_main");
+                    w.Key("result");    w.String("cancel");
+                    w.Key("exit_location");
+                    w.StartObject(); loc(w, file, line); w.EndObject();
+                });
     }
 
     void enter_range (const std::string & file, int line, const std::string & descr) override
     {
-        auto val = loc(file, line);
-        val.AddMember("type", "range", doc.GetAllocator());
-        val.AddMember("description", descr, doc.GetAllocator());
-
-        rj::Value arr;
-        arr.SetArray();
-        val.AddMember("content", std::move(arr), doc.GetAllocator());
-
-        vals.emplace(std::move(val));
+        open_scope("range", [&](auto & w)
+                {
+                    loc(w, file, line);
+                    w.Key("description"); w.String(descr);
+                });
     }
     void enter_range_mismatch (const std::string & file, int line,
                                const std::string & descr, const std::string & lhs, const std::string& rhs) override
     {
-        auto val = loc(file, line);
-        val.AddMember("type", "range", doc.GetAllocator());
-        val.AddMember("description", descr, doc.GetAllocator());
-
-        rj::Value mismatch;
-        mismatch.SetObject();
-        mismatch.AddMember("lhs", lhs, doc.GetAllocator());
-        mismatch.AddMember("rhs", rhs, doc.GetAllocator());
-        val.AddMember("mismatch", std::move(mismatch), doc.GetAllocator());
-        rj::Value arr;
-        arr.SetArray();
-        val.AddMember("content", std::move(arr), doc.GetAllocator());
-
-        vals.emplace(std::move(val));
+        open_scope("range", [&](auto & w)
+                {
+                    loc(w, file, line);
+                    w.Key("description"); w.String(descr);
+                    w.Key("mismatch");
+                    w.StartObject();
+                    w.Key("lhs"); w.String(lhs);
+                    w.Key("rhs"); w.String(rhs);
+                    w.EndObject();
+                });
     }
 
     void exit_range  (const std::string & file, int line, int executed, int warnings, int errors) override
     {
-        auto val = steal();
-        {
-            rj::Value sum;
-            sum.SetObject();
-            sum.AddMember("executed", executed, doc.GetAllocator());
-            sum.AddMember("warnings", warnings, doc.GetAllocator());
-            sum.AddMember("errors",   errors  , doc.GetAllocator());
-            val.AddMember("summary", std::move(sum), doc.GetAllocator());
-        }
-        val.AddMember("result", "exit", doc.GetAllocator());
-        val.AddMember("exit_location", loc(file, line), doc.GetAllocator());
-        repush(std::move(val));
+        close_scope("exit_range", executed, warnings, errors, [&](auto & w)
+                {
+                    w.Key("result"); w.String("exit");
+                    w.Key("exit_location");
+                    w.StartObject(); loc(w, file, line); w.EndObject();
+                });
     }
 
     void cancel_case (const std::string & id, int executed, int warnings, int errors) override
     {
-        auto val = steal();
-        {
-            rj::Value sum;
-            sum.SetObject();
-            sum.AddMember("executed", executed, doc.GetAllocator());
-            sum.AddMember("warnings", warnings, doc.GetAllocator());
-            sum.AddMember("errors",   errors  , doc.GetAllocator());
-            val.AddMember("summary", std::move(sum), doc.GetAllocator());
-        }
-        val.AddMember("result", "cancel", doc.GetAllocator());
-        //add_to_array(std::move(val));
-        repush(std::move(val));
-  }
+        close_scope("cancel_case", executed, warnings, errors, [&](auto & w)
+                {
+                    w.Key("result"); w.String("cancel");
+                });
+    }
 
     void enter_case(const std::string & file, int line, const std::string & id) override
     {
-        auto val = loc(file, line);
-        val.AddMember("type", "case", doc.GetAllocator());
-        val.AddMember("id", id, doc.GetAllocator());
-
-        rj::Value arr;
-        arr.SetArray();
-        val.AddMember("content", std::move(arr), doc.GetAllocator());
-
-        vals.emplace(std::move(val));
+        open_scope("case", [&](auto & w)
+                {
+                    loc(w, file, line);
+                    w.Key("id"); w.String(id);
+                });
     }
     void exit_case (const std::string & file, int line, const std::string & id, int executed, int warnings, int errors) override
     {
-        auto val = steal();
-        {
-            rj::Value sum;
-            sum.SetObject();
-            sum.AddMember("executed", executed, doc.GetAllocator());
-            sum.AddMember("warnings", warnings, doc.GetAllocator());
-            sum.AddMember("errors",   errors  , doc.GetAllocator());
-            val.AddMember("summary", std::move(sum), doc.GetAllocator());
-        }
-        val.AddMember("result", "exit", doc.GetAllocator());
-     //   add_to_array(std::move(val));
-
-        repush(std::move(val));
+        close_scope("exit_case", executed, warnings, errors, [&](auto & w)
+                {
+                    w.Key("result"); w.String("exit");
+                });
+    }
+    void case_timing(const std::string & id, std::uint64_t host_us, const boost::optional<std::uint64_t> & target_ticks) override
+    {
+        //written when the case is closed.
+        timing = timing_t{host_us, target_ticks};
+    }
+    void timestamp_unavailable() override
+    {
+        entry("timestamp_unavailable", [](auto &){});
     }
     void report (int free_executed, int free_warnings, int free_errors,
                  int executed, int warnings, int errors) override
     {
-        if (free_executed)
-        {
-            rj::Value val;
-            val.SetObject();
-            val.AddMember("executed", free_executed, doc.GetAllocator());
-            val.AddMember("warnings", free_warnings, doc.GetAllocator());
-            val.AddMember("errors",   free_errors  , doc.GetAllocator());
-
-            doc.AddMember("free_tests", std::move(val), doc.GetAllocator());
-        }
-
+        auto impl = [&](auto & w)
+                {
+                    if (free_executed)
+                        summary(w, "free_tests", free_executed, free_warnings, free_errors);
+                    summary(w, "summary", executed, warnings, errors);
+                };
+
+        if (js.ndjson())
+            js.event([&](auto & w)
+                    {
+                        w.StartObject();
+                        w.Key("type"); w.String("report");
+                        impl(w);
+                        w.EndObject();
+                    });
+        else
         {
-            rj::Value val;
-            val.SetObject();
-            val.AddMember("executed", executed, doc.GetAllocator());
-            val.AddMember("warnings", warnings, doc.GetAllocator());
-            val.AddMember("errors",   errors  , doc.GetAllocator());
-
-            doc.AddMember("summary", std::move(val), doc.GetAllocator());
+            close_all();
+            js.nested(impl);
         }
-        rj::StringBuffer buffer;
-        rj::PrettyWriter<rapidjson::StringBuffer> writer(buffer);
-
-        doc.Accept(writer);
-
-        *os << buffer.GetString();
-
+        finish();
     }
 
     void log        (const std::string & file, int line, const std::string & message) override
     {
-        auto val = loc(file, line);
-        val.AddMember("type", "message",  doc.GetAllocator());
-        val.AddMember("message", message, doc.GetAllocator());
-        add_to_array(std::move(val));
-
+        entry("message", [&](auto & w)
+                {
+                    loc(w, file, line);
+                    w.Key("message"); w.String(message);
+                });
     }
     void checkpoint (const std::string & file, int line) override
     {
-        auto val = loc(file, line);
-        val.AddMember("type", "checkpoint", doc.GetAllocator());
-        add_to_array(std::move(val));
+        entry("checkpoint", [&](auto & w){ loc(w, file, line); });
+    }
+    void benchmark  (const std::string & file, int line, const std::string & name, const std::string & code,
+                     std::uint64_t iterations, std::uint64_t min, double mean, std::uint64_t max) override
+    {
+        entry("benchmark", [&](auto & w)
+                {
+                    loc(w, file, line);
+                    w.Key("name");       w.String(name);
+                    w.Key("code");       w.String(code);
+                    w.Key("iterations"); w.Uint64(iterations);
+                    w.Key("min");        w.Uint64(min);
+                    w.Key("mean");       w.Double(mean);
+                    w.Key("max");        w.Uint64(max);
+                });
     }
 
     void message(const std::string & file, int line, bool condition, level_t lvl, bool critical, int index, const std::string & message) override
     {
-        auto val = check(file, line, condition, lvl, critical, index);
-        val.AddMember("type",  "message",  doc.GetAllocator());
-        val.AddMember("message",  message, doc.GetAllocator());
-        add_to_array(std::move(val));
+        entry("message", [&](auto & w)
+                {
+                    check(w, file, line, condition, lvl, critical, index);
+                    w.Key("message"); w.String(message);
+                });
     }
     void plain  (const std::string & file, int line, bool condition, level_t lvl, bool critical, int index, const std::string & message) override
     {
-        auto val = check(file, line, condition, lvl, critical, index);
-        val.AddMember("type",    "plain",  doc.GetAllocator());
-        val.AddMember("message",  message, doc.GetAllocator());
-        add_to_array(std::move(val));
+        entry("plain", [&](auto & w)
+                {
+                    check(w, file, line, condition, lvl, critical, index);
+                    w.Key("message"); w.String(message);
+                });
     }
 
     void predicate  (const std::string & file, int line, bool condition, level_t lvl, bool critical, int index,
                      const std::string & name, const std::string &args) override
     {
-        auto val = check(file, line, condition, lvl, critical, index);
-        val.AddMember("type", "predicate",  doc.GetAllocator());
-        val.AddMember("name",  name, doc.GetAllocator());
-        val.AddMember("args",  args, doc.GetAllocator());
-        add_to_array(std::move(val));
+        entry("predicate", [&](auto & w)
+                {
+                    check(w, file, line, condition, lvl, critical, index);
+                    w.Key("name"); w.String(name);
+                    w.Key("args"); w.String(args);
+                });
+    }
+
+    void comparison(const char * type, const std::string & file, int line, bool condition, level_t lvl, bool critical, int index,
+                    const boost::optional<bool> & bw,
+                    const std::string & lhs, const std::string &rhs, const std::string & lhs_val, const std::string & rhs_val)
+    {
+        entry(type, [&](auto & w)
+                {
+                    check(w, file, line, condition, lvl, critical, index);
+                    if (bw)
+                    {
+                        w.Key("bitwise"); w.Bool(*bw);
+                    }
+                    w.Key("lhs");     w.String(lhs);
+                    w.Key("rhs");     w.String(rhs);
+                    w.Key("lhs_val"); w.String(lhs_val);
+                    w.Key("rhs_val"); w.String(rhs_val);
+                });
+    }
+
+    void closeness (const char * type, const std::string & file, int line, bool condition, level_t lvl, bool critical, int index,
+                    const std::string & lhs, const std::string &rhs, const std::string & tolerance,
+                    const std::string & lhs_val, const std::string & rhs_val, const std::string& tolerance_val)
+    {
+        entry(type, [&](auto & w)
+                {
+                    check(w, file, line, condition, lvl, critical, index);
+                    w.Key("lhs");           w.String(lhs);
+                    w.Key("rhs");           w.String(rhs);
+                    w.Key("tolerance");     w.String(tolerance);
+                    w.Key("lhs_val");       w.String(lhs_val);
+                    w.Key("rhs_val");       w.String(rhs_val);
+                    w.Key("tolerance_val"); w.String(tolerance_val);
+                });
     }
+
     void equal     (const std::string & file, int line, bool condition, level_t lvl, bool critical, int index, bool bw,
                     const std::string & lhs, const std::string &rhs, const std::string & lhs_val, const std::string & rhs_val) override
     {
-        auto val = check(file, line, condition, lvl, critical, index);
-        val.AddMember("type", "equal",  doc.GetAllocator());
-        val.AddMember("bitwise", bw, doc.GetAllocator());
-        val.AddMember("lhs",        lhs,       doc.GetAllocator());
-        val.AddMember("rhs",        rhs,       doc.GetAllocator());
-        val.AddMember("lhs_val",    lhs_val,       doc.GetAllocator());
-        val.AddMember("rhs_val",    rhs_val,       doc.GetAllocator());
-        add_to_array(std::move(val));
+        comparison("equal", file, line, condition, lvl, critical, index, bw, lhs, rhs, lhs_val, rhs_val);
     }
 
     void not_equal (const std::string & file, int line, bool condition, level_t lvl, bool critical, int index, bool bw,
                     const std::string & lhs, const std::string &rhs, const std::string & lhs_val, const std::string & rhs_val) override
     {
-        auto val = check(file, line, condition, lvl, critical, index);
-        val.AddMember("type", "not_equal",  doc.GetAllocator());
-        val.AddMember("bitwise", bw, doc.GetAllocator());
-        val.AddMember("lhs",       lhs,       doc.GetAllocator());
-        val.AddMember("rhs",       rhs,       doc.GetAllocator());
-        val.AddMember("lhs_val",   lhs_val,       doc.GetAllocator());
-        val.AddMember("rhs_val",   rhs_val,       doc.GetAllocator());
-        add_to_array(std::move(val));
+        comparison("not_equal", file, line, condition, lvl, critical, index, bw, lhs, rhs, lhs_val, rhs_val);
     }
 
     void close     (const std::string & file, int line, bool condition, level_t lvl, bool critical, int index,
                     const std::string & lhs, const std::string &rhs, const std::string & tolerance,
                     const std::string & lhs_val, const std::string & rhs_val, const std::string& tolerance_val) override
     {
-        auto val = check(file, line, condition, lvl, critical, index);
-        val.AddMember("type", "close",  doc.GetAllocator());
-        val.AddMember("lhs",       lhs,       doc.GetAllocator());
-        val.AddMember("rhs",       rhs,       doc.GetAllocator());
-        val.AddMember("tolerance",tolerance, doc.GetAllocator());
-        val.AddMember("lhs_val",       lhs_val,       doc.GetAllocator());
-        val.AddMember("rhs_val",       rhs_val,       doc.GetAllocator());
-        val.AddMember("tolerance_val",tolerance_val, doc.GetAllocator());
-        add_to_array(std::move(val));
+        closeness("close", file, line, condition, lvl, critical, index, lhs, rhs, tolerance, lhs_val, rhs_val, tolerance_val);
     }
 
     void close_rel (const std::string & file, int line, bool condition, level_t lvl, bool critical, int index,
                     const std::string & lhs, const std::string &rhs, const std::string & tolerance,
                     const std::string & lhs_val, const std::string & rhs_val, const std::string& tolerance_val) override
     {
-        auto val = check(file, line, condition, lvl, critical, index);
-        val.AddMember("type", "close_rel",  doc.GetAllocator());
-        val.AddMember("lhs",       lhs,       doc.GetAllocator());
-        val.AddMember("rhs",       rhs,       doc.GetAllocator());
-        val.AddMember("tolerance",tolerance, doc.GetAllocator());
-        val.AddMember("lhs_val",       lhs_val,       doc.GetAllocator());
-        val.AddMember("rhs_val",       rhs_val,       doc.GetAllocator());
-        val.AddMember("tolerance_val",tolerance_val, doc.GetAllocator());
-        add_to_array(std::move(val));
+        closeness("close_rel", file, line, condition, lvl, critical, index, lhs, rhs, tolerance, lhs_val, rhs_val, tolerance_val);
     }
 
     void close_per (const std::string & file, int line, bool condition, level_t lvl, bool critical, int index,
                     const std::string & lhs, const std::string &rhs, const std::string & tolerance,
                     const std::string & lhs_val, const std::string & rhs_val, const std::string& tolerance_val) override
     {
-        auto val = check(file, line, condition, lvl, critical, index);
-        val.AddMember("type", "close_per",  doc.GetAllocator());
-        val.AddMember("lhs",       lhs,       doc.GetAllocator());
-        val.AddMember("rhs",       rhs,       doc.GetAllocator());
-        val.AddMember("tolerance",tolerance, doc.GetAllocator());
-        val.AddMember("lhs_val",       lhs_val,       doc.GetAllocator());
-        val.AddMember("rhs_val",       rhs_val,       doc.GetAllocator());
-        val.AddMember("tolerance_val",tolerance_val, doc.GetAllocator());
-        add_to_array(std::move(val));
+        closeness("close_per", file, line, condition, lvl, critical, index, lhs, rhs, tolerance, lhs_val, rhs_val, tolerance_val);
     }
 
     void ge        (const std::string & file, int line, bool condition, level_t lvl, bool critical, int index, bool bw,
                     const std::string & lhs, const std::string &rhs, const std::string & lhs_val, const std::string & rhs_val) override
     {
-        auto val = check(file, line, condition, lvl, critical, index);
-        val.AddMember("type", "ge",  doc.GetAllocator());
-        val.AddMember("bitwise", bw, doc.GetAllocator());
-        val.AddMember("lhs",       lhs,       doc.GetAllocator());
-        val.AddMember("rhs",       rhs,       doc.GetAllocator());
-        val.AddMember("lhs_val",       lhs_val,       doc.GetAllocator());
-        val.AddMember("rhs_val",       rhs_val,       doc.GetAllocator());
-        add_to_array(std::move(val));
+        comparison("ge", file, line, condition, lvl, critical, index, bw, lhs, rhs, lhs_val, rhs_val);
     }
 
     void greater   (const std::string & file, int line, bool condition, level_t lvl, bool critical, int index,
                     const std::string & lhs, const std::string &rhs, const std::string & lhs_val, const std::string & rhs_val) override
     {
-        auto val = check(file, line, condition, lvl, critical, index);
-        val.AddMember("type", "greater",  doc.GetAllocator());
-        val.AddMember("lhs",       lhs,       doc.GetAllocator());
-        val.AddMember("rhs",       rhs,       doc.GetAllocator());
-        val.AddMember("lhs_val",       lhs_val,       doc.GetAllocator());
-        val.AddMember("rhs_val",       rhs_val,       doc.GetAllocator());
-        add_to_array(std::move(val));
+        comparison("greater", file, line, condition, lvl, critical, index, boost::none, lhs, rhs, lhs_val, rhs_val);
     }
 
     void le        (const std::string & file, int line, bool condition, level_t lvl, bool critical, int index, bool bw,
                     const std::string & lhs, const std::string &rhs, const std::string & lhs_val, const std::string & rhs_val) override
     {
-        auto val = check(file, line, condition, lvl, critical, index);
-        val.AddMember("type", "le",  doc.GetAllocator());
-        val.AddMember("bitwise", bw, doc.GetAllocator());
-        val.AddMember("lhs",       lhs,       doc.GetAllocator());
-        val.AddMember("rhs",       rhs,       doc.GetAllocator());
-        val.AddMember("lhs_val",       lhs_val,       doc.GetAllocator());
-        val.AddMember("rhs_val",       rhs_val,       doc.GetAllocator());
-        add_to_array(std::move(val));
+        comparison("le", file, line, condition, lvl, critical, index, bw, lhs, rhs, lhs_val, rhs_val);
     }
 
     void lesser    (const std::string & file, int line, bool condition, level_t lvl, bool critical, int index,
                     const std::string & lhs, const std::string &rhs, const std::string & lhs_val, const std::string & rhs_val) override
     {
-        auto val = check(file, line, condition, lvl, critical, index);
-        val.AddMember("type", "lesser",  doc.GetAllocator());
-        val.AddMember("lhs",       lhs,       doc.GetAllocator());
-        val.AddMember("rhs",       rhs,       doc.GetAllocator());
-        val.AddMember("lhs_val",       lhs_val,       doc.GetAllocator());
-        val.AddMember("rhs_val",       rhs_val,       doc.GetAllocator());
-        add_to_array(std::move(val));
+        comparison("lesser", file, line, condition, lvl, critical, index, boost::none, lhs, rhs, lhs_val, rhs_val);
     }
 
     void exception (const std::string & file, int line, bool condition, level_t lvl, bool critical, int index,
                     const std::string & got, const std::string & expected) override
     {
-        auto val = check(file, line, condition, lvl, critical, index);
-        val.AddMember("type", "exception",  doc.GetAllocator());
-        val.AddMember("got",      got,      doc.GetAllocator());
-        val.AddMember("expected", expected, doc.GetAllocator());
-        add_to_array(std::move(val));
+        entry("exception", [&](auto & w)
+                {
+                    check(w, file, line, condition, lvl, critical, index);
+                    w.Key("got");      w.String(got);
+                    w.Key("expected"); w.String(expected);
+                });
     }
 
     void any_exception(const std::string & file, int line, bool condition, level_t lvl, bool critical, int index) override
     {
-        auto val = check(file, line, condition, lvl, critical, index);
-        val.AddMember("type", "any_exception", doc.GetAllocator());
-
-        add_to_array(std::move(val));
+        entry("any_exception", [&](auto & w){ check(w, file, line, condition, lvl, critical, index); });
     }
     void no_exception (const std::string & file, int line, bool condition, level_t lvl, bool critical, int index) override
     {
-        auto val = check(file, line, condition, lvl, critical, index);
-        val.AddMember("type", "no_exception", doc.GetAllocator());
-
-        add_to_array(std::move(val));
+        entry("no_exception", [&](auto & w){ check(w, file, line, condition, lvl, critical, index); });
     }
     void no_execute   (const std::string & file, int line, bool condition, level_t lvl, bool critical, int index) override
     {
-        auto val = check(file, line, condition, lvl, critical, index);
-        val.AddMember("type", "no_execute_check", doc.GetAllocator());
-
-        add_to_array(std::move(val));
+        entry("no_execute_check", [&](auto & w){ check(w, file, line, condition, lvl, critical, index); });
     }
     void execute      (const std::string & file, int line, bool condition, level_t lvl, bool critical, int index) override
     {
-        auto val = check(file, line, condition, lvl, critical, index);
-        val.AddMember("type", "execute_check", doc.GetAllocator());
-
-        add_to_array(std::move(val));
+        entry("execute_check", [&](auto & w){ check(w, file, line, condition, lvl, critical, index); });
     }
 };
 
 
 boost::optional<json_sink_t> json_sink;
 
-data_sink_t * get_json_sink(std::ostream & os)
+data_sink_t * get_json_sink(std::ostream & os, bool ndjson)
 {
-    json_sink.emplace();
-    json_sink->os = &os;
+    json_sink.emplace(os, ndjson);
     return &*json_sink;
-}
\ No newline at end of file
+}
@@ -0,0 +1,253 @@
+/**
+ * @file   unit/shard.cpp
+ * @date   19.10.2026
+ * @author Klemens D. Morgenstern
+ *
+
+ */
+#include "shard.hpp"
+
+#include <boost/dll/runtime_symbol_info.hpp>
+#include <boost/filesystem/operations.hpp>
+#include <boost/process/io.hpp>
+
+#include <algorithm>
+#include <iostream>
+#include <stdexcept>
+
+namespace bp = boost::process;
+namespace fs = boost::filesystem;
+
+void shard_t::setup(int jobs, int index, const std::string & file, const std::vector<std::string> & args)
+{
+    _jobs  = jobs;
+    _index = index;
+
+    if (!active())
+        return;
+
+    if (!file.empty())
+        _file.emplace(file, std::ios::binary);
+    else if (coordinator())
+    {
+        //a runner without metal_dbg_setup_args doesn't tell us how it was invoked.
+        if (args.empty())
+            throw std::runtime_error("metal.unit: parallel execution requires the arguments of the runner");
+        _launch(args);
+    }
+}
+
+namespace
+{
+
+//splits "--name=value" & "-Xvalue", the value is empty if it's passed as the next argument.
+std::pair<std::string, std::string> split_option(const std::string & arg)
+{
+    if (arg.compare(0, 2, "--") == 0)
+    {
+        auto eq = arg.find('=');
+        if (eq == std::string::npos)
+            return {arg.substr(2), ""};
+        return {arg.substr(2, eq - 2), arg.substr(eq + 1)};
+    }
+    else if ((arg.size() > 1) && (arg[0] == '-'))
+        return {arg.substr(1, 1), arg.substr(2)};
+    return {"", ""};
+}
+
+//the log of the runner & the sinks of the other plugins, which would be written by every instance.
+bool is_output_option(const std::string & name)
+{
+    const std::string suffix = "-sink";
+    if ((name == "log") || (name == "L"))
+        return true;
+    return (name != "metal-test-sink") && (name.size() > suffix.size())
+         && (name.compare(name.size() - suffix.size(), suffix.size(), suffix) == 0);
+}
+
+}
+
+std::vector<std::string> shard_t::_worker_args(const std::vector<std::string> & args, int idx)
+{
+    const auto suffix = ".shard-" + std::to_string(idx);
+
+    std::vector<std::string> res;
+    res.reserve(args.size() + 2);
+    for (auto itr = args.begin(); itr != args.end(); itr++)
+    {
+        auto opt = split_option(*itr);
+
+        if (((*itr)[0] == '@') || (opt.first == "response-file") || (opt.first == "config-file") || (opt.first == "C"))
+            throw std::runtime_error("metal.unit: parallel execution cannot be used with a response or config file, "
+                                     "the output options of the instances couldn't be separated");
+
+        const bool ptrace = (opt.second == "ptrace") || ((opt.second.empty() && (std::next(itr) != args.end()) && (*std::next(itr) == "ptrace")));
+        if (((opt.first == "backend") || (opt.first == "B")) && ptrace)
+            throw std::runtime_error("metal.unit: parallel execution is not available with the ptrace backend, "
+                                     "it cannot return from a skipped test case");
+
+        res.push_back(*itr);
+        if (!is_output_option(opt.first))
+            continue;
+
+        if (!opt.second.empty())
+            res.back() += suffix;
+        else if (std::next(itr) != args.end())
+            res.push_back(*++itr + suffix);
+    }
+
+    res.push_back("--metal-test-shard=" + std::to_string(idx));
+    return res;
+}
+
+void shard_t::_launch(const std::vector<std::string> & args)
+{
+    auto exe = boost::dll::program_location();
+
+    _dir = fs::temp_directory_path() / fs::unique_path("metal-unit-%%%%-%%%%-%%%%");
+    fs::create_directories(_dir);
+
+    for (int i = 1; i < _jobs; i++)
+    {
+        auto file = _dir / ("shard-" + std::to_string(i));
+
+        auto a = _worker_args(args, i);
+        a.push_back("--metal-test-shard-file=" + file.string());
+
+        //the error output is written into a file, so it can be shown if the instance fails.
+        auto err = _dir / ("shard-" + std::to_string(i) + ".err");
+
+        _files.push_back(file);
+        _errors.push_back(err);
+        _children.emplace_back(exe, a, bp::std_in < bp::null, bp::std_out > bp::null, bp::std_err > err);
+    }
+}
+
+void shard_t::_forward_errors(std::size_t idx, bool missing)
+{
+    auto & ch = _children[idx];
+    std::ifstream ifs(_errors[idx].string(), std::ios::binary);
+    const bool has_output = ifs && (ifs.peek() != std::ifstream::traits_type::eof());
+
+    //the exit code is also set by failing test cases, which is reported by the merged results.
+    if (!missing && ((ch.exit_code() == 0) || !has_output))
+        return;
+
+    std::cerr << "metal.unit: shard " << (idx + 1);
+    if (missing)
+        std::cerr << " has no results";
+    std::cerr << ", exited with " << ch.exit_code() << std::endl;
+
+    if (has_output)
+        std::cerr << ifs.rdbuf() << std::flush;
+}
+
+void shard_t::_write(shard_chunk && chunk)
+{
+    if (_file)
+    {
+        *_file << chunk.position << ' ' << (chunk.is_case ? "case" : "free") << ' '
+               << chunk.executed << ' ' << chunk.warnings << ' ' << chunk.errors << ' '
+               << chunk.content.size() << '\n';
+        _file->write(chunk.content.data(), chunk.content.size());
+    }
+    else
+        _chunks.push_back(std::move(chunk));
+}
+
+void shard_t::close_free(int position)
+{
+    if (!active())
+        return;
+
+    shard_chunk ch;
+    ch.position = position;
+    ch.content  = _buffer.str();
+    _buffer.str("");
+
+    //the free tests are executed by every instance, but only reported by the coordinator.
+    if (coordinator() && !ch.content.empty())
+        _write(std::move(ch));
+}
+
+void shard_t::close_case(int position, int executed, int warnings, int errors)
+{
+    if (!active())
+        return;
+
+    shard_chunk ch;
+    ch.position = position;
+    ch.is_case  = true;
+    ch.executed = executed;
+    ch.warnings = warnings;
+    ch.errors   = errors;
+    ch.content  = _buffer.str();
+    _buffer.str("");
+
+    _write(std::move(ch));
+}
+
+std::vector<shard_chunk> shard_t::collect()
+{
+    auto chunks = std::move(_chunks);
+    _chunks.clear();
+
+    for (auto i = 0u; i < _children.size(); i++)
+    {
+        auto & ch = _children[i];
+        if (ch.valid() && ch.running())
+            ch.wait();
+
+        std::ifstream ifs(_files[i].string(), std::ios::binary);
+        _forward_errors(i, !ifs);
+        if (!ifs)
+            continue;
+
+        shard_chunk c;
+        std::string kind;
+        std::size_t size;
+        while (ifs >> c.position >> kind >> c.executed >> c.warnings >> c.errors >> size)
+        {
+            ifs.get(); //the newline
+            c.is_case = (kind == "case");
+            c.content.resize(size);
+            ifs.read(&c.content[0], size);
+            chunks.push_back(c);
+        }
+    }
+    _children.clear();
+    _files.clear();
+    _errors.clear();
+
+    boost::system::error_code ec;
+    if (!_dir.empty())
+        fs::remove_all(_dir, ec);
+
+    //free output before a case with the same position, since it was written before entering it.
+    std::stable_sort(chunks.begin(), chunks.end(),
+            [](const shard_chunk & lhs, const shard_chunk & rhs)
+            {
+                if (lhs.position != rhs.position)
+                    return lhs.position < rhs.position;
+                return !lhs.is_case && rhs.is_case;
+            });
+
+    return chunks;
+}
+
+void shard_t::finish()
+{
+    if (_file)
+        _file->flush();
+}
+
+shard_t::~shard_t()
+{
+    for (auto & ch : _children)
+        if (ch.valid() && ch.running())
+            ch.terminate();
+
+    boost::system::error_code ec;
+    if (!_dir.empty())
+        fs::remove_all(_dir, ec);
+}
@@ -0,0 +1,87 @@
+/**
+ * @file   unit/shard.hpp
+ * @date   19.10.2026
+ * @author Klemens D. Morgenstern
+ *
+
+ This header provides the parallel execution of test cases. The test binary is run in several debugger
+ instances, each of which only executes every n-th test case. The output of every case is collected in chunks,
+ which get merged back in the original order by the first instance.
+
+ */
+#ifndef METAL_UNIT_SHARD_HPP_
+#define METAL_UNIT_SHARD_HPP_
+
+#include <boost/filesystem/path.hpp>
+#include <boost/optional.hpp>
+#include <boost/process/child.hpp>
+
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+///The output of either a test case or the free tests between two cases.
+struct shard_chunk
+{
+    int position = 0; ///<Index of the test case, or the number of cases entered before the free chunk.
+    bool is_case = false;
+    int executed = 0;
+    int warnings = 0;
+    int errors   = 0;
+    std::string content;
+};
+
+class shard_t
+{
+    int _jobs  = 1;
+    int _index = 0;
+
+    std::ostringstream _buffer;
+    boost::optional<std::ofstream> _file;
+
+    std::vector<shard_chunk> _chunks;
+    std::vector<boost::process::child> _children;
+    std::vector<boost::filesystem::path> _files;
+    std::vector<boost::filesystem::path> _errors;
+    boost::filesystem::path _dir;
+
+    void _write(shard_chunk && chunk);
+    void _launch(const std::vector<std::string> & args);
+    ///The arguments of a worker, which writes the other outputs to its own file, suffixed with `.shard-<idx>`.
+    static std::vector<std::string> _worker_args(const std::vector<std::string> & args, int idx);
+    void _forward_errors(std::size_t idx, bool missing);
+public:
+    ///Returns true if the test cases are distributed over several debugger instances.
+    bool active() const {return _jobs > 1;}
+    ///The coordinator is the instance that launched the others and merges the results.
+    bool coordinator() const {return _index == 0;}
+    ///Check if the test case with the given index is executed by this instance.
+    bool owns(int case_index) const {return (case_index % _jobs) == _index;}
+
+    ///The stream the data sink writes into while sharding is active.
+    std::ostream & buffer() {return _buffer;}
+
+    /** Setup the shard. If this is the coordinator, the other instances will be launched.
+     *
+     * @param jobs The number of debugger instances.
+     * @param index The index of this instance.
+     * @param file The file the chunks are written to, empty for the coordinator.
+     * @param args The arguments of the runner, the other instances are launched with them.
+     */
+    void setup(int jobs, int index, const std::string & file, const std::vector<std::string> & args);
+
+    ///Close the output of the free tests, the workers discard it.
+    void close_free(int position);
+    ///Close the output of a test case.
+    void close_case(int position, int executed, int warnings, int errors);
+
+    ///Wait for all instances and return the chunks of all of them in order. Only valid for the coordinator.
+    std::vector<shard_chunk> collect();
+    ///Flush the chunk file, only needed for the workers.
+    void finish();
+
+    ~shard_t();
+};
+
+#endif /* METAL_UNIT_SHARD_HPP_ */
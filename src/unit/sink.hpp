@@ -9,6 +9,10 @@
 #ifndef SINK_HPP_
 #define SINK_HPP_
 
+#include "../sink/hrf_stream.hpp"
+
+#include <boost/optional.hpp>
+#include <cstdint>
 #include <ostream>
 
 enum class level_t
@@ -20,6 +24,8 @@ enum class level_t
 struct data_sink_t
 {
     virtual void start() = 0;
+    ///Write out everything that is buffered.
+    virtual void flush() = 0;
     virtual void cancel_main  (const std::string & file, int line, int executed, int warnings, int errors) = 0;
     virtual void continue_main(const std::string & file, int line, int executed, int warnings, int errors) = 0;
 
@@ -35,12 +41,17 @@ struct data_sink_t
 
     virtual void enter_case(const std::string & file, int line, const std::string & id) = 0;
     virtual void exit_case (const std::string & file, int line, const std::string & id, int executed, int warnings, int errors) = 0;
+    ///Duration of a test case, written before exit_case. The target ticks are only available if metal_timestamp is provided.
+    virtual void case_timing(const std::string & id, std::uint64_t host_us, const boost::optional<std::uint64_t> & target_ticks) = 0;
+    virtual void timestamp_unavailable() = 0;
 
     virtual void report (int free_executed, int free_warnings, int free_errors,
                          int executed, int warnings, int errors) = 0;
 
     virtual void log        (const std::string & file, int line, const std::string & id) = 0;
     virtual void checkpoint (const std::string & file, int line) = 0;
+    virtual void benchmark  (const std::string & file, int line, const std::string & name, const std::string & code,
+                             std::uint64_t iterations, std::uint64_t min, double mean, std::uint64_t max) = 0;
 
     virtual void message(const std::string & file, int line, bool condition, level_t lvl, bool critical, int index, const std::string & message) = 0;
     virtual void plain  (const std::string & file, int line, bool condition, level_t lvl, bool critical, int index, const std::string & message) = 0;
@@ -87,8 +98,8 @@ struct data_sink_t
     virtual void execute      (const std::string & file, int line, bool condition, level_t lvl, bool critical, int idx = 0) = 0;
 };
 
-data_sink_t * get_hrf_sink (std::ostream & os);
-data_sink_t * get_json_sink(std::ostream & os);
+data_sink_t * get_hrf_sink (std::ostream & os, const metal::sink::hrf_options & options = {});
+data_sink_t * get_json_sink(std::ostream & os, bool ndjson = false);
 
 
 #endif /* SINK_HPP_ */
@@ -309,6 +309,37 @@ TEST_CASE(recursion)
 
 }
 
+//simulates an interrupt, that runs in another context.
+unsigned long context = 0;
+unsigned long metal_calltrace_thread_id(void)
+{
+    return context;
+}
+
+void interrupted()
+{
+    foo();
+    context = 1;
+    foo();
+    context = 0;
+    bar();
+}
+
+TEST_CASE(threads)
+{
+    const void * arr[] = {&foo, &bar};
+    metal_calltrace ct = {&interrupted, arr, 2, 0, 0};
+
+    CHECK(metal_calltrace_init(&ct));
+
+    unwatched();
+    interrupted();
+    unwatched();
+
+    CHECK(metal_calltrace_success(&ct));
+    CHECK(metal_calltrace_deinit(&ct));
+}
+
 int main(int argc, const char* argv[])
 {
     simple();
@@ -316,5 +347,6 @@ int main(int argc, const char* argv[])
     nested();
     ovl();
     recursion();
+    threads();
     return errored;
 }
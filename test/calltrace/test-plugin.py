@@ -8,22 +8,30 @@ parser.add_argument('--root', metavar='R', type=str, # nargs='+',
 
 
 parser.add_argument('--calltrace')
+parser.add_argument('--decoder')
 parser.add_argument('--hrf_cmp_ts')
 parser.add_argument('--runner')
 parser.add_argument('--hrf_cmp')
 parser.add_argument('--plugin_test')
 parser.add_argument('--plugin_test_ts')
+parser.add_argument('--plugin_test_buffered')
+parser.add_argument('--plugin_test_target_check')
+parser.add_argument('--backend', default='gdb')
 
 args = parser.parse_args()
 
 plugin_test     = args.plugin_test
 plugin_test_ts  = args.plugin_test_ts
-runner          = args.runner
+plugin_test_buffered = args.plugin_test_buffered
+plugin_test_target_check = args.plugin_test_target_check
+runner          = [args.runner, "--backend=" + args.backend]
 calltrace       = args.calltrace
+decoder         = args.decoder
 hrf_cmp_file    = args.hrf_cmp
 hrf_cmp_ts_file = args.hrf_cmp_ts
 
 import subprocess
+import json
 
 cwd = os.getcwd();
 
@@ -32,7 +40,7 @@ root = os.path.normpath(str(args.root))
 print ("FILE      : " + os.path.realpath(__file__))
 print ("PWD       : " + os.getcwd())
 print ("CT        : " + calltrace)
-print ("RN        : " + runner)
+print ("RN        : " + " ".join(runner))
 print ("Plugin-Ts : " + plugin_test_ts)
 print ("Plugin    : " + plugin_test)
 print ("HRF-CMP   : " + hrf_cmp_file)
@@ -40,8 +48,8 @@ print ("HRF-CMP-ts: " + hrf_cmp_ts_file)
 
 errored = False
 
-plugin_test_ts_out = subprocess.check_output([runner, "--exe", plugin_test_ts, "--lib", calltrace, "--metal-calltrace-timestamp"]).decode()
-plugin_test_out    = subprocess.check_output([runner, "--exe", plugin_test,    "--lib", calltrace, "--metal-calltrace-timestamp"]).decode()
+plugin_test_ts_out = subprocess.check_output(runner + ["--exe", plugin_test_ts, "--lib", calltrace, "--metal-calltrace-timestamp"]).decode()
+plugin_test_out    = subprocess.check_output(runner + ["--exe", plugin_test,    "--lib", calltrace, "--metal-calltrace-timestamp"]).decode()
 
 
 import re
@@ -64,20 +72,106 @@ with open(hrf_cmp_file) as f:
         i+=1
 
 
-with open(hrf_cmp_ts_file) as f:
-    hrf_cmp_ts = f.read().splitlines()
+#the ptrace backend cannot call metal_timestamp(), so there are no timestamps.
+if args.backend != "ptrace":
+    with open(hrf_cmp_ts_file) as f:
+        hrf_cmp_ts = f.read().splitlines()
+        i = 1
+        for out, cmp in zip(plugin_test_ts_out, hrf_cmp_ts):
+            if not out.startswith(cmp):
+                print(hrf_cmp_ts_file + '(' + str(i) + '): Mismatch in comparison : "' + out + '" != "' + cmp + '"')
+                errored = True;
+            i+=1
+
+plugin_test_out    = subprocess.check_output(runner + ["--exe", plugin_test,    "--lib", calltrace, "--metal-calltrace-timestamp"]).decode()
+
+#the buffered calls must yield the same output
+if plugin_test_buffered:
+    plugin_test_buffered_out = subprocess.check_output(runner + ["--exe", plugin_test_buffered, "--lib", calltrace, "--metal-calltrace-timestamp"]).decode()
+    plugin_test_buffered_out = ts_regex.sub("with timestamp --timestamps--", hex_regex.sub("--hex--", plugin_test_buffered_out)).splitlines()
+
     i = 1
-    for out, cmp in zip(plugin_test_ts_out, hrf_cmp_ts):
+    for out, cmp in zip(plugin_test_buffered_out, hrf_cmp):
         if not out.startswith(cmp):
-            print(hrf_cmp_ts_file + '(' + str(i) + '): Mismatch in comparison : "' + out + '" != "' + cmp + '"')
-            errored = True;
+            print(hrf_cmp_file + '(' + str(i) + '): Mismatch in buffered comparison : "' + out + '" != "' + cmp + '"')
+            errored = True
         i+=1
 
-plugin_test_out    = subprocess.check_output([runner, "--exe", plugin_test,    "--lib", calltrace, "--metal-calltrace-timestamp"]).decode()
+    out = subprocess.check_output(runner + ["--exe", plugin_test_buffered, "--lib", calltrace,
+                                    "--metal-calltrace-format=json", "--metal-calltrace-depth=4"])
+    jsn = json.loads(out.decode())
+    if len(jsn["calls"]) != 14:
+        print ("Wrong number of buffered calls: " + str(len(jsn["calls"])))
+        errored = True
+
+
+#a second run with the symbol cache must not change the output
+import tempfile
+with tempfile.TemporaryDirectory() as cache_dir:
+    cached_out = []
+    for run in range(2):
+        out = subprocess.check_output(runner + ["--exe", plugin_test, "--lib", calltrace, "--metal-calltrace-binary", plugin_test,
+                                        "--metal-calltrace-symbol-cache", cache_dir, "--metal-calltrace-symbol-preload"]).decode()
+        cached_out.append(hex_regex.sub("--hex--", out).splitlines())
+
+    if len(os.listdir(cache_dir)) != 1:
+        print("Symbol cache not written: " + str(os.listdir(cache_dir)))
+        errored = True
+
+    if cached_out[0] != cached_out[1]:
+        print("Mismatch between the runs with the symbol cache")
+        errored = True
+
+
+#the binary format decoded to hrf must yield the same output as the hrf format.
+if decoder:
+    with tempfile.TemporaryDirectory() as bin_dir:
+        bin_file = os.path.join(bin_dir, "calltrace.bin")
+        subprocess.check_call(runner + ["--exe", plugin_test, "--lib", calltrace, "--metal-calltrace-timestamp",
+                                "--metal-calltrace-format=bin", "--metal-calltrace-sink", bin_file])
+        decoded_out = subprocess.check_output([decoder, bin_file, "--format=hrf"]).decode()
+        decoded_out = ts_regex.sub("with timestamp --timestamps--", hex_regex.sub("--hex--", decoded_out)).splitlines()
+
+        i = 1
+        for out, cmp in zip(decoded_out, hrf_cmp):
+            if not out.startswith(cmp):
+                print(hrf_cmp_file + '(' + str(i) + '): Mismatch in decoded comparison : "' + out + '" != "' + cmp + '"')
+                errored = True
+            i+=1
+
+
+#the target checks the calltraces itself, the results must be the same.
+target_check_out = subprocess.check_output(runner + ["--exe", plugin_test_target_check, "--lib", calltrace, "--metal-calltrace-target-check"]).decode()
+target_check_out = [l for l in hex_regex.sub("--hex--", target_check_out).splitlines() if "unregistered calltrace" in l]
+unregistered_cmp = [l for l in hrf_cmp if "unregistered calltrace" in l]
+
+if target_check_out != unregistered_cmp:
+    print("Mismatch in target check: " + str(target_check_out) + " != " + str(unregistered_cmp))
+    errored = True
+
+
+#the profile must contain the call graph of the functions that were called.
+profile = json.loads(subprocess.check_output(runner + ["--exe", plugin_test, "--lib", calltrace, "--metal-calltrace-all",
+                                               "--metal-calltrace-timestamp", "--metal-calltrace-format=profile-json"]).decode())
+profiled = dict((f["function"], f) for f in profile["functions"])
+if "foobar()" not in profiled or profiled["foobar()"]["calls"] < 1 or len(profile["edges"]) == 0:
+    print("Missing functions in profile: " + str(list(profiled.keys())))
+    errored = True
+
+
+#the chrome trace must have begin & end events for the calls.
+chrome = json.loads(subprocess.check_output(runner + ["--exe", plugin_test_ts, "--lib", calltrace, "--metal-calltrace-all",
+                                              "--metal-calltrace-timestamp", "--metal-calltrace-format=chrome",
+                                              "--metal-calltrace-tick-us=0.5"]).decode())
+begins = [e for e in chrome if e["ph"] == "B"]
+ends   = [e for e in chrome if e["ph"] == "E"]
+if len(begins) == 0 or len(ends) == 0 or "foobar()" not in [e["name"] for e in begins]:
+    print("Wrong events in chrome trace: " + str(len(begins)) + " begin, " + str(len(ends)) + " end")
+    errored = True
 
 
-min = subprocess.check_output([runner, "--exe", plugin_test, "--lib", calltrace, 
-                               "--metal-calltrace-timestamp", "--metal-calltrace-minimal", "--metal-calltrace-format=json"])
+min = subprocess.check_output(runner + ["--exe", plugin_test, "--lib", calltrace, 
+                                "--metal-calltrace-timestamp", "--metal-calltrace-minimal", "--metal-calltrace-format=json"])
 
 import json
 
@@ -128,20 +222,20 @@ compare(get_ptr(err[15]), addr[4])
 compare(get_ptr(err[16]), addr[5])
 
 
-out = subprocess.check_output([runner, "--exe", plugin_test, "--lib", calltrace, 
-                               "--metal-calltrace-timestamp", "--metal-calltrace-format=json", "--metal-calltrace-depth=3"])
+out = subprocess.check_output(runner + ["--exe", plugin_test, "--lib", calltrace, 
+                                "--metal-calltrace-timestamp", "--metal-calltrace-format=json", "--metal-calltrace-depth=3"])
 
 jsn = json.loads(out.decode())
 compare(len(jsn["calls"]), 10)
 
-out = subprocess.check_output([runner, "--exe", plugin_test, "--lib", calltrace, 
-                               "--metal-calltrace-timestamp", "--metal-calltrace-format=json", "--metal-calltrace-depth=4"])
+out = subprocess.check_output(runner + ["--exe", plugin_test, "--lib", calltrace, 
+                                "--metal-calltrace-timestamp", "--metal-calltrace-format=json", "--metal-calltrace-depth=4"])
 
 jsn = json.loads(out.decode())
 compare(len(jsn["calls"]), 14)
 
-out = subprocess.check_output([runner, "--exe", plugin_test, "--lib", calltrace, 
-                               "--metal-calltrace-timestamp", "--metal-calltrace-format=json", "--metal-calltrace-all"])
+out = subprocess.check_output(runner + ["--exe", plugin_test, "--lib", calltrace, 
+                                "--metal-calltrace-timestamp", "--metal-calltrace-format=json", "--metal-calltrace-all"])
 
 jsn = json.loads(out.decode())
 if len(jsn["calls"]) <= 14:
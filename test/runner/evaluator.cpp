@@ -0,0 +1,286 @@
+/**
+ * @file   /gdb-runner/test/evaluator.cpp
+ * @date   19.10.2026
+ * @author Klemens D. Morgenstern
+ *
+
+ The test of the `.debug_info` & `.eh_frame` readers and the expression evaluator of the ptrace backend.
+ The evaluator reads the initialized globals of evaluator_target from its sections, so it isn't run.
+
+ */
+
+#include "../../src/elf/call_frame.hpp"
+#include "../../src/elf/debug_info.hpp"
+#include "../../src/metal/ptrace/expression.hpp"
+
+#include <metal/debug/interpreter.hpp>
+
+#define BOOST_TEST_MODULE evaluator_test
+#define BOOST_TEST_NO_LIB
+
+#include <boost/test/included/unit_test.hpp>
+
+#include <algorithm>
+#include <map>
+#include <string>
+
+namespace elf = metal::elf;
+namespace pt  = metal::ptrace;
+
+struct section_target : pt::expression_target
+{
+    const elf::elf_file & file;
+    elf::debug_info & info;
+    std::map<std::uint64_t, std::uint8_t> written;
+
+    section_target(const elf::elf_file & file, elf::debug_info & info) : file(file), info(info) {}
+
+    std::vector<std::uint8_t> read_memory(std::uint64_t addr, std::size_t size) override
+    {
+        auto itr = std::find_if(file.sections().begin(), file.sections().end(),
+                                [&](const elf::section & s){return (s.address != 0u) && (s.address <= addr) && ((addr + size) <= (s.address + s.size));});
+        if (itr == file.sections().end())
+            throw metal::debug::interpreter_error("Cannot access memory at " + std::to_string(addr));
+
+        std::vector<std::uint8_t> res(size, 0u);
+        if (itr->type != 8u) //SHT_NOBITS, i.e. .bss
+        {
+            auto data = file.data(*itr);
+            std::copy(data.data + (addr - itr->address), data.data + (addr - itr->address) + size, res.begin());
+        }
+        for (std::size_t i = 0u; i < size; i++)
+        {
+            auto w = written.find(addr + i);
+            if (w != written.end())
+                res[i] = w->second;
+        }
+        return res;
+    }
+    void write_memory(std::uint64_t addr, const std::vector<std::uint8_t> &vec) override
+    {
+        for (auto c : vec)
+            written[addr++] = c;
+    }
+    std::uint64_t read_register(std::size_t) override
+    {
+        throw metal::debug::interpreter_error("No registers without a process.");
+    }
+    void write_register(std::size_t, std::uint64_t) override
+    {
+        throw metal::debug::interpreter_error("No registers without a process.");
+    }
+    boost::optional<pt::value> lookup(const std::string & id) override
+    {
+        auto gl = info.find_global(id);
+        if (!gl)
+            return boost::none;
+        pt::value res;
+        res.type = gl->type;
+        res.address = gl->address;
+        return res;
+    }
+};
+
+struct evaluator_fixture
+{
+    static const char * target()
+    {
+        using boost::unit_test::framework::master_test_suite;
+
+        BOOST_REQUIRE(master_test_suite().argc > 1);
+        return master_test_suite().argv[1];
+    }
+
+    elf::elf_file file{target()};
+    elf::debug_info info{file};
+    section_target tg{file, info};
+    pt::evaluator ev{info, tg};
+
+    std::string print(const std::string & expr, bool bitwise = false)
+    {
+        return ev.to_var(ev.evaluate(expr), bitwise).value;
+    }
+    std::string format(const std::string & expr)
+    {
+        return ev.format(ev.evaluate(expr));
+    }
+};
+
+BOOST_FIXTURE_TEST_SUITE(debug_info, evaluator_fixture)
+
+BOOST_AUTO_TEST_CASE(types)
+{
+    auto gl = info.find_global("global_segment");
+    BOOST_REQUIRE(gl);
+    BOOST_REQUIRE(gl->address);
+
+    auto & seg = info.type(info.resolve(gl->type));
+    BOOST_CHECK(seg.kind == elf::type_kind::structure);
+    BOOST_CHECK_EQUAL(seg.name, "segment");
+    BOOST_REQUIRE_EQUAL(seg.members.size(), 3u);
+    BOOST_CHECK_EQUAL(seg.members[0].name, "from");
+    BOOST_CHECK_EQUAL(seg.members[1].name, "to");
+    BOOST_CHECK_EQUAL(seg.members[2].name, "c");
+    BOOST_CHECK_EQUAL(seg.members[1].offset, 12u);
+    BOOST_CHECK_EQUAL(seg.members[2].offset, 24u);
+    BOOST_CHECK_EQUAL(info.size_of(gl->type), 28u);
+
+    auto & pnt = info.type(info.resolve(seg.members[0].type));
+    BOOST_REQUIRE_EQUAL(pnt.members.size(), 3u);
+    auto & name = info.type(info.resolve(pnt.members[2].type));
+    BOOST_CHECK(name.kind == elf::type_kind::array);
+    BOOST_CHECK_EQUAL(name.count, 4u);
+    BOOST_CHECK_EQUAL(pnt.members[2].offset, 6u);
+
+    auto & cl = info.type(info.resolve(seg.members[2].type));
+    BOOST_CHECK(cl.kind == elf::type_kind::enumeration);
+    BOOST_CHECK_EQUAL(cl.enumerators.size(), 3u);
+
+    auto en = info.find_enumerator("green");
+    BOOST_REQUIRE(en);
+    BOOST_CHECK_EQUAL(en->first, 4);
+    BOOST_CHECK_EQUAL(info.resolve(en->second), info.resolve(seg.members[2].type));
+
+    auto i = info.find_type("int");
+    BOOST_REQUIRE(i != elf::no_type);
+    BOOST_CHECK_EQUAL(info.type(i).encoding, elf::dw_ate_signed);
+    BOOST_CHECK_EQUAL(info.size_of(i), 4u);
+    BOOST_CHECK(info.find_type("no_such_type") == elf::no_type);
+
+    auto letter = info.find_global("letter");
+    BOOST_REQUIRE(letter);
+    BOOST_CHECK_EQUAL(info.type(info.resolve(letter->type)).encoding, elf::dw_ate_signed_char);
+
+    BOOST_CHECK(!info.find_global("argc"));
+}
+
+BOOST_AUTO_TEST_CASE(functions)
+{
+    auto syms = file.function_symbols();
+    auto itr = std::find_if(syms.begin(), syms.end(), [](const elf::symbol & s){return s.name == "main";});
+    BOOST_REQUIRE(itr != syms.end());
+
+    auto fn = info.find_function(itr->value + 1u);
+    BOOST_REQUIRE(fn);
+    BOOST_CHECK_EQUAL(fn->name, "main");
+    BOOST_CHECK_EQUAL(fn->low_pc, itr->value);
+    BOOST_REQUIRE_EQUAL(fn->parameters.size(), 2u);
+    BOOST_CHECK_EQUAL(fn->parameters[0].name, "argc");
+    BOOST_CHECK_EQUAL(fn->parameters[1].name, "argv");
+    BOOST_CHECK(fn->parameters[0].frame_offset);
+
+    BOOST_CHECK(!info.find_function(0u));
+}
+
+BOOST_AUTO_TEST_CASE(call_frames)
+{
+    elf::call_frame_info cfi{file};
+    BOOST_REQUIRE(!cfi.empty());
+
+    auto syms = file.function_symbols();
+    auto itr = std::find_if(syms.begin(), syms.end(), [](const elf::symbol & s){return s.name == "main";});
+    BOOST_REQUIRE(itr != syms.end());
+
+    //on entry the CFA is above the return address.
+    auto entry = cfi.rules(itr->value);
+    BOOST_CHECK_EQUAL(entry.cfa_register, 7u); //rsp
+    BOOST_CHECK_EQUAL(entry.cfa_offset, 8);
+
+    //after the prologue it's based on the frame pointer, which is saved right below the return address.
+    bool framed = false;
+    for (auto addr = itr->value; (addr < itr->value + itr->size) && !framed; addr++)
+    {
+        auto r = cfi.rules(addr);
+        framed = (r.cfa_register == 6u) && (r.cfa_offset == 16)
+              && std::any_of(r.saved.begin(), r.saved.end(),
+                             [](const elf::saved_register & s){return (s.reg == 6u) && (s.offset == -16);});
+    }
+    BOOST_CHECK(framed);
+
+    BOOST_CHECK_THROW(cfi.rules(0u), elf::elf_error);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_FIXTURE_TEST_SUITE(evaluator, evaluator_fixture)
+
+BOOST_AUTO_TEST_CASE(members)
+{
+    BOOST_CHECK_EQUAL(print("global_segment.from.x"), "1");
+    BOOST_CHECK_EQUAL(print("global_segment.from.y"), "-2");
+    BOOST_CHECK_EQUAL(print("global_segment.to.name"), "\"xy\"");
+    BOOST_CHECK_EQUAL(print("global_segment.c"), "green");
+    BOOST_CHECK_EQUAL(print("global_segment"),
+            "{from = {x = 1, y = -2, name = \"abc\"}, to = {x = 3, y = 4, name = \"xy\"}, c = green}");
+    BOOST_CHECK_EQUAL(print("(&global_segment)->to.x"), "3");
+    BOOST_CHECK_EQUAL(print("sizeof(global_segment)"), "28");
+
+    BOOST_CHECK_THROW(print("global_segment.z"), metal::debug::interpreter_error);
+}
+
+BOOST_AUTO_TEST_CASE(subscripts)
+{
+    BOOST_CHECK_EQUAL(print("numbers[2]"), "30");
+    BOOST_CHECK_EQUAL(print("numbers"), "{10, 20, 30, 40}");
+    BOOST_CHECK_EQUAL(print("numbers[1] + numbers[2] * 2"), "80");
+    BOOST_CHECK_EQUAL(print("*(numbers + 3)"), "40");
+    BOOST_CHECK_EQUAL(print("global_segment.from.name[1]"), "98");
+    BOOST_CHECK_EQUAL(ev.as_integer(ev.evaluate("&numbers[3]")) - ev.as_integer(ev.evaluate("&numbers[0]")), 12u);
+
+    BOOST_CHECK_THROW(print("numbers["), metal::debug::interpreter_error);
+}
+
+BOOST_AUTO_TEST_CASE(casts)
+{
+    BOOST_CHECK_EQUAL(print("(unsigned char)-1"), "255");
+    BOOST_CHECK_EQUAL(print("(short)70000"), "4464");
+    BOOST_CHECK_EQUAL(print("(int)2.75"), "2");
+    BOOST_CHECK_EQUAL(print("(double)numbers[0] / 4"), "2.5");
+    BOOST_CHECK_EQUAL(print("(colour)5"), "blue");
+    BOOST_CHECK_EQUAL(print("(colour)7"), "7");
+    BOOST_CHECK_EQUAL(print("*(short*)&global_segment.from.y"), "-2");
+
+    BOOST_CHECK_THROW(print("(no_such_type)1"), metal::debug::interpreter_error);
+}
+
+BOOST_AUTO_TEST_CASE(output_format)
+{
+    //a char is printed with its literal, but the variable only has the number, as with gdb.
+    BOOST_CHECK_EQUAL(format("letter"), "65 'A'");
+    BOOST_CHECK_EQUAL(print("letter"), "65");
+    BOOST_CHECK_EQUAL(format("byte"), "214 '\\326'");
+    BOOST_CHECK_EQUAL(print("byte"), "214");
+
+    BOOST_CHECK_EQUAL(print("ratio"), "0.5");
+    BOOST_CHECK_EQUAL(print("flag"), "true");
+    BOOST_CHECK_EQUAL(print("zeroed"), "0");
+    BOOST_CHECK_EQUAL(print("'\\n'"), "10");
+
+    BOOST_CHECK_EQUAL(print("numbers[0]", true), "1010");
+    BOOST_CHECK_EQUAL(print("0b101", true), "101");
+    BOOST_CHECK_EQUAL(print("0x10"), "16");
+    BOOST_CHECK_EQUAL(print("global_segment.from.y", true), "1111111111111110");
+
+    auto ptr = ev.to_var(ev.evaluate("&numbers[1]"));
+    BOOST_CHECK_EQUAL(ptr.value.substr(0, 2), "0x");
+    BOOST_CHECK_EQUAL(std::stoull(ptr.value, nullptr, 16), ev.as_integer(ev.evaluate("&numbers[0]")) + 4u);
+}
+
+BOOST_AUTO_TEST_CASE(assignment)
+{
+    ev.assign(ev.evaluate("numbers[0]"), ev.evaluate("42"));
+    BOOST_CHECK_EQUAL(print("numbers[0]"), "42");
+    BOOST_CHECK_EQUAL(print("numbers[1]"), "20");
+
+    ev.assign(ev.evaluate("global_segment.c"), ev.evaluate("red"));
+    BOOST_CHECK_EQUAL(print("global_segment.c"), "red");
+}
+
+BOOST_AUTO_TEST_CASE(unsupported)
+{
+    BOOST_CHECK_THROW(print("no_such_variable"), metal::debug::interpreter_error);
+    BOOST_CHECK_THROW(print("main()"), metal::debug::interpreter_error);
+    BOOST_CHECK_THROW(print("argc"), metal::debug::interpreter_error);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
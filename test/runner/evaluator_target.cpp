@@ -0,0 +1,30 @@
+//the globals read by the evaluator test from the sections of the binary, without running it.
+
+enum colour {red, green = 4, blue};
+
+struct point
+{
+    int x;
+    short y;
+    char name[4];
+};
+
+struct segment
+{
+    point from;
+    point to;
+    colour c;
+};
+
+segment global_segment = {{1, -2, "abc"}, {3, 4, "xy"}, green};
+int numbers[4] = {10, 20, 30, 40};
+char letter = 'A';
+unsigned char byte = 214;
+double ratio = 0.5;
+bool flag = true;
+int zeroed;
+
+int main(int argc, char * argv[])
+{
+    return global_segment.from.x + numbers[0] + letter + byte + static_cast<int>(ratio) + flag + zeroed - 77;
+}
@@ -53,11 +53,26 @@ struct f_ret : break_point
     }
 };
 
+struct h_outer : break_point
+{
+    h_outer() : break_point("h()")
+    {
+
+    }
+    void invoke(frame & fr, const std::string & file, int line) override
+    {
+        std::cerr << file << "(" << line << "): " << "h()" << std::endl;
+        fr.select(1);
+        fr.return_();
+    }
+};
+
 void metal_dbg_setup_bps(std::vector<std::unique_ptr<metal::debug::break_point>> & bps)
 {
     bps.push_back(std::make_unique<f_ptr>());
     bps.push_back(std::make_unique<f_ref>());
     bps.push_back(std::make_unique<f_ret>());
+    bps.push_back(std::make_unique<h_outer>());
 };
 
 
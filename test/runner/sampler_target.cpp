@@ -0,0 +1,17 @@
+#include <chrono>
+
+volatile int counter = 0;
+
+void spin()
+{
+    for (int i = 0; i < 1000; i++)
+        counter++;
+}
+
+int main(int argc, char * argv[])
+{
+    auto end = std::chrono::steady_clock::now() + std::chrono::milliseconds(500);
+    while (std::chrono::steady_clock::now() < end)
+        spin();
+    return 0;
+}
@@ -22,6 +22,24 @@ void f(int * p)
 
 int f() {return 0;}
 
+void h() {}
+
+//the plugin returns from this frame, so the registers it clobbered need to be restored from where it saved them.
+void clobber()
+{
+    asm volatile("xor %%ebx, %%ebx\n\txor %%r12d, %%r12d\n\txor %%r13d, %%r13d" ::: "rbx", "r12", "r13");
+    h();
+}
+
+//keeps the values in callee-saved registers over the call.
+__attribute__((noinline, optimize("O2", "no-omit-frame-pointer"))) long keep(long v)
+{
+    long a = v * 3;
+    long b = v + 5;
+    clobber();
+    return a + b + v;
+}
+
 int main(int argc, char * argv[])
 {
     int value = 0;
@@ -42,6 +60,9 @@ int main(int argc, char * argv[])
     if (f() != 42)
         error |= 0b10000;
 
+    if (keep(10) != 55)
+        error |= 0b100000;
+
     return error;
 }
 
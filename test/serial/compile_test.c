@@ -77,7 +77,18 @@ int main(int argc, char ** args)
     return 0;
 }
 
+#if defined(METAL_SERIAL_BLOCK_WRITE)
+
+void write_metal_serial_block(const void * data, size_t size)
+{
+    fwrite(data, 1, size, file_ptr);
+}
+
+#else
+
 void  write_metal_serial(char c)
 {
     putc(c, file_ptr);
-}
\ No newline at end of file
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,61 @@
+/**
+ * @file   profile_test.cpp
+ * @date   19.10.2026
+ * @author Klemens D. Morgenstern
+ *
+ */
+
+#include <metal/serial.hpp>
+#include <cstdio>
+
+FILE * file_ptr;
+
+//the clock only advances in work, so the durations are known. It wraps around during the test.
+static std::uint32_t now = 0xFFFFFF00u;
+
+std::uint32_t metal_serial_timestamp(void)
+{
+    return now;
+}
+
+void work(std::uint32_t ticks)
+{
+    now += ticks;
+}
+
+void inner(int i)
+{
+    METAL_SERIAL_PROFILE_SCOPE(inner);
+    work(10 + i);
+    if (i % 2)
+        return;
+    work(0);
+}
+
+int main(int argc, char ** argv)
+{
+    if (argc > 1)
+        file_ptr = std::fopen(argv[1], "w");
+    else
+        file_ptr = stdout;
+
+    METAL_SERIAL_INIT();
+
+    for (int i = 0; i < 10; i++)
+    {
+        METAL_SERIAL_PROFILE_BEGIN(outer);
+        work(100);
+        inner(i);
+        METAL_SERIAL_PROFILE_END(outer);
+    }
+
+    METAL_SERIAL_EXIT(0);
+
+    std::fclose(file_ptr);
+    return 0;
+}
+
+void  write_metal_serial(char c)
+{
+    std::putc(c, file_ptr);
+}
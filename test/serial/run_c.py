@@ -10,6 +10,9 @@ parser = argparse.ArgumentParser(description='Test script')
 parser.add_argument('--serial')
 parser.add_argument('--source-dir')
 parser.add_argument('--exe')
+parser.add_argument('--comparison', default='c.out')
+parser.add_argument('--live', choices=['fifo', 'pty', 'tcp'], help='pass the output through a live input, instead of stdin')
+parser.add_argument('--parallel', type=int, default=0, help='decode this many copies of the output at once')
 
 args = parser.parse_args()
 
@@ -44,17 +47,99 @@ with tempfile.NamedTemporaryFile() as temp_json:
     assert proc.returncode == 0
 
 
-hrf_proc  = subprocess.Popen([serial, exe, source_dir], stdin=subprocess.PIPE, stdout=subprocess.PIPE, stderr=subprocess.STDOUT)
-hrf_proc.stdin.write(bin_output)
-out, err = hrf_proc.communicate()
+def run_live(kind):
+    import socket
+    import time
+
+    tmp_dir = tempfile.mkdtemp()
+    extra = []
+    if kind == 'fifo':
+        path = os.path.join(tmp_dir, 'serial.fifo')
+        os.mkfifo(path)
+        extra = ["--input=" + path]
+    elif kind == 'pty':
+        import pty
+        import tty
+        master, slave = pty.openpty()
+        #data written before metal.serial configures the device, would otherwise pass the line discipline.
+        tty.setraw(slave)
+        extra = ["--input=" + os.ttyname(slave), "--baud-rate=115200"]
+    else:
+        #let the os pick a free port, so parallel tests don't collide.
+        probe = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
+        probe.bind(('127.0.0.1', 0))
+        port = probe.getsockname()[1]
+        probe.close()
+        extra = ["--listen=%d" % port]
+
+    proc = subprocess.Popen([serial, exe, source_dir, "--input-timeout=5000"] + extra, stdout=subprocess.PIPE, stderr=subprocess.STDOUT)
+
+    #written in chunks, so the records arrive split up.
+    def write_chunks(write):
+        for i in range(0, len(bin_output), 37):
+            write(bin_output[i:i+37])
+            time.sleep(0.005)
+
+    if kind == 'fifo':
+        with open(path, 'wb', buffering=0) as fifo:
+            write_chunks(fifo.write)
+    elif kind == 'pty':
+        write_chunks(lambda data: os.write(master, data))
+    else:
+        for i in range(100):
+            try:
+                sock = socket.create_connection(('127.0.0.1', port))
+                break
+            except ConnectionRefusedError:
+                time.sleep(0.05)
+        write_chunks(sock.sendall)
+        sock.close()
+
+    out, err = proc.communicate()
+    return proc, out
+
+
+comparison = open(os.path.join(os.path.dirname(__file__), args.comparison)).read().splitlines()
+
+def compare(output, comparison=comparison):
+    for c, m in zip(comparison, output):
+        if not m.endswith(c):
+            print ("Line mismatch: ", c, m)
+            sys.exit(1)
+
+if args.parallel:
+    tmp_dir = tempfile.mkdtemp()
+    inputs = []
+    for i in range(args.parallel):
+        inputs.append(os.path.join(tmp_dir, 'input%d.bin' % i))
+        open(inputs[-1], 'wb').write(bin_output)
+
+    proc = subprocess.Popen([serial, exe, source_dir, "--output-dir", tmp_dir, "--input"] + inputs, stdout=subprocess.PIPE)
+    out, err = proc.communicate()
+    summary = out.decode().splitlines()
+    if proc.returncode != 42 or len(summary) != args.parallel + 1:
+        print ("Summary mismatch: ", proc.returncode, summary)
+        sys.exit(1)
+
+    #the outputs contain what's written to stdout, i.e. without the first & last line.
+    for i in range(args.parallel):
+        assert summary[i].startswith(inputs[i] + " -> ")
+        assert summary[i].endswith(": exit code 42, 17 executed, 4 errors, 4 warnings")
+        output = open(inputs[i] + ".out").read().splitlines()
+        assert len(output) == len(comparison) - 2
+        compare(output, comparison[1:-1])
+    sys.exit(0)
+
+if args.live:
+    hrf_proc, out = run_live(args.live)
+else:
+    hrf_proc  = subprocess.Popen([serial, exe, source_dir], stdin=subprocess.PIPE, stdout=subprocess.PIPE, stderr=subprocess.STDOUT)
+    hrf_proc.stdin.write(bin_output)
+    out, err = hrf_proc.communicate()
 
 assert hrf_proc.returncode == 42
 #comparison
-comparison = open(os.path.join(os.path.dirname(__file__), "c.out")).read().splitlines()
-for c, m in zip(comparison, out.decode().splitlines()):
-    if not m.endswith(c):
-        print ("Line mismatch: ", c, m)
-        sys.exit(1)
+compare(out.decode().splitlines())
 
 
 sys.exit(0)
\ No newline at end of file
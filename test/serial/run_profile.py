@@ -0,0 +1,48 @@
+import argparse
+import json
+import os
+import sys
+import tempfile
+import os.path
+import subprocess
+
+parser = argparse.ArgumentParser(description='Test script')
+
+parser.add_argument('--serial')
+parser.add_argument('--source-dir')
+parser.add_argument('--exe')
+
+args = parser.parse_args()
+
+exe = args.exe
+source_dir = args.source_dir
+serial = args.serial
+
+print (exe, serial)
+
+bin_output = subprocess.check_output([exe], stderr=subprocess.STDOUT)
+
+def run(*extra):
+    proc = subprocess.Popen([serial, exe, source_dir] + list(extra), stdin=subprocess.PIPE, stdout=subprocess.PIPE, stderr=subprocess.STDOUT)
+    out, err = proc.communicate(bin_output)
+    output = out.decode().splitlines()
+    if proc.returncode != 0:
+        print ("Exit code mismatch: ", proc.returncode, output)
+        sys.exit(1)
+    assert output[0].startswith("Initializing metal serial from")
+    return output[1:]
+
+comparison = open(os.path.join(os.path.dirname(__file__), 'profile.out')).read().splitlines()
+assert run() == comparison
+
+assert run("--metal-profile-format", "folded") == [comparison[0], "outer 1000", "outer;inner 145"]
+
+with tempfile.NamedTemporaryFile() as temp_json:
+    run("--metal-profile-format", "json", "--metal-profile-sink", temp_json.name)
+    regions = json.load(open(temp_json.name))["regions"]
+
+    assert [r["region"] for r in regions] == ["outer", "inner"]
+    assert regions[1] == {"region": "inner", "count": 10, "total": 145, "min": 10, "mean": 14,
+                          "p50": 14, "p90": 18, "p99": 19, "max": 19}
+
+sys.exit(0)
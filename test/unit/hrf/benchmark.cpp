@@ -0,0 +1,17 @@
+#define METAL_UNIT_TIMESTAMP
+#include <metal/unit>
+
+//every call advances the clock by one tick, so each iteration takes exactly one tick.
+extern "C" __metal_ticks_t metal_timestamp()
+{
+    static __metal_ticks_t ticks = 0;
+    return ticks++;
+}
+
+int main(int argc, char * argv[])
+{
+    int value = 0;
+    METAL_BENCHMARK("increment", 100, value++);
+    METAL_EXPECT_EQUAL(value, 100);
+    return METAL_REPORT();
+}
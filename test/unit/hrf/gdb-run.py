@@ -13,6 +13,9 @@ parser.add_argument('--return_code', metavar='R', type=int,
                     help="Expected return code")
 parser.add_argument('--runner', type=str)
 parser.add_argument('--unit', type=str)
+parser.add_argument('--jobs', type=int, default=1)
+parser.add_argument('--backend', type=str, default='gdb')
+parser.add_argument('--timing', action='store_true', help='measure the test cases, the host duration is masked')
 
 
 parser.add_argument('bin', nargs='*', help='binaries!')
@@ -34,12 +37,22 @@ print ("FILE " + os.path.realpath(__file__))
 print ("PWD  " + os.getcwd())
 
 #(GDB-RUNNER) --gdb $(GDB) --exe F:\mwspace\test\unit\test\hrf\bin\custom_test\empty_test\empty_test.exe --lib F:\mwspace\test\bin\debug\libmw-test-unit.dll $(RFLAGS) > F:\mwspace\test\unit\test\hrf\bin\custom_test\empty_test\empty_test.run
-process = subprocess.Popen([runner, "--exe", exe, "--lib", unit],
-                           stdout=subprocess.PIPE, stderr=subprocess.STDOUT)
+cmd = [runner, "--backend=" + args.backend, "--exe", exe, "--lib", unit]
+if args.jobs > 1:
+    cmd += ["--metal-test-jobs", str(args.jobs)]
+if args.timing:
+    cmd += ["--metal-test-timing"]
+
+process = subprocess.Popen(cmd, stdout=subprocess.PIPE, stderr=subprocess.STDOUT)
 
 
 make_out = process.communicate()[0].decode().splitlines()
 
+if args.timing:
+    import re
+    host_regex = re.compile(r"host : \d+us")
+    make_out = [host_regex.sub("host : --us", line) for line in make_out]
+
 result = 0
 
 file_content = None;
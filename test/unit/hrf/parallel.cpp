@@ -0,0 +1,25 @@
+#include <metal/unit>
+
+void first()
+{
+    METAL_ASSERT(true);
+}
+
+void second()
+{
+    METAL_ASSERT(false);
+}
+
+void third()
+{
+    METAL_EXPECT(false);
+}
+
+int main(int argc, char * argv[])
+{
+    METAL_CALL(first,  "first case");
+    METAL_EXPECT(true);
+    METAL_CALL(second, "second case");
+    METAL_CALL(third,  "third case");
+    return METAL_REPORT();
+}
@@ -0,0 +1,20 @@
+#define METAL_UNIT_TIMESTAMP
+#include <metal/unit>
+
+//every call advances the clock by one tick, so each test case takes exactly one tick.
+extern "C" __metal_ticks_t metal_timestamp()
+{
+    static __metal_ticks_t ticks = 0;
+    return ticks++;
+}
+
+void func()
+{
+    METAL_ASSERT(true);
+}
+
+int main(int argc, char * argv[])
+{
+    METAL_CALL(func, "timed case");
+    return METAL_REPORT();
+}
@@ -0,0 +1,12 @@
+#include <metal/unit>
+
+void func()
+{
+    METAL_ASSERT(true);
+}
+
+int main(int argc, char * argv[])
+{
+    METAL_CALL(func, "timed case");
+    return METAL_REPORT();
+}
@@ -0,0 +1,55 @@
+import argparse
+import os
+import sys
+
+parser = argparse.ArgumentParser(description='Test script')
+parser.add_argument('--root', metavar='R', type=str,
+                    help='the source directory')
+parser.add_argument('--exe', metavar='E', type=str, 
+                    help="The stem name of the executable to test")
+
+parser.add_argument('--runner')
+parser.add_argument('--unit')
+
+args = parser.parse_args()
+
+exe = args.exe;
+runner = args.runner;
+unit = args.unit;
+
+import subprocess
+
+print (exe, unit)
+
+output = subprocess.check_output([runner, "--exe", exe, "--lib", unit, "--metal-test-format", "ndjson", "--metal-test-no-exit-code"], stderr=subprocess.STDOUT)
+
+import json
+
+#every line is a separate event
+events = [json.loads(line) for line in output.decode().splitlines() if line.startswith('{')]
+
+assert events[0]["type"] == "execute_check"
+assert events[0]["line"] == 195
+assert events[1]["type"] == "execute_check"
+assert events[1]["line"] == 196
+
+assert events[2]["type"] == "enter_case"
+assert events[2]["id"] == "equal test"
+assert events[2]["line"] == 198
+
+exit_case = next(ev for ev in events if ev["type"] == "exit_case")
+assert exit_case["summary"]["executed"] == 8
+assert exit_case["summary"]["warnings"] == 3
+assert exit_case["summary"]["errors"]   == 2
+assert exit_case["result"] == "exit"
+
+report = events[-1]
+assert report["type"] == "report"
+
+assert report["free_tests"]["executed"] == 4
+assert report["free_tests"]["warnings"] == 1
+assert report["free_tests"]["errors"] == 1
+
+assert report["summary"]["warnings"] == 21
+assert report["summary"]["executed"] == 71
+assert report["summary"]["errors"] == 20